@@ -3,8 +3,6 @@
 
 Display::Display(std::string title, int width, int height)
 {
-    SDL_WarpMouseInWindow(gGraphicsApplicationWindow, getScreenWidth()/2, getScreenHeight()/2);
-
     title = title;
     screenWidth = width;
     screenHeight = height;
@@ -12,6 +10,18 @@ Display::Display(std::string title, int width, int height)
     gOpenGLContext = nullptr;
     gQuit = false;
 
+    mInputMap.Bind(SDL_SCANCODE_UP, INPUT_ACTION_MOVE_FORWARD);
+    mInputMap.Bind(SDL_SCANCODE_W, INPUT_ACTION_MOVE_FORWARD);
+    mInputMap.Bind(SDL_SCANCODE_DOWN, INPUT_ACTION_MOVE_BACKWARD);
+    mInputMap.Bind(SDL_SCANCODE_S, INPUT_ACTION_MOVE_BACKWARD);
+    mInputMap.Bind(SDL_SCANCODE_LEFT, INPUT_ACTION_MOVE_LEFT);
+    mInputMap.Bind(SDL_SCANCODE_A, INPUT_ACTION_MOVE_LEFT);
+    mInputMap.Bind(SDL_SCANCODE_RIGHT, INPUT_ACTION_MOVE_RIGHT);
+    mInputMap.Bind(SDL_SCANCODE_D, INPUT_ACTION_MOVE_RIGHT);
+    mInputMap.Bind(SDL_SCANCODE_F1, INPUT_ACTION_TOGGLE_HUD);
+    mInputMap.Bind(SDL_SCANCODE_F2, INPUT_ACTION_TOGGLE_OVERDRAW);
+    mInputMap.Bind(SDL_SCANCODE_F3, INPUT_ACTION_TOGGLE_DEPTH_PREPASS);
+
     Display::InitializeProgram();
 }
 
@@ -33,6 +43,8 @@ void Display::InitializeProgram()
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
     SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
     SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, 24);
+    /* The overdraw view counts fragments in the stencil buffer */
+    SDL_GL_SetAttribute(SDL_GL_STENCIL_SIZE, 8);
 
     /* Create an application window using OpenGL that supports SDL. */
     gGraphicsApplicationWindow = SDL_CreateWindow(title.c_str(), 30, 30, screenWidth, screenHeight, 
@@ -44,6 +56,13 @@ void Display::InitializeProgram()
         exit(1);
     }
 
+    /* Hide the cursor and report raw relative motion, the camera turns
+       with the mouse without ever hitting the edge of the window */
+    if ( SDL_SetRelativeMouseMode(SDL_TRUE) < 0 )
+    {
+        std::cout << "Relative mouse mode not available: " << SDL_GetError() << std::endl;
+    }
+
     /* Create an OpenGL Graphics Context */
     gOpenGLContext = SDL_GL_CreateContext(gGraphicsApplicationWindow);
 
@@ -76,11 +95,8 @@ void Display::CleanUp()
     SDL_Quit();
 }
 
-void Display::Input(Camera* camera)
+void Display::PollEvents()
 {
-    static int mouseX = getScreenWidth()/2;
-    static int mouseY = getScreenHeight()/2;
-
     SDL_Event e;
 
     while ( SDL_PollEvent(&e) != 0 )
@@ -90,39 +106,156 @@ void Display::Input(Camera* camera)
             std::cout << "Goodbye!" << std::endl;
             gQuit = true;
         }
-        
+
+        // Escape always quits, also in the middle of a replay
+        if (e.type == SDL_KEYDOWN && e.key.keysym.scancode == SDL_SCANCODE_ESCAPE)
+        {
+            gQuit = true;
+        }
+
+        // A replay ignores the live input, except for quitting
+        if (mInputRecorder != nullptr && mInputRecorder->IsReplaying())
+        {
+            continue;
+        }
+
+        InputEvent event;
+        event.timestamp = e.common.timestamp;
+
         if (e.type == SDL_MOUSEMOTION)
         {
-            mouseX += e.motion.xrel;
-            mouseY += e.motion.yrel;
-            camera->MouseLook(mouseX, mouseY);
+            event.type = INPUT_EVENT_MOUSE_MOTION;
+            event.x = (short) e.motion.xrel;
+            event.y = (short) e.motion.yrel;
+            mPendingEvents.push_back(event);
+        }
+        else if ((e.type == SDL_KEYDOWN || e.type == SDL_KEYUP) && e.key.repeat == 0)
+        {
+            event.type = e.type == SDL_KEYDOWN ? INPUT_EVENT_KEY_DOWN : INPUT_EVENT_KEY_UP;
+            event.x = (short) e.key.keysym.scancode;
+            mPendingEvents.push_back(event);
         }
     }
 
-    gRotate += 0.001f;
+    // What is held once the events are in, so a key that went down before
+    // a recording started (or outside the window) still counts. A replay
+    // replaces it with the recorded state.
+    int keyCount = 0;
+    const Uint8* state = SDL_GetKeyboardState(&keyCount);
+    mInputFrame.keys.assign(state, state + keyCount);
 
-    // Retrieve keyboard state
-    const Uint8 *state = SDL_GetKeyboardState(NULL);
+    mSampleCounter = SDL_GetPerformanceCounter();
+}
+
+void Display::Input(Camera* camera, float stepSeconds)
+{
+    // Only the first step of a frame gets the events, the ones after it
+    // just keep moving with the held actions
+    mInputFrame.events.swap(mPendingEvents);
+    mPendingEvents.clear();
 
-    if (state[SDL_SCANCODE_UP]) {
-        camera->MoveForward(speed);
+    if (mInputRecorder != nullptr && mInputRecorder->IsReplaying())
+    {
+        // The end of the recording ends the run
+        if (!mInputRecorder->ReplayStep(mInputFrame))
+        {
+            gQuit = true;
+            return;
+        }
     }
+    else
+    {
+        if (mInputRecorder != nullptr && mInputRecorder->IsRecording())
+        {
+            mInputRecorder->RecordStep(mInputFrame);
+        }
+
+        if (!mInputFrame.events.empty() && mUnsubmittedEvents == 0)
+        {
+            mOldestEventTimestamp = mInputFrame.events[0].timestamp;
+        }
 
-    if (state[SDL_SCANCODE_RIGHT]) {
-        camera->MoveRight(speed);
+        mUnsubmittedEvents += (unsigned int) mInputFrame.events.size();
     }
 
-    if (state[SDL_SCANCODE_LEFT]) {
-        camera->MoveLeft(speed);
+    mInputMap.Process(mInputFrame);
+
+    float lookX = mInputMap.GetAxis(INPUT_AXIS_LOOK_X);
+    float lookY = mInputMap.GetAxis(INPUT_AXIS_LOOK_Y);
+
+    if (lookX != 0.0f || lookY != 0.0f)
+    {
+        camera->MouseLook(lookX, lookY);
     }
 
-    if (state[SDL_SCANCODE_DOWN]) {
-        camera->MoveBackward(speed);
+    if (mInputMap.GetPresses(INPUT_ACTION_TOGGLE_HUD) % 2 == 1)
+    {
+        showHud = !showHud;
     }
 
-    if (state[SDL_SCANCODE_ESCAPE]) {
-        gQuit = true;
+    if (mInputMap.GetPresses(INPUT_ACTION_TOGGLE_OVERDRAW) % 2 == 1)
+    {
+        showOverdraw = !showOverdraw;
     }
+
+    if (mInputMap.GetPresses(INPUT_ACTION_TOGGLE_DEPTH_PREPASS) % 2 == 1)
+    {
+        depthPrePass = !depthPrePass;
+    }
+
+    gRotate += rotateSpeed * stepSeconds;
+
+    float distance = speed * stepSeconds;
+
+    if (mInputMap.IsHeld(INPUT_ACTION_MOVE_FORWARD)) {
+        camera->MoveForward(distance);
+    }
+
+    if (mInputMap.IsHeld(INPUT_ACTION_MOVE_RIGHT)) {
+        camera->MoveRight(distance);
+    }
+
+    if (mInputMap.IsHeld(INPUT_ACTION_MOVE_LEFT)) {
+        camera->MoveLeft(distance);
+    }
+
+    if (mInputMap.IsHeld(INPUT_ACTION_MOVE_BACKWARD)) {
+        camera->MoveBackward(distance);
+    }
+}
+
+void Display::DiscardEvents()
+{
+    mPendingEvents.clear();
+}
+
+void Display::MarkSubmitted()
+{
+    Uint64 now = SDL_GetPerformanceCounter();
+
+    mInputLatency.sampleToSubmitMilliseconds = (now - mSampleCounter) * 1000.0 / SDL_GetPerformanceFrequency();
+    mInputLatency.events = mUnsubmittedEvents;
+    mInputLatency.eventToSubmitMilliseconds = 0.0;
+
+    if (mUnsubmittedEvents > 0)
+    {
+        // Event time stamps only come in whole milliseconds
+        unsigned int ticks = SDL_GetTicks();
+        mInputLatency.eventToSubmitMilliseconds = ticks >= mOldestEventTimestamp
+                                                  ? (double) (ticks - mOldestEventTimestamp) : 0.0;
+    }
+
+    mUnsubmittedEvents = 0;
+}
+
+const InputLatency& Display::getInputLatency() const
+{
+    return mInputLatency;
+}
+
+void Display::SetInputRecorder(InputRecorder* recorder)
+{
+    mInputRecorder = recorder;
 }
 
 std::string Display::getScreenTitle() const
@@ -157,6 +290,26 @@ bool Display::getGQuit() const
     return gQuit;
 }
 
+bool Display::getShowHud() const
+{
+    return showHud;
+}
+
+bool Display::getShowOverdraw() const
+{
+    return showOverdraw;
+}
+
+bool Display::getDepthPrePass() const
+{
+    return depthPrePass;
+}
+
+void Display::SetDepthPrePass(bool enabled)
+{
+    depthPrePass = enabled;
+}
+
 SDL_GLContext Display::getOpenGLContext() const
 {
     return gOpenGLContext;
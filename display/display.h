@@ -7,6 +7,8 @@
 #include <string>
 
 #include "Camera.hpp"
+#include "InputMap.hpp"
+#include "InputRecorder.hpp"
 
 // C++ standard template library (STL)
 #include <iostream>
@@ -17,24 +19,57 @@ class Display
         std::string title;
         int screenHeight;
         int screenWidth;
-        float speed = 0.001f;
+        // Per second of simulated time
+        float speed = 0.06f;
+        float rotateSpeed = 0.06f;
 
         float uOffset = -2.0f;
         float gRotate = 0.0f;
         float gScale = 0.75f;
         
         bool gQuit;
+        // Performance overlay, toggled with F1
+        bool showHud = false;
+        // Overdraw heat map instead of the scene, toggled with F2
+        bool showOverdraw = false;
+        // F3 switches the depth pre-pass on and off
+        bool depthPrePass = true;
         
         SDL_Window* gGraphicsApplicationWindow;
         SDL_GLContext gOpenGLContext;
 
+        // Events polled since the last simulation step
+        std::vector<InputEvent> mPendingEvents;
+        InputFrame mInputFrame;
+        InputMap mInputMap;
+        InputRecorder* mInputRecorder = nullptr;
+
+        // Live input consumed since the last submission, for the latency
+        Uint64 mSampleCounter = 0;
+        unsigned int mOldestEventTimestamp = 0;
+        unsigned int mUnsubmittedEvents = 0;
+        InputLatency mInputLatency;
+
     public:
         Display(std::string title, int width, int height);
 
         void GetOpenGLVersionInfo();
         void InitializeProgram();
         void CleanUp();
-        void Input(Camera* camera);
+
+        // Once per frame, as late as possible before drawing: drains the
+        // SDL event queue, then samples the keyboard state
+        void PollEvents();
+        // Once per fixed simulation step: maps the events since the previous
+        // step to actions and applies them to the camera, recording them or
+        // taking them from the replay instead
+        void Input(Camera* camera, float stepSeconds);
+        // For frames that take no input steps at all, e.g. a benchmark
+        void DiscardEvents();
+        // Right before the frame goes to the GPU, completes the latency
+        void MarkSubmitted();
+        const InputLatency& getInputLatency() const;
+        void SetInputRecorder(InputRecorder* recorder);
 
         std::string getScreenTitle() const;
         int getScreenHeight() const;
@@ -43,6 +78,10 @@ class Display
         float getGRotate() const;
         float getGScale() const;
         bool getGQuit() const;
+        bool getShowHud() const;
+        bool getShowOverdraw() const;
+        bool getDepthPrePass() const;
+        void SetDepthPrePass(bool enabled);
         SDL_GLContext getOpenGLContext() const;
         SDL_Window* getGraphicsApplicationWindow() const;
 };
@@ -0,0 +1,102 @@
+#ifndef ASSETLOADER_HPP
+#define ASSETLOADER_HPP
+
+#include "Mesh3D.hpp"
+#include "ThreadPool.hpp"
+#include "VirtualFileSystem.hpp"
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+enum AssetState {
+    ASSET_PENDING = 0,   // queued, nothing has happened yet
+    ASSET_LOADING,       // being read / decoded on a worker thread
+    ASSET_UPLOADING,     // on the CPU, waiting for (or in the middle of) its upload
+    ASSET_READY,         // usable
+    ASSET_FAILED,
+    ASSET_RELEASED       // its data was let go of, nothing can use it anymore
+};
+
+struct Asset {
+    std::string mPath = "";
+    std::atomic<int> mState;
+
+    Asset() : mState(ASSET_PENDING) {}
+
+    AssetState GetState() const { return (AssetState) mState.load(); }
+    bool IsReady() const { return GetState() == ASSET_READY; }
+    bool IsPending() const { return GetState() < ASSET_READY; }
+};
+
+// Plain text (e.g. shader source), no GPU upload involved
+struct TextAsset : public Asset {
+    std::string mText = "";
+};
+
+struct MeshAsset : public Asset {
+    Mesh3D* mMesh = nullptr;
+
+    // Upload progress, only touched by the GL thread
+    GLsizeiptr mVertexBytesUploaded = 0;
+    GLsizeiptr mIndexBytesUploaded = 0;
+};
+
+struct AssetLoaderStats {
+    GLsizeiptr uploadedBytesThisFrame = 0;
+    unsigned long long uploadedBytesTotal = 0;
+    unsigned int pendingUploads = 0;
+    unsigned int assetsInFlight = 0;
+};
+
+/*
+    Loads assets in the background.
+
+    File I/O (through the VirtualFileSystem) and decoding happen on the
+    thread pool. Everything that needs
+    OpenGL is done on the main thread in PumpUploads, which copies at most a
+    fixed number of bytes per frame to the GPU through a staging buffer, so
+    a big asset arriving never causes a long frame.
+*/
+class AssetLoader {
+    public:
+        AssetLoader(ThreadPool* threadPool, const VirtualFileSystem* fileSystem,
+                    GLsizeiptr uploadBytesPerFrame, GLsizeiptr stagingBufferBytes);
+        ~AssetLoader();
+
+        TextAsset* LoadText(const std::string& fileName);
+        MeshAsset* LoadMesh(const std::string& fileName, Mesh3D* meshData);
+        // The data is already in memory, only schedule the upload
+        MeshAsset* UploadMesh(Mesh3D* meshData);
+
+        // Call once per frame from the thread owning the OpenGL context
+        void PumpUploads();
+
+        void SetUploadBytesPerFrame(GLsizeiptr bytes);
+        bool IsIdle() const;
+        const AssetLoaderStats& GetStats() const;
+
+    private:
+        void QueueUpload(MeshAsset* asset);
+        GLsizeiptr StageCopy(GLuint destination, GLintptr destinationOffset,
+                             const unsigned char* source, GLsizeiptr size);
+
+        ThreadPool* mThreadPool;
+        const VirtualFileSystem* mFileSystem;
+        GLsizeiptr mUploadBytesPerFrame;
+        GLsizeiptr mStagingBufferBytes;
+        GLuint mStagingBuffer;
+
+        // Filled by workers, drained by PumpUploads
+        std::mutex mUploadMutex;
+        std::deque<MeshAsset*> mUploadQueue;
+
+        std::vector<Asset*> mAssets;
+        std::atomic<unsigned int> mInFlight;
+        std::atomic<unsigned int> mWorkerJobs;
+        AssetLoaderStats mStats;
+};
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef BENCHMARKREPORT_HPP
+#define BENCHMARKREPORT_HPP
+
+#include <string>
+#include <vector>
+
+/*
+    The results of a benchmark run as named numbers. Names are dotted paths,
+    "frame_ms.p95" is written as {"frame_ms": {"p95": ...}} in the JSON
+    file; reading a file flattens it the same way again.
+*/
+struct BenchmarkMetric {
+    std::string name;
+    double value;
+};
+
+typedef std::vector<BenchmarkMetric> BenchmarkReport;
+
+/* Nearest rank percentile (0 - 100), 0 for no samples. */
+double Percentile(std::vector<double> samples, double percentile);
+
+/* Adds name.mean, name.p50, name.p95, name.p99 and name.max. */
+void AddSummary(BenchmarkReport& report, const std::string& name, const std::vector<double>& samples);
+
+void AddMetric(BenchmarkReport& report, const std::string& name, double value);
+
+/* @return true on success. */
+bool SaveBenchmarkReport(const std::string& fileName, const BenchmarkReport& report);
+
+/*
+    Reads any JSON file made of objects and numbers (strings, arrays,
+    booleans and null are skipped).
+
+    @return true on success.
+*/
+bool LoadBenchmarkReport(const std::string& fileName, BenchmarkReport& report);
+
+struct BenchmarkComparison {
+    std::string name;
+    double baseline;
+    double current;
+    bool regression;
+};
+
+/*
+    Lower is better for every metric. A metric regressed when it grew by
+    more than 'tolerance' (0.1 = 10 %) and, for times (names containing
+    "_ms"), by at least minimumMilliseconds, so noise in tiny sections does
+    not count. Metrics under "scene." describe the run and must be equal.
+
+    @return false when anything regressed or the scenes differ.
+*/
+bool CompareBenchmarkReports(const BenchmarkReport& baseline, const BenchmarkReport& current,
+                             double tolerance, double minimumMilliseconds,
+                             std::vector<BenchmarkComparison>& comparisons);
+
+#endif
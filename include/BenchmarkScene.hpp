@@ -0,0 +1,84 @@
+#ifndef BENCHMARKSCENE_HPP
+#define BENCHMARKSCENE_HPP
+
+#include "LightClusters.hpp"
+#include "MaterialSystem.hpp"
+#include "Mesh3D.hpp"
+#include "Scene.hpp"
+#include "TextureIO.hpp"
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+/*
+    A stress scene for frame time measurements: 'instances' copies of
+    'meshes' unique meshes, spread over 'programs' shader programs and
+    'materials' materials, textured with one of 'textures' small textures
+    (none when 0) and lit by 'lights' point and spot lights (unlit when 0),
+    seen from a scripted camera for 'frames' frames after 'warmupFrames'.
+*/
+struct BenchmarkConfig {
+    bool enabled = false;
+    unsigned int instances = 1000;
+    unsigned int meshes = 8;
+    unsigned int programs = 4;
+    unsigned int textures = 0;
+    unsigned int materials = 0;
+    unsigned int lights = 0;
+    unsigned int frames = 1000;
+    unsigned int warmupFrames = 60;
+    std::string output = "bench.json";
+};
+
+/*
+    Reads --bench, --instances N, --meshes M, --programs K, --textures T,
+    --materials C, --lights L, --frames F, --warmup W and --output file.json; other
+    options are left alone.
+
+    @return false when one of them is malformed.
+*/
+bool ParseBenchmarkOptions(int argc, char* argv[], BenchmarkConfig& config);
+
+/*
+    The unique meshes: spheres of increasing tessellation, so the scene
+    mixes cheap and expensive draws. The caller owns them.
+*/
+void GenerateBenchmarkMeshes(const BenchmarkConfig& config, std::vector<Mesh3D*>& meshes);
+
+/*
+    The textures: 32 to 256 texels square, each with its own colors and a
+    full mip chain.
+*/
+void GenerateBenchmarkTextures(const BenchmarkConfig& config, std::vector<TextureData>& textures);
+
+/*
+    The materials: as many as the larger of 'materials' and 'textures',
+    each with its own tint, material i with texture i % textures. None when
+    both are 0. All of them, the default material too, cull back faces.
+*/
+void GenerateBenchmarkMaterials(const BenchmarkConfig& config, const std::vector<TextureAsset*>& textures,
+                                MaterialSystem& materialSystem, std::vector<MaterialId>& materials);
+
+/*
+    The lights: scattered through the scene, each reaching about as far as
+    the next instance, every fourth one a spot light pointing down at some
+    angle.
+*/
+void GenerateBenchmarkLights(const BenchmarkConfig& config, std::vector<Light>& lights);
+
+/*
+    The instances on a grid filling a cube in front of the default camera,
+    each with one of the materials (DEFAULT_MATERIAL when there are none).
+*/
+void GenerateBenchmarkInstances(const BenchmarkConfig& config, const std::vector<Mesh3D*>& meshes,
+                                const std::vector<MaterialId>& materials, std::vector<SceneInstance>& instances);
+
+/*
+    The camera path: one orbit through the scene over the measured frames,
+    looking at its center. The same frame always gives the same pose.
+*/
+void GetBenchmarkCameraPose(unsigned int frame, unsigned int frameCount, glm::vec3& eye, glm::vec3& viewDirection);
+
+#endif
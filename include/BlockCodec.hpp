@@ -0,0 +1,80 @@
+#ifndef BLOCKCODEC_HPP
+#define BLOCKCODEC_HPP
+
+#include "ThreadPool.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+    Small LZ77 codec (LZ4 style byte oriented sequences) built for fast
+    decompression.
+
+    Data is split into fixed size blocks that are compressed independently,
+    so the blocks of one frame can be decoded in parallel.
+
+    Frame format (little endian)
+
+    BlockFrameHeader
+    uint32_t blockSizes[blockCount]   stored size of every block, the top bit
+                                      marks a block stored uncompressed
+    ...      blocks                   back to back
+
+    Block format: a list of sequences
+        token         literal length (high nibble) / match length - 4 (low nibble),
+                      15 means more length bytes follow (255 = keep going)
+        literals
+        uint16_t      match offset (1 .. 65535)
+    The last sequence only has literals.
+*/
+struct BlockFrameHeader {
+    char magic[4];              // "LZB1"
+    uint32_t blockSize;
+    uint64_t rawSize;
+    uint32_t blockCount;
+    uint32_t reserved;
+};
+
+const uint32_t BLOCK_CODEC_DEFAULT_BLOCK_SIZE = 64 * 1024;
+const uint32_t BLOCK_CODEC_STORED_FLAG = 0x80000000u;
+
+/*
+    Compress a single block.
+
+    @return the compressed size, 0 if it did not fit in dstCapacity (the
+    block should then be stored as is).
+*/
+size_t LZCompressBlock(const unsigned char* src, size_t srcSize,
+                       unsigned char* dst, size_t dstCapacity);
+
+/*
+    Decompress a single block. dstSize must be the exact decompressed size.
+
+    @return false if the data is corrupt.
+*/
+bool LZDecompressBlock(const unsigned char* src, size_t srcSize,
+                       unsigned char* dst, size_t dstSize);
+
+/*
+    Compress data into a frame. Blocks are compressed on the thread pool
+    when one is given.
+*/
+void BlockCompress(const unsigned char* src, size_t srcSize, std::vector<unsigned char>& frame,
+                   uint32_t blockSize = BLOCK_CODEC_DEFAULT_BLOCK_SIZE,
+                   ThreadPool* threadPool = nullptr);
+
+/* @return false if frame is not a valid frame header. */
+bool BlockDecompressedSize(const unsigned char* frame, size_t frameSize, size_t& rawSize);
+
+/*
+    Decompress a frame into dst, which must hold exactly the decompressed
+    size. Blocks are decoded on the thread pool when one is given.
+
+    @return false if the data is corrupt.
+*/
+bool BlockDecompress(const unsigned char* frame, size_t frameSize,
+                     unsigned char* dst, size_t dstSize,
+                     ThreadPool* threadPool = nullptr);
+
+#endif
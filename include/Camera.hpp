@@ -10,23 +10,50 @@ class Camera {
     public:
         Camera();
 
-        // The ultimate view matrix we will produce and return.
-        glm::mat4 GetViewMatrix() const {
-            return glm::lookAt(mEye, mEye + mViewDirection, mUpVector);
+        // The ultimate view matrix we will produce and return. Built straight
+        // from the cached basis, the same matrix glm::lookAt would give.
+        glm::mat4 GetViewMatrix() const;
+
+        // Perspective: 45 degree vertical field of view, from 0.1 to 10 units.
+        // Anything closer or farther is not visible.
+        glm::mat4 GetProjectionMatrix(float aspectRatio) const;
+
+        glm::vec3 GetEye() const {
+            return mEye;
+        }
+
+        glm::vec3 GetViewDirection() const {
+            return mViewDirection;
         }
 
-        void MouseLook(int mouseX, int mouseY);
+        // Place the camera directly, e.g. along a scripted path. Looking
+        // straight up or down is limited like the mouse look.
+        void SetPose(const glm::vec3& eye, const glm::vec3& viewDirection);
+
+        // Relative mouse motion in pixels, summed over a frame: right turns
+        // right, down looks down. The pitch stops short of straight up/down.
+        void MouseLook(float deltaX, float deltaY);
         void MoveForward(float speed);
         void MoveBackward(float speed);
         void MoveLeft(float speed);
         void MoveRight(float speed);
 
     private:
+        // Derives the basis from yaw and pitch, one sin/cos pair each
+        void UpdateBasis();
+
         glm::vec3 mEye;
+        // Radians. Yaw 0 looks along -z, positive yaw turns towards +x.
+        float mYaw;
+        float mPitch;
+
+        // Orthonormal, recomputed whenever the angles change, so rounding
+        // never accumulates over many small turns
         glm::vec3 mViewDirection;
+        glm::vec3 mRightVector;
+        glm::vec3 mCameraUpVector;
+        // The world's up, yaw turns around it
         glm::vec3 mUpVector;
-
-        glm::vec2 mOldMousePosition;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,27 @@
+#ifndef FIXEDTIMESTEP_HPP
+#define FIXEDTIMESTEP_HPP
+
+/*
+    Turns the real time between frames into a whole number of simulation
+    steps of a fixed size, so movement does not depend on the frame rate.
+    Time that is left over carries to the next frame.
+*/
+class FixedTimestep {
+    public:
+        // After a long stall at most maxStepsPerFrame are taken, the rest
+        // of the time is dropped instead of catching up forever
+        FixedTimestep(double stepSeconds, unsigned int maxStepsPerFrame);
+
+        /* @return the number of steps to simulate for elapsedSeconds of real time. */
+        unsigned int Advance(double elapsedSeconds);
+
+        void SetStepSeconds(double stepSeconds);
+        double GetStepSeconds() const;
+
+    private:
+        double mStepSeconds;
+        unsigned int mMaxStepsPerFrame;
+        double mAccumulator;
+};
+
+#endif
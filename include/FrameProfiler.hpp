@@ -0,0 +1,74 @@
+#ifndef FRAMEPROFILER_HPP
+#define FRAMEPROFILER_HPP
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+/*
+    CPU time per subsystem, frame by frame. Sections are registered once
+    and then timed with BeginSection / EndSection; a section may be entered
+    several times per frame, the times add up. Counters (draw calls,
+    triangles, ...) work the same way with AddToCounter.
+
+    Every frame is kept, so percentiles can be taken at the end of a run.
+*/
+class FrameProfiler {
+    public:
+        FrameProfiler();
+
+        /* @return the id to time the section with. */
+        unsigned int AddSection(const std::string& name);
+        /* @return the id to count with. */
+        unsigned int AddCounter(const std::string& name);
+
+        // Closes the previous frame and starts the next one. Frame time is
+        // measured from BeginFrame to BeginFrame, swap and vsync included;
+        // call it once more after the last frame of a run.
+        void BeginFrame();
+
+        void BeginSection(unsigned int section);
+        void EndSection(unsigned int section);
+        void AddToCounter(unsigned int counter, unsigned long long amount);
+        // The count so far in the current frame
+        unsigned long long GetCounter(unsigned int counter) const;
+
+        // Drops the frames recorded so far, e.g. after warming up
+        void Reset();
+
+        size_t GetFrameCount() const;
+        const std::vector<double>& GetFrameMilliseconds() const;
+
+        size_t GetSectionCount() const;
+        const std::string& GetSectionName(unsigned int section) const;
+        const std::vector<double>& GetSectionMilliseconds(unsigned int section) const;
+
+        size_t GetCounterCount() const;
+        const std::string& GetCounterName(unsigned int counter) const;
+        const std::vector<double>& GetCounterValues(unsigned int counter) const;
+
+    private:
+        typedef std::chrono::high_resolution_clock Clock;
+
+        struct Section {
+            std::string name;
+            Clock::time_point start;
+            double thisFrame;
+            std::vector<double> frames;
+        };
+
+        struct Counter {
+            std::string name;
+            unsigned long long thisFrame;
+            std::vector<double> frames;
+        };
+
+        std::vector<Section> mSections;
+        std::vector<Counter> mCounters;
+
+        bool mFrameStarted;
+        Clock::time_point mFrameStart;
+        std::vector<double> mFrameMilliseconds;
+};
+
+#endif
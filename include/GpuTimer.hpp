@@ -0,0 +1,41 @@
+#ifndef GPUTIMER_HPP
+#define GPUTIMER_HPP
+
+#include <glad/glad.h>
+
+/*
+    GPU time of a stretch of commands, with GL_TIME_ELAPSED queries.
+
+    Results arrive a few frames late; the timer keeps a small ring of
+    queries and only reads the ones that are available, so it never waits
+    on the GPU. When every query is still in flight the measurement for
+    that frame is skipped. Time elapsed queries can not be nested: only one
+    timer may be between Begin and End at a time.
+*/
+class GpuTimer {
+    public:
+        GpuTimer();
+        ~GpuTimer();
+
+        void Begin();
+        void End();
+
+        // The latest finished measurement, 0 until there is one
+        double GetMilliseconds() const;
+
+        // Needs the context, the destructor does not touch OpenGL
+        void Release();
+
+    private:
+        static const unsigned int QUERY_COUNT = 4;
+
+        void CollectResults();
+
+        GLuint mQueries[QUERY_COUNT];
+        bool mPending[QUERY_COUNT];
+        unsigned int mNext;
+        bool mActive;
+        double mMilliseconds;
+};
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef IMAGEIO_HPP
+#define IMAGEIO_HPP
+
+#include <string>
+
+#include <vector>
+
+/*
+    Image readers and writers for tools and reference frames. Pixels are 8
+    bit RGBA, rows bottom to top (the order glReadPixels, glTexImage2D and
+    the software rasterizer use); the files are top to bottom.
+*/
+
+/* Binary PPM (P6), alpha is dropped. @return true on success. */
+bool SavePPM(const std::string& fileName, unsigned int width, unsigned int height,
+             const unsigned char* rgba);
+
+/*
+    PNG, RGBA. The image data is stored without compression, which keeps
+    the writer tiny; any viewer and image diff tool reads it.
+
+    @return true on success.
+*/
+bool SavePNG(const std::string& fileName, unsigned int width, unsigned int height,
+             const unsigned char* rgba);
+
+/*
+    Binary PPM (P6, opaque) or PAM (P7 with a depth of 3 or 4), 8 bits per
+    channel. Enough for tool input without an image library.
+
+    @return true on success.
+*/
+bool LoadPPM(const std::string& fileName, unsigned int& width, unsigned int& height,
+             std::vector<unsigned char>& rgba);
+
+/* SavePNG or SavePPM, depending on the file extension. */
+bool SaveImage(const std::string& fileName, unsigned int width, unsigned int height,
+               const unsigned char* rgba);
+
+#endif
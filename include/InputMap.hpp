@@ -0,0 +1,84 @@
+#ifndef INPUTMAP_HPP
+#define INPUTMAP_HPP
+
+#include "InputRecorder.hpp"
+
+#include <vector>
+
+enum InputAction {
+    INPUT_ACTION_MOVE_FORWARD = 0,
+    INPUT_ACTION_MOVE_BACKWARD,
+    INPUT_ACTION_MOVE_LEFT,
+    INPUT_ACTION_MOVE_RIGHT,
+    INPUT_ACTION_TOGGLE_HUD,
+    INPUT_ACTION_TOGGLE_OVERDRAW,
+    INPUT_ACTION_TOGGLE_DEPTH_PREPASS,
+    INPUT_ACTION_COUNT
+};
+
+enum InputAxis {
+    INPUT_AXIS_LOOK_X = 0,
+    INPUT_AXIS_LOOK_Y,
+    INPUT_AXIS_COUNT
+};
+
+/*
+    How old the input behind a frame is when the frame is handed to the GPU.
+
+    eventToSubmit runs from the oldest event of the batch (its SDL time
+    stamp, so millisecond steps) to the submission, sampleToSubmit from
+    draining the event queue to the submission. Both are 0 for frames
+    without fresh input, e.g. during a replay.
+*/
+struct InputLatency {
+    double eventToSubmitMilliseconds = 0.0;
+    double sampleToSubmitMilliseconds = 0.0;
+    unsigned int events = 0;
+};
+
+/*
+    Turns a batch of input events into actions and axes.
+
+    Keys are bound to actions by scancode, any number of keys per action.
+    An action is held while one of its keys is down and counts every press
+    within the batch, so a short tap between two frames is not lost. Mouse
+    motion is summed per axis over the whole batch and applied once, instead
+    of once per motion event.
+*/
+class InputMap {
+    public:
+        InputMap();
+
+        void Bind(unsigned int scancode, InputAction action);
+
+        /*
+            Takes the next batch in order. Held actions carry over from the
+            previous batch, presses and axes start from zero. A non-empty
+            keyboard state in the frame overrides what the key events left
+            held, so a key released outside the window does not get stuck.
+        */
+        void Process(const InputFrame& frame);
+
+        bool IsHeld(InputAction action) const;
+        // How often the action was pressed during the last batch
+        unsigned int GetPresses(InputAction action) const;
+        float GetAxis(InputAxis axis) const;
+
+    private:
+        struct Binding {
+            unsigned int scancode;
+            InputAction action;
+        };
+
+        void SetKey(unsigned int scancode, bool down);
+
+        std::vector<Binding> mBindings;
+        // Per scancode, only the bound ones are tracked
+        std::vector<unsigned char> mKeys;
+
+        unsigned int mHeldKeys[INPUT_ACTION_COUNT];
+        unsigned int mPresses[INPUT_ACTION_COUNT];
+        float mAxes[INPUT_AXIS_COUNT];
+};
+
+#endif
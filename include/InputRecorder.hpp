@@ -0,0 +1,105 @@
+#ifndef INPUTRECORDER_HPP
+#define INPUTRECORDER_HPP
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+enum InputEventType {
+    INPUT_EVENT_MOUSE_MOTION = 1, // x, y: relative motion
+    INPUT_EVENT_KEY_DOWN = 2,     // x: scancode
+    INPUT_EVENT_KEY_UP = 3        // x: scancode
+};
+
+struct InputEvent {
+    unsigned char type = 0;
+    unsigned int timestamp = 0; // milliseconds, as SDL stamps its events
+    short x = 0;
+    short y = 0;
+};
+
+/*
+    Everything one simulation step sees: the events since the previous step
+    and optionally the keyboard state (one byte per scancode, non-zero while
+    held). The display sends both, the state sampled right after the events
+    of the frame.
+*/
+struct InputFrame {
+    std::vector<InputEvent> events;
+    std::vector<unsigned char> keys;
+};
+
+/*
+    Input file format (little endian)
+
+    InputFileHeader
+    per step:
+        unsigned short eventCount
+        unsigned char  keysChanged
+        unsigned char  keyBits[(keyCount + 7) / 8]  (only when keysChanged)
+        eventCount x { unsigned char type, unsigned int timestamp, short x, short y }
+*/
+struct InputFileHeader {
+    char magic[4];                 // "INP1"
+    unsigned int version;
+    unsigned int stepMicroseconds;
+    unsigned int keyCount;
+};
+
+const unsigned int INPUT_FILE_VERSION = 1;
+
+/*
+    Records the input of every fixed simulation step to a file and plays it
+    back step by step. Together with a fixed timestep the same file always
+    produces the same camera path, which makes frame time runs comparable.
+
+    The keyboard state is only stored when it changed since the previous
+    step, a fly-through costs a few bytes per step.
+*/
+class InputRecorder {
+    public:
+        InputRecorder();
+        ~InputRecorder();
+
+        /* @return true when the file could be created. */
+        bool StartRecording(const std::string& fileName, double stepSeconds, unsigned int keyCount);
+
+        /* Reads the whole file. @return true when it is a valid recording. */
+        bool StartReplay(const std::string& fileName);
+
+        // Ends recording (flushing the file) or replay
+        void Stop();
+
+        bool IsRecording() const;
+        bool IsReplaying() const;
+
+        void RecordStep(const InputFrame& frame);
+
+        /*
+            The next recorded step. Keys beyond the recorded key count read
+            as released.
+
+            @return false when the recording is exhausted (or broken), the
+            replay stops then.
+        */
+        bool ReplayStep(InputFrame& frame);
+
+        // The step size the replayed file was recorded with
+        double GetStepSeconds() const;
+        unsigned long long GetStepCount() const;
+
+    private:
+        std::ofstream mOutput;
+        std::vector<unsigned char> mReplay;
+        size_t mReplayOffset;
+        bool mRecording;
+        bool mReplaying;
+
+        unsigned int mKeyCount;
+        double mStepSeconds;
+        unsigned long long mStepCount;
+        // Key bits of the previous step, changes are stored against them
+        std::vector<unsigned char> mKeyBits;
+};
+
+#endif
@@ -0,0 +1,130 @@
+#ifndef LIGHTCLUSTERS_HPP
+#define LIGHTCLUSTERS_HPP
+
+#include "ThreadPool.hpp"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+enum LightType {
+    LIGHT_POINT = 0,
+    LIGHT_SPOT
+};
+
+/* A light in world space. Nothing is lit beyond its range. */
+struct Light {
+    LightType type = LIGHT_POINT;
+    glm::vec3 position = glm::vec3(0.0f);
+    float range = 1.0f;
+    glm::vec3 color = glm::vec3(1.0f);
+    float intensity = 1.0f;
+    // Spot lights only: where the cone points and the cosines of the angles
+    // at which the light starts to fade and where it is gone
+    glm::vec3 direction = glm::vec3(0.0f, -1.0f, 0.0f);
+    float cosInner = 0.94f;
+    float cosOuter = 0.87f;
+};
+
+// The grid: screen tiles times depth slices. Slices get exponentially
+// deeper, so clusters are about as deep as they are wide.
+const unsigned int CLUSTER_TILES_X = 16;
+const unsigned int CLUSTER_TILES_Y = 9;
+const unsigned int CLUSTER_SLICES = 24;
+const unsigned int CLUSTER_COUNT = CLUSTER_TILES_X * CLUSTER_TILES_Y * CLUSTER_SLICES;
+// Further lights in a cluster are dropped (and counted)
+const unsigned int MAX_LIGHTS_PER_CLUSTER = 128;
+
+struct LightClusterStats {
+    unsigned int lights = 0;
+    // In at least one cluster
+    unsigned int visibleLights = 0;
+    unsigned int litClusters = 0;
+    unsigned int lightIndices = 0;
+    double averageLightsPerCluster = 0.0;
+    // Over the clusters with at least one light
+    double averageLightsPerLitCluster = 0.0;
+    unsigned int maxLightsPerCluster = 0;
+    unsigned int droppedLights = 0;
+    double binMilliseconds = 0.0;
+};
+
+/*
+    Clustered forward lighting: the view frustum is split into a grid of
+    clusters (screen tiles x depth slices) and every cluster gets the list
+    of lights that can reach it. A fragment finds its cluster from its
+    window position and view depth and only loops over those lights.
+
+    Build runs on the CPU: lights go to view space, then the depth slices
+    are binned in parallel on the workers, each light's bounding sphere
+    tested against four cluster boxes at a time (SSE where available).
+    Upload hands the results to three texture buffers:
+        u_Lights        RGBA32F, 3 texels per light (view space):
+                        position + range, color * intensity + cosInner,
+                        direction + cosOuter (-2 for point lights)
+        u_ClusterRanges RG32UI, per cluster: first index, light count
+        u_LightIndices  R16UI, the light lists one after the other
+    Clusters are numbered (slice * CLUSTER_TILES_Y + tileY) * CLUSTER_TILES_X
+    + tileX, tile (0, 0) in the bottom left corner.
+*/
+class LightClusters {
+    public:
+        LightClusters(ThreadPool* threadPool);
+
+        // The projection must be a symmetric perspective one
+        void Build(const std::vector<Light>& lights, const glm::mat4& view, const glm::mat4& projection);
+
+        // GL thread: creates the buffers on first use
+        void Upload();
+        // The three buffer textures on units firstUnit to firstUnit + 2
+        void Bind(GLuint firstUnit) const;
+
+        // A fragment's slice is log(view depth) * scale - bias
+        float GetDepthScale() const;
+        float GetDepthBias() const;
+
+        const LightClusterStats& GetStats() const;
+
+        // Needs the context, the destructor does not touch OpenGL
+        void Release();
+
+    private:
+        void BuildClusterBounds();
+        void BinSlice(unsigned int slice);
+
+        ThreadPool* mThreadPool;
+
+        // What the cluster bounds were built for
+        glm::mat4 mProjection;
+        float mNear;
+        float mFar;
+        float mTanHalfX;
+        float mTanHalfY;
+
+        // View space boxes, one slice after the other, each coordinate in
+        // an array of its own for the SIMD tests
+        std::vector<float> mMinX, mMinY, mMinZ;
+        std::vector<float> mMaxX, mMaxY, mMaxZ;
+
+        // This frame's lights in view space: bounding spheres (xyz center,
+        // w radius) and what the shaders get
+        std::vector<glm::vec4> mSpheres;
+        std::vector<glm::vec4> mGpuLights;
+        std::vector<std::vector<unsigned int> > mSliceLights;
+
+        // Per cluster: MAX_LIGHTS_PER_CLUSTER slots and how many are used
+        std::vector<unsigned short> mScratch;
+        std::vector<unsigned int> mScratchCounts;
+        std::vector<unsigned int> mDropped;
+
+        std::vector<glm::uvec2> mRanges;
+        std::vector<unsigned short> mIndices;
+
+        GLuint mBuffers[3];
+        GLuint mTextures[3];
+
+        LightClusterStats mStats;
+};
+
+#endif
@@ -0,0 +1,98 @@
+#ifndef MATERIALSYSTEM_HPP
+#define MATERIALSYSTEM_HPP
+
+#include "TextureManager.hpp"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+typedef unsigned int MaterialId;
+
+// Untextured, white: the vertex colors as they are
+const MaterialId DEFAULT_MATERIAL = 0;
+
+/*
+    The shading parameters of one material, as the Materials uniform block
+    in the shaders lays them out (std140).
+*/
+struct MaterialParameters {
+    // Multiplies the vertex colors (and the albedo texture)
+    glm::vec4 baseColor = glm::vec4(1.0f);
+    // rgb is added on top
+    glm::vec4 emissive = glm::vec4(0.0f);
+    // Where the albedo UVs go on the atlas layer: offset xy, scale zw
+    glm::vec4 atlasRect = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+    // x: 1 when the albedo is sampled, y: its atlas layer (-1 when it is
+    // bound on its own to unit 0). Kept up to date by MaterialSystem.
+    glm::ivec4 albedo = glm::ivec4(0, -1, 0, 0);
+};
+
+struct Material {
+    MaterialParameters parameters;
+    // Bound to unit 0 when it is not in the atlas
+    TextureAsset* albedo = nullptr;
+    // Pipeline state rather than a parameter: closed meshes skip their back
+    // faces, open or thin ones keep both sides
+    bool cullBackFaces = false;
+};
+
+struct MaterialStats {
+    unsigned int materials = 0;
+    // Contiguous ranges of dirty materials sent by the last Update
+    unsigned int uploadsThisFrame = 0;
+    GLsizeiptr uploadedBytesThisFrame = 0;
+};
+
+/*
+    Every material's parameters live in one uniform buffer, indexed by
+    material ID from the per instance data. Drawing with another material
+    changes an index instead of a round of glUniform calls, so instances of
+    one mesh draw together whatever their materials.
+
+    Changes are only recorded on the CPU. Update sends the dirty materials,
+    in as few glBufferSubData ranges as possible, and nothing at all on
+    frames where no material changed.
+*/
+class MaterialSystem {
+    public:
+        // Room for capacity materials, the shaders' array must match
+        MaterialSystem(unsigned int capacity);
+
+        /* @return DEFAULT_MATERIAL when there is no room left. */
+        MaterialId Create(const MaterialParameters& parameters, TextureAsset* albedo, bool cullBackFaces = false);
+
+        const Material& Get(MaterialId material) const;
+
+        // The albedo has to be bound to unit 0 for the material (nullptr when
+        // it has none or it is in the atlas)
+        TextureAsset* GetBoundAlbedo(MaterialId material) const;
+        bool IsAtlased(MaterialId material) const;
+
+        void SetParameters(MaterialId material, const MaterialParameters& parameters);
+        void SetCullBackFaces(MaterialId material, bool cullBackFaces);
+
+        // The albedo moved into the atlas (see TextureAtlas.hpp)
+        void SetAtlasEntry(MaterialId material, int layer, const glm::vec4& rect);
+
+        unsigned int GetCount() const;
+
+        // Once per frame on the GL thread: creates the buffer on first use
+        // and binds it to the block binding, then sends what is dirty
+        void Update(GLuint blockBinding);
+
+        const MaterialStats& GetStats() const;
+
+        // Needs the context, the destructor does not touch OpenGL
+        void Release();
+
+    private:
+        unsigned int mCapacity;
+        std::vector<Material> mMaterials;
+        std::vector<bool> mDirty;
+        GLuint mBuffer;
+        MaterialStats mStats;
+};
+
+#endif
@@ -0,0 +1,161 @@
+#ifndef MESH3D_HPP
+#define MESH3D_HPP
+
+// Third party libraries
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "Meshlet.hpp"
+#include "VertexFormat.hpp"
+
+// C++ standard template library (STL)
+#include <string>
+#include <vector>
+
+/*
+    One level of detail: a range of indexBufferData, drawn with the same
+    vertex buffer as every other level.
+*/
+struct MeshLOD {
+    GLuint firstIndex = 0;
+    GLuint indexCount = 0;
+    // How far (object space) this level's surface may be from the full
+    // detail one, see MeshSimplifier.hpp
+    float error = 0.0f;
+};
+
+struct Mesh3D {
+    // OpenGL Objects
+    // Vertex Array Object (VAO)
+    // Vertex array objects encapsulate all of the items needed to render an object.
+    // For example, we may have multiple vertex buffer objects (VBO) related to rendering one
+    // object. The VAO allows us to setup the OpenGL state to render that object using
+    // the correct layout and correct buffers with one call after being setup.
+
+    // Vertex Buffer Object (VBO)
+    // Vertex Buffer Objects store information relating to vertices (e.g. positions,
+    // normals, textures)
+    // VBOs are our mechanism for arranging geometry on the GPU.
+    GLuint mVertexArrayObject = 0; // VAO
+    // Same buffers, only the position stream: for depth only passes
+    GLuint mPositionArrayObject = 0;
+    GLuint mVertexBufferObject = 0; // VBO
+    GLuint mIndexBufferObject = 0; // IBO (EBO)
+
+    std::vector<GLfloat> vertexData {
+            // 0 - Vertex
+            -0.5f, -0.5f, 0.0f, // position
+            1.0f, 0.0f, 0.0f, // color
+            // 1 - Vertex
+            0.5f, -0.5f, 0.0f, // position
+            0.0f, 1.0f, 0.0f, // color
+            // 2 - Vertex
+            -0.5f, 0.5f, 0.0f, // position
+            0.0f, 0.0f, 1.0f, // color
+            // 3 - Vertex
+            0.5f, 0.5f, 0.0f, // position
+            1.0f, 0.0f, 0.0f, // color
+    };
+
+    std::vector<GLuint> indexBufferData {
+            2, 0, 1, 3, 2, 1
+    };
+
+    // Optional vertex streams, empty when the mesh does not have them. The
+    // default quad has UVs, so a texture covers it once.
+    std::vector<GLfloat> normalData; // 3 floats per vertex
+    std::vector<GLfloat> uvData { // 2 floats per vertex
+            0.0f, 0.0f,
+            1.0f, 0.0f,
+            0.0f, 1.0f,
+            1.0f, 1.0f
+    };
+
+    // How the vertices are laid out on the GPU (see VertexFormat.hpp)
+    VertexFormat mVertexFormat = VERTEX_FORMAT_FLOAT;
+    NormalEncoding mNormalEncoding = NORMAL_ENCODING_OCTAHEDRAL;
+
+    // Filled by BuildMeshStreams, the vertex shader turns quantized
+    // positions back into mPositionBoundsMin + position * mPositionBoundsExtent
+    std::vector<unsigned char> mVertexStream;
+    // Indices as they go to the GPU, 16 bit whenever the vertex count allows
+    std::vector<unsigned char> mIndexStream;
+    GLenum mIndexType = GL_UNSIGNED_INT;
+    VertexLayout mVertexLayout;
+    glm::vec3 mPositionBoundsMin = glm::vec3(0.0f);
+    glm::vec3 mPositionBoundsExtent = glm::vec3(1.0f);
+
+    // Object space bounding box, also filled by BuildMeshStreams
+    glm::vec3 mBoundsMin = glm::vec3(0.0f);
+    glm::vec3 mBoundsMax = glm::vec3(0.0f);
+
+    // Level of detail chain, finest first (see MeshLOD.hpp). Empty when the
+    // whole index buffer is the only level.
+    std::vector<MeshLOD> mLODs;
+
+    // Clusters of the full detail level, for culling (see Meshlet.hpp).
+    // Empty when the mesh is always drawn whole.
+    std::vector<Meshlet> mMeshlets;
+    MeshletBounds mMeshletBounds;
+
+    float m_uOffset = -2.0f;
+    float m_uRotate = 0.0f;
+    float m_uScale = 0.5f;
+
+    // GPU residency record
+    // Sizes (in bytes) of the buffers currently living on the GPU, zero when
+    // the mesh is not resident. The index count is kept apart from
+    // indexBufferData so we can still draw after the CPU copy was dropped.
+    GLsizeiptr mVertexBufferSize = 0;
+    GLsizeiptr mIndexBufferSize = 0;
+    GLsizei mIndexCount = 0;
+
+    // Where the mesh can be streamed back from (see MeshIO.hpp).
+    // Empty for meshes that only exist in memory.
+    std::string mSourcePath = "";
+};
+
+/*
+    Setup your geometry during the vertex specification step and upload it
+    to the GPU.
+
+    @param uploadData When false, the buffers are only allocated and the
+    data is expected to be copied in later (see AssetLoader.hpp).
+*/
+void VertexSpecification(Mesh3D* meshData, bool uploadData = true);
+
+/*
+    Lay out the CPU side vertex data in mVertexStream, in the mesh's vertex
+    format (see VertexLayout), and pack the indices into mIndexStream (GL_UNSIGNED_SHORT
+    when there are at most 65536 vertices). Does not need OpenGL, so it can
+    run on a worker thread.
+*/
+void BuildMeshStreams(Mesh3D* meshData);
+
+/* Free mVertexStream and mIndexStream once they have been uploaded. */
+void ReleaseMeshStreams(Mesh3D* meshData);
+
+size_t GetMeshVertexCount(const Mesh3D* meshData);
+
+/*
+    The mesh's model matrix: translated by m_uOffset along z, rotated by
+    m_uRotate degrees around (1, 1, 1) and scaled by m_uScale.
+*/
+glm::mat4 GetMeshModelMatrix(const Mesh3D* meshData);
+
+/*
+    Delete the VAOs, VBO and IBO of a mesh and reset its residency record.
+    The CPU side data is left untouched.
+*/
+void ReleaseMeshBuffers(Mesh3D* meshData);
+
+/* @return true when the mesh has buffers on the GPU. */
+bool IsMeshResident(const Mesh3D* meshData);
+
+/* @return the number of bytes the mesh currently occupies on the GPU. */
+GLsizeiptr GetMeshResidentBytes(const Mesh3D* meshData);
+
+/* @return the number of bytes the mesh will occupy once uploaded. */
+GLsizeiptr GetMeshUploadBytes(const Mesh3D* meshData);
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef MESHGENERATOR_HPP
+#define MESHGENERATOR_HPP
+
+#include "Mesh3D.hpp"
+
+/*
+    Procedural meshes for tools and stress tests.
+*/
+
+/*
+    A size x size quad grid in the xy plane, centered on the origin, with a
+    slight bump in z, vertex colors, normals and uvs.
+
+    @param shuffleTriangles Emit the triangles in random order, like a
+    badly exported mesh would.
+*/
+void GenerateGridMesh(Mesh3D* meshData, unsigned int size, bool shuffleTriangles = false);
+
+/*
+    A UV sphere with the given number of rings and segments.
+*/
+void GenerateSphereMesh(Mesh3D* meshData, unsigned int rings, unsigned int segments);
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef MESHIO_HPP
+#define MESHIO_HPP
+
+#include "Mesh3D.hpp"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/*
+    Binary mesh format (little endian)
+
+    MeshFileHeader
+    GLfloat vertexData[vertexFloatCount]  (position + color, 6 floats per vertex)
+    GLuint  indexData[indexCount]
+    GLfloat normalData[normalFloatCount]  (3 floats per vertex, optional)
+    GLfloat uvData[uvFloatCount]          (2 floats per vertex, optional)
+    MeshLOD lods[lodCount]                (ranges of indexData, optional)
+*/
+struct MeshFileHeader {
+    char magic[4];                 // "MSH1"
+    unsigned int version;
+    unsigned int vertexFloatCount;
+    unsigned int indexCount;
+    unsigned int normalFloatCount;
+    unsigned int uvFloatCount;
+    unsigned int lodCount;
+};
+
+const unsigned int MESH_FILE_VERSION = 3;
+
+/* The mesh file contents, as SaveMeshBinary would write them. */
+void SerializeMesh(const Mesh3D* meshData, std::vector<unsigned char>& bytes);
+
+/*
+    Write the CPU side vertex and index data of a mesh to disk.
+
+    @return true on success.
+*/
+bool SaveMeshBinary(const std::string& fileName, const Mesh3D* meshData);
+
+/*
+    Read vertex and index data from disk into meshData. Nothing is uploaded
+    to the GPU, call VertexSpecification for that.
+
+    @return true on success.
+*/
+bool LoadMeshBinary(const std::string& fileName, Mesh3D* meshData);
+
+/*
+    Same as LoadMeshBinary, from a file that is already in memory (e.g. a
+    view into the asset archive). Does not touch mSourcePath.
+
+    @return true on success.
+*/
+bool LoadMeshFromMemory(const unsigned char* data, size_t size, Mesh3D* meshData);
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef MESHLOD_HPP
+#define MESHLOD_HPP
+
+#include "Mesh3D.hpp"
+
+const size_t MAX_MESH_LODS = 6;
+
+/*
+    Build a level of detail chain from the mesh's current index buffer.
+    Every level is simplified from the full detail one (see
+    MeshSimplifier.hpp) to 'reduction' times the triangles of the level
+    before it, and the chain ends early once a level no longer gets
+    meaningfully smaller or would exceed maxRelativeError.
+
+    The levels are appended to indexBufferData and described in mLODs. Run
+    OptimizeMesh first; each new level gets its own vertex cache pass.
+
+    @param maxRelativeError Largest error allowed, as a fraction of the
+    bounding box diagonal.
+    @return the number of levels, including the full detail one.
+*/
+size_t GenerateMeshLODs(Mesh3D* meshData, size_t maxLODs = MAX_MESH_LODS,
+                        float reduction = 0.5f, float maxRelativeError = 0.05f);
+
+/* @return level 'lod', or the whole index buffer for meshes without a chain. */
+MeshLOD GetMeshLOD(const Mesh3D* meshData, size_t lod);
+
+size_t GetMeshLODCount(const Mesh3D* meshData);
+
+/*
+    How many pixels one object space unit covers at the given distance from
+    the eye.
+
+    projection: the perspective matrix used to draw
+    viewportHeight: in pixels
+    objectScale: the largest scale factor in the model matrix
+*/
+float PixelsPerObjectUnit(const glm::mat4& projection, float viewportHeight,
+                          float distance, float objectScale);
+
+/*
+    Pick the coarsest level whose error stays under pixelThreshold pixels on
+    screen. To avoid popping back and forth at a boundary, the mesh only
+    goes coarser once that level is comfortably (by 'hysteresis') under the
+    threshold, and only goes finer once the current level is comfortably
+    over it. currentLOD is what was drawn last frame, of this one instance:
+    instances of a mesh at different distances keep their own levels.
+
+    @return the level to draw, the next frame's currentLOD.
+*/
+size_t SelectMeshLOD(const Mesh3D* meshData, size_t currentLOD, float pixelsPerUnit,
+                     float pixelThreshold = 1.0f, float hysteresis = 0.25f);
+
+/* What was submitted, the counters are reset by the caller each frame */
+struct LODStats {
+    unsigned long long trianglesThisFrame = 0;
+    // What the same draws would have cost at full detail
+    unsigned long long fullDetailTrianglesThisFrame = 0;
+    unsigned int lodSwitchesThisFrame = 0;
+};
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef MESHOPTIMIZER_HPP
+#define MESHOPTIMIZER_HPP
+
+#include "Mesh3D.hpp"
+
+#include <vector>
+
+/*
+    Post-transform vertex cache efficiency of an index buffer, measured
+    with a FIFO cache simulation.
+
+    ACMR: average cache miss ratio, vertex shader runs per triangle
+          (0.5 is the best possible for a regular grid, 3 the worst)
+    ATVR: average transformed vertex ratio, vertex shader runs per vertex
+          (1 is the best possible)
+*/
+struct VertexCacheStats {
+    unsigned int vertexShaderRuns = 0;
+    float acmr = 0.0f;
+    float atvr = 0.0f;
+};
+
+const unsigned int DEFAULT_VERTEX_CACHE_SIZE = 16;
+
+VertexCacheStats AnalyzeVertexCache(const std::vector<GLuint>& indices, size_t vertexCount,
+                                    unsigned int cacheSize = DEFAULT_VERTEX_CACHE_SIZE);
+
+/*
+    Reorder triangles so vertices are reused while they are still in the
+    post-transform cache (Tom Forsyth's linear-speed vertex cache
+    optimisation).
+*/
+void OptimizeVertexCache(std::vector<GLuint>& indices, size_t vertexCount);
+
+/*
+    Reorder clusters of triangles so that the ones facing outwards are drawn
+    first, which lets the depth test reject more of what is behind them.
+    Clusters are cut where the cache is mostly cold anyway, and the new order is
+    only kept if the ACMR does not get worse than threshold times the
+    input's. Run after OptimizeVertexCache.
+
+    positions: Mesh3D::vertexData (6 floats per vertex, xyz first)
+*/
+void OptimizeOverdraw(std::vector<GLuint>& indices, const std::vector<GLfloat>& positions,
+                      float threshold = 1.05f);
+
+/*
+    Renumber vertices in the order the index buffer first uses them, so
+    the vertex fetch walks memory linearly. Unused vertices are dropped.
+    All vertex streams of the mesh are remapped.
+*/
+void OptimizeVertexFetch(Mesh3D* meshData);
+
+/*
+    All of the above, in the right order. Meshes that already have levels
+    of detail are left as they are.
+*/
+void OptimizeMesh(Mesh3D* meshData);
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef MESHRESIDENCY_HPP
+#define MESHRESIDENCY_HPP
+
+#include "Mesh3D.hpp"
+#include "VirtualFileSystem.hpp"
+
+#include <list>
+#include <unordered_map>
+
+/*
+    Counters describing what the residency manager did. The 'ThisFrame'
+    values are reset by BeginFrame.
+*/
+struct ResidencyStats {
+    GLsizeiptr budgetBytes = 0;
+    GLsizeiptr residentBytes = 0;
+    unsigned int residentMeshes = 0;
+    unsigned int trackedMeshes = 0;
+
+    // Upload bandwidth
+    GLsizeiptr uploadedBytesThisFrame = 0;
+    unsigned long long uploadedBytesTotal = 0;
+
+    // Eviction churn: restreams only count meshes brought back after an
+    // eviction, not their first upload
+    unsigned int evictionsThisFrame = 0;
+    unsigned int restreamsThisFrame = 0;
+    unsigned long long evictionsTotal = 0;
+    unsigned long long restreamsTotal = 0;
+
+    // True when the meshes used this frame alone do not fit the budget
+    bool overBudget = false;
+};
+
+/*
+    Keeps the GPU buffers of the meshes we actually draw resident within a
+    byte budget.
+
+    Every mesh drawn in a frame must go through MakeResident first. Meshes
+    are kept in least-recently-used order; when the budget is exceeded, the
+    meshes that have not been used for the longest time are evicted. If a
+    mesh came from disk (mSourcePath), its CPU copy is dropped as well and it
+    is streamed back in from disk the next time it becomes visible.
+*/
+class MeshResidencyManager {
+    public:
+        MeshResidencyManager(GLsizeiptr budgetBytes);
+
+        // Evicted meshes are streamed back through here when set
+        void SetFileSystem(const VirtualFileSystem* fileSystem);
+
+        void SetBudget(GLsizeiptr budgetBytes);
+        GLsizeiptr GetBudget() const;
+
+        void Register(Mesh3D* mesh);
+        void Unregister(Mesh3D* mesh);
+
+        void BeginFrame();
+        bool MakeResident(Mesh3D* mesh);
+        void EndFrame();
+
+        const ResidencyStats& GetStats() const;
+
+    private:
+        struct Entry {
+            Mesh3D* mesh;
+            unsigned long long lastUsedFrame;
+            // Evicted at least once, uploading it again is churn
+            bool evicted;
+        };
+
+        bool Restream(Mesh3D* mesh, bool evicted);
+        void Evict(Mesh3D* mesh);
+        void EvictUntil(GLsizeiptr targetBytes);
+
+        // Front is the most recently used
+        std::list<Entry> mLRU;
+        std::unordered_map<Mesh3D*, std::list<Entry>::iterator> mLookup;
+
+        const VirtualFileSystem* mFileSystem;
+        unsigned long long mFrame;
+        ResidencyStats mStats;
+};
+
+#endif
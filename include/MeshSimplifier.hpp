@@ -0,0 +1,31 @@
+#ifndef MESHSIMPLIFIER_HPP
+#define MESHSIMPLIFIER_HPP
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <vector>
+
+/*
+    Quadric error metric simplification (Garland & Heckbert), by collapsing
+    edges onto one of their existing vertices. No vertex is moved or
+    created, so the result indexes the same vertex buffer as the input and
+    a whole LOD chain can share one VBO.
+
+    Vertices on an open border only slide along the border. Vertices that
+    share their position with another vertex (uv or color seams) are never
+    collapsed, so seams do not tear open.
+
+    positions: Mesh3D::vertexData (6 floats per vertex, xyz first)
+    targetIndexCount: stop once the result has at most this many indices
+    maxError: stop before any collapse would move the surface further than
+              this (in object space units)
+    resultError: the largest error actually introduced, in the same units
+
+    @return the number of indices in result.
+*/
+size_t SimplifyMesh(const std::vector<GLuint>& indices, const std::vector<GLfloat>& positions,
+                    size_t targetIndexCount, float maxError,
+                    std::vector<GLuint>& result, float& resultError);
+
+#endif
@@ -0,0 +1,99 @@
+#ifndef MESHLET_HPP
+#define MESHLET_HPP
+
+// Third party libraries
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+struct Mesh3D;
+class ThreadPool;
+
+/*
+    Meshlets (clusters) split the full detail level of a mesh into small
+    runs of consecutive triangles, so the parts of a dense mesh that are
+    off screen or facing away can be skipped without touching its index
+    buffer. The limits keep a cluster's vertices within what a post
+    transform cache can hold.
+*/
+const size_t MESHLET_MAX_VERTICES = 64;
+const size_t MESHLET_MAX_TRIANGLES = 124;
+
+struct Meshlet {
+    // Range of Mesh3D::indexBufferData
+    GLuint firstIndex = 0;
+    GLuint indexCount = 0;
+
+    // Bounding sphere
+    glm::vec3 center = glm::vec3(0.0f);
+    float radius = 0.0f;
+
+    // Normal cone: every triangle faces away from an eye inside the cone
+    // around -coneAxis starting at coneApex. coneCutoff is the sine of the
+    // spread of the normals, 1 when they spread too far to ever reject.
+    glm::vec3 coneApex = glm::vec3(0.0f);
+    glm::vec3 coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+    float coneCutoff = 1.0f;
+};
+
+/*
+    The culling data of all meshlets of a mesh, one array per component and
+    padded to a multiple of 4 so four meshlets are tested at a time.
+*/
+struct MeshletBounds {
+    size_t count = 0;
+    std::vector<float> centerX, centerY, centerZ, radius;
+    std::vector<float> apexX, apexY, apexZ;
+    std::vector<float> axisX, axisY, axisZ, cutoff;
+};
+
+/*
+    Cut the mesh's full detail level into meshlets and compute their bounds
+    (Mesh3D::mMeshlets and mMeshletBounds). The triangles keep their order,
+    so run OptimizeMesh first for compact clusters. Does not need OpenGL.
+*/
+void BuildMeshlets(Mesh3D* meshData,
+                   size_t maxVertices = MESHLET_MAX_VERTICES,
+                   size_t maxTriangles = MESHLET_MAX_TRIANGLES);
+
+struct MeshletCullStats {
+    unsigned int meshlets = 0;
+    unsigned int frustumCulled = 0;
+    unsigned int backfaceCulled = 0;
+    unsigned int visible = 0;
+    unsigned long long trianglesSubmitted = 0;
+    // Ranges handed to glMultiDrawElements, after merging neighbours
+    unsigned int drawRanges = 0;
+    double cullMilliseconds = 0.0;
+};
+
+/*
+    What to draw of a meshlet mesh this frame: the arguments for one
+    glMultiDrawElements call.
+*/
+struct MeshletDrawList {
+    std::vector<GLsizei> counts;
+    std::vector<const GLvoid*> offsets;
+
+    // Scratch space, one visibility flag per meshlet
+    std::vector<unsigned char> visible;
+};
+
+/*
+    Test every meshlet of a mesh against the view frustum and, when the
+    pipeline culls back faces, against its normal cone. Visible meshlets
+    that follow each other in the index buffer are merged into one range.
+
+    modelViewProjection: the full transform the mesh is drawn with
+    eye: the camera position in the mesh's object space
+    threadPool: optional, large meshes are split across the workers
+
+    @return the number of ranges in drawList.
+*/
+size_t CullMeshlets(const Mesh3D* meshData, const glm::mat4& modelViewProjection,
+                    glm::vec3 eye, bool backfaceCulling, ThreadPool* threadPool,
+                    MeshletDrawList& drawList, MeshletCullStats& stats);
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef MIPGENERATOR_HPP
+#define MIPGENERATOR_HPP
+
+#include "TextureIO.hpp"
+#include "ThreadPool.hpp"
+
+enum MipFilter {
+    // 2x2 average, the fastest. Along odd sides 3 texels, so every
+    // source texel counts the same.
+    MIP_FILTER_BOX = 0,
+    // Kaiser windowed sinc over 8x8 texels, keeps the smaller levels sharp
+    MIP_FILTER_KAISER
+};
+
+struct MipOptions {
+    MipFilter filter = MIP_FILTER_BOX;
+    // Color channels are sRGB encoded and averaged in linear space, alpha
+    // is linear either way. The texture gets TEXTURE_FORMAT_SRGB8_ALPHA8.
+    bool srgb = false;
+    // rgb holds a unit vector (0 - 255 for -1 - 1) that is renormalized in
+    // every level
+    bool normalMap = false;
+    // 0 for the full chain down to 1x1
+    unsigned int levelCount = 0;
+};
+
+/*
+    Builds the mip chain of an RGBA8 image (rows bottom to top) on the CPU,
+    so no level has to come from glGenerateMipmap.
+
+    Every level is filtered from the one above in 32 bit float, 4 channels
+    in one SSE register. The rows of a level are split over the thread pool
+    when one is given (it may be null). The Kaiser filter repeats the edge
+    texel past the edges.
+
+    texture.levels[0] is a copy of the input.
+*/
+void GenerateMips(const unsigned char* rgba, unsigned int width, unsigned int height,
+                  const MipOptions& options, ThreadPool* threadPool, TextureData& texture);
+
+#endif
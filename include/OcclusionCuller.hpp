@@ -0,0 +1,96 @@
+#ifndef OCCLUSIONCULLER_HPP
+#define OCCLUSIONCULLER_HPP
+
+#include "Mesh3D.hpp"
+#include "ThreadPool.hpp"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+struct OcclusionStats {
+    unsigned int occluders = 0;
+    unsigned long long occluderTriangles = 0;
+    unsigned int tested = 0;
+    unsigned int occluded = 0;
+    double rasterMilliseconds = 0.0;
+    double pyramidMilliseconds = 0.0;
+    double testMilliseconds = 0.0;
+};
+
+/*
+    Software occlusion culling, without the latency of GPU queries.
+
+    Each frame a few large occluder meshes are rasterized (on the workers,
+    with SSE where available) into a small depth buffer. A pyramid of its
+    farthest depths then lets IsVisible reject a bounding box with a
+    handful of reads: if the box is behind the farthest occluder depth
+    everywhere it covers, nothing of it can be seen.
+
+    Usage, once per frame:
+        BeginFrame(viewProjection);
+        AddOccluder(...) for each occluder;
+        RasterizeOccluders();
+        IsVisible(...) for each candidate, before it goes into the draw list.
+
+    Occluders must not be tested against themselves. Depth is NDC z mapped
+    to [0, 1], like the default glDepthRange.
+*/
+class OcclusionCuller {
+    public:
+        // The width is rounded up to a multiple of 4
+        OcclusionCuller(unsigned int width, unsigned int height, ThreadPool* threadPool);
+
+        void BeginFrame(const glm::mat4& viewProjection);
+
+        // The mesh's CPU data must stay around until RasterizeOccluders
+        void AddOccluder(const Mesh3D* mesh, const glm::mat4& model);
+
+        void RasterizeOccluders();
+
+        /* @return false when the box is certainly hidden by the occluders. */
+        bool IsVisible(const glm::mat4& model, glm::vec3 boundsMin, glm::vec3 boundsMax);
+
+        const OcclusionStats& GetStats() const;
+
+        // Level 0 is the full resolution depth buffer
+        unsigned int GetLevelCount() const;
+        unsigned int GetLevelWidth(unsigned int level) const;
+        unsigned int GetLevelHeight(unsigned int level) const;
+        const float* GetLevel(unsigned int level) const;
+
+    private:
+        struct Occluder {
+            const Mesh3D* mesh;
+            glm::mat4 model;
+        };
+
+        // A triangle ready for rasterization: screen space edge and depth
+        // equations, plus its pixel bounding box
+        struct ScreenTriangle {
+            float edgeA[3], edgeB[3], edgeC[3];
+            float depthX, depthY, depthC;
+            int minX, minY, maxX, maxY;
+        };
+
+        void SetupTriangles();
+        void RasterizeRows(int firstRow, int endRow);
+        void BuildPyramid();
+
+        unsigned int mWidth;
+        unsigned int mHeight;
+        ThreadPool* mThreadPool;
+
+        glm::mat4 mViewProjection;
+        std::vector<Occluder> mOccluders;
+        std::vector<glm::vec4> mClipVertices;
+        std::vector<ScreenTriangle> mTriangles;
+
+        std::vector<std::vector<float> > mLevels;
+        std::vector<unsigned int> mLevelWidths;
+        std::vector<unsigned int> mLevelHeights;
+
+        OcclusionStats mStats;
+};
+
+#endif
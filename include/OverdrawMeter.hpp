@@ -0,0 +1,65 @@
+#ifndef OVERDRAWMETER_HPP
+#define OVERDRAWMETER_HPP
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <vector>
+
+struct OverdrawStats {
+    unsigned long long coveredPixels = 0;
+    unsigned long long shadedFragments = 0;
+    // Shaded fragments per covered pixel, 1 is no overdraw at all
+    double averageOverdraw = 0.0;
+    unsigned int maxOverdraw = 0;
+};
+
+/*
+    Debug view of how often every pixel is shaded.
+
+    While counting, every fragment that passes the depth test increments
+    the stencil buffer (8 bits, it saturates at 255). Measure reads the
+    stencil back and sums it up, which stalls until the GPU is done, so
+    this is for looking at, not for measured frames. Draw shows the counts
+    as a heat map: one full screen triangle per level, through the stencil
+    test, from blue (shaded once) to red (OVERDRAW_LEVELS times or more).
+*/
+class OverdrawMeter {
+    public:
+        static const unsigned int OVERDRAW_LEVELS = 8;
+
+        OverdrawMeter();
+
+        /*
+            Takes over the linked program (shaders/overdraw*.glsl).
+
+            @return true on success.
+        */
+        bool Initialize(GLuint program);
+        bool IsInitialized() const;
+
+        // Around the draws to count, the stencil has to be cleared to 0
+        void BeginCounting();
+        void EndCounting();
+
+        void Measure(int screenWidth, int screenHeight);
+        // Replaces the picture, depth test off
+        void Draw();
+
+        const OverdrawStats& GetStats() const;
+
+        void Release();
+
+    private:
+        GLuint mProgram;
+        GLint mColorLocation;
+        GLuint mVertexArray;
+
+        std::vector<unsigned char> mStencil;
+        OverdrawStats mStats;
+};
+
+/* Sum up a stencil read back, one count per pixel. */
+OverdrawStats ComputeOverdrawStats(const unsigned char* counts, size_t pixels);
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef PERFHUD_HPP
+#define PERFHUD_HPP
+
+#include "GpuTimer.hpp"
+#include "InputMap.hpp"
+
+#include <glad/glad.h>
+
+#include <string>
+#include <vector>
+
+struct HudStats {
+    double frameMilliseconds = 0.0; // frame to frame, CPU side
+    double gpuMilliseconds = 0.0;
+    unsigned long long drawCalls = 0;
+    unsigned long long triangles = 0;
+    double residentMegabytes = 0.0;
+    double budgetMegabytes = 0.0;
+    double textureMegabytes = 0.0;
+    double textureBudgetMegabytes = 0.0;
+    InputLatency inputLatency; // of the previous frame
+};
+
+/*
+    Performance overlay: FPS, frame / GPU time, draw calls, triangles,
+    mesh and texture memory, input latency and a graph of the recent frame times.
+
+    Text comes from a 5x7 pixel font baked into a small atlas texture at
+    start-up. All text, the graph and the background are quads in one
+    dynamic vertex buffer, drawn with a single draw call. The overlay shows
+    its own CPU and GPU cost, which stays well under 0.1 ms.
+*/
+class PerfHud {
+    public:
+        PerfHud();
+
+        /*
+            Takes over the linked program (shaders/hud*.glsl) and creates
+            the atlas and vertex buffer.
+
+            @return true on success.
+        */
+        bool Initialize(GLuint program);
+        bool IsInitialized() const;
+
+        // Once per frame, also while hidden, so the graph is full when shown
+        void AddFrameTime(double milliseconds);
+
+        // Draws on top of whatever is there, blending on, depth test off
+        void Draw(const HudStats& stats, int screenWidth, int screenHeight);
+
+        void Release();
+
+    private:
+        struct HudVertex {
+            float x, y;
+            float u, v;
+            unsigned char color[4];
+        };
+
+        void BuildVertices(const HudStats& stats);
+        void AddQuad(float x0, float y0, float x1, float y1, float u0, float v0, float u1, float v1,
+                     unsigned int color);
+        void AddSolidQuad(float x0, float y0, float x1, float y1, unsigned int color);
+        void AddText(float x, float y, const char* text, unsigned int color);
+
+        GLuint mProgram;
+        GLint mScreenSizeLocation;
+        GLuint mAtlas;
+        GLuint mVertexArray;
+        GLuint mVertexBuffer;
+        GLsizeiptr mBufferCapacity;
+
+        std::vector<HudVertex> mVertices;
+
+        std::vector<float> mFrameHistory;
+        size_t mHistoryNext;
+
+        // What the overlay itself cost last time it was drawn
+        double mCpuMilliseconds;
+        GpuTimer mGpuTimer;
+};
+
+#endif
@@ -0,0 +1,101 @@
+#ifndef POSTPROCESSOR_HPP
+#define POSTPROCESSOR_HPP
+
+#include "GpuTimer.hpp"
+#include "RenderGraph.hpp"
+
+#include <glad/glad.h>
+
+#include <string>
+
+enum PostPass {
+    POST_PASS_BLOOM_DOWNSAMPLE = 0,
+    POST_PASS_BLOOM_UPSAMPLE,
+    POST_PASS_TONEMAP,
+    POST_PASS_FXAA,
+    POST_PASS_COUNT
+};
+
+// Levels of the bloom chain, each half the size of the one above
+const unsigned int BLOOM_LEVELS = 6;
+
+struct PostSettings {
+    bool bloom = true;
+    // The bloom chain starts at half the screen size (full size when off)
+    bool halfResolutionBloom = true;
+    bool fxaa = true;
+    float exposure = 1.0f;
+    // Only what is brighter goes into the bloom
+    float bloomThreshold = 1.0f;
+    float bloomStrength = 0.05f;
+};
+
+/*
+    The frame goes to an HDR target (RGBA16F, with depth and stencil) and
+    reaches the screen through a chain of full screen passes:
+
+        bloom downsample  the bright parts, halved level by level
+        bloom upsample    back up, each level added onto the one above
+        tonemap           scene + bloom, ACES curve, gamma, luma in alpha
+        fxaa              edge smoothing, straight to the screen
+
+    Without FXAA the tonemap writes to the screen, at a bloom strength of 0
+    the bloom is left out. The passes go into the frame's RenderGraph, one
+    per bloom level: the graph hands out the targets and takes each back as
+    soon as its last reader is done. They all differ in size or format, so
+    each has a texture of its own, kept from frame to frame by the pool.
+    Each of the four has its own GPU timer.
+*/
+class PostProcessor {
+    public:
+        PostProcessor();
+
+        /*
+            Takes over the linked programs (shaders/post*.glsl), all with
+            postVertexShader.glsl.
+
+            @return true on success.
+        */
+        bool Initialize(GLuint downsample, GLuint upsample, GLuint tonemap, GLuint fxaa);
+        bool IsInitialized() const;
+
+        PostSettings& GetSettings();
+
+        // Declares the chain, from the scene's color (RGBA16F) to the screen
+        void AddPasses(RenderGraph& graph, RenderResource sceneColor);
+
+        // Of the last finished measurement, 0 for passes that did not run
+        double GetPassMilliseconds(PostPass pass) const;
+        bool DidPassRun(PostPass pass) const;
+        static std::string GetPassName(PostPass pass);
+
+        // Needs the context, the destructor does not touch OpenGL
+        void Release();
+
+    private:
+        // The state and program for a full screen triangle
+        void BeginFullScreen(GLuint program);
+        // After the last pass, back to the state the scene is drawn with
+        void EndFullScreen();
+
+        PostSettings mSettings;
+
+        GLuint mDownsampleProgram;
+        GLuint mUpsampleProgram;
+        GLuint mTonemapProgram;
+        GLuint mFxaaProgram;
+        GLuint mVertexArray;
+
+        GLint mDownsampleTexelSizeLocation;
+        GLint mPrefilterLocation;
+        GLint mThresholdLocation;
+        GLint mUpsampleTexelSizeLocation;
+        GLint mBloomStrengthLocation;
+        GLint mExposureLocation;
+        GLint mFxaaTexelSizeLocation;
+
+        GpuTimer mTimers[POST_PASS_COUNT];
+        bool mRan[POST_PASS_COUNT];
+};
+
+#endif
@@ -0,0 +1,171 @@
+#ifndef RENDERGRAPH_HPP
+#define RENDERGRAPH_HPP
+
+#include "RenderTargetPool.hpp"
+
+#include <glad/glad.h>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+typedef unsigned int RenderResource;
+const RenderResource NO_RENDER_RESOURCE = 0xffffffffu;
+
+struct RenderGraphStats {
+    unsigned int passes = 0;
+    // Declared, but nothing needed what they write
+    unsigned int culledPasses = 0;
+    unsigned int transientTargets = 0;
+    unsigned int framebufferBinds = 0;
+    // Over the whole run, and how long the last one took
+    unsigned int compiles = 0;
+    double compileMilliseconds = 0.0;
+};
+
+/*
+    The passes of a frame, declared anew every frame with what they read and
+    write, then run in an order the graph works out:
+
+        - passes whose results nothing needs are culled; passes that write
+          the screen or an imported texture always run
+        - transient targets come from a RenderTargetPool just before their
+          first pass and go back right after their last, so a later one of
+          the same size and format would get the same texture; targets of
+          different sizes or formats never share memory
+        - among the passes whose inputs are ready, one drawing into the
+          framebuffer already bound goes first, otherwise the one whose
+          framebuffer the fewest later passes share: passes drawing into
+          one framebuffer end up next to each other
+        - each set of attachments keeps its own framebuffer object
+
+    Compiling only happens when the declarations differ from the last
+    compiled ones (passes, what they use, target sizes and formats), which
+    is rare: most frames just run the cached order.
+
+    OpenGL orders a draw into a texture before a later read of it by itself,
+    so the graph inserts no barriers; it refuses passes that read what they
+    draw into.
+*/
+class RenderGraph {
+    public:
+        typedef std::function<void(const RenderGraph& graph)> PassFunction;
+
+        RenderGraph(RenderTargetPool* pool);
+
+        // Forgets the last frame's declarations, not the compiled graph
+        void BeginFrame(GLsizei screenWidth, GLsizei screenHeight);
+
+        // The default framebuffer, with its own depth and stencil
+        RenderResource GetScreen() const;
+        RenderResource CreateTarget(const std::string& name, const RenderTargetDesc& desc);
+        // A texture that lives on across frames, like the shadow maps
+        RenderResource ImportTexture(const std::string& name, GLuint texture);
+
+        /* @return the pass, for Read and the Write functions. */
+        unsigned int AddPass(const std::string& name, const PassFunction& function);
+        void Read(unsigned int pass, RenderResource resource);
+        // Drawn into through the graph's framebuffer for the pass
+        void WriteColor(unsigned int pass, RenderResource resource);
+        void WriteDepth(unsigned int pass, RenderResource resource);
+        // Written some other way, a pass doing so binds its own framebuffer
+        void Write(unsigned int pass, RenderResource resource);
+
+        /*
+            Compile when needed, then run the passes. Leaves the default
+            framebuffer bound.
+
+            @return false when the graph does not compile, nothing runs then.
+        */
+        bool Execute();
+
+        // Only while the passes run, for the ones using the resource
+        GLuint GetTexture(RenderResource resource) const;
+        GLsizei GetWidth(RenderResource resource) const;
+        GLsizei GetHeight(RenderResource resource) const;
+
+        // Of the last Execute, in the order they ran
+        std::vector<std::string> GetPassOrder() const;
+
+        const RenderGraphStats& GetStats() const;
+
+        // Needs the context, the destructor does not touch OpenGL
+        void Release();
+
+    private:
+        enum ResourceKind {
+            RESOURCE_SCREEN = 0,
+            RESOURCE_TRANSIENT,
+            RESOURCE_IMPORTED
+        };
+
+        struct Resource {
+            std::string name;
+            ResourceKind kind;
+            RenderTargetDesc desc;
+            GLuint texture;
+        };
+
+        struct Pass {
+            std::string name;
+            PassFunction function;
+            std::vector<RenderResource> reads;
+            std::vector<RenderResource> writes;
+            RenderResource color;
+            RenderResource depth;
+        };
+
+        struct Framebuffer {
+            GLuint framebuffer;
+            // What it was last checked with
+            GLuint attachedColor;
+            GLuint attachedDepth;
+            bool complete;
+        };
+
+        // Adds the declaration to mTopology
+        void Declare(unsigned int a, unsigned int b, unsigned int c, unsigned int d);
+
+        bool Compile();
+        bool Validate() const;
+        void Cull();
+        void Schedule();
+        void AssignFramebuffers();
+        void ComputeLifetimes();
+
+        bool Uses(const Pass& pass, RenderResource resource) const;
+        bool Writes(const Pass& pass, RenderResource resource) const;
+
+        /* @return whether the pass can run. */
+        bool BindFramebuffer(int framebuffer, const Pass& pass);
+
+        RenderTargetPool* mPool;
+        GLsizei mScreenWidth;
+        GLsizei mScreenHeight;
+
+        std::vector<Resource> mResources;
+        std::vector<Pass> mPasses;
+        // Everything declared this frame, as numbers
+        std::vector<unsigned int> mTopology;
+
+        /* The compiled graph */
+        std::vector<unsigned int> mCompiledTopology;
+        bool mCompiled;
+        bool mValid;
+        std::vector<bool> mNeeded;
+        std::vector<unsigned int> mOrder;
+        // By pass: into mFramebuffers, or the screen or none
+        std::vector<int> mPassFramebuffers;
+        // By position in mOrder
+        std::vector<std::vector<RenderResource> > mAcquires;
+        std::vector<std::vector<RenderResource> > mReleases;
+
+        std::vector<Framebuffer> mFramebuffers;
+        unsigned int mFramebufferCount;
+        int mBoundFramebuffer;
+        std::vector<std::string> mRunOrder;
+
+        RenderGraphStats mStats;
+};
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef RENDERTARGETPOOL_HPP
+#define RENDERTARGETPOOL_HPP
+
+#include <glad/glad.h>
+
+#include <vector>
+
+struct RenderTargetDesc {
+    GLsizei width = 0;
+    GLsizei height = 0;
+    // GL_RGBA16F, GL_R11F_G11F_B10F, GL_RGBA8 or GL_DEPTH24_STENCIL8
+    GLenum format = GL_RGBA8;
+};
+
+struct RenderTargetPoolStats {
+    unsigned int textures = 0;
+    GLsizeiptr bytes = 0;
+    unsigned int acquiresThisFrame = 0;
+    // Acquires served by a texture already in the pool
+    unsigned int reusesThisFrame = 0;
+    unsigned int createdThisFrame = 0;
+};
+
+/*
+    Textures for transient render targets, handed out by size and format.
+
+    A released texture goes straight back to the pool. A later acquire of
+    the same size and format, in this frame or the next, gets it again;
+    nothing else does, a texture is never shared between sizes or formats.
+    Textures not acquired for 60 frames (e.g. after a resize) are deleted
+    in EndFrame.
+*/
+class RenderTargetPool {
+    public:
+        RenderTargetPool();
+
+        // Linear filtering, clamped to the edges, one level
+        GLuint Acquire(const RenderTargetDesc& desc);
+        void Release(GLuint texture);
+
+        // Deletes textures unused for a while, then starts a new frame
+        void EndFrame();
+
+        const RenderTargetPoolStats& GetStats() const;
+
+        // Needs the context, the destructor does not touch OpenGL
+        void Release();
+
+        /* @return the bytes of one texel of a supported format. */
+        static GLsizeiptr GetTexelBytes(GLenum format);
+
+    private:
+        struct Entry {
+            GLuint texture;
+            RenderTargetDesc desc;
+            bool inUse;
+            unsigned long long lastUsedFrame;
+        };
+
+        std::vector<Entry> mEntries;
+        unsigned long long mFrame;
+        RenderTargetPoolStats mStats;
+};
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef SCENE_HPP
+#define SCENE_HPP
+
+#include "MaterialSystem.hpp"
+#include "Mesh3D.hpp"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/* One mesh placed in the world, drawn with one of the shader programs. */
+struct SceneInstance {
+    Mesh3D* mesh = nullptr;
+    glm::mat4 model = glm::mat4(1.0f);
+    // Index into the application's shader programs
+    unsigned int program = 0;
+    // Colors and albedo, see MaterialSystem.hpp
+    MaterialId material = DEFAULT_MATERIAL;
+    // The level drawn last frame, the selection hysteresis starts from it
+    size_t lod = 0;
+};
+
+/*
+    Orders the instances by program, then by whether their material culls
+    back faces, then by mesh, then by the albedo texture their material
+    binds (none, which includes the atlas, first), then by material ID.
+    Every program, cull state, vertex array and texture is set as few times
+    as possible, instances of one mesh follow each other, and within a run
+    of them materials come in the order of their parameters.
+*/
+void SortSceneInstances(std::vector<SceneInstance>& instances, const MaterialSystem& materials);
+
+struct SceneBatchCounts {
+    unsigned int drawCalls = 0;
+    unsigned int textureBinds = 0;
+    unsigned int programSwitches = 0;
+    unsigned int cullStateChanges = 0;
+};
+
+/*
+    What drawing the sorted instances costs when every run of instances
+    with the same program, cull state, mesh and bound albedo texture is one
+    instanced draw of at most maxInstancesPerDraw, whatever their materials. Culling
+    and level of detail are left out, so this compares orders and atlases,
+    not frames.
+*/
+SceneBatchCounts CountSceneBatches(const std::vector<SceneInstance>& instances, const MaterialSystem& materials,
+                                   unsigned int maxInstancesPerDraw);
+
+#endif
@@ -0,0 +1,112 @@
+#ifndef SHADOWCASCADES_HPP
+#define SHADOWCASCADES_HPP
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+const unsigned int SHADOW_CASCADE_COUNT = 4;
+
+/*
+    Cascaded shadow maps for one directional light. The view frustum is
+    split in depth, and every split gets a layer of a depth texture array
+    rendered from the light. Near splits are short, so the texels near the
+    camera are small.
+
+    Each cascade's projection is stable. It covers a bounding sphere of its
+    split, so its size does not change as the camera turns. It is moved in
+    whole shadow texels, so its edges do not shimmer as the camera moves.
+    Only casters that can reach a cascade's box are drawn into it. Its near
+    plane hugs the sphere, casters closer to the light are drawn with depth
+    clamping: flattened onto the near plane, they still shadow the box.
+
+    Cascades can update at staggered rates: one with an interval of n
+    frames keeps its map and matrices in between. The shaders use the first
+    cascade that covers a fragment, so a stale cascade still shadows what
+    it covers.
+*/
+class ShadowCascades {
+    public:
+        // size x size texels per cascade
+        ShadowCascades(unsigned int size);
+
+        // Redraw the cascade every 'frames' frames (1: every frame)
+        void SetUpdateInterval(unsigned int cascade, unsigned int frames);
+        unsigned int GetUpdateInterval(unsigned int cascade) const;
+
+        /*
+            New splits from the projection (a glm::perspective one) and new
+            matrices for the cascades that are due this frame. Everything is
+            due when the projection or the light direction (pointing from the
+            light into the scene) changes.
+        */
+        void Update(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& lightDirection);
+
+        // Due this frame: its casters have to be drawn
+        bool IsUpdated(unsigned int cascade) const;
+
+        /* @return whether a world space sphere can cast a shadow into the cascade. */
+        bool IsCaster(unsigned int cascade, const glm::vec3& center, float radius) const;
+
+        const glm::mat4& GetLightView(unsigned int cascade) const;
+        const glm::mat4& GetLightProjection(unsigned int cascade) const;
+        // World space to shadow map coordinates: xy texture, z depth
+        glm::mat4 GetShadowMatrix(unsigned int cascade) const;
+        // View depth where the cascade's split ends
+        float GetSplitDistance(unsigned int cascade) const;
+        // World units per shadow texel
+        float GetTexelSize(unsigned int cascade) const;
+        unsigned int GetSize() const;
+
+        /*
+            Render into a cascade: binds its layer (the texture array and
+            framebuffer are created on first use), sets the viewport and
+            clears the depth, and turns on depth clamping. @return false
+            when the framebuffer is not usable.
+        */
+        bool BeginCascade(unsigned int cascade);
+        // Back to the default framebuffer, depth clamping off
+        void EndCascades();
+
+        // The depth texture array, comparing, on a texture unit
+        void Bind(GLuint unit) const;
+        // 0 until the first cascade is drawn
+        GLuint GetTexture() const;
+
+        // Needs the context, the destructor does not touch OpenGL
+        void Release();
+
+    private:
+        struct Cascade {
+            unsigned int interval = 1;
+            bool updated = false;
+            float splitDistance = 0.0f;
+            float texelSize = 0.0f;
+            glm::mat4 view = glm::mat4(1.0f);
+            glm::mat4 projection = glm::mat4(1.0f);
+            // Light space box the casters are tested against
+            glm::vec2 boxMin = glm::vec2(0.0f);
+            glm::vec2 boxMax = glm::vec2(0.0f);
+            float nearDistance = 0.0f;
+            float farDistance = 0.0f;
+        };
+
+        void UpdateCascade(unsigned int index, const glm::mat4& inverseView, float splitNear, float splitFar);
+
+        unsigned int mSize;
+        unsigned long long mFrame;
+        Cascade mCascades[SHADOW_CASCADE_COUNT];
+
+        // What the cascades were last built for
+        glm::mat4 mProjection;
+        glm::vec3 mLightDirection;
+        glm::mat4 mLightRotation;
+        float mNear;
+        float mTanHalfX;
+        float mTanHalfY;
+
+        GLuint mTexture;
+        GLuint mFramebuffer;
+        bool mComplete;
+};
+
+#endif
@@ -0,0 +1,106 @@
+#ifndef SOFTWARERASTERIZER_HPP
+#define SOFTWARERASTERIZER_HPP
+
+#include "Mesh3D.hpp"
+#include "ThreadPool.hpp"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+struct RasterStats {
+    unsigned long long trianglesSubmitted = 0;
+    // After near plane clipping and back face culling
+    unsigned long long trianglesRasterized = 0;
+    unsigned long long pixelsShaded = 0;
+    double setupMilliseconds = 0.0;
+    double rasterMilliseconds = 0.0;
+};
+
+/*
+    A CPU reference for the OpenGL path, for machines without a GPU and as
+    ground truth for image comparisons.
+
+    It draws the same Mesh3D data with the same model / view / projection
+    matrices as PreDraw and shades like fragmentShader.glsl: the vertex
+    color, interpolated perspective correct. Rasterization follows the GL
+    rules (pixel centers, top-left fill rule, near plane clipping, depth
+    test GL_LESS when enabled). Vertex data is read as floats, so a mesh
+    drawn in VERTEX_FORMAT_PACKED on the GPU may differ by a quantization
+    step.
+
+    Triangles are set up and binned into screen tiles by DrawMesh; Flush
+    rasterizes the tiles in parallel, each in submission order, with SSE
+    edge functions where available.
+*/
+class SoftwareRasterizer {
+    public:
+        SoftwareRasterizer(unsigned int width, unsigned int height, ThreadPool* threadPool);
+
+        // Matches glEnable / glDisable, both off by default like in PreDraw
+        void SetDepthTest(bool enabled);
+        void SetBackfaceCulling(bool enabled);
+
+        // Color and depth (to 1), drops anything not flushed yet
+        void Clear(glm::vec4 color);
+
+        void DrawMesh(const Mesh3D* mesh, const glm::mat4& model, const glm::mat4& view,
+                      const glm::mat4& projection);
+        // A range of the index buffer, e.g. one level of detail
+        void DrawMesh(const Mesh3D* mesh, const glm::mat4& model, const glm::mat4& view,
+                      const glm::mat4& projection, size_t firstIndex, size_t indexCount);
+
+        void Flush();
+
+        // Like glReadPixels(GL_RGBA, GL_UNSIGNED_BYTE): bottom row first
+        void ReadPixels(std::vector<unsigned char>& rgba) const;
+
+        unsigned int GetWidth() const;
+        unsigned int GetHeight() const;
+
+        const RasterStats& GetStats() const;
+        void ResetStats();
+
+    private:
+        // Everything rasterization needs, as planes a * x + b * y + c in
+        // window coordinates
+        struct Triangle {
+            float edge[3][3];
+            bool topLeft[3];
+            float inverseW[3];
+            float colorOverW[3][3];
+            float depth[3];
+            int minX, minY, maxX, maxY;
+        };
+
+        struct ClipVertex {
+            glm::vec4 position;
+            glm::vec3 color;
+        };
+
+        void SetupTriangle(const ClipVertex& a, const ClipVertex& b, const ClipVertex& c);
+        void RasterizeTile(unsigned int tile);
+
+        unsigned int mWidth;
+        unsigned int mHeight;
+        // Rows are padded to a multiple of 4 pixels
+        unsigned int mStride;
+        ThreadPool* mThreadPool;
+
+        bool mDepthTest;
+        bool mBackfaceCulling;
+
+        std::vector<unsigned int> mColor; // RGBA8
+        std::vector<float> mDepth;
+
+        unsigned int mTilesX;
+        unsigned int mTilesY;
+        std::vector<Triangle> mTriangles;
+        std::vector<std::vector<unsigned int> > mTileBins;
+        std::vector<unsigned long long> mTilePixels;
+        std::vector<ClipVertex> mVertices;
+
+        RasterStats mStats;
+};
+
+#endif
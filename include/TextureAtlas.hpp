@@ -0,0 +1,74 @@
+#ifndef TEXTUREATLAS_HPP
+#define TEXTUREATLAS_HPP
+
+#include "TextureIO.hpp"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/*
+    Skyline bin packer. The top edge of everything placed so far is kept
+    as a list of horizontal segments, and a new rectangle goes where its
+    top ends up lowest (then leftmost).
+*/
+class SkylinePacker {
+    public:
+        SkylinePacker(unsigned int width, unsigned int height);
+
+        /* @return false when the rectangle does not fit anywhere. */
+        bool Insert(unsigned int width, unsigned int height, unsigned int& x, unsigned int& y);
+
+        // Fraction of the area covered by the inserted rectangles
+        float GetOccupancy() const;
+
+    private:
+        struct Segment {
+            int x;
+            int y;
+            int width;
+        };
+
+        bool Fits(size_t index, int width, int height, int& y) const;
+
+        int mWidth;
+        int mHeight;
+        unsigned long long mUsedArea;
+        std::vector<Segment> mSkyline;
+};
+
+/*
+    Where a packed texture ended up. Its UVs map to rect.xy + uv * rect.zw
+    on the given layer.
+*/
+struct AtlasEntry {
+    int layer = -1; // -1 when the texture was left out
+    glm::vec4 rect = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+};
+
+// Levels of every atlas layer. The gutters and alignment keep the packed
+// textures apart down to the smallest one.
+const unsigned int ATLAS_LEVEL_COUNT = 4;
+
+/*
+    Packs small textures into the layers (layerSize x layerSize) of a
+    texture array, so they can all be drawn with a single bind.
+
+    Only uncompressed textures of the given format that are at most
+    maxTextureSize on a side are packed; the others get layer -1. Every
+    packed texture sits on an 8 texel grid with an 8 texel gutter of its
+    edge texels around it. Its own mip levels are copied into the layer
+    levels, so nothing from a neighbour is ever filtered in, and UVs
+    outside 0 - 1 must be clamped.
+
+    @return the number of textures packed.
+*/
+unsigned int PackTextureAtlas(const std::vector<const TextureData*>& textures, TextureFormat format,
+                              unsigned int layerSize, unsigned int maxTextureSize,
+                              std::vector<AtlasEntry>& entries, std::vector<TextureData>& layers);
+
+/* Upload layers (all of one size) as a GL_TEXTURE_2D_ARRAY. @return 0 when there are none. */
+GLuint CreateTextureArray(const std::vector<TextureData>& layers);
+
+#endif
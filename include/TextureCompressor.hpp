@@ -0,0 +1,58 @@
+#ifndef TEXTURECOMPRESSOR_HPP
+#define TEXTURECOMPRESSOR_HPP
+
+#include "TextureIO.hpp"
+#include "ThreadPool.hpp"
+
+#include <cstddef>
+
+enum CompressionQuality {
+    // Endpoints straight from the principal axis of the block, for iterating
+    // on assets
+    COMPRESSION_FAST = 0,
+    // Refines the endpoints by least squares and tries every block mode and
+    // p-bit combination, for shipping builds
+    COMPRESSION_HIGH
+};
+
+/*
+    Encodes one 4x4 block. texels holds 16 RGBA8 texels, row by row, block
+    gets 8 bytes for BC1 and 16 for the others.
+
+    BC1 switches to its 3 color mode with a transparent index when any alpha
+    is below 128. BC5 stores red and green, BC7 always uses mode 6 (one
+    subset, RGBA endpoints with p-bits, 4 bit indices).
+*/
+void EncodeBlock(TextureFormat format, const unsigned char* texels, CompressionQuality quality,
+                 unsigned char* block);
+
+/* The reverse of EncodeBlock. BC7 blocks in modes other than 6 come out magenta. */
+void DecodeBlock(TextureFormat format, const unsigned char* block, unsigned char* texels);
+
+/*
+    Compresses every level of an RGBA8 or SRGB8_ALPHA8 texture to format
+    (TEXTURE_FORMAT_BC1, _BC3, _BC5 or _BC7). sRGB sources get the _SRGB
+    variant, and cannot go to BC5.
+
+    Block rows are split over the thread pool when one is given (it may be
+    null). Levels that are not a multiple of 4 repeat their edge texels.
+
+    @return true on success.
+*/
+bool CompressTexture(const TextureData& source, TextureFormat format, CompressionQuality quality,
+                     ThreadPool* threadPool, TextureData& compressed);
+
+/*
+    Decodes every level back to RGBA8 (SRGB8_ALPHA8 for the sRGB formats),
+    for measuring quality and for drivers without the extension. BC5 gives
+    blue 0 and alpha 255.
+
+    @return true on success.
+*/
+bool DecompressTexture(const TextureData& compressed, ThreadPool* threadPool, TextureData& rgba);
+
+/* PSNR in dB of b against a over the channels in channelMask (1 red, 2 green, 4 blue, 8 alpha). */
+double ComputePSNR(const unsigned char* a, const unsigned char* b, size_t texelCount,
+                   unsigned int channelMask);
+
+#endif
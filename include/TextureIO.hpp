@@ -0,0 +1,90 @@
+#ifndef TEXTUREIO_HPP
+#define TEXTUREIO_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+enum TextureFormat {
+    TEXTURE_FORMAT_RGBA8 = 0,        // 4 bytes per texel, linear
+    TEXTURE_FORMAT_SRGB8_ALPHA8 = 1, // 4 bytes per texel, sRGB color, linear alpha
+
+    // Block compressed, 4x4 texels per block, see TextureCompressor.hpp
+    TEXTURE_FORMAT_BC1 = 2,          // 8 bytes: RGB, 1 bit alpha
+    TEXTURE_FORMAT_BC1_SRGB = 3,
+    TEXTURE_FORMAT_BC3 = 4,          // 16 bytes: RGB, smooth alpha
+    TEXTURE_FORMAT_BC3_SRGB = 5,
+    TEXTURE_FORMAT_BC5 = 6,          // 16 bytes: two channels (normal map xy)
+    TEXTURE_FORMAT_BC7 = 7,          // 16 bytes: RGBA, best quality
+    TEXTURE_FORMAT_BC7_SRGB = 8
+};
+
+/*
+    Texture file format (little endian)
+
+    TextureFileHeader
+    TextureLevel levels[levelCount]   level 0 (full size) first
+    ...          level data           coarsest level first, every level
+                                      16 byte aligned
+
+    The coarse levels sit at the front of the data, so a reader that only
+    needs the small ones touches just the first few pages of the file.
+*/
+struct TextureFileHeader {
+    char magic[4];                 // "TEX1"
+    unsigned int version;
+    unsigned int format;           // TextureFormat
+    unsigned int width;
+    unsigned int height;
+    unsigned int levelCount;
+};
+
+struct TextureLevel {
+    unsigned int width;
+    unsigned int height;
+    unsigned long long offset;     // from the start of the file
+    unsigned long long size;
+};
+
+const unsigned int TEXTURE_FILE_VERSION = 1;
+
+/* One mip level in memory, levels[0] is the full size. */
+struct TextureImage {
+    unsigned int width = 0;
+    unsigned int height = 0;
+    std::vector<unsigned char> data;
+};
+
+struct TextureData {
+    TextureFormat format = TEXTURE_FORMAT_RGBA8;
+    std::vector<TextureImage> levels;
+};
+
+/* Bytes of one level of the given size, whole blocks for block formats. */
+size_t GetTextureLevelBytes(TextureFormat format, unsigned int width, unsigned int height);
+
+bool IsCompressedFormat(TextureFormat format);
+bool IsSRGBFormat(TextureFormat format);
+
+/* Number of levels of a full chain down to 1x1. */
+unsigned int GetFullMipCount(unsigned int width, unsigned int height);
+
+/* The texture file contents, as SaveTextureBinary would write them. */
+void SerializeTexture(const TextureData& texture, std::vector<unsigned char>& bytes);
+
+/* @return true on success. */
+bool SaveTextureBinary(const std::string& fileName, const TextureData& texture);
+
+/*
+    Checks the header and level table of a texture file in memory, without
+    copying any texel data. Every level is within the file afterwards.
+
+    @return true when it is a valid texture file.
+*/
+bool ReadTextureLevels(const unsigned char* data, size_t size, TextureFileHeader& header,
+                       std::vector<TextureLevel>& levels);
+
+/* Copies all levels out of a texture file in memory. @return true on success. */
+bool LoadTextureFromMemory(const unsigned char* data, size_t size, TextureData& texture);
+
+#endif
@@ -0,0 +1,132 @@
+#ifndef TEXTUREMANAGER_HPP
+#define TEXTUREMANAGER_HPP
+
+#include "AssetLoader.hpp"
+#include "TextureIO.hpp"
+#include "ThreadPool.hpp"
+#include "VirtualFileSystem.hpp"
+
+#include <glad/glad.h>
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/*
+    A texture whose finer mip levels come and go. It is ASSET_READY (and
+    can be sampled) as soon as its coarse levels are on the GPU.
+*/
+struct TextureAsset : public Asset {
+    GLuint mTexture = 0;
+    TextureFormat mFormat = TEXTURE_FORMAT_RGBA8;
+    std::vector<TextureLevel> mLevels;
+
+    // The file: a view into the archive when possible, mFile otherwise
+    const unsigned char* mFileData = nullptr;
+    std::vector<unsigned char> mFile;
+
+    // GL thread only. Levels are counted like GL does, 0 is the full size.
+    // mResidentLevel is the finest level on the GPU (= GL_TEXTURE_BASE_LEVEL).
+    int mResidentLevel = 0;
+    int mWantedLevel = 0;
+    int mRequestedLevel = 0;
+    unsigned long long mLastRequestFrame = 0;
+    GLsizeiptr mResidentBytes = 0;
+};
+
+/*
+    Counters describing what the texture manager did. The 'ThisFrame'
+    values are reset by Update.
+*/
+struct TextureStats {
+    GLsizeiptr budgetBytes = 0;
+    GLsizeiptr residentBytes = 0;
+    unsigned int textures = 0;
+    // Ready, but with fewer levels than the screen asks for
+    unsigned int streamingTextures = 0;
+
+    GLsizeiptr uploadedBytesThisFrame = 0;
+    unsigned long long uploadedBytesTotal = 0;
+    unsigned int levelsStreamedThisFrame = 0;
+    unsigned int levelsDroppedThisFrame = 0;
+
+    // True when the wanted levels do not fit the budget
+    bool overBudget = false;
+};
+
+/*
+    Loads textures from texture files (see TextureIO.hpp) and streams their
+    mip levels by on-screen size.
+
+    Files are read on the thread pool, where a file with only the full
+    size level also gets its mip chain (box filtered). Block compressed
+    files (see TextureCompressor.hpp) go to the GPU as they are, unless the
+    driver lacks the extension, then they are decoded there first.
+
+    The GL thread first uploads the small levels of a new texture, so it
+    can be drawn right away, then adds one finer level at a time, as many as
+    fit the per-frame upload budget, to the textures that are drawn larger
+    than their finest resident level.
+    GL_TEXTURE_BASE_LEVEL and GL_TEXTURE_MAX_LEVEL keep sampling within the
+    resident levels.
+
+    Resident bytes are kept within a budget. To make room, the finest levels
+    of textures that are larger than they need to be (or have not been drawn
+    for a while) are dropped again, least recently drawn first.
+*/
+class TextureManager {
+    public:
+        TextureManager(ThreadPool* threadPool, const VirtualFileSystem* fileSystem,
+                       GLsizeiptr budgetBytes, GLsizeiptr uploadBytesPerFrame);
+        ~TextureManager();
+
+        TextureAsset* Load(const std::string& fileName);
+
+        // A texture made in memory, it is uploaded by the next Update
+        TextureAsset* Create(const std::string& name, const TextureData& data);
+
+        /* Copies every level of a ready texture. @return false when it is not ready. */
+        bool ReadTexture(const TextureAsset* texture, TextureData& data) const;
+
+        // Frees the GL texture and the file of a ready texture that is no
+        // longer drawn, e.g. once it was copied into the atlas. The asset
+        // stays around, as ASSET_RELEASED.
+        void Unload(TextureAsset* texture);
+
+        /*
+            The texture is drawn this frame with its whole UV range covering
+            about screenPixels pixels (along its larger side). Call for every
+            use, the largest one counts.
+        */
+        void Request(TextureAsset* texture, float screenPixels);
+
+        // Once per frame on the GL thread: finishes loads, then streams
+        // levels for the requests since the previous Update
+        void Update();
+
+        void SetBudget(GLsizeiptr budgetBytes);
+        const TextureStats& GetStats() const;
+
+    private:
+        void CreateTexture(TextureAsset* texture);
+        void UploadLevel(TextureAsset* texture, int level);
+        void DropLevel(TextureAsset* texture);
+        bool MakeRoom(GLsizeiptr bytes, const TextureAsset* keep);
+
+        ThreadPool* mThreadPool;
+        const VirtualFileSystem* mFileSystem;
+        GLsizeiptr mUploadBytesPerFrame;
+
+        // Filled by workers, drained by Update
+        std::mutex mLoadedMutex;
+        std::deque<TextureAsset*> mLoaded;
+
+        std::vector<TextureAsset*> mTextures;
+        std::atomic<unsigned int> mWorkerJobs;
+        unsigned long long mFrame;
+        TextureStats mStats;
+};
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef THREADPOOL_HPP
+#define THREADPOOL_HPP
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+    A fixed set of worker threads pulling jobs from a single queue.
+
+    Jobs must not touch OpenGL, the context only lives on the main thread.
+*/
+class ThreadPool {
+    public:
+        ThreadPool(unsigned int workerCount);
+        ~ThreadPool();
+
+        // Run a job on one of the workers at some point in the future
+        void Submit(const std::function<void()>& job);
+
+        /*
+            Split [0, count) into chunks of 'grain' items and run them on the
+            workers. The calling thread helps out and only returns once every
+            chunk is done.
+        */
+        void ParallelFor(unsigned int count, unsigned int grain,
+                         const std::function<void(unsigned int begin, unsigned int end)>& body);
+
+        unsigned int GetWorkerCount() const;
+
+        // One worker per hardware thread, leaving one for the main thread
+        static unsigned int DefaultWorkerCount();
+
+    private:
+        void WorkerMain();
+
+        std::vector<std::thread> mWorkers;
+        std::deque<std::function<void()> > mJobs;
+        std::mutex mMutex;
+        std::condition_variable mWakeUp;
+        bool mShutdown;
+};
+
+#endif
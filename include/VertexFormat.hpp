@@ -0,0 +1,97 @@
+#ifndef VERTEXFORMAT_HPP
+#define VERTEXFORMAT_HPP
+
+// Third party libraries
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+// C++ standard template library (STL)
+#include <vector>
+
+/*
+    Attribute locations, these match the layout(location=...) in
+    vertexShader.glsl.
+*/
+enum VertexAttributeLocation {
+    ATTRIBUTE_POSITION = 0,
+    ATTRIBUTE_COLOR = 1,
+    ATTRIBUTE_NORMAL = 2,
+    ATTRIBUTE_UV = 3
+};
+
+enum VertexFormat {
+    // 32 bit floats everywhere (24 bytes for position + color)
+    VERTEX_FORMAT_FLOAT = 0,
+    // position: 4 x 16 bit unorm relative to the bounding box
+    // color:    RGBA8 unorm
+    // normal:   see NormalEncoding
+    // uv:       2 x half float
+    VERTEX_FORMAT_PACKED
+};
+
+enum NormalEncoding {
+    // 2 x 16 bit snorm, octahedral mapping of the unit sphere
+    NORMAL_ENCODING_OCTAHEDRAL = 0,
+    // 10:10:10:2 snorm (GL_INT_2_10_10_10_REV)
+    NORMAL_ENCODING_INT_2_10_10_10
+};
+
+/*
+    Everything glVertexAttribPointer needs to know about one attribute.
+*/
+struct VertexAttribute {
+    GLuint location;
+    GLint components;
+    GLenum type;
+    GLboolean normalized;
+    GLsizei offset;
+};
+
+/*
+    Vertex buffers hold two streams: every position first, tightly packed
+    (positionStride apart), then the other attributes interleaved (stride
+    apart). Depth only passes read the position stream and nothing else.
+    Offsets are relative to the start of a vertex in its stream.
+*/
+struct VertexLayout {
+    std::vector<VertexAttribute> attributes;
+    GLsizei positionStride = 0;
+    GLsizei stride = 0;
+};
+
+VertexLayout MakeVertexLayout(VertexFormat format, NormalEncoding normalEncoding,
+                              bool hasNormals, bool hasUVs);
+
+/*
+    Lay out and (for VERTEX_FORMAT_PACKED) quantize vertex streams
+    according to layout. normals and uvs may be null.
+
+    positionsAndColors: 6 floats per vertex, as in Mesh3D::vertexData
+    normals:            3 floats per vertex
+    uvs:                2 floats per vertex
+*/
+void EncodeVertices(const VertexLayout& layout, VertexFormat format, NormalEncoding normalEncoding,
+                    size_t vertexCount, const GLfloat* positionsAndColors,
+                    const GLfloat* normals, const GLfloat* uvs,
+                    glm::vec3 boundsMin, glm::vec3 boundsExtent,
+                    std::vector<unsigned char>& stream);
+
+/*
+    Bind the attributes of layout to the vertex buffer currently bound to
+    GL_ARRAY_BUFFER, in the currently bound vertex array object. The
+    buffer holds vertexCount vertices, the interleaved stream starts right
+    after their positions.
+*/
+void ApplyVertexLayout(const VertexLayout& layout, size_t vertexCount);
+
+/* Like ApplyVertexLayout, but only the position stream. */
+void ApplyPositionLayout(const VertexLayout& layout);
+
+/* @return the bytes of vertexCount vertices, both streams. */
+size_t GetVertexBytes(const VertexLayout& layout, size_t vertexCount);
+
+// Octahedral normal encoding, result in [-1, 1]^2
+glm::vec2 EncodeOctahedral(glm::vec3 normal);
+glm::vec3 DecodeOctahedral(glm::vec2 encoded);
+
+#endif
@@ -0,0 +1,115 @@
+#ifndef VIRTUALFILESYSTEM_HPP
+#define VIRTUALFILESYSTEM_HPP
+
+#include "ThreadPool.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+    Packed archive format (little endian)
+
+    PackHeader
+    PackEntry entries[entryCount]   sorted by pathHash
+    char      names[]               paths of the entries, not null terminated
+    ...       file data             every entry 16 byte aligned
+*/
+struct PackHeader {
+    char magic[4];              // "PAK1"
+    uint32_t version;
+    uint32_t entryCount;
+    uint32_t flags;
+    uint64_t entriesOffset;
+    uint64_t namesOffset;
+};
+
+struct PackEntry {
+    uint64_t pathHash;
+    uint64_t offset;            // from the start of the archive
+    uint64_t storedSize;        // size in the archive
+    uint64_t rawSize;           // size once decompressed
+    uint32_t nameOffset;        // from namesOffset
+    uint16_t nameLength;
+    uint16_t compression;       // PackCompression
+};
+
+enum PackCompression {
+    PACK_COMPRESSION_NONE = 0,
+    PACK_COMPRESSION_LZ = 1     // BlockCodec frame
+};
+
+const uint32_t PACK_VERSION = 1;
+
+/*
+    Read-only view of a file mapped into memory.
+*/
+class MappedFile {
+    public:
+        MappedFile();
+        ~MappedFile();
+
+        bool Open(const std::string& fileName);
+        void Close();
+
+        const unsigned char* GetData() const;
+        size_t GetSize() const;
+
+    private:
+        MappedFile(const MappedFile&);
+        MappedFile& operator=(const MappedFile&);
+
+        const unsigned char* mData;
+        size_t mSize;
+#ifdef _WIN32
+        void* mFileHandle;
+        void* mMappingHandle;
+#endif
+};
+
+/*
+    All asset reads go through here.
+
+    Files are looked up in the loose overlay directories first (so assets
+    can be edited without rebuilding the archive during development) and
+    then in the mounted archive. The archive is opened and mapped once;
+    every lookup after that is a binary search over the path hashes.
+
+    Reading is thread safe once mounting is done.
+*/
+class VirtualFileSystem {
+    public:
+        VirtualFileSystem();
+
+        bool MountArchive(const std::string& fileName);
+        void AddOverlayDirectory(const std::string& directory);
+
+        // Compressed entries are decoded on these threads when set
+        void SetThreadPool(ThreadPool* threadPool);
+
+        bool Exists(const std::string& path) const;
+        bool ReadFile(const std::string& path, std::vector<unsigned char>& contents) const;
+        bool ReadText(const std::string& path, std::string& text) const;
+
+        // Direct pointer into the archive for uncompressed entries, no copy.
+        // Fails when overlays are active, fall back to ReadFile then.
+        bool GetView(const std::string& path, const unsigned char*& data, size_t& size) const;
+
+        static std::string NormalizePath(const std::string& path);
+        static uint64_t HashPath(const std::string& normalizedPath);
+
+    private:
+        const PackEntry* FindEntry(const std::string& normalizedPath) const;
+        bool ReadLooseFile(const std::string& normalizedPath, std::vector<unsigned char>& contents) const;
+
+        MappedFile mArchive;
+        const PackEntry* mEntries;
+        uint32_t mEntryCount;
+        const char* mNames;
+
+        std::vector<std::string> mOverlayDirectories;
+        ThreadPool* mThreadPool;
+};
+
+#endif
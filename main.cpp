@@ -7,6 +7,8 @@
 #include "display/display.h"
 
 // C++ standard template library (STL)
+#include <algorithm>
+#include <cstring>
 #include <vector>
 #include <iostream>
 #include <fstream>
@@ -20,7 +22,31 @@
 #include <glm/ext/scalar_constants.hpp> // glm::pi
 
 /* Our libraries */
+#include "BenchmarkReport.hpp"
+#include "BenchmarkScene.hpp"
 #include "Camera.hpp"
+#include "FixedTimestep.hpp"
+#include "FrameProfiler.hpp"
+#include "InputRecorder.hpp"
+#include "LightClusters.hpp"
+#include "MaterialSystem.hpp"
+#include "Mesh3D.hpp"
+#include "MeshGenerator.hpp"
+#include "MeshLOD.hpp"
+#include "OcclusionCuller.hpp"
+#include "PerfHud.hpp"
+#include "PostProcessor.hpp"
+#include "RenderGraph.hpp"
+#include "RenderTargetPool.hpp"
+#include "Scene.hpp"
+#include "ShadowCascades.hpp"
+#include "MeshResidency.hpp"
+#include "OverdrawMeter.hpp"
+#include "TextureAtlas.hpp"
+#include "TextureManager.hpp"
+#include "ThreadPool.hpp"
+#include "AssetLoader.hpp"
+#include "VirtualFileSystem.hpp"
 
 glm::mat4 camera(float Translate, glm::vec2 const& Rotate)
 {
@@ -33,82 +59,294 @@ glm::mat4 camera(float Translate, glm::vec2 const& Rotate)
 }
 /* end of glm */
 
-/* globals */
-std::string LoadShaderAsString(const std::string& fileName)
-{
-    /* Resulting shader program loaded as a single string */
-    std::string result = "";
-
-    std::string line = "";
-    std::ifstream myFile(fileName.c_str());
+// A linked program and where its uniforms live, looked up once
+struct ShaderProgram {
+    GLuint mProgram = 0;
+    GLint mViewLocation = -1;
+    GLint mProjectionLocation = -1;
+    GLint mBoundsMinLocation = -1;
+    GLint mBoundsExtentLocation = -1;
+    GLint mOctahedralNormalsLocation = -1;
+    GLint mLightingLocation = -1;
+    GLint mClusterTileSizeLocation = -1;
+    GLint mClusterDepthLocation = -1;
+    GLint mSunDirectionLocation = -1;
+    GLint mSunColorLocation = -1;
+    GLint mShadowMatricesLocation = -1;
+};
 
-    if (myFile.is_open())
-    {
-        while (std::getline(myFile, line)) {
-            result += line + '\n';
-        }
+/*
+    Per instance data, as the Instances uniform block in vertexShader.glsl
+    lays it out (std140).
+*/
+struct InstanceData {
+    glm::mat4 model;
+    glm::ivec4 indices; // x: material
+};
 
-        myFile.close();
-    }
+/*
+    Instances waiting to be recorded together: same program, cull state,
+    mesh, level of detail and bound albedo texture. Their materials may
+    differ.
+*/
+struct DrawBatch {
+    unsigned int program = 0;
+    bool cullBackFaces = false;
+    Mesh3D* mesh = nullptr;
+    size_t lod = 0;
+    TextureAsset* texture = nullptr;
+    // Some of the materials sample the atlas
+    bool atlased = false;
+    std::vector<InstanceData> instances;
+};
 
-    return result;
-}
+/*
+    One draw of the frame, recorded once and replayed by every pass, so the
+    depth pre-pass and the main pass draw exactly the same triangles.
+*/
+struct DrawCommand {
+    unsigned int program = 0;
+    bool cullBackFaces = false;
+    Mesh3D* mesh = nullptr;
+    TextureAsset* texture = nullptr;
+    bool atlased = false;
+    // Where its instances start in the frame's instance buffer
+    GLintptr instanceOffset = 0;
+    GLsizei instanceCount = 0;
+    // An instanced draw of this index range...
+    MeshLOD range;
+    // ... or, when rangeCount > 0, the visible meshlet ranges in
+    // gMeshletCounts / gMeshletOffsets
+    size_t firstRange = 0;
+    size_t rangeCount = 0;
+};
 
 struct App {
     // shader
     // The following stores the a unique id for the graphics pipeline
     // program object that will be used for our OpenGL draw calls.
     GLuint mGraphicsPipelineShaderProgram = 0;
+    // Every program scene instances can use, the graphics pipeline first
+    std::vector<ShaderProgram> mPrograms;
+    // Positions only, depth only: the depth pre-pass
+    ShaderProgram mDepthProgram;
+
+    // Shader sources, loaded in the background
+    TextAsset* mVertexShaderAsset = nullptr;
+    TextAsset* mFragmentShaderAsset = nullptr;
+    TextAsset* mHudVertexShaderAsset = nullptr;
+    TextAsset* mHudFragmentShaderAsset = nullptr;
+    TextAsset* mDepthVertexShaderAsset = nullptr;
+    TextAsset* mDepthFragmentShaderAsset = nullptr;
+    TextAsset* mOverdrawVertexShaderAsset = nullptr;
+    TextAsset* mOverdrawFragmentShaderAsset = nullptr;
+    TextAsset* mPostVertexShaderAsset = nullptr;
+    TextAsset* mPostDownsampleShaderAsset = nullptr;
+    TextAsset* mPostUpsampleShaderAsset = nullptr;
+    TextAsset* mPostTonemapShaderAsset = nullptr;
+    TextAsset* mPostFxaaShaderAsset = nullptr;
 
     /* Our Camera */
     // Create a single global camera
     Camera* mCamera = new Camera();
-};
 
-struct Mesh3D {
-    // OpenGL Objects
-    // Vertex Array Object (VAO)
-    // Vertex array objects encapsulate all of the items needed to render an object.
-    // For example, we may have multiple vertex buffer objects (VBO) related to rendering one
-    // object. The VAO allows us to setup the OpenGL state to render that object using
-    // the correct layout and correct buffers with one call after being setup.
-
-    // Vertex Buffer Object (VBO)
-    // Vertex Buffer Objects store information relating to vertices (e.g. positions,
-    // normals, textures)
-    // VBOs are our mechanism for arranging geometry on the GPU.
-    GLuint mVertexArrayObject = 0; // VAO
-    GLuint mVertexBufferObject = 0; // VBO
-    GLuint mIndexBufferObject = 0; // IBO (EBO)
-
-    std::vector<GLfloat> vertexData {
-            // 0 - Vertex
-            -0.5f, -0.5f, 0.0f, // position
-            1.0f, 0.0f, 0.0f, // color
-            // 1 - Vertex
-            0.5f, -0.5f, 0.0f, // position
-            0.0f, 1.0f, 0.0f, // color
-            // 2 - Vertex
-            -0.5f, 0.5f, 0.0f, // position
-            0.0f, 0.0f, 1.0f, // color
-            // 3 - Vertex
-            0.5f, 0.5f, 0.0f, // position
-            1.0f, 0.0f, 0.0f, // color
-    };
-
-    std::vector<GLuint> indexBufferData {
-            2, 0, 1, 3, 2, 1
-    };
-
-    float m_uOffset = -2.0f;
-    float m_uRotate = 0.0f;
-    float m_uScale = 0.5f;
+    // Kept from PreDraw, level of detail selection and culling need them
+    glm::mat4 mView = glm::mat4(1.0f);
+    glm::mat4 mProjection = glm::mat4(1.0f);
+    float mViewportWidth = 1.0f;
+    float mViewportHeight = 1.0f;
 };
 
 /* Globals */
 App* gApp = new App(); // Global Application
 Mesh3D* gMesh1 = new Mesh3D();
 
+// Keeps the meshes we draw on the GPU within a fixed amount of memory
+const GLsizeiptr gMeshBudgetBytes = 256 * 1024 * 1024;
+MeshResidencyManager* gResidency = new MeshResidencyManager(gMeshBudgetBytes);
+
+// All assets are read through the file system, see MountAssets
+VirtualFileSystem* gFileSystem = new VirtualFileSystem();
+
+// Background asset loading, at most gUploadBytesPerFrame reach the GPU each frame
+const GLsizeiptr gUploadBytesPerFrame = 4 * 1024 * 1024;
+const GLsizeiptr gStagingBufferBytes = 1024 * 1024;
+ThreadPool* gThreadPool = new ThreadPool(ThreadPool::DefaultWorkerCount());
+AssetLoader* gLoader = new AssetLoader(gThreadPool, gFileSystem, gUploadBytesPerFrame, gStagingBufferBytes);
+
+// Textures stream their mip levels in by size on screen, within a budget
+const GLsizeiptr gTextureBudgetBytes = 128 * 1024 * 1024;
+TextureManager* gTextures = new TextureManager(gThreadPool, gFileSystem, gTextureBudgetBytes, gUploadBytesPerFrame);
+// --texture: applied to gMesh1
+TextureAsset* gTexture = nullptr;
+// --grid N: gMesh1 is an N x N grid instead of the quad, big enough to be
+// split into meshlets and culled cluster by cluster
+unsigned int gDemoGridSize = 0;
+// Every texture the scene uses, the atlas is built once they are all ready
+std::vector<TextureAsset*> gSceneTextures;
+
+// Material parameters sit in one uniform buffer (64 bytes each, 16 KB in
+// all), instances pick theirs by ID
+const unsigned int gMaxMaterials = 256;
+const GLuint gMaterialBlockBinding = 1;
+MaterialSystem* gMaterials = new MaterialSystem(gMaxMaterials);
+
+// Small textures are packed into the layers of one array texture, so
+// instances of a mesh draw together whatever their texture. --no-atlas
+// binds every texture on its own instead.
+bool gUseAtlas = true;
+bool gAtlasBuilt = false;
+const unsigned int gAtlasLayerSize = 2048;
+const unsigned int gAtlasMaxTextureSize = 512;
+GLuint gAtlasTexture = 0;
+
+// Runs of instances of one mesh are one instanced draw. The data of all
+// of a frame's draws goes up in one uniform buffer, every draw binds its
+// part as the Instances block (16 KB is the smallest a driver may allow).
+const unsigned int gMaxInstancesPerDraw = 128;
+const GLuint gInstanceBlockBinding = 0;
+GLuint gInstanceBuffer = 0;
+GLsizeiptr gInstanceBufferBytes = 0;
+size_t gInstanceOffsetAlignment = 256;
+DrawBatch gBatch;
+// The frame's draws, recorded once for every pass
+std::vector<DrawCommand> gDrawList;
+std::vector<unsigned char> gFrameInstances;
+std::vector<GLsizei> gMeshletCounts;
+std::vector<const GLvoid*> gMeshletOffsets;
+// What is bound on the albedo units and the cull state, reset every frame
+TextureAsset* gBoundTexture = nullptr;
+bool gAtlasBound = false;
+bool gCullingEnabled = false;
+
+// The depth pre-pass (F3, --no-prepass) draws depth only, then the main
+// pass shades what is left with GL_EQUAL, without overdraw. F2 shows (and
+// measures) the overdraw instead of the picture.
+bool gDepthPrePass = true;
+bool gShowOverdraw = false;
+OverdrawMeter* gOverdraw = new OverdrawMeter();
+
+// Clustered forward lighting: every frame the lights are binned into the
+// clusters of the view frustum on the workers, and fragments only shade
+// with the lights of their own cluster. The three buffer textures sit on
+// units 2 to 4. No lights, no lighting.
+std::vector<Light> gLights;
+const GLuint gLightTextureUnit = 2;
+LightClusters* gLightClusters = new LightClusters(gThreadPool);
+
+// The sun and its cascaded shadow maps (--shadows), on unit 5. Far
+// cascades are redrawn less often (--no-shadow-stagger: all of them every
+// frame). Each cascade draws the casters that reach it, recorded after the
+// scene's draws into gDrawList.
+bool gShadows = false;
+bool gShadowStagger = true;
+const unsigned int gShadowMapSize = 1024;
+const unsigned int gShadowIntervals[SHADOW_CASCADE_COUNT] = { 1, 1, 2, 4 };
+const GLuint gShadowTextureUnit = 5;
+const glm::vec3 gSunDirection = glm::normalize(glm::vec3(-0.4f, -1.0f, -0.3f));
+const glm::vec3 gSunColor(1.0f, 0.95f, 0.85f);
+ShadowCascades* gShadowCascades = new ShadowCascades(gShadowMapSize);
+// View space to shadow map, this frame
+glm::mat4 gShadowMatrices[SHADOW_CASCADE_COUNT];
+size_t gSceneDrawCount = 0;
+size_t gShadowDrawFirst[SHADOW_CASCADE_COUNT];
+size_t gShadowDrawEnd[SHADOW_CASCADE_COUNT];
+GpuTimer gShadowGpuTimers[SHADOW_CASCADE_COUNT];
+std::vector<double> gShadowGpuSamples[SHADOW_CASCADE_COUNT];
+
+// Either turns on the lighting in the shaders
+bool gLighting = false;
+
+// The frame is drawn in HDR and reaches the screen through bloom, tone
+// mapping and FXAA (--no-post: straight to the screen, also while the
+// overdraw view is on; --no-bloom, --no-fxaa, --full-res-bloom).
+bool gPostProcessing = true;
+PostProcessor* gPost = new PostProcessor();
+bool gPostThisFrame = false;
+// Only the frames the pass ran in
+std::vector<double> gPostGpuSamples[POST_PASS_COUNT];
+
+// Every pass of the frame declares what it reads and writes, the graph
+// culls, orders and runs them. Its targets come from a pool that keeps
+// them from one frame to the next.
+RenderTargetPool* gRenderTargets = new RenderTargetPool();
+RenderGraph* gRenderGraph = new RenderGraph(gRenderTargets);
+
+// What we draw: gMesh1, or the stress scene when benchmarking. Sorted by
+// program and mesh once it is built.
+std::vector<SceneInstance> gScene;
+std::vector<MeshAsset*> gSceneAssets;
+
+// --bench: stress scene, scripted camera and a JSON report at the end
+BenchmarkConfig gBenchmark;
+std::vector<Mesh3D*> gBenchmarkMeshes;
+
+// CPU time per subsystem and per frame counts
+FrameProfiler gProfiler;
+const unsigned int gInputSection = gProfiler.AddSection("input");
+const unsigned int gStreamingSection = gProfiler.AddSection("streaming");
+const unsigned int gOcclusionSection = gProfiler.AddSection("occlusion");
+const unsigned int gLightSection = gProfiler.AddSection("lights");
+const unsigned int gShadowSection = gProfiler.AddSection("shadows");
+const unsigned int gDrawSection = gProfiler.AddSection("draw");
+const unsigned int gSwapSection = gProfiler.AddSection("swap");
+const unsigned int gDrawCallCounter = gProfiler.AddCounter("draw_calls");
+const unsigned int gDepthDrawCallCounter = gProfiler.AddCounter("depth_draw_calls");
+const unsigned int gShadowDrawCallCounters[SHADOW_CASCADE_COUNT] = {
+    gProfiler.AddCounter("shadow_draw_calls_0"),
+    gProfiler.AddCounter("shadow_draw_calls_1"),
+    gProfiler.AddCounter("shadow_draw_calls_2"),
+    gProfiler.AddCounter("shadow_draw_calls_3")
+};
+const unsigned int gProgramSwitchCounter = gProfiler.AddCounter("program_switches");
+const unsigned int gTextureBindCounter = gProfiler.AddCounter("texture_binds");
+const unsigned int gMaterialUploadCounter = gProfiler.AddCounter("material_uploads");
+const unsigned int gTriangleCounter = gProfiler.AddCounter("triangles");
+// Input sampling to submission per frame, next to the profiler frames
+std::vector<double> gInputLatencySamples;
+// Average lights per cluster, over all of them and over the lit ones
+std::vector<double> gLightsPerClusterSamples;
+std::vector<double> gLightsPerLitClusterSamples;
+
+// Performance overlay (F1) and the GPU time of the scene it shows, the
+// depth pre-pass and the scene pass each timed on their own
+PerfHud* gHud = new PerfHud();
+GpuTimer gDepthPrePassGpuTimer;
+GpuTimer gSceneGpuTimer;
+
+// Level of detail: largest error on screen, in pixels, and what we submitted
+const float gLODPixelThreshold = 1.0f;
+LODStats gLODStats;
+
+// Cluster culling of dense meshes, the normal cones only for materials
+// that cull back faces
+MeshletDrawList gMeshletDrawList;
+MeshletCullStats gMeshletStats;
+
+// Occlusion culling: each frame the scene instances that look biggest
+// (of simple enough meshes) are picked as occluders and rasterized on the
+// CPU, everything else is tested against them before it is drawn
+const size_t gMaxOccluders = 16;
+const size_t gMaxOccluderTriangles = 1500;
+// Bounding radius over distance, smaller ones hide too little
+const float gMinOccluderSize = 0.05f;
+// By scene instance, whether it is one of this frame's occluders
+std::vector<bool> gIsOccluder;
+const unsigned int gOcclusionWidth = 256;
+const unsigned int gOcclusionHeight = 224;
+OcclusionCuller* gOcclusion = new OcclusionCuller(gOcclusionWidth, gOcclusionHeight, gThreadPool);
+
+// Start-up latency measurement
+Uint64 gStartCounter = 0;
+
+// Input and camera movement run in fixed steps. With --record the input of
+// every step goes to a file, --replay plays it back one step per frame, so
+// every run draws the same sequence of frames.
+const double gStepSeconds = 1.0 / 120.0;
+const unsigned int gMaxStepsPerFrame = 8;
+FixedTimestep gTimestep(gStepSeconds, gMaxStepsPerFrame);
+InputRecorder* gInputRecorder = new InputRecorder();
+
 /* Error handling routines */
 static void GLClearAllErrors()
 {
@@ -162,336 +400,1700 @@ and the OpenGL context (with the appropriate version)
 */
 void PreDraw(Display* display)
 {
-    glDisable(GL_DEPTH_TEST);
+    gPostThisFrame = gPostProcessing && gPost->IsInitialized() && !display->getShowOverdraw();
+
+    // Depth writes have to be on for the clear
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_LESS);
+    glDepthMask(GL_TRUE);
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+    // Culling is set per draw, from the materials
     glDisable(GL_CULL_FACE);
+    gCullingEnabled = false;
 
-    glViewport(0,0,
-               display->getScreenWidth(),
-               display->getScreenHeight());
-    glClearColor(1.0f, 0.984f, 0.0f, 1.f);
-    glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
+    gDepthPrePass = display->getDepthPrePass() && gApp->mDepthProgram.mProgram != 0;
+    gShowOverdraw = display->getShowOverdraw() && gOverdraw->IsInitialized();
+    gLighting = !gLights.empty() || gShadows;
 
-    glUseProgram(gApp->mGraphicsPipelineShaderProgram);
-    
-    // Model transformation by translating the object to world space
-    glm::mat4 model = glm::translate(glm::mat4(1.0f),
-                                     glm::vec3(0.0f, 0.0f,
-                                               gMesh1->m_uOffset));
-    // Rotate it
-    model = glm::rotate(model, glm::radians(gMesh1->m_uRotate),
-                        glm::vec3(1.0f, 1.0f, 1.0f));
-
-    float scale = gMesh1->m_uScale;
-    model = glm::scale(model, glm::vec3(scale,
-                                        scale,
-                                        scale));
-
-    // Retrieve our location of our model matrix
-    GLint u_ModelMatrixLocation = glGetUniformLocation(gApp->mGraphicsPipelineShaderProgram,
-                                                       "u_ModelMatrix");
-
-    if (u_ModelMatrixLocation >= 0) {
-        glUniformMatrix4fv(u_ModelMatrixLocation, 1, false, &model[0][0]);
-    } else {
-        std::cout << "Could not find model matrix uniform(s), maybe a mispelling?\n" << std::endl;
+    // Model transformation: translate, rotate and scale the object into
+    // world space (see GetMeshModelMatrix)
+    if (!gBenchmark.enabled) {
+        gScene[0].model = GetMeshModelMatrix(gMesh1);
     }
 
     /* View matrix */
-    glm::mat4 view = gApp->mCamera->GetViewMatrix();
-    GLint u_ViewLocation = glGetUniformLocation(gApp->mGraphicsPipelineShaderProgram, "u_ViewMatrix");
+    gApp->mView = gApp->mCamera->GetViewMatrix();
+
+    // Projection matrix (in perspective)
+    gApp->mProjection = gApp->mCamera->GetProjectionMatrix(
+        (float) display->getScreenWidth()/(float)display->getScreenHeight());
+    gApp->mViewportWidth = (float) display->getScreenWidth();
+    gApp->mViewportHeight = (float) display->getScreenHeight();
+}
+
+/*
+    Bind a program and give it a view and projection: the camera's, or a
+    shadow cascade's.
+*/
+void UseProgram(const ShaderProgram& program, const glm::mat4& view, const glm::mat4& projection)
+{
+    glUseProgram(program.mProgram);
 
-    if (u_ViewLocation >= 0) {
-        glUniformMatrix4fv(u_ViewLocation, 1, false, &view[0][0]);
+    if (program.mViewLocation >= 0) {
+        glUniformMatrix4fv(program.mViewLocation, 1, false, &view[0][0]);
     } else {
         std::cout << "Could not find viewmatrix uniform, maybe a mispelling?\n" <<  std::endl;
     }
 
-    // Projection matrix (in perspective)
-    glm::mat4 projection = glm::perspective(
-        glm::radians(45.0f),
-        (float) display->getScreenWidth()/(float)display->getScreenHeight(),
-        0.1f, // how close can we see things, if something is closer then we cannot see it
-        10.0f
-    );
-
-    // Retrieve our location of our perspective matrix
-    GLint u_ProjectionLocation = glGetUniformLocation(gApp->mGraphicsPipelineShaderProgram, "u_Projection");
-
-    if (u_ProjectionLocation >= 0) {
-        glUniformMatrix4fv(u_ProjectionLocation, 1, false, &projection[0][0]);
+    if (program.mProjectionLocation >= 0) {
+        glUniformMatrix4fv(program.mProjectionLocation, 1, false, &projection[0][0]);
     } else {
         std::cout << "Could not find projection uniform, maybe a mispelling?\n" << std::endl;
     }
+
+    // The depth program shades nothing
+    if (program.mLightingLocation >= 0) {
+        glUniform1i(program.mLightingLocation, gLighting);
+        glUniform2f(program.mClusterTileSizeLocation, gApp->mViewportWidth / CLUSTER_TILES_X,
+                    gApp->mViewportHeight / CLUSTER_TILES_Y);
+        glUniform2f(program.mClusterDepthLocation, gLightClusters->GetDepthScale(),
+                    gLightClusters->GetDepthBias());
+    }
+
+    // Black without a sun, then there is no shadow lookup either
+    if (program.mSunColorLocation >= 0) {
+        glm::vec3 towardsSun = -glm::mat3(view) * gSunDirection;
+        glm::vec3 color = gShadows ? gSunColor : glm::vec3(0.0f);
+
+        glUniform3fv(program.mSunDirectionLocation, 1, &towardsSun[0]);
+        glUniform3fv(program.mSunColorLocation, 1, &color[0]);
+        glUniformMatrix4fv(program.mShadowMatricesLocation, SHADOW_CASCADE_COUNT, false, &gShadowMatrices[0][0][0]);
+    }
 }
 
-void Draw()
+/*
+    Bind the mesh's vertex array and tell the program how to decode its
+    vertices. The depth pre-pass binds the one with positions only.
+*/
+void UseMesh(Mesh3D* mesh, const ShaderProgram& program, bool positionsOnly)
 {
+    // How to turn the mesh's (possibly quantized) vertices back into floats
+    if (program.mBoundsMinLocation >= 0 && program.mBoundsExtentLocation >= 0) {
+        glUniform3fv(program.mBoundsMinLocation, 1, &mesh->mPositionBoundsMin[0]);
+        glUniform3fv(program.mBoundsExtentLocation, 1, &mesh->mPositionBoundsExtent[0]);
+    } else {
+        std::cout << "Could not find position bounds uniforms, maybe a mispelling?\n" << std::endl;
+    }
+
+    // Only used when the mesh has normals, so it may be optimized out
+    if (program.mOctahedralNormalsLocation >= 0) {
+        glUniform1i(program.mOctahedralNormalsLocation,
+                    mesh->mVertexFormat == VERTEX_FORMAT_PACKED
+                    && mesh->mNormalEncoding == NORMAL_ENCODING_OCTAHEDRAL);
+    }
+
     /* Enable our attributes */
-    glBindVertexArray(gMesh1->mVertexArrayObject);
-    
-    /* Render data */
-    //glDrawArrays(GL_TRIANGLES, 0, 6);
-    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+    glBindVertexArray(positionsOnly ? mesh->mPositionArrayObject : mesh->mVertexArrayObject);
+}
 
-    /* Stop using our current graphics pipeline */
-    /* Note: This is not necessary if we only have one graphics pipeline. */
-    glUseProgram(0);
+/*
+    Bind the textures of a draw, unless they already are. The atlas has a
+    unit of its own, so it never has to be bound twice in a frame. Whether
+    to sample them is up to the materials.
+*/
+void UseTexture(bool atlased, TextureAsset* texture)
+{
+    if (atlased && !gAtlasBound)
+    {
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, gAtlasTexture);
+        glActiveTexture(GL_TEXTURE0);
+        gAtlasBound = true;
+        gProfiler.AddToCounter(gTextureBindCounter, 1);
+    }
+
+    if (texture != nullptr && texture->IsReady() && texture != gBoundTexture)
+    {
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, texture->mTexture);
+        gBoundTexture = texture;
+        gProfiler.AddToCounter(gTextureBindCounter, 1);
+    }
 }
 
-void MainLoop(Display* display)
+/* Back face culling as the material of the draw wants it. */
+void UseCulling(bool cullBackFaces)
 {
-    while (!display->getGQuit())
+    if (cullBackFaces == gCullingEnabled)
     {
-        display->Input(gApp->mCamera);
-        PreDraw(display);
-        Draw();
-        SDL_GL_SwapWindow(display->getGraphicsApplicationWindow());
+        return;
+    }
+
+    if (cullBackFaces) {
+        glEnable(GL_CULL_FACE);
+    } else {
+        glDisable(GL_CULL_FACE);
     }
+
+    gCullingEnabled = cullBackFaces;
 }
 
 /*
+    Append instances to the frame's instance data. Every draw binds a whole
+    Instances block from its first instance on, so the start is aligned for
+    glBindBufferRange.
 
-Setup your geometry during the vertex specification step
-@return void
-
+    @return where they start, in bytes.
 */
-void VertexSpecification(Mesh3D* meshData)
-{
-    /*
-    
-    Geometry data
-    here we are going to store x, y and z position attributes within vertexPositions
-    for the data.
-    
-    For now, this information is just stored in the CPU, and we are going to store
-    this data on the GPU shortly, in a call to glBufferData which will store
-    the information into a vertex buffer object.
-
-    Note: That I have segregated the data from the OpenGL calls this function.
-
-    */
-
-    // Lives on the cpu
-    const std::vector<GLfloat> vertexData = meshData->vertexData;
-
-    /*
-    
-    Vertex Array Object (VAO) Setup
-    Note: We can think of the VAO as a 'wrapper around' all of the vertex buffer
-    objects, in the sense that it encapsulates all vbo state that we are setting up
-    Thus, it is also important that we glBindVertexArray (i. e. select the vao we
-    want to use) before our vertex buffer object operations.
-
-    We bind (i.e. select) to the vertex array object (vao) that we want to work
-    with.
-    
-    */
+GLintptr AddFrameInstances(const InstanceData* instances, size_t count)
+{
+    size_t offset = (gFrameInstances.size() + gInstanceOffsetAlignment - 1)
+                    / gInstanceOffsetAlignment * gInstanceOffsetAlignment;
 
-/*
-        We are working with gl_array_buffer or gl_element_array_buffer
-        size of the data in bytes
-        raw array of data
-        how we intend to use the data
-
-
-        For our given vertex array object, we need to tell OpenGL
-        how the information our buffer will be used.
-
-        for the specific attribute in our vertex specification, we use
-        glVertexAttribPointer to figure out how we are going to move through
-        the data
-
-        attribute 0 corresponds to the enabled glEnableVertexAttribArray
-
-        In the future, you will see in our vertex shader this also correspond to (layout=0)
-        which selects these attributes
-
-        the number of components (e.g. x, y, z = 3 components)
-    */
-
-   /*
-    
-    Vertex Buffer Object (VBO) creation
-    Create a new vertex buffer object
-    Note: We'll see this pattern of code often in OpenGL of creating and
-    binding to a buffer.
-
-    Next we will do glBindBuffer
-    Bind is equivalent to 'selecting the active buffer object' that we want to
-    work with in OpenGL.
-
-    Now, in our currently binded buffer, we populate the data from our
-    'vertexPositions' which is on the CPU, onto a buffer that will store
-    on the GPU.
-
-    */
-    // Start generating our VBO
-
-    // We start setting things up on the GPU
-    glGenVertexArrays(1, &meshData->mVertexArrayObject);
-    glBindVertexArray(meshData->mVertexArrayObject);
-
-    /* Vertex coords buffer */
-    glGenBuffers(1, &meshData->mVertexBufferObject);
-    glBindBuffer(GL_ARRAY_BUFFER, meshData->mVertexBufferObject);
-    glBufferData(GL_ARRAY_BUFFER,
-                 vertexData.size() * sizeof(GLfloat ),
-                vertexData.data(), 
-                GL_STATIC_DRAW);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(
-        0, // layout=0
-        3, // number of components
-        GL_FLOAT, // type
-        false, // is the data normalized
-        sizeof(GLfloat ) * 6, // Stride (how to get the next component)
-        (GLvoid*)0 // Offset
-    );
-
-    /* Setup the index buffer object (IBO) or EBO(Element Array Object Buffer)  */
-    const std::vector<GLuint> indexBufferData = meshData->indexBufferData;
-
-    glGenBuffers(1, &meshData->mIndexBufferObject);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, meshData->mIndexBufferObject);
-    /* Populate our Index Buffer */
-    glBufferData(
-        GL_ELEMENT_ARRAY_BUFFER,
-        indexBufferData.size() * sizeof(GLuint),
-        indexBufferData.data(),
-        GL_STATIC_DRAW
-    );
-
-    /*Color information*/
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(
-        1,
-        3,
-        GL_FLOAT,
-        false,
-        sizeof(GLfloat) * 6,
-        (void*) (sizeof(GLfloat) * 3)
-    );
-    
-    glBindVertexArray(0);
-
-    glDisableVertexAttribArray(0);
-    glDisableVertexAttribArray(1);
+    gFrameInstances.resize(offset + count * sizeof(InstanceData));
+    std::memcpy(&gFrameInstances[offset], instances, count * sizeof(InstanceData));
+
+    return (GLintptr) offset;
 }
 
-/*
-    CompileShader will compile any valid vertex, fragment, geometry, tesselation or
-    compute shader.
+/* Record the instances collected in gBatch as one instanced draw. */
+void FlushBatch()
+{
+    if (gBatch.instances.empty())
+    {
+        return;
+    }
 
-    @param type We use the 'type' field to determine which shader we
-    are going to compile.
+    DrawCommand command;
+    command.program = gBatch.program;
+    command.cullBackFaces = gBatch.cullBackFaces;
+    command.mesh = gBatch.mesh;
+    command.texture = gBatch.texture;
+    command.atlased = gBatch.atlased;
+    command.instanceOffset = AddFrameInstances(gBatch.instances.data(), gBatch.instances.size());
+    command.instanceCount = (GLsizei) gBatch.instances.size();
+    command.range = GetMeshLOD(gBatch.mesh, gBatch.lod);
+    gDrawList.push_back(command);
+
+    gBatch.instances.clear();
+}
 
-    @param source: The shader source code.
-    @return id of the shaderObject.
+/*
+    Record one instance: occlusion test, level of detail and, at full
+    detail, cluster culling. Instances that are not cluster culled go to
+    gBatch, to be drawn with the next instances of the same mesh.
 */
-GLuint CompileShader(GLuint type, const std::string& source)
+void RecordInstance(SceneInstance& instance, bool occluder)
 {
-    GLuint shaderObject;
+    Mesh3D* mesh = instance.mesh;
 
-    if (type == GL_VERTEX_SHADER)
+    /* Skip whatever the occluders hide, they would hide themselves */
+    if (!occluder && !gOcclusion->IsVisible(instance.model, mesh->mBoundsMin, mesh->mBoundsMax))
     {
-        shaderObject = glCreateShader(GL_VERTEX_SHADER);
-    } else if (type == GL_FRAGMENT_SHADER)
+        return;
+    }
+
+    /* Make sure the mesh is on the GPU before we draw it */
+    if (!gResidency->MakeResident(mesh))
     {
-        shaderObject = glCreateShader(GL_FRAGMENT_SHADER);
+        return;
     }
 
-    const char* src = source.c_str();
-    glShaderSource(shaderObject, 1, &src, nullptr);
-    glCompileShader(shaderObject);
+    /* Pick the level of detail from the mesh's size on screen */
+    glm::vec3 position(instance.model[3]);
+    float scale = glm::length(glm::vec3(instance.model[0]));
+    float distance = glm::length(gApp->mCamera->GetEye() - position);
+    float pixelsPerUnit = PixelsPerObjectUnit(gApp->mProjection, gApp->mViewportHeight, distance, scale);
+    size_t previousLOD = instance.lod;
+    size_t lod = SelectMeshLOD(mesh, previousLOD, pixelsPerUnit, gLODPixelThreshold);
+    instance.lod = lod;
 
-    /* Retrieve the result of our compilation */
-    int result;
+    TextureAsset* texture = gMaterials->GetBoundAlbedo(instance.material);
+    bool atlased = gMaterials->IsAtlased(instance.material);
+    bool cullBackFaces = gMaterials->Get(instance.material).cullBackFaces;
 
-    /* Our goal with glGetShaderiv is to retrieve the compilation status */
-    glGetShaderiv(shaderObject, GL_COMPILE_STATUS, &result);
+    if (texture != nullptr && texture->IsReady())
+    {
+        // The UV range is assumed to span the mesh's larger side
+        glm::vec3 size = mesh->mBoundsMax - mesh->mBoundsMin;
+        gTextures->Request(texture, pixelsPerUnit * std::max(size.x, std::max(size.y, size.z)));
+    }
 
-    if (result == GL_FALSE)
+    InstanceData data;
+    data.model = instance.model;
+    data.indices = glm::ivec4((int) instance.material, 0, 0, 0);
+
+    /* Render data */
+    //glDrawArrays(GL_TRIANGLES, 0, 6);
+    if (lod == 0 && mesh->mMeshlets.size() > 1)
     {
-        int length;
-        glGetShaderiv(shaderObject, GL_INFO_LOG_LENGTH, &length);
-        char* errorMessages = new char[length];
-        glGetShaderInfoLog(shaderObject, length, &length, errorMessages);
+        // Full detail: only the clusters that can be seen, on its own. The
+        // normal cones may only reject clusters when back faces are culled.
+        glm::vec3 eye = glm::vec3(glm::inverse(instance.model) * glm::vec4(gApp->mCamera->GetEye(), 1.0f));
+        unsigned long long submittedBefore = gMeshletStats.trianglesSubmitted;
 
-        if (type == GL_VERTEX_SHADER)
+        size_t ranges = CullMeshlets(mesh, gApp->mProjection * gApp->mView * instance.model, eye,
+                                     cullBackFaces, gThreadPool, gMeshletDrawList, gMeshletStats);
+
+        if (ranges > 0)
         {
-            std::cout << "ERROR: GL_VERTEX_SHADER compilation failed!\n" << errorMessages << std::endl;
+            DrawCommand command;
+            command.program = instance.program;
+            command.cullBackFaces = cullBackFaces;
+            command.mesh = mesh;
+            command.texture = texture;
+            command.atlased = atlased;
+            command.instanceOffset = AddFrameInstances(&data, 1);
+            command.instanceCount = 1;
+            command.firstRange = gMeshletCounts.size();
+            command.rangeCount = ranges;
+            gDrawList.push_back(command);
+
+            gMeshletCounts.insert(gMeshletCounts.end(), gMeshletDrawList.counts.begin(),
+                                  gMeshletDrawList.counts.begin() + ranges);
+            gMeshletOffsets.insert(gMeshletOffsets.end(), gMeshletDrawList.offsets.begin(),
+                                   gMeshletDrawList.offsets.begin() + ranges);
         }
-        else if (type == GL_FRAGMENT_SHADER) 
+
+        gLODStats.trianglesThisFrame += gMeshletStats.trianglesSubmitted - submittedBefore;
+    }
+    else
+    {
+        if (gBatch.program != instance.program || gBatch.cullBackFaces != cullBackFaces
+            || gBatch.mesh != mesh || gBatch.lod != lod || gBatch.texture != texture
+            || gBatch.instances.size() == gMaxInstancesPerDraw)
         {
-            std::cout << "ERROR: GL_FRAGMENT_SHADER compilation failed!" << errorMessages << std::endl;
+            FlushBatch();
+
+            gBatch.program = instance.program;
+            gBatch.cullBackFaces = cullBackFaces;
+            gBatch.mesh = mesh;
+            gBatch.lod = lod;
+            gBatch.texture = texture;
+            gBatch.atlased = false;
         }
 
-        /* Reclaim our memory */
-        delete[] errorMessages;
+        gBatch.atlased = gBatch.atlased || atlased;
+        gBatch.instances.push_back(data);
+        gLODStats.trianglesThisFrame += GetMeshLOD(mesh, lod).indexCount / 3;
+    }
 
-        /* Delete our broken shader */
-        glDeleteShader(shaderObject);
+    gLODStats.fullDetailTrianglesThisFrame += GetMeshLOD(mesh, 0).indexCount / 3;
+    gLODStats.lodSwitchesThisFrame += lod != previousLOD;
+}
 
-        return 0;
+/*
+    Hand the frame's instance data to the GPU, once for every pass.
+*/
+void UploadFrameInstances()
+{
+    // The last draw binds a whole block too
+    GLsizeiptr bytes = (GLsizeiptr) (gFrameInstances.size() + gMaxInstancesPerDraw * sizeof(InstanceData));
+
+    if (bytes > gInstanceBufferBytes)
+    {
+        gInstanceBufferBytes = bytes * 2;
     }
 
-    return shaderObject;
+    glBindBuffer(GL_UNIFORM_BUFFER, gInstanceBuffer);
+    // Orphan last frame's data instead of waiting for it
+    glBufferData(GL_UNIFORM_BUFFER, gInstanceBufferBytes, nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, (GLsizeiptr) gFrameInstances.size(), gFrameInstances.data());
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
 }
 
-GLuint CreateShaderProgram(const std::string& vertexShaderSource, const std::string &fragmentShaderSource)
+/*
+    Replay the recorded draws from first to end. Depth only passes (the
+    pre-pass and the shadow cascades) draw them with the depth program and
+    positions only, the main pass with their own programs (sorted, so each
+    one is bound once) and textures.
+*/
+void DrawList(size_t first, size_t end, bool depthOnly, const glm::mat4& view, const glm::mat4& projection)
 {
-    GLuint programObject = glCreateProgram();
+    unsigned int boundProgram = (unsigned int) gApp->mPrograms.size();
+    const ShaderProgram* program = &gApp->mDepthProgram;
 
-    GLuint myVertexShader = CompileShader(GL_VERTEX_SHADER, vertexShaderSource);
-    GLuint myFragmentShader = CompileShader(GL_FRAGMENT_SHADER, fragmentShaderSource);
+    if (depthOnly)
+    {
+        UseProgram(gApp->mDepthProgram, view, projection);
+    }
+    else if (gLighting)
+    {
+        gLightClusters->Bind(gLightTextureUnit);
 
-    glAttachShader(programObject, myVertexShader);
-    glAttachShader(programObject, myFragmentShader);
-    glLinkProgram(programObject);
+        if (gShadows)
+        {
+            gShadowCascades->Bind(gShadowTextureUnit);
+        }
+    }
 
-    /* Validate our program */
-    glValidateProgram(programObject);
+    for (size_t i = first; i < end; i++)
+    {
+        const DrawCommand& command = gDrawList[i];
 
-    glDetachShader(programObject, myVertexShader);
-    glDetachShader(programObject, myFragmentShader);
+        if (!depthOnly && command.program != boundProgram)
+        {
+            boundProgram = command.program;
+            program = &gApp->mPrograms[boundProgram];
+            UseProgram(*program, view, projection);
+            gProfiler.AddToCounter(gProgramSwitchCounter, 1);
+        }
 
-    glDeleteShader(myVertexShader);
-    glDeleteShader(myFragmentShader);
+        UseCulling(command.cullBackFaces);
+        glBindBufferRange(GL_UNIFORM_BUFFER, gInstanceBlockBinding, gInstanceBuffer, command.instanceOffset,
+                          gMaxInstancesPerDraw * sizeof(InstanceData));
+        UseMesh(command.mesh, *program, depthOnly);
 
-    return programObject;
+        if (!depthOnly)
+        {
+            UseTexture(command.atlased, command.texture);
+        }
+
+        if (command.rangeCount > 0)
+        {
+            glMultiDrawElements(GL_TRIANGLES, &gMeshletCounts[command.firstRange], command.mesh->mIndexType,
+                                &gMeshletOffsets[command.firstRange], (GLsizei) command.rangeCount);
+        }
+        else
+        {
+            size_t indexSize = command.mesh->mIndexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+
+            glDrawElementsInstanced(GL_TRIANGLES, command.range.indexCount, command.mesh->mIndexType,
+                                    (GLvoid*) (command.range.firstIndex * indexSize), command.instanceCount);
+        }
+    }
 }
 
-void CreateGraphicsPipeline()
+/*
+    Record the casters of the cascades that are due this frame, after the
+    scene's draws. They are drawn depth only from the light, both faces, at
+    the level of detail their size in shadow texels calls for.
+*/
+void RecordShadowCasters()
 {
-    std::string vertexShaderSource = LoadShaderAsString("./shaders/vertexShader.glsl");
-    std::string fragmentShaderSource = LoadShaderAsString("./shaders/fragmentShader.glsl");
+    gShadowCascades->Update(gApp->mView, gApp->mProjection, gSunDirection);
+
+    for (unsigned int cascade = 0; cascade < SHADOW_CASCADE_COUNT; cascade++)
+    {
+        gShadowMatrices[cascade] = gShadowCascades->GetShadowMatrix(cascade) * glm::inverse(gApp->mView);
+        gShadowDrawFirst[cascade] = gDrawList.size();
+
+        if (gShadowCascades->IsUpdated(cascade))
+        {
+            for (size_t i = 0; i < gScene.size(); i++)
+            {
+                const SceneInstance& instance = gScene[i];
+                Mesh3D* mesh = instance.mesh;
+                float scale = glm::length(glm::vec3(instance.model[0]));
+                glm::vec3 center = glm::vec3(instance.model
+                                             * glm::vec4((mesh->mBoundsMin + mesh->mBoundsMax) * 0.5f, 1.0f));
+                float radius = glm::length(mesh->mBoundsMax - mesh->mBoundsMin) * 0.5f * scale;
+
+                if (!gShadowCascades->IsCaster(cascade, center, radius) || !gResidency->MakeResident(mesh))
+                {
+                    continue;
+                }
+
+                // Coarsest level that stays under the threshold. Unlike
+                // SelectMeshLOD there is no hysteresis, nothing is kept
+                // from the last frame.
+                float pixelsPerUnit = scale / gShadowCascades->GetTexelSize(cascade);
+                size_t lod = 0;
+
+                while (lod + 1 < mesh->mLODs.size()
+                       && mesh->mLODs[lod + 1].error * pixelsPerUnit <= gLODPixelThreshold)
+                {
+                    lod++;
+                }
+
+                // An empty batch may still hold the last scene draw's state
+                if (gBatch.instances.empty() || gBatch.mesh != mesh || gBatch.lod != lod
+                    || gBatch.instances.size() == gMaxInstancesPerDraw)
+                {
+                    FlushBatch();
+
+                    gBatch.program = 0;
+                    gBatch.cullBackFaces = false;
+                    gBatch.mesh = mesh;
+                    gBatch.lod = lod;
+                    gBatch.texture = nullptr;
+                    gBatch.atlased = false;
+                }
+
+                InstanceData data;
+                data.model = instance.model;
+                data.indices = glm::ivec4((int) instance.material, 0, 0, 0);
+                gBatch.instances.push_back(data);
+            }
+
+            FlushBatch();
+        }
 
-    gApp->mGraphicsPipelineShaderProgram = CreateShaderProgram(vertexShaderSource, fragmentShaderSource);
+        gShadowDrawEnd[cascade] = gDrawList.size();
+    }
 }
 
-void CleanUpMeshData()
+/*
+    Draw the recorded casters into the cascades that are due, each between
+    its own GPU timer.
+*/
+void DrawShadows()
 {
-    glDeleteBuffers(1, &gMesh1->mVertexBufferObject);
-    glDeleteVertexArrays(1, &gMesh1->mVertexArrayObject);
+    // Keeps surfaces from shadowing themselves
+    glEnable(GL_POLYGON_OFFSET_FILL);
+    glPolygonOffset(2.0f, 4.0f);
+
+    for (unsigned int cascade = 0; cascade < SHADOW_CASCADE_COUNT; cascade++)
+    {
+        if (!gShadowCascades->IsUpdated(cascade))
+        {
+            continue;
+        }
+
+        if (!gShadowCascades->BeginCascade(cascade))
+        {
+            gShadows = false;
+            break;
+        }
+
+        gShadowGpuTimers[cascade].Begin();
+        DrawList(gShadowDrawFirst[cascade], gShadowDrawEnd[cascade], true,
+                 gShadowCascades->GetLightView(cascade), gShadowCascades->GetLightProjection(cascade));
+        gShadowGpuTimers[cascade].End();
+
+        gProfiler.AddToCounter(gShadowDrawCallCounters[cascade], gShadowDrawEnd[cascade] - gShadowDrawFirst[cascade]);
+    }
+
+    gShadowCascades->EndCascades();
+    glDisable(GL_POLYGON_OFFSET_FILL);
 }
 
-int main(int argc, char *argv[])
+/* Clear the scene's target, in the first of the scene's passes. */
+void BeginScenePasses()
 {
-    // 1. setup the graphics program
-    Display* display = new Display("First OpenGL", 1000, 900);
+    glClearColor(1.0f, 0.984f, 0.0f, 1.f);
+    glClearStencil(0);
+    glDepthMask(GL_TRUE);
+    glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
 
-    // 2. setup our geometry
-    VertexSpecification(gMesh1);
+    gBoundTexture = nullptr;
+    gAtlasBound = false;
+}
 
-    // 3. Create our graphics pipeline
-    // At a minimum, this means the vertex and fragment shader
-    CreateGraphicsPipeline();
+/* Lay down the depth first, so every pixel is shaded once */
+void DrawDepthPrePass()
+{
+    gProfiler.BeginSection(gDrawSection);
+    BeginScenePasses();
+    gDepthPrePassGpuTimer.Begin();
 
-    // 4. Call the main application loop
-    MainLoop(display);
+    glDepthFunc(GL_LESS);
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    DrawList(0, gSceneDrawCount, true, gApp->mView, gApp->mProjection);
+    gProfiler.AddToCounter(gDepthDrawCallCounter, gSceneDrawCount);
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
 
-    // 4.5 Clean up entities
-    CleanUpMeshData();
+    glUseProgram(0);
+    gDepthPrePassGpuTimer.End();
+    gProfiler.EndSection(gDrawSection);
+}
+
+void DrawScene()
+{
+    gProfiler.BeginSection(gDrawSection);
+
+    if (!gDepthPrePass)
+    {
+        BeginScenePasses();
+    }
+
+    gSceneGpuTimer.Begin();
+
+    if (gDepthPrePass)
+    {
+        // Only the nearest surface passes, and its depth is already there
+        glDepthFunc(GL_EQUAL);
+        glDepthMask(GL_FALSE);
+    }
+    else
+    {
+        glDepthFunc(GL_LESS);
+        glDepthMask(GL_TRUE);
+    }
+
+    if (gShowOverdraw)
+    {
+        gOverdraw->BeginCounting();
+    }
+
+    DrawList(0, gSceneDrawCount, false, gApp->mView, gApp->mProjection);
+    gProfiler.AddToCounter(gDrawCallCounter, gSceneDrawCount);
+
+    if (gShowOverdraw)
+    {
+        gOverdraw->EndCounting();
+    }
+
+    glDepthFunc(GL_LESS);
+    glDepthMask(GL_TRUE);
+
+    /* Stop using our current graphics pipeline */
+    /* Note: This is not necessary if we only have one graphics pipeline. */
+    glUseProgram(0);
+    gSceneGpuTimer.End();
+    gProfiler.EndSection(gDrawSection);
+}
+
+/*
+    Declare the frame's passes to the render graph: the shadow maps, the
+    scene (with its depth pre-pass), then either the post-processing chain
+    or the overdraw view.
+*/
+void AddPasses()
+{
+    GLsizei width = (GLsizei) gApp->mViewportWidth;
+    GLsizei height = (GLsizei) gApp->mViewportHeight;
+
+    gRenderGraph->BeginFrame(width, height);
+
+    RenderResource screen = gRenderGraph->GetScreen();
+    RenderResource shadowMap = NO_RENDER_RESOURCE;
+
+    /* The shadow maps first, they have GPU timers of their own */
+    if (gShadows)
+    {
+        shadowMap = gRenderGraph->ImportTexture("shadow_map", gShadowCascades->GetTexture());
+
+        unsigned int pass = gRenderGraph->AddPass("shadows", [](const RenderGraph&)
+        {
+            gProfiler.BeginSection(gShadowSection);
+            DrawShadows();
+            gProfiler.EndSection(gShadowSection);
+        });
+
+        gRenderGraph->Write(pass, shadowMap);
+    }
+
+    // Without post-processing straight to the screen, with its own depth
+    RenderResource color = screen;
+    RenderResource depth = NO_RENDER_RESOURCE;
+
+    if (gPostThisFrame)
+    {
+        RenderTargetDesc desc;
+        desc.width = width;
+        desc.height = height;
+        desc.format = GL_RGBA16F;
+        color = gRenderGraph->CreateTarget("scene_color", desc);
+
+        desc.format = GL_DEPTH24_STENCIL8;
+        depth = gRenderGraph->CreateTarget("scene_depth", desc);
+    }
+
+    // Each pass sets its own depth state and has its own GPU timer, so
+    // nothing breaks when the shadows run in between. The targets they
+    // share keep the pre-pass before the scene.
+    if (gDepthPrePass)
+    {
+        // It clears the color too
+        unsigned int pass = gRenderGraph->AddPass("depth_prepass", [](const RenderGraph&) { DrawDepthPrePass(); });
+        gRenderGraph->WriteColor(pass, color);
+
+        if (depth != NO_RENDER_RESOURCE)
+        {
+            gRenderGraph->WriteDepth(pass, depth);
+        }
+    }
+
+    unsigned int scene = gRenderGraph->AddPass("scene", [](const RenderGraph&) { DrawScene(); });
+
+    if (shadowMap != NO_RENDER_RESOURCE)
+    {
+        gRenderGraph->Read(scene, shadowMap);
+    }
+
+    gRenderGraph->WriteColor(scene, color);
+
+    if (depth != NO_RENDER_RESOURCE)
+    {
+        gRenderGraph->WriteDepth(scene, depth);
+    }
+
+    if (gPostThisFrame)
+    {
+        gPost->AddPasses(*gRenderGraph, color);
+    }
+    else if (gShowOverdraw)
+    {
+        // Waits for the GPU, so only while it is shown
+        unsigned int pass = gRenderGraph->AddPass("overdraw", [](const RenderGraph& graph)
+        {
+            gOverdraw->Measure(graph.GetWidth(graph.GetScreen()), graph.GetHeight(graph.GetScreen()));
+            gOverdraw->Draw();
+        });
+
+        gRenderGraph->WriteColor(pass, screen);
+    }
+}
+
+/*
+    Pick this frame's occluders: the gMaxOccluders instances that look
+    biggest from the camera, of meshes with their CPU data around and at
+    most gMaxOccluderTriangles triangles. Instances the camera is inside of
+    are left out.
+*/
+void SelectOccluders()
+{
+    std::vector<std::pair<float, size_t> > candidates;
+    glm::vec3 eye = gApp->mCamera->GetEye();
+
+    gIsOccluder.assign(gScene.size(), false);
+
+    for (size_t i = 0; i < gScene.size(); i++)
+    {
+        const SceneInstance& instance = gScene[i];
+        const Mesh3D* mesh = instance.mesh;
+        size_t triangles = (mesh->mLODs.empty() ? mesh->indexBufferData.size() : mesh->mLODs[0].indexCount) / 3;
+
+        if (triangles == 0 || triangles > gMaxOccluderTriangles || GetMeshVertexCount(mesh) == 0)
+        {
+            continue;
+        }
+
+        glm::vec3 center = glm::vec3(instance.model * glm::vec4(0.5f * (mesh->mBoundsMin + mesh->mBoundsMax), 1.0f));
+        float scale = glm::length(glm::vec3(instance.model[0]));
+        float radius = 0.5f * glm::length(mesh->mBoundsMax - mesh->mBoundsMin) * scale;
+        float distance = glm::length(center - eye);
+
+        if (distance > radius && radius / distance >= gMinOccluderSize)
+        {
+            candidates.push_back(std::make_pair(radius / distance, i));
+        }
+    }
+
+    size_t count = std::min(candidates.size(), gMaxOccluders);
+    std::partial_sort(candidates.begin(), candidates.begin() + count, candidates.end(),
+                      std::greater<std::pair<float, size_t> >());
+
+    for (size_t i = 0; i < count; i++)
+    {
+        gIsOccluder[candidates[i].second] = true;
+        gOcclusion->AddOccluder(gScene[candidates[i].second].mesh, gScene[candidates[i].second].model);
+    }
+}
+
+void Draw()
+{
+    /* Rasterize the occluders, everything else is tested against them */
+    gProfiler.BeginSection(gOcclusionSection);
+    gOcclusion->BeginFrame(gApp->mProjection * gApp->mView);
+    SelectOccluders();
+    gOcclusion->RasterizeOccluders();
+    gProfiler.EndSection(gOcclusionSection);
+
+    /* Bin the lights into the clusters of this frame's frustum */
+    if (gLighting)
+    {
+        gProfiler.BeginSection(gLightSection);
+        gLightClusters->Build(gLights, gApp->mView, gApp->mProjection);
+        gLightClusters->Upload();
+        gProfiler.EndSection(gLightSection);
+    }
+
+    /* Cull, pick levels of detail and batch once, every pass draws the result */
+    gProfiler.BeginSection(gDrawSection);
+    gDrawList.clear();
+    gFrameInstances.clear();
+    gMeshletCounts.clear();
+    gMeshletOffsets.clear();
+
+    for (size_t i = 0; i < gScene.size(); i++)
+    {
+        RecordInstance(gScene[i], gIsOccluder[i]);
+    }
+
+    FlushBatch();
+    gSceneDrawCount = gDrawList.size();
+    gProfiler.EndSection(gDrawSection);
+
+    if (gShadows)
+    {
+        gProfiler.BeginSection(gShadowSection);
+        RecordShadowCasters();
+        gProfiler.EndSection(gShadowSection);
+    }
+
+    gProfiler.BeginSection(gDrawSection);
+    UploadFrameInstances();
+    gProfiler.EndSection(gDrawSection);
+
+    /* The passes, in the order the render graph picks */
+    AddPasses();
+    gRenderGraph->Execute();
+}
+
+// Defined further down, next to the other shader routines
+void CreateGraphicsPipeline();
+void CreatePerfHud();
+void CreateOverdrawMeter();
+void CreatePostProcessor();
+
+/*
+    Shown while the assets are still loading.
+*/
+void DrawLoadingPlaceholder(Display* display)
+{
+    glViewport(0,0,
+               display->getScreenWidth(),
+               display->getScreenHeight());
+    glClearColor(0.3f, 0.3f, 0.3f, 1.f);
+    glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
+}
+
+static double MillisecondsSinceStart()
+{
+    return (double) (SDL_GetPerformanceCounter() - gStartCounter) * 1000.0
+           / (double) SDL_GetPerformanceFrequency();
+}
+
+/*
+    Once every scene texture has loaded, pack the small ones into the atlas
+    and point the materials that use them at it. Reports what that saves,
+    before culling and level of detail.
+*/
+static void BuildSceneAtlas()
+{
+    if (gAtlasBuilt)
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < gSceneTextures.size(); i++)
+    {
+        if (gSceneTextures[i]->IsPending())
+        {
+            return;
+        }
+    }
+
+    gAtlasBuilt = true;
+
+    if (!gUseAtlas || gSceneTextures.empty())
+    {
+        return;
+    }
+
+    SceneBatchCounts before = CountSceneBatches(gScene, *gMaterials, gMaxInstancesPerDraw);
+
+    // The atlas takes the format of the first texture, the others keep
+    // their own binds
+    std::vector<TextureData> textures(gSceneTextures.size());
+    std::vector<const TextureData*> sources;
+    TextureFormat format = TEXTURE_FORMAT_RGBA8;
+    bool formatChosen = false;
+
+    for (size_t i = 0; i < gSceneTextures.size(); i++)
+    {
+        if (gTextures->ReadTexture(gSceneTextures[i], textures[i]) && !formatChosen)
+        {
+            format = textures[i].format;
+            formatChosen = true;
+        }
+
+        sources.push_back(&textures[i]);
+    }
+
+    std::vector<AtlasEntry> entries;
+    std::vector<TextureData> layers;
+    unsigned int packed = PackTextureAtlas(sources, format, gAtlasLayerSize, gAtlasMaxTextureSize, entries, layers);
+
+    if (packed == 0)
+    {
+        return;
+    }
+
+    gAtlasTexture = CreateTextureArray(layers);
+
+    for (MaterialId material = 0; material < gMaterials->GetCount(); material++)
+    {
+        TextureAsset* albedo = gMaterials->Get(material).albedo;
+        size_t index = std::find(gSceneTextures.begin(), gSceneTextures.end(), albedo) - gSceneTextures.begin();
+
+        if (index < entries.size() && entries[index].layer >= 0)
+        {
+            gMaterials->SetAtlasEntry(material, entries[index].layer, entries[index].rect);
+        }
+    }
+
+    // Every material using a packed texture now samples the atlas, the
+    // texture itself would only take memory twice
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+        if (entries[i].layer >= 0)
+        {
+            gTextures->Unload(gSceneTextures[i]);
+        }
+    }
+
+    SortSceneInstances(gScene, *gMaterials);
+    SceneBatchCounts after = CountSceneBatches(gScene, *gMaterials, gMaxInstancesPerDraw);
+
+    std::cout << "Atlas: " << packed << "/" << gSceneTextures.size() << " textures in " << layers.size()
+              << " layers of " << gAtlasLayerSize << "x" << gAtlasLayerSize << ", draw calls "
+              << before.drawCalls << " -> " << after.drawCalls << ", texture binds "
+              << before.textureBinds << " -> " << after.textureBinds << " per frame before culling" << std::endl;
+}
+
+static bool IsSceneReady()
+{
+    if (gApp->mGraphicsPipelineShaderProgram == 0 || !gAtlasBuilt)
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < gSceneAssets.size(); i++)
+    {
+        if (!gSceneAssets[i]->IsReady())
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*
+    Frame time percentiles, CPU time per subsystem and the per frame
+    counts of the measured frames, see BenchmarkReport.hpp.
+*/
+static void WriteBenchmarkReport(Display* display)
+{
+    BenchmarkReport report;
+    AddMetric(report, "scene.instances", gBenchmark.instances);
+    AddMetric(report, "scene.meshes", gBenchmark.meshes);
+    AddMetric(report, "scene.programs", gBenchmark.programs);
+    AddMetric(report, "scene.materials", gMaterials->GetCount());
+    AddMetric(report, "scene.lights", (double) gLights.size());
+    AddMetric(report, "scene.shadows", gShadows ? 1.0 : 0.0);
+    AddMetric(report, "scene.post", gPostThisFrame ? 1.0 : 0.0);
+    AddMetric(report, "post.pool_textures", gRenderTargets->GetStats().textures);
+    AddMetric(report, "post.pool_megabytes", gRenderTargets->GetStats().bytes / (1024.0 * 1024.0));
+    AddMetric(report, "graph.passes", gRenderGraph->GetStats().passes);
+    AddMetric(report, "graph.culled_passes", gRenderGraph->GetStats().culledPasses);
+    AddMetric(report, "graph.framebuffer_binds", gRenderGraph->GetStats().framebufferBinds);
+    AddMetric(report, "graph.compiles", gRenderGraph->GetStats().compiles);
+    AddMetric(report, "scene.depth_prepass", gDepthPrePass ? 1.0 : 0.0);
+    AddMetric(report, "scene.frames", (double) gProfiler.GetFrameCount());
+    AddMetric(report, "scene.width", display->getScreenWidth());
+    AddMetric(report, "scene.height", display->getScreenHeight());
+
+    AddSummary(report, "frame_ms", gProfiler.GetFrameMilliseconds());
+
+    for (unsigned int i = 0; i < gProfiler.GetSectionCount(); i++)
+    {
+        AddSummary(report, "cpu_ms." + gProfiler.GetSectionName(i), gProfiler.GetSectionMilliseconds(i));
+    }
+
+    for (unsigned int i = 0; i < gProfiler.GetCounterCount(); i++)
+    {
+        AddSummary(report, gProfiler.GetCounterName(i), gProfiler.GetCounterValues(i));
+    }
+
+    AddSummary(report, "input_latency_ms", gInputLatencySamples);
+
+    if (!gLights.empty())
+    {
+        AddSummary(report, "lights_per_cluster", gLightsPerClusterSamples);
+        AddSummary(report, "lights_per_lit_cluster", gLightsPerLitClusterSamples);
+    }
+
+    // Only the frames that redrew the cascade
+    for (unsigned int i = 0; gShadows && i < SHADOW_CASCADE_COUNT; i++)
+    {
+        AddSummary(report, "gpu_ms.shadow_" + std::to_string(i), gShadowGpuSamples[i]);
+    }
+
+    for (unsigned int i = 0; i < POST_PASS_COUNT; i++)
+    {
+        if (!gPostGpuSamples[i].empty())
+        {
+            AddSummary(report, "gpu_ms.post_" + PostProcessor::GetPassName((PostPass) i), gPostGpuSamples[i]);
+        }
+    }
+
+    const std::vector<double>& frames = gProfiler.GetFrameMilliseconds();
+
+    std::cout << "Benchmark: " << frames.size() << " frames, p50 " << Percentile(frames, 50.0)
+              << " ms, p95 " << Percentile(frames, 95.0) << " ms, p99 " << Percentile(frames, 99.0)
+              << " ms" << std::endl;
+
+    if (SaveBenchmarkReport(gBenchmark.output, report))
+    {
+        std::cout << "Wrote " << gBenchmark.output << std::endl;
+    }
+}
+
+void MainLoop(Display* display)
+{
+    bool firstFrame = true;
+    bool sceneWasReady = false;
+    double lastReport = 0.0;
+    double lastFrame = MillisecondsSinceStart();
+    // Frames drawn since the scene was ready, warm-up included
+    unsigned int benchmarkFrame = 0;
+
+    while (!display->getGQuit())
+    {
+        gProfiler.BeginFrame();
+        gResidency->BeginFrame();
+        gLODStats = LODStats();
+        gMeshletStats = MeshletCullStats();
+
+        // Finish whatever the workers have handed back to us
+        gProfiler.BeginSection(gStreamingSection);
+        gLoader->PumpUploads();
+        gTextures->Update();
+        BuildSceneAtlas();
+        gMaterials->Update(gMaterialBlockBinding);
+        gProfiler.AddToCounter(gMaterialUploadCounter, gMaterials->GetStats().uploadsThisFrame);
+        CreateGraphicsPipeline();
+        CreatePerfHud();
+        CreateOverdrawMeter();
+        CreatePostProcessor();
+        gProfiler.EndSection(gStreamingSection);
+
+        // Input comes after the streaming work, as close to drawing as
+        // possible, so the frame shows the freshest state
+        gProfiler.BeginSection(gInputSection);
+        display->PollEvents();
+
+        double now = MillisecondsSinceStart();
+        double frameMilliseconds = now - lastFrame;
+        unsigned int steps = gInputRecorder->IsReplaying() ? 1 : gTimestep.Advance(frameMilliseconds / 1000.0);
+        lastFrame = now;
+        gHud->AddFrameTime(frameMilliseconds);
+
+        if (gBenchmark.enabled)
+        {
+            // The camera follows the script, only quitting is left to the user
+            glm::vec3 eye, viewDirection;
+            GetBenchmarkCameraPose(benchmarkFrame >= gBenchmark.warmupFrames
+                                   ? benchmarkFrame - gBenchmark.warmupFrames : 0,
+                                   gBenchmark.frames, eye, viewDirection);
+            gApp->mCamera->SetPose(eye, viewDirection);
+            display->DiscardEvents();
+        }
+        else
+        {
+            for (unsigned int step = 0; step < steps && !display->getGQuit(); step++)
+            {
+                display->Input(gApp->mCamera, (float) gTimestep.GetStepSeconds());
+            }
+        }
+
+        gProfiler.EndSection(gInputSection);
+
+        bool sceneReady = IsSceneReady();
+
+        if (sceneReady)
+        {
+            PreDraw(display);
+            Draw();
+        }
+        else
+        {
+            DrawLoadingPlaceholder(display);
+        }
+
+        if (display->getShowHud())
+        {
+            const ResidencyStats& residency = gResidency->GetStats();
+
+            HudStats hudStats;
+            hudStats.frameMilliseconds = frameMilliseconds;
+            hudStats.gpuMilliseconds = gSceneGpuTimer.GetMilliseconds()
+                                       + (gDepthPrePass ? gDepthPrePassGpuTimer.GetMilliseconds() : 0.0);
+            hudStats.drawCalls = gProfiler.GetCounter(gDrawCallCounter);
+            hudStats.triangles = gLODStats.trianglesThisFrame;
+            hudStats.residentMegabytes = residency.residentBytes / (1024.0 * 1024.0);
+            hudStats.budgetMegabytes = residency.budgetBytes / (1024.0 * 1024.0);
+            hudStats.textureMegabytes = gTextures->GetStats().residentBytes / (1024.0 * 1024.0);
+            hudStats.textureBudgetMegabytes = gTextures->GetStats().budgetBytes / (1024.0 * 1024.0);
+            hudStats.inputLatency = display->getInputLatency();
+
+            gHud->Draw(hudStats, display->getScreenWidth(), display->getScreenHeight());
+        }
+
+        gResidency->EndFrame();
+        display->MarkSubmitted();
+
+        if (gBenchmark.enabled)
+        {
+            gInputLatencySamples.push_back(display->getInputLatency().sampleToSubmitMilliseconds);
+
+            if (!gLights.empty())
+            {
+                gLightsPerClusterSamples.push_back(gLightClusters->GetStats().averageLightsPerCluster);
+                gLightsPerLitClusterSamples.push_back(gLightClusters->GetStats().averageLightsPerLitCluster);
+            }
+
+            for (unsigned int i = 0; gShadows && i < SHADOW_CASCADE_COUNT; i++)
+            {
+                if (gShadowCascades->IsUpdated(i))
+                {
+                    gShadowGpuSamples[i].push_back(gShadowGpuTimers[i].GetMilliseconds());
+                }
+            }
+
+            for (unsigned int i = 0; gPostThisFrame && i < POST_PASS_COUNT; i++)
+            {
+                if (gPost->DidPassRun((PostPass) i))
+                {
+                    gPostGpuSamples[i].push_back(gPost->GetPassMilliseconds((PostPass) i));
+                }
+            }
+        }
+
+        gProfiler.BeginSection(gSwapSection);
+        SDL_GL_SwapWindow(display->getGraphicsApplicationWindow());
+        gProfiler.EndSection(gSwapSection);
+
+        gProfiler.AddToCounter(gTriangleCounter, gLODStats.trianglesThisFrame);
+
+        if (gBenchmark.enabled && sceneReady)
+        {
+            benchmarkFrame++;
+
+            // Loading and warm-up frames do not count
+            if (benchmarkFrame == gBenchmark.warmupFrames)
+            {
+                gProfiler.Reset();
+                gInputLatencySamples.clear();
+                gLightsPerClusterSamples.clear();
+                gLightsPerLitClusterSamples.clear();
+
+                for (unsigned int i = 0; i < SHADOW_CASCADE_COUNT; i++)
+                {
+                    gShadowGpuSamples[i].clear();
+                }
+
+                for (unsigned int i = 0; i < POST_PASS_COUNT; i++)
+                {
+                    gPostGpuSamples[i].clear();
+                }
+            }
+
+            if (benchmarkFrame == gBenchmark.warmupFrames + gBenchmark.frames)
+            {
+                gProfiler.BeginFrame();
+                WriteBenchmarkReport(display);
+                break;
+            }
+        }
+
+        if (firstFrame)
+        {
+            std::cout << "First frame after " << MillisecondsSinceStart() << " ms" << std::endl;
+            firstFrame = false;
+        }
+
+        if (sceneReady && !sceneWasReady)
+        {
+            std::cout << "Scene ready after " << MillisecondsSinceStart() << " ms" << std::endl;
+            sceneWasReady = true;
+        }
+
+        // Once a second is plenty for the console
+        if (sceneReady && MillisecondsSinceStart() - lastReport >= 1000.0)
+        {
+            std::cout << "Triangles submitted: " << gLODStats.trianglesThisFrame
+                      << " (" << gLODStats.fullDetailTrianglesThisFrame << " at full detail, "
+                      << gLODStats.lodSwitchesThisFrame << " LOD switches)" << std::endl;
+
+            const OcclusionStats& occlusion = gOcclusion->GetStats();
+
+            std::cout << "Occlusion: " << occlusion.occluded << "/" << occlusion.tested << " culled, "
+                      << occlusion.occluders << " occluders (" << occlusion.occluderTriangles << " triangles), raster "
+                      << occlusion.rasterMilliseconds << " ms, pyramid " << occlusion.pyramidMilliseconds
+                      << " ms, tests " << occlusion.testMilliseconds << " ms" << std::endl;
+
+            if (gMeshletStats.meshlets > 0)
+            {
+                std::cout << "Meshlets: " << gMeshletStats.visible << "/" << gMeshletStats.meshlets << " visible ("
+                          << gMeshletStats.frustumCulled << " outside the frustum, "
+                          << gMeshletStats.backfaceCulled << " facing away), "
+                          << gMeshletStats.drawRanges << " ranges, "
+                          << gMeshletStats.cullMilliseconds << " ms" << std::endl;
+            }
+            const TextureStats& textures = gTextures->GetStats();
+
+            if (textures.textures > 0)
+            {
+                std::cout << "Textures: " << textures.residentBytes / 1024 << " KB of "
+                          << textures.budgetBytes / 1024 << " KB resident, "
+                          << textures.streamingTextures << "/" << textures.textures << " still streaming, "
+                          << textures.levelsStreamedThisFrame << " levels in, "
+                          << textures.levelsDroppedThisFrame << " dropped this frame" << std::endl;
+            }
+
+            if (gShowOverdraw)
+            {
+                const OverdrawStats& overdraw = gOverdraw->GetStats();
+
+                std::cout << "Overdraw: " << overdraw.averageOverdraw << " shaded fragments per covered pixel (max "
+                          << overdraw.maxOverdraw << ", " << overdraw.coveredPixels << " pixels), depth pre-pass "
+                          << (gDepthPrePass ? "on" : "off") << std::endl;
+            }
+
+            if (!gLights.empty())
+            {
+                const LightClusterStats& lights = gLightClusters->GetStats();
+
+                std::cout << "Lights: " << lights.visibleLights << "/" << lights.lights << " visible, "
+                          << lights.averageLightsPerCluster << " per cluster on average ("
+                          << lights.averageLightsPerLitCluster << " in the " << lights.litClusters << "/"
+                          << CLUSTER_COUNT << " lit ones, max " << lights.maxLightsPerCluster << ", "
+                          << lights.droppedLights << " dropped), binned in " << lights.binMilliseconds << " ms"
+                          << std::endl;
+            }
+
+            if (gShadows)
+            {
+                std::cout << "Shadows:";
+
+                for (unsigned int i = 0; i < SHADOW_CASCADE_COUNT; i++)
+                {
+                    std::cout << (i > 0 ? "," : "") << " cascade " << i << " to "
+                              << gShadowCascades->GetSplitDistance(i) << ": "
+                              << gProfiler.GetCounter(gShadowDrawCallCounters[i]) << " draws, "
+                              << gShadowGpuTimers[i].GetMilliseconds() << " ms GPU, every "
+                              << gShadowCascades->GetUpdateInterval(i) << " frames";
+                }
+
+                std::cout << std::endl;
+            }
+
+            if (gPostThisFrame)
+            {
+                const RenderTargetPoolStats& pool = gRenderTargets->GetStats();
+
+                std::cout << "Post:";
+
+                for (unsigned int i = 0; i < POST_PASS_COUNT; i++)
+                {
+                    if (gPost->DidPassRun((PostPass) i))
+                    {
+                        std::cout << " " << PostProcessor::GetPassName((PostPass) i) << " "
+                                  << gPost->GetPassMilliseconds((PostPass) i) << " ms,";
+                    }
+                }
+
+                std::cout << " " << pool.textures << " targets (" << pool.bytes / 1024 << " KB), "
+                          << pool.reusesThisFrame << "/" << pool.acquiresThisFrame << " reused this frame"
+                          << std::endl;
+            }
+
+            const RenderGraphStats& graph = gRenderGraph->GetStats();
+            std::vector<std::string> order = gRenderGraph->GetPassOrder();
+
+            std::cout << "Render graph: " << graph.passes - graph.culledPasses << "/" << graph.passes << " passes run, "
+                      << graph.transientTargets << " transient targets, " << graph.framebufferBinds
+                      << " framebuffer binds, compiled " << graph.compiles << " times (last "
+                      << graph.compileMilliseconds << " ms):";
+
+            for (size_t i = 0; i < order.size(); i++)
+            {
+                std::cout << (i > 0 ? " >" : "") << " " << order[i];
+            }
+
+            std::cout << std::endl;
+
+            const MaterialStats& materials = gMaterials->GetStats();
+
+            std::cout << "Materials: " << materials.materials << "/" << gMaxMaterials << ", "
+                      << materials.uploadsThisFrame << " uploads (" << materials.uploadedBytesThisFrame
+                      << " bytes) this frame" << std::endl;
+
+            const InputLatency& latency = display->getInputLatency();
+
+            std::cout << "Input latency: " << latency.sampleToSubmitMilliseconds << " ms from sampling, "
+                      << latency.eventToSubmitMilliseconds << " ms from the oldest of "
+                      << latency.events << " events to submission" << std::endl;
+
+            lastReport = MillisecondsSinceStart();
+        }
+
+        // After the console, which shows this frame's acquires
+        gRenderTargets->EndFrame();
+    }
+}
+
+/*
+    CompileShader will compile any valid vertex, fragment, geometry, tesselation or
+    compute shader.
+
+    @param type We use the 'type' field to determine which shader we
+    are going to compile.
+
+    @param source: The shader source code.
+    @return id of the shaderObject.
+*/
+GLuint CompileShader(GLuint type, const std::string& source)
+{
+    GLuint shaderObject;
+
+    if (type == GL_VERTEX_SHADER)
+    {
+        shaderObject = glCreateShader(GL_VERTEX_SHADER);
+    } else if (type == GL_FRAGMENT_SHADER)
+    {
+        shaderObject = glCreateShader(GL_FRAGMENT_SHADER);
+    }
+
+    const char* src = source.c_str();
+    glShaderSource(shaderObject, 1, &src, nullptr);
+    glCompileShader(shaderObject);
+
+    /* Retrieve the result of our compilation */
+    int result;
+
+    /* Our goal with glGetShaderiv is to retrieve the compilation status */
+    glGetShaderiv(shaderObject, GL_COMPILE_STATUS, &result);
+
+    if (result == GL_FALSE)
+    {
+        int length;
+        glGetShaderiv(shaderObject, GL_INFO_LOG_LENGTH, &length);
+        char* errorMessages = new char[length];
+        glGetShaderInfoLog(shaderObject, length, &length, errorMessages);
+
+        if (type == GL_VERTEX_SHADER)
+        {
+            std::cout << "ERROR: GL_VERTEX_SHADER compilation failed!\n" << errorMessages << std::endl;
+        }
+        else if (type == GL_FRAGMENT_SHADER) 
+        {
+            std::cout << "ERROR: GL_FRAGMENT_SHADER compilation failed!" << errorMessages << std::endl;
+        }
+
+        /* Reclaim our memory */
+        delete[] errorMessages;
+
+        /* Delete our broken shader */
+        glDeleteShader(shaderObject);
+
+        return 0;
+    }
+
+    return shaderObject;
+}
+
+GLuint CreateShaderProgram(const std::string& vertexShaderSource, const std::string &fragmentShaderSource)
+{
+    GLuint programObject = glCreateProgram();
+
+    GLuint myVertexShader = CompileShader(GL_VERTEX_SHADER, vertexShaderSource);
+    GLuint myFragmentShader = CompileShader(GL_FRAGMENT_SHADER, fragmentShaderSource);
+
+    glAttachShader(programObject, myVertexShader);
+    glAttachShader(programObject, myFragmentShader);
+    glLinkProgram(programObject);
+
+    /* Validate our program */
+    glValidateProgram(programObject);
+
+    glDetachShader(programObject, myVertexShader);
+    glDetachShader(programObject, myFragmentShader);
+
+    glDeleteShader(myVertexShader);
+    glDeleteShader(myFragmentShader);
+
+    return programObject;
+}
+
+/*
+    Compile the graphics pipeline once both shader sources have arrived.
+    Does nothing if it already exists or the sources are still loading.
+*/
+ShaderProgram LinkShaderProgram(const std::string& vertexShaderSource, const std::string& fragmentShaderSource)
+{
+    ShaderProgram program;
+    program.mProgram = CreateShaderProgram(vertexShaderSource, fragmentShaderSource);
+    program.mViewLocation = glGetUniformLocation(program.mProgram, "u_ViewMatrix");
+    program.mProjectionLocation = glGetUniformLocation(program.mProgram, "u_Projection");
+    program.mBoundsMinLocation = glGetUniformLocation(program.mProgram, "u_PositionBoundsMin");
+    program.mBoundsExtentLocation = glGetUniformLocation(program.mProgram, "u_PositionBoundsExtent");
+    program.mOctahedralNormalsLocation = glGetUniformLocation(program.mProgram, "u_OctahedralNormals");
+    program.mLightingLocation = glGetUniformLocation(program.mProgram, "u_Lighting");
+    program.mClusterTileSizeLocation = glGetUniformLocation(program.mProgram, "u_ClusterTileSize");
+    program.mClusterDepthLocation = glGetUniformLocation(program.mProgram, "u_ClusterDepth");
+    program.mSunDirectionLocation = glGetUniformLocation(program.mProgram, "u_SunDirection");
+    program.mSunColorLocation = glGetUniformLocation(program.mProgram, "u_SunColor");
+    program.mShadowMatricesLocation = glGetUniformLocation(program.mProgram, "u_ShadowMatrices");
+
+    GLuint instanceBlock = glGetUniformBlockIndex(program.mProgram, "Instances");
+
+    if (instanceBlock != GL_INVALID_INDEX) {
+        glUniformBlockBinding(program.mProgram, instanceBlock, gInstanceBlockBinding);
+    } else {
+        std::cout << "Could not find the Instances uniform block, maybe a mispelling?\n" << std::endl;
+    }
+
+    // The depth program has no materials
+    GLuint materialBlock = glGetUniformBlockIndex(program.mProgram, "Materials");
+
+    if (materialBlock != GL_INVALID_INDEX) {
+        glUniformBlockBinding(program.mProgram, materialBlock, gMaterialBlockBinding);
+    }
+
+    // The albedo texture always sits on unit 0, the atlas on unit 1, the
+    // light clusters and the shadow maps after them
+    glUseProgram(program.mProgram);
+    glUniform1i(glGetUniformLocation(program.mProgram, "u_Albedo"), 0);
+    glUniform1i(glGetUniformLocation(program.mProgram, "u_AlbedoAtlas"), 1);
+    glUniform1i(glGetUniformLocation(program.mProgram, "u_Lights"), gLightTextureUnit);
+    glUniform1i(glGetUniformLocation(program.mProgram, "u_ClusterRanges"), gLightTextureUnit + 1);
+    glUniform1i(glGetUniformLocation(program.mProgram, "u_LightIndices"), gLightTextureUnit + 2);
+    glUniform1i(glGetUniformLocation(program.mProgram, "u_ShadowMap"), gShadowTextureUnit);
+    glUseProgram(0);
+
+    return program;
+}
+
+/*
+    Compile the graphics pipeline and the depth pre-pass program once
+    their shader sources have arrived. Does nothing if they already exist
+    or the sources are still loading.
+
+    The benchmark asks for more programs: copies of the pipeline with a
+    PROGRAM_VARIANT define, so the driver really has to switch programs.
+*/
+void CreateGraphicsPipeline()
+{
+    if (gApp->mGraphicsPipelineShaderProgram != 0
+        || !gApp->mVertexShaderAsset->IsReady()
+        || !gApp->mFragmentShaderAsset->IsReady()
+        || !gApp->mDepthVertexShaderAsset->IsReady()
+        || !gApp->mDepthFragmentShaderAsset->IsReady())
+    {
+        return;
+    }
+
+    const std::string& vertexShaderSource = gApp->mVertexShaderAsset->mText;
+    const std::string& fragmentShaderSource = gApp->mFragmentShaderAsset->mText;
+
+    gApp->mPrograms.push_back(LinkShaderProgram(vertexShaderSource, fragmentShaderSource));
+
+    unsigned int programCount = gBenchmark.enabled ? gBenchmark.programs : 1;
+
+    for (unsigned int i = 1; i < programCount; i++)
+    {
+        // Right after the #version line, which has to come first
+        std::string variant = fragmentShaderSource;
+        size_t lineEnd = variant.find('\n');
+        variant.insert(lineEnd == std::string::npos ? variant.size() : lineEnd + 1,
+                       "#define PROGRAM_VARIANT " + std::to_string(i) + "\n");
+
+        gApp->mPrograms.push_back(LinkShaderProgram(vertexShaderSource, variant));
+    }
+
+    gApp->mGraphicsPipelineShaderProgram = gApp->mPrograms[0].mProgram;
+    gApp->mDepthProgram = LinkShaderProgram(gApp->mDepthVertexShaderAsset->mText,
+                                            gApp->mDepthFragmentShaderAsset->mText);
+
+    // Draws bind their instances with glBindBufferRange, at offsets the
+    // driver accepts
+    GLint alignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+
+    if (alignment > 0)
+    {
+        gInstanceOffsetAlignment = (size_t) alignment;
+    }
+
+    glGenBuffers(1, &gInstanceBuffer);
+}
+
+/*
+    Set up the performance overlay once its shaders have arrived.
+*/
+void CreatePerfHud()
+{
+    if (gHud->IsInitialized()
+        || !gApp->mHudVertexShaderAsset->IsReady()
+        || !gApp->mHudFragmentShaderAsset->IsReady())
+    {
+        return;
+    }
+
+    gHud->Initialize(CreateShaderProgram(gApp->mHudVertexShaderAsset->mText,
+                                         gApp->mHudFragmentShaderAsset->mText));
+}
+
+/*
+    Set up the overdraw view once its shaders have arrived.
+*/
+void CreateOverdrawMeter()
+{
+    if (gOverdraw->IsInitialized()
+        || !gApp->mOverdrawVertexShaderAsset->IsReady()
+        || !gApp->mOverdrawFragmentShaderAsset->IsReady())
+    {
+        return;
+    }
+
+    gOverdraw->Initialize(CreateShaderProgram(gApp->mOverdrawVertexShaderAsset->mText,
+                                              gApp->mOverdrawFragmentShaderAsset->mText));
+}
+
+/*
+    Set up the post-processing chain once its shaders have arrived.
+*/
+void CreatePostProcessor()
+{
+    if (gPost->IsInitialized()
+        || !gApp->mPostVertexShaderAsset->IsReady()
+        || !gApp->mPostDownsampleShaderAsset->IsReady()
+        || !gApp->mPostUpsampleShaderAsset->IsReady()
+        || !gApp->mPostTonemapShaderAsset->IsReady()
+        || !gApp->mPostFxaaShaderAsset->IsReady())
+    {
+        return;
+    }
+
+    const std::string& vertexShaderSource = gApp->mPostVertexShaderAsset->mText;
+
+    gPost->Initialize(CreateShaderProgram(vertexShaderSource, gApp->mPostDownsampleShaderAsset->mText),
+                      CreateShaderProgram(vertexShaderSource, gApp->mPostUpsampleShaderAsset->mText),
+                      CreateShaderProgram(vertexShaderSource, gApp->mPostTonemapShaderAsset->mText),
+                      CreateShaderProgram(vertexShaderSource, gApp->mPostFxaaShaderAsset->mText));
+}
+
+/*
+    Mount the asset archive that sits next to the executable, so we do not
+    depend on the working directory. Development builds also look for loose
+    files there first, so assets can be edited without repacking.
+*/
+void MountAssets()
+{
+    std::string basePath = "./";
+    char* sdlBasePath = SDL_GetBasePath();
+
+    if (sdlBasePath != nullptr)
+    {
+        basePath = sdlBasePath;
+        SDL_free(sdlBasePath);
+    }
+
+#ifndef NDEBUG
+    gFileSystem->AddOverlayDirectory(basePath);
+#endif
+
+    if (!gFileSystem->MountArchive(basePath + "assets.pak"))
+    {
+        std::cout << "No assets.pak found, using loose files only" << std::endl;
+#ifdef NDEBUG
+        gFileSystem->AddOverlayDirectory(basePath);
+#endif
+    }
+
+    gFileSystem->SetThreadPool(gThreadPool);
+    gResidency->SetFileSystem(gFileSystem);
+}
+
+void CleanUpMeshData()
+{
+    gResidency->Unregister(gMesh1);
+    ReleaseMeshBuffers(gMesh1);
+
+    for (size_t i = 0; i < gBenchmarkMeshes.size(); i++)
+    {
+        gResidency->Unregister(gBenchmarkMeshes[i]);
+        ReleaseMeshBuffers(gBenchmarkMeshes[i]);
+        delete gBenchmarkMeshes[i];
+    }
+
+    gBenchmarkMeshes.clear();
+}
+
+int main(int argc, char *argv[])
+{
+    gStartCounter = SDL_GetPerformanceCounter();
+
+    // 1. setup the graphics program
+    Display* display = new Display("First OpenGL", 1000, 900);
+    MountAssets();
+
+    // usage: main [--record input.rec | --replay input.rec] [--texture file.tex] [--grid N] [--no-atlas]
+    //             [--no-prepass] [--shadows [--no-shadow-stagger]]
+    //             [--no-post | --no-bloom --no-fxaa --full-res-bloom]
+    for (int i = 1; i < argc; i++)
+    {
+        std::string option = argv[i];
+
+        if (option == "--no-atlas")
+        {
+            gUseAtlas = false;
+        }
+        else if (option == "--no-prepass")
+        {
+            display->SetDepthPrePass(false);
+        }
+        else if (option == "--shadows")
+        {
+            gShadows = true;
+        }
+        else if (option == "--no-shadow-stagger")
+        {
+            gShadowStagger = false;
+        }
+        else if (option == "--no-post")
+        {
+            gPostProcessing = false;
+        }
+        else if (option == "--no-bloom")
+        {
+            gPost->GetSettings().bloom = false;
+        }
+        else if (option == "--no-fxaa")
+        {
+            gPost->GetSettings().fxaa = false;
+        }
+        else if (option == "--full-res-bloom")
+        {
+            gPost->GetSettings().halfResolutionBloom = false;
+        }
+        else if (i + 1 == argc)
+        {
+            break;
+        }
+        else if (option == "--texture")
+        {
+            gTexture = gTextures->Load(argv[++i]);
+        }
+        else if (option == "--grid")
+        {
+            gDemoGridSize = (unsigned int) std::max(std::atoi(argv[++i]), 1);
+        }
+        else if (option == "--record")
+        {
+            gInputRecorder->StartRecording(argv[++i], gStepSeconds, SDL_NUM_SCANCODES);
+        }
+        else if (option == "--replay" && gInputRecorder->StartReplay(argv[++i]))
+        {
+            gTimestep.SetStepSeconds(gInputRecorder->GetStepSeconds());
+        }
+    }
+
+    display->SetInputRecorder(gInputRecorder);
+
+    for (unsigned int i = 0; gShadowStagger && i < SHADOW_CASCADE_COUNT; i++)
+    {
+        gShadowCascades->SetUpdateInterval(i, gShadowIntervals[i]);
+    }
+
+    // --bench [--instances N] [--meshes M] [--programs K] [--textures T]
+    //         [--materials C] [--lights L] [--frames F] [--warmup W] [--output bench.json]
+    if (!ParseBenchmarkOptions(argc, argv, gBenchmark))
+    {
+        return EXIT_FAILURE;
+    }
+
+    // 2. setup our geometry
+    // Vertices are quantized to 16 bit positions and 8 bit colors
+    // The upload happens over the first frames, see AssetLoader::PumpUploads
+    if (gBenchmark.enabled)
+    {
+        std::vector<TextureData> textures;
+        GenerateBenchmarkMeshes(gBenchmark, gBenchmarkMeshes);
+        GenerateBenchmarkTextures(gBenchmark, textures);
+
+        for (size_t i = 0; i < textures.size(); i++)
+        {
+            gSceneTextures.push_back(gTextures->Create("benchmark texture " + std::to_string(i), textures[i]));
+        }
+
+        std::vector<MaterialId> materials;
+        GenerateBenchmarkMaterials(gBenchmark, gSceneTextures, *gMaterials, materials);
+        GenerateBenchmarkInstances(gBenchmark, gBenchmarkMeshes, materials, gScene);
+        GenerateBenchmarkLights(gBenchmark, gLights);
+
+        for (size_t i = 0; i < gBenchmarkMeshes.size(); i++)
+        {
+            gSceneAssets.push_back(gLoader->UploadMesh(gBenchmarkMeshes[i]));
+        }
+
+        // Frame times, not the refresh rate
+        SDL_GL_SetSwapInterval(0);
+    }
+    else
+    {
+        if (gDemoGridSize > 0)
+        {
+            GenerateGridMesh(gMesh1, gDemoGridSize);
+        }
+
+        gMesh1->mVertexFormat = VERTEX_FORMAT_PACKED;
+        gSceneAssets.push_back(gLoader->UploadMesh(gMesh1));
+
+        SceneInstance instance;
+        instance.mesh = gMesh1;
+
+        if (gTexture != nullptr)
+        {
+            instance.material = gMaterials->Create(MaterialParameters(), gTexture);
+            gSceneTextures.push_back(gTexture);
+        }
+
+        gScene.push_back(instance);
+    }
+
+    SortSceneInstances(gScene, *gMaterials);
+
+    // 3. Create our graphics pipeline
+    // At a minimum, this means the vertex and fragment shader.
+    // The sources are read on the worker threads, CreateGraphicsPipeline
+    // compiles them as soon as they are there.
+    gApp->mVertexShaderAsset = gLoader->LoadText("shaders/vertexShader.glsl");
+    gApp->mFragmentShaderAsset = gLoader->LoadText("shaders/fragmentShader.glsl");
+    gApp->mHudVertexShaderAsset = gLoader->LoadText("shaders/hudVertexShader.glsl");
+    gApp->mHudFragmentShaderAsset = gLoader->LoadText("shaders/hudFragmentShader.glsl");
+    gApp->mDepthVertexShaderAsset = gLoader->LoadText("shaders/depthVertexShader.glsl");
+    gApp->mDepthFragmentShaderAsset = gLoader->LoadText("shaders/depthFragmentShader.glsl");
+    gApp->mOverdrawVertexShaderAsset = gLoader->LoadText("shaders/overdrawVertexShader.glsl");
+    gApp->mOverdrawFragmentShaderAsset = gLoader->LoadText("shaders/overdrawFragmentShader.glsl");
+    gApp->mPostVertexShaderAsset = gLoader->LoadText("shaders/postVertexShader.glsl");
+    gApp->mPostDownsampleShaderAsset = gLoader->LoadText("shaders/postDownsampleFragmentShader.glsl");
+    gApp->mPostUpsampleShaderAsset = gLoader->LoadText("shaders/postUpsampleFragmentShader.glsl");
+    gApp->mPostTonemapShaderAsset = gLoader->LoadText("shaders/postTonemapFragmentShader.glsl");
+    gApp->mPostFxaaShaderAsset = gLoader->LoadText("shaders/postFxaaFragmentShader.glsl");
+
+    // 4. Call the main application loop
+    MainLoop(display);
+
+    // 4.5 Clean up entities
+    delete gInputRecorder;
+    delete gTextures;
+    delete gLoader;
+    CleanUpMeshData();
+    gHud->Release();
+    gOverdraw->Release();
+    gDepthPrePassGpuTimer.Release();
+    gSceneGpuTimer.Release();
+    glDeleteTextures(1, &gAtlasTexture);
+    glDeleteBuffers(1, &gInstanceBuffer);
+    gMaterials->Release();
+    gLightClusters->Release();
+    gShadowCascades->Release();
+    gPost->Release();
+    gRenderGraph->Release();
+    gRenderTargets->Release();
+
+    for (unsigned int i = 0; i < SHADOW_CASCADE_COUNT; i++)
+    {
+        gShadowGpuTimers[i].Release();
+    }
 
     // 5. call the cleanup function when our program terminates
     display->CleanUp();
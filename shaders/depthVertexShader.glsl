@@ -0,0 +1,30 @@
+#version 410 core
+
+// Only the position stream is bound, see VertexLayout
+layout(location=0) in vec3 position;
+
+uniform mat4 u_Projection;
+uniform mat4 u_ViewMatrix;
+
+uniform vec3 u_PositionBoundsMin;
+uniform vec3 u_PositionBoundsExtent;
+
+// Same block as vertexShader.glsl, only the model matrix is used
+struct Instance {
+   mat4 model;
+   ivec4 indices;
+};
+
+layout(std140) uniform Instances {
+   Instance u_Instances[128];
+};
+
+// The main pass tests against this depth with GL_EQUAL, so both compute
+// it with the same expression
+invariant gl_Position;
+
+void main()
+{
+   vec3 objectPosition = u_PositionBoundsMin + position * u_PositionBoundsExtent;
+   gl_Position = u_Projection * u_ViewMatrix * u_Instances[gl_InstanceID].model * vec4(objectPosition, 1.0f);
+}
@@ -1,10 +1,120 @@
 #version 410 core
 
 in vec3 v_vertexColors;
+in vec3 v_viewPosition;
+in vec3 v_vertexNormal;
+in vec2 v_uv;
+flat in int v_material;
+
+// Every material, see MaterialParameters in MaterialSystem.hpp
+struct Material {
+   vec4 baseColor;
+   vec4 emissive;
+   vec4 atlasRect;
+   ivec4 albedo;    // x: 1 when textured, y: atlas layer or -1
+};
+
+layout(std140) uniform Materials {
+   Material u_Materials[256];
+};
+
+// Albedo on texture unit 0, or the atlas on unit 1 for atlased materials
+uniform sampler2D u_Albedo;
+uniform sampler2DArray u_AlbedoAtlas;
+
+// Clustered lights, see LightClusters.hpp. Without lights (u_Lighting
+// off) the colors are drawn as they are.
+uniform bool u_Lighting;
+uniform vec2 u_ClusterTileSize;  // pixels per screen tile
+uniform vec2 u_ClusterDepth;     // slice = log(view depth) * x - y
+uniform samplerBuffer u_Lights;
+uniform usamplerBuffer u_ClusterRanges;
+uniform usamplerBuffer u_LightIndices;
+
+// The sun, with cascaded shadow maps (see ShadowCascades.hpp)
+uniform vec3 u_SunDirection;     // view space, towards the sun
+uniform vec3 u_SunColor;         // black without a sun
+uniform mat4 u_ShadowMatrices[4];  // view space to shadow map, per cascade
+uniform sampler2DArrayShadow u_ShadowMap;
+
+// CLUSTER_TILES_X, CLUSTER_TILES_Y and CLUSTER_SLICES
+const ivec3 CLUSTER_COUNTS = ivec3(16, 9, 24);
+const vec3 AMBIENT = vec3(0.2f);
 
 out vec4 color;
 
+// How much of the sun reaches a view space position: the first cascade
+// that covers it decides, beyond them all there is no shadow
+float SunShadow(vec3 position)
+{
+   for (int i = 0; i < 4; i++) {
+      vec3 coords = vec3(u_ShadowMatrices[i] * vec4(position, 1.0f));
+
+      if (all(greaterThan(coords, vec3(0.0f))) && all(lessThan(coords, vec3(1.0f)))) {
+         return texture(u_ShadowMap, vec4(coords.xy, float(i), coords.z));
+      }
+   }
+
+   return 1.0f;
+}
+
+// The light reaching a view space position: the sun and its cluster's lights
+vec3 ShadeLights(vec3 position, vec3 normal)
+{
+   ivec2 tile = min(ivec2(gl_FragCoord.xy / u_ClusterTileSize), CLUSTER_COUNTS.xy - 1);
+   int slice = clamp(int(floor(log(-position.z) * u_ClusterDepth.x - u_ClusterDepth.y)), 0, CLUSTER_COUNTS.z - 1);
+   int cluster = (slice * CLUSTER_COUNTS.y + tile.y) * CLUSTER_COUNTS.x + tile.x;
+   uvec2 range = texelFetch(u_ClusterRanges, cluster).xy;
+
+   // Without a normal every light counts fully
+   bool hasNormal = dot(normal, normal) > 1e-8f;
+   normal = hasNormal ? normalize(gl_FrontFacing ? normal : -normal) : normal;
+   vec3 light = AMBIENT;
+
+   if (u_SunColor != vec3(0.0f)) {
+      float lambert = hasNormal ? max(dot(normal, u_SunDirection), 0.0f) : 1.0f;
+      light += u_SunColor * (lambert * SunShadow(position));
+   }
+
+   for (uint i = 0u; i < range.y; i++) {
+      int index = int(texelFetch(u_LightIndices, int(range.x + i)).x) * 3;
+      vec4 positionRange = texelFetch(u_Lights, index);
+      vec4 colorInner = texelFetch(u_Lights, index + 1);
+      vec4 directionOuter = texelFetch(u_Lights, index + 2);
+
+      vec3 toLight = positionRange.xyz - position;
+      float lightDistance = length(toLight);
+
+      if (lightDistance >= positionRange.w) {
+         continue;
+      }
+
+      vec3 direction = toLight / max(lightDistance, 1e-4f);
+      // Down to nothing at the range, smoothly
+      float falloff = 1.0f - lightDistance / positionRange.w;
+      // Point lights have an outer cosine of -2, so this is always 1
+      float cone = smoothstep(directionOuter.w, colorInner.w, dot(-direction, directionOuter.xyz));
+      float lambert = hasNormal ? max(dot(normal, direction), 0.0f) : 1.0f;
+
+      light += colorInner.rgb * (lambert * falloff * falloff * cone);
+   }
+
+   return light;
+}
+
 void main()
 {
-   color = vec4(v_vertexColors.r, v_vertexColors.g, v_vertexColors.b, 1.0f);
-}
\ No newline at end of file
+   Material material = u_Materials[v_material];
+   color = vec4(v_vertexColors.r, v_vertexColors.g, v_vertexColors.b, 1.0f) * material.baseColor;
+
+   if (material.albedo.x != 0) {
+      color *= material.albedo.y >= 0 ? texture(u_AlbedoAtlas, vec3(v_uv, float(material.albedo.y)))
+                                      : texture(u_Albedo, v_uv);
+   }
+
+   if (u_Lighting) {
+      color.rgb *= ShadeLights(v_viewPosition, v_vertexNormal);
+   }
+
+   color.rgb += material.emissive.rgb;
+}
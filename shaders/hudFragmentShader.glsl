@@ -0,0 +1,14 @@
+#version 410 core
+
+in vec2 v_uv;
+in vec4 v_color;
+
+// Glyph coverage in the red channel
+uniform sampler2D u_Atlas;
+
+out vec4 color;
+
+void main()
+{
+   color = vec4(v_color.rgb, v_color.a * texture(u_Atlas, v_uv).r);
+}
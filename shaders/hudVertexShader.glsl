@@ -0,0 +1,19 @@
+#version 410 core
+
+layout(location=0) in vec2 position; // pixels, origin in the top left corner
+layout(location=1) in vec2 uv;
+layout(location=2) in vec4 color;
+
+uniform vec2 u_ScreenSize;
+
+out vec2 v_uv;
+out vec4 v_color;
+
+void main()
+{
+   v_uv = uv;
+   v_color = color;
+
+   vec2 ndc = position / u_ScreenSize * 2.0f - 1.0f;
+   gl_Position = vec4(ndc.x, -ndc.y, 0.0f, 1.0f);
+}
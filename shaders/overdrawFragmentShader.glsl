@@ -0,0 +1,11 @@
+#version 410 core
+
+// The heat of the overdraw level the stencil test lets through
+uniform vec4 u_Color;
+
+out vec4 color;
+
+void main()
+{
+   color = u_Color;
+}
@@ -0,0 +1,53 @@
+#version 410 core
+
+in vec2 v_uv;
+
+// The level above, twice the size of this one
+uniform sampler2D u_Source;
+uniform vec2 u_TexelSize;
+// The first level keeps only what is brighter than the threshold, with a
+// soft knee instead of a hard edge
+uniform bool u_Prefilter;
+uniform float u_Threshold;
+
+out vec4 color;
+
+vec3 Prefilter(vec3 c)
+{
+   float brightness = max(c.r, max(c.g, c.b));
+   float knee = 0.5f * u_Threshold;
+   float soft = clamp(brightness - u_Threshold + knee, 0.0f, 2.0f * knee);
+   soft = soft * soft / (4.0f * knee + 1e-4f);
+   return c * max(soft, brightness - u_Threshold) / max(brightness, 1e-4f);
+}
+
+vec3 Sample(vec2 offset)
+{
+   return texture(u_Source, v_uv + offset * u_TexelSize).rgb;
+}
+
+// 13 taps: a 4x4 box in the middle and four 2x2 boxes around it, so
+// small bright spots do not flicker as they move between texels
+void main()
+{
+   vec3 a = Sample(vec2(-2.0f, 2.0f));
+   vec3 b = Sample(vec2(0.0f, 2.0f));
+   vec3 c = Sample(vec2(2.0f, 2.0f));
+   vec3 d = Sample(vec2(-2.0f, 0.0f));
+   vec3 e = Sample(vec2(0.0f, 0.0f));
+   vec3 f = Sample(vec2(2.0f, 0.0f));
+   vec3 g = Sample(vec2(-2.0f, -2.0f));
+   vec3 h = Sample(vec2(0.0f, -2.0f));
+   vec3 i = Sample(vec2(2.0f, -2.0f));
+   vec3 j = Sample(vec2(-1.0f, 1.0f));
+   vec3 k = Sample(vec2(1.0f, 1.0f));
+   vec3 l = Sample(vec2(-1.0f, -1.0f));
+   vec3 m = Sample(vec2(1.0f, -1.0f));
+
+   vec3 result = (j + k + l + m) * 0.125f
+               + (a + c + g + i) * 0.03125f
+               + (b + d + f + h) * 0.0625f
+               + e * 0.125f;
+
+   color = vec4(u_Prefilter ? Prefilter(result) : result, 1.0f);
+}
@@ -0,0 +1,41 @@
+#version 410 core
+
+in vec2 v_uv;
+
+// Tonemapped, luma in alpha
+uniform sampler2D u_Source;
+uniform vec2 u_TexelSize;
+
+out vec4 color;
+
+const float REDUCE_MIN = 1.0f / 128.0f;
+const float REDUCE_MUL = 1.0f / 8.0f;
+const float SPAN_MAX = 8.0f;
+
+// FXAA: blur along the edge the luma of the corners points at, and only
+// as far as stays within the local luma range
+void main()
+{
+   vec4 center = texture(u_Source, v_uv);
+   // North is -y, as in the texture coordinates the direction sums below
+   // were written for: with it flipped they point across the edge
+   float lumaNW = textureOffset(u_Source, v_uv, ivec2(-1, -1)).a;
+   float lumaNE = textureOffset(u_Source, v_uv, ivec2(1, -1)).a;
+   float lumaSW = textureOffset(u_Source, v_uv, ivec2(-1, 1)).a;
+   float lumaSE = textureOffset(u_Source, v_uv, ivec2(1, 1)).a;
+   float lumaMin = min(center.a, min(min(lumaNW, lumaNE), min(lumaSW, lumaSE)));
+   float lumaMax = max(center.a, max(max(lumaNW, lumaNE), max(lumaSW, lumaSE)));
+
+   vec2 direction = vec2(-((lumaNW + lumaNE) - (lumaSW + lumaSE)), (lumaNW + lumaSW) - (lumaNE + lumaSE));
+   float reduce = max((lumaNW + lumaNE + lumaSW + lumaSE) * 0.25f * REDUCE_MUL, REDUCE_MIN);
+   float scale = 1.0f / (min(abs(direction.x), abs(direction.y)) + reduce);
+   direction = clamp(direction * scale, vec2(-SPAN_MAX), vec2(SPAN_MAX)) * u_TexelSize;
+
+   vec3 inner = 0.5f * (texture(u_Source, v_uv + direction * (1.0f / 3.0f - 0.5f)).rgb
+                      + texture(u_Source, v_uv + direction * (2.0f / 3.0f - 0.5f)).rgb);
+   vec3 outer = inner * 0.5f + 0.25f * (texture(u_Source, v_uv - direction * 0.5f).rgb
+                                      + texture(u_Source, v_uv + direction * 0.5f).rgb);
+   float lumaOuter = dot(outer, vec3(0.299f, 0.587f, 0.114f));
+
+   color = vec4(lumaOuter < lumaMin || lumaOuter > lumaMax ? inner : outer, 1.0f);
+}
@@ -0,0 +1,31 @@
+#version 410 core
+
+in vec2 v_uv;
+
+// The HDR scene and its bloom (the top level of the bloom chain)
+uniform sampler2D u_Scene;
+uniform sampler2D u_Bloom;
+uniform float u_BloomStrength;  // 0 without bloom
+uniform float u_Exposure;
+
+out vec4 color;
+
+// Narkowicz's fit of the ACES filmic curve
+vec3 ToneMapACES(vec3 x)
+{
+   return clamp((x * (2.51f * x + 0.03f)) / (x * (2.43f * x + 0.59f) + 0.14f), 0.0f, 1.0f);
+}
+
+void main()
+{
+   vec3 hdr = texture(u_Scene, v_uv).rgb;
+
+   if (u_BloomStrength > 0.0f) {
+      hdr += texture(u_Bloom, v_uv).rgb * u_BloomStrength;
+   }
+
+   vec3 ldr = pow(ToneMapACES(hdr * u_Exposure), vec3(1.0f / 2.2f));
+
+   // FXAA finds its edges by luma, it comes along in alpha
+   color = vec4(ldr, dot(ldr, vec3(0.299f, 0.587f, 0.114f)));
+}
@@ -0,0 +1,25 @@
+#version 410 core
+
+in vec2 v_uv;
+
+// The level below, added onto this one by blending
+uniform sampler2D u_Source;
+uniform vec2 u_TexelSize;
+
+out vec4 color;
+
+// 3x3 tent filter
+void main()
+{
+   vec3 sum = texture(u_Source, v_uv).rgb * 4.0f;
+   sum += texture(u_Source, v_uv + vec2(-1.0f, 0.0f) * u_TexelSize).rgb * 2.0f;
+   sum += texture(u_Source, v_uv + vec2(1.0f, 0.0f) * u_TexelSize).rgb * 2.0f;
+   sum += texture(u_Source, v_uv + vec2(0.0f, -1.0f) * u_TexelSize).rgb * 2.0f;
+   sum += texture(u_Source, v_uv + vec2(0.0f, 1.0f) * u_TexelSize).rgb * 2.0f;
+   sum += texture(u_Source, v_uv + vec2(-1.0f, -1.0f) * u_TexelSize).rgb;
+   sum += texture(u_Source, v_uv + vec2(1.0f, -1.0f) * u_TexelSize).rgb;
+   sum += texture(u_Source, v_uv + vec2(-1.0f, 1.0f) * u_TexelSize).rgb;
+   sum += texture(u_Source, v_uv + vec2(1.0f, 1.0f) * u_TexelSize).rgb;
+
+   color = vec4(sum / 16.0f, 1.0f);
+}
@@ -0,0 +1,11 @@
+#version 410 core
+
+// One triangle covering the target, no vertex buffer needed
+out vec2 v_uv;
+
+void main()
+{
+   vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+   v_uv = corner;
+   gl_Position = vec4(corner * 2.0f - 1.0f, 0.0f, 1.0f);
+}
@@ -2,17 +2,81 @@
 
 layout(location=0) in vec3 position;
 layout(location=1) in vec3 vertexColors;
+layout(location=2) in vec3 normal;
+layout(location=3) in vec2 uv;
 
-uniform mat4 u_ModelMatrix; // uniform variable
 uniform mat4 u_Projection; // uniform variable
 uniform mat4 u_ViewMatrix; // uniform variable
 
+// Quantized positions are relative to the mesh bounding box
+// (min = 0, extent = 1 for float vertices)
+uniform vec3 u_PositionBoundsMin;
+uniform vec3 u_PositionBoundsExtent;
+// Normals come in as 2 x 16 bit octahedral instead of xyz
+uniform bool u_OctahedralNormals;
+
+// One entry per instance of the draw, see InstanceData in main.cpp
+struct Instance {
+   mat4 model;
+   ivec4 indices;   // x: material
+};
+
+layout(std140) uniform Instances {
+   Instance u_Instances[128];
+};
+
+// Every material, see MaterialParameters in MaterialSystem.hpp
+struct Material {
+   vec4 baseColor;
+   vec4 emissive;
+   vec4 atlasRect;  // where the UVs go on the atlas layer: offset xy, scale zw
+   ivec4 albedo;    // x: 1 when textured, y: atlas layer or -1
+};
+
+layout(std140) uniform Materials {
+   Material u_Materials[256];
+};
+
 out vec3 v_vertexColors;
+// View space, where the lights are
+out vec3 v_viewPosition;
+out vec3 v_vertexNormal;
+out vec2 v_uv;
+flat out int v_material;
+
+// Must match the depth pre-pass bit for bit, see depthVertexShader.glsl
+invariant gl_Position;
+
+vec3 DecodeOctahedral(vec2 e)
+{
+   vec3 n = vec3(e.xy, 1.0f - abs(e.x) - abs(e.y));
+   if (n.z < 0.0f) {
+      n.xy = (1.0f - abs(n.yx)) * vec2(n.x >= 0.0f ? 1.0f : -1.0f, n.y >= 0.0f ? 1.0f : -1.0f);
+   }
+   return normalize(n);
+}
 
 void main()
 {
    v_vertexColors = vertexColors;
-   vec4 newPosition = u_Projection * u_ViewMatrix * u_ModelMatrix * vec4(position, 1.0f);
+   Instance instance = u_Instances[gl_InstanceID];
+   mat4 modelView = u_ViewMatrix * instance.model;
+   // Models are only scaled uniformly, so this keeps normals perpendicular.
+   // Meshes without normals end up with a zero one.
+   v_vertexNormal = mat3(modelView) * (u_OctahedralNormals ? DecodeOctahedral(normal.xy) : normal);
+   v_material = instance.indices.x;
+   Material material = u_Materials[v_material];
+
+   // Atlased textures cannot repeat, the UVs stay within their rectangle
+   if (material.albedo.y >= 0) {
+      v_uv = material.atlasRect.xy + clamp(uv, 0.0f, 1.0f) * material.atlasRect.zw;
+   } else {
+      v_uv = uv;
+   }
+
+   vec3 objectPosition = u_PositionBoundsMin + position * u_PositionBoundsExtent;
+   v_viewPosition = vec3(modelView * vec4(objectPosition, 1.0f));
+   vec4 newPosition = u_Projection * u_ViewMatrix * instance.model * vec4(objectPosition, 1.0f);
                                                                // do not forget 'w'
    gl_Position = vec4(newPosition.x, newPosition.y, newPosition.z, newPosition.w);
-}
\ No newline at end of file
+}
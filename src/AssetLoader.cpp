@@ -0,0 +1,270 @@
+#include "AssetLoader.hpp"
+#include "MeshIO.hpp"
+#include "MeshOptimizer.hpp"
+
+#include <cstring>
+#include <iostream>
+
+AssetLoader::AssetLoader(ThreadPool* threadPool, const VirtualFileSystem* fileSystem,
+                         GLsizeiptr uploadBytesPerFrame, GLsizeiptr stagingBufferBytes)
+    : mInFlight(0), mWorkerJobs(0)
+{
+    mThreadPool = threadPool;
+    mFileSystem = fileSystem;
+    mUploadBytesPerFrame = uploadBytesPerFrame;
+    mStagingBufferBytes = stagingBufferBytes;
+    // Created on the first PumpUploads, we may not have a context yet
+    mStagingBuffer = 0;
+}
+
+AssetLoader::~AssetLoader()
+{
+    // Workers still hold pointers to our assets
+    while (mWorkerJobs.load() != 0)
+    {
+        std::this_thread::yield();
+    }
+
+    for (size_t i = 0; i < mAssets.size(); i++)
+    {
+        delete mAssets[i];
+    }
+
+    if (mStagingBuffer != 0)
+    {
+        glDeleteBuffers(1, &mStagingBuffer);
+    }
+}
+
+TextAsset* AssetLoader::LoadText(const std::string& fileName)
+{
+    TextAsset* asset = new TextAsset();
+    asset->mPath = fileName;
+    mAssets.push_back(asset);
+    mInFlight++;
+    mWorkerJobs++;
+
+    mThreadPool->Submit([this, asset]() {
+        asset->mState = ASSET_LOADING;
+
+        if (mFileSystem->ReadText(asset->mPath, asset->mText))
+        {
+            asset->mState = ASSET_READY;
+        }
+        else
+        {
+            asset->mState = ASSET_FAILED;
+        }
+
+        mInFlight--;
+        mWorkerJobs--;
+    });
+
+    return asset;
+}
+
+MeshAsset* AssetLoader::LoadMesh(const std::string& fileName, Mesh3D* meshData)
+{
+    MeshAsset* asset = new MeshAsset();
+    asset->mPath = fileName;
+    asset->mMesh = meshData;
+    mAssets.push_back(asset);
+    mInFlight++;
+    mWorkerJobs++;
+
+    mThreadPool->Submit([this, asset]() {
+        asset->mState = ASSET_LOADING;
+
+        // Decode straight out of the archive mapping when we can
+        const unsigned char* data = nullptr;
+        size_t size = 0;
+        std::vector<unsigned char> contents;
+
+        if (!mFileSystem->GetView(asset->mPath, data, size)
+            && mFileSystem->ReadFile(asset->mPath, contents))
+        {
+            data = contents.data();
+            size = contents.size();
+        }
+
+        if (data != nullptr && LoadMeshFromMemory(data, size, asset->mMesh))
+        {
+            asset->mMesh->mSourcePath = asset->mPath;
+            // Optimize, quantize and cluster here rather than on the GL thread
+            OptimizeMesh(asset->mMesh);
+            BuildMeshStreams(asset->mMesh);
+            BuildMeshlets(asset->mMesh);
+            QueueUpload(asset);
+        }
+        else
+        {
+            asset->mState = ASSET_FAILED;
+            mInFlight--;
+        }
+
+        mWorkerJobs--;
+    });
+
+    return asset;
+}
+
+MeshAsset* AssetLoader::UploadMesh(Mesh3D* meshData)
+{
+    MeshAsset* asset = new MeshAsset();
+    asset->mMesh = meshData;
+    mAssets.push_back(asset);
+    mInFlight++;
+
+    OptimizeMesh(meshData);
+    BuildMeshStreams(meshData);
+    BuildMeshlets(meshData);
+    QueueUpload(asset);
+
+    return asset;
+}
+
+void AssetLoader::QueueUpload(MeshAsset* asset)
+{
+    asset->mState = ASSET_UPLOADING;
+
+    std::lock_guard<std::mutex> lock(mUploadMutex);
+    mUploadQueue.push_back(asset);
+}
+
+/*
+    Copy one chunk of source into destination through the staging buffer.
+
+    @return the number of bytes copied.
+*/
+GLsizeiptr AssetLoader::StageCopy(GLuint destination, GLintptr destinationOffset,
+                                  const unsigned char* source, GLsizeiptr size)
+{
+    GLsizeiptr chunk = size < mStagingBufferBytes ? size : mStagingBufferBytes;
+
+    glBindBuffer(GL_COPY_READ_BUFFER, mStagingBuffer);
+
+    // Invalidating lets the driver hand us fresh memory instead of waiting
+    // for the previous copy out of the staging buffer to finish
+    void* staging = glMapBufferRange(GL_COPY_READ_BUFFER, 0, chunk,
+                                     GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+
+    if (staging == nullptr)
+    {
+        std::cout << "Could not map the staging buffer" << std::endl;
+        return 0;
+    }
+
+    std::memcpy(staging, source, chunk);
+    glUnmapBuffer(GL_COPY_READ_BUFFER);
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, destination);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, destinationOffset, chunk);
+
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    return chunk;
+}
+
+void AssetLoader::PumpUploads()
+{
+    if (mStagingBuffer == 0)
+    {
+        glGenBuffers(1, &mStagingBuffer);
+        glBindBuffer(GL_COPY_READ_BUFFER, mStagingBuffer);
+        glBufferData(GL_COPY_READ_BUFFER, mStagingBufferBytes, nullptr, GL_STREAM_DRAW);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    }
+
+    GLsizeiptr budget = mUploadBytesPerFrame;
+    mStats.uploadedBytesThisFrame = 0;
+
+    while (budget > 0)
+    {
+        MeshAsset* asset = nullptr;
+
+        {
+            std::lock_guard<std::mutex> lock(mUploadMutex);
+
+            if (!mUploadQueue.empty())
+            {
+                asset = mUploadQueue.front();
+            }
+        }
+
+        if (asset == nullptr)
+        {
+            break;
+        }
+
+        Mesh3D* mesh = asset->mMesh;
+
+        // First time we see this mesh: create the buffers, without data
+        if (mesh->mVertexArrayObject == 0)
+        {
+            VertexSpecification(mesh, false);
+        }
+
+        const unsigned char* vertices = mesh->mVertexStream.data();
+        const unsigned char* indices = mesh->mIndexStream.data();
+        GLsizeiptr copied = 0;
+
+        if (asset->mVertexBytesUploaded < mesh->mVertexBufferSize)
+        {
+            GLsizeiptr remaining = mesh->mVertexBufferSize - asset->mVertexBytesUploaded;
+            copied = StageCopy(mesh->mVertexBufferObject, asset->mVertexBytesUploaded,
+                               vertices + asset->mVertexBytesUploaded,
+                               remaining < budget ? remaining : budget);
+            asset->mVertexBytesUploaded += copied;
+        }
+        else if (asset->mIndexBytesUploaded < mesh->mIndexBufferSize)
+        {
+            GLsizeiptr remaining = mesh->mIndexBufferSize - asset->mIndexBytesUploaded;
+            copied = StageCopy(mesh->mIndexBufferObject, asset->mIndexBytesUploaded,
+                               indices + asset->mIndexBytesUploaded,
+                               remaining < budget ? remaining : budget);
+            asset->mIndexBytesUploaded += copied;
+        }
+
+        budget -= copied;
+        mStats.uploadedBytesThisFrame += copied;
+        mStats.uploadedBytesTotal += copied;
+
+        if (asset->mVertexBytesUploaded == mesh->mVertexBufferSize
+            && asset->mIndexBytesUploaded == mesh->mIndexBufferSize)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mUploadMutex);
+                mUploadQueue.pop_front();
+            }
+
+            ReleaseMeshStreams(mesh);
+            asset->mState = ASSET_READY;
+            mInFlight--;
+        }
+        else if (copied == 0)
+        {
+            // Mapping failed, try again next frame
+            break;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mUploadMutex);
+    mStats.pendingUploads = (unsigned int) mUploadQueue.size();
+    mStats.assetsInFlight = mInFlight.load();
+}
+
+void AssetLoader::SetUploadBytesPerFrame(GLsizeiptr bytes)
+{
+    mUploadBytesPerFrame = bytes;
+}
+
+bool AssetLoader::IsIdle() const
+{
+    return mInFlight.load() == 0;
+}
+
+const AssetLoaderStats& AssetLoader::GetStats() const
+{
+    return mStats;
+}
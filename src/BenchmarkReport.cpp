@@ -0,0 +1,365 @@
+#include "BenchmarkReport.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace {
+    struct JsonNode {
+        std::string name;
+        double value = 0.0;
+        std::vector<JsonNode> children;
+    };
+
+    void Insert(JsonNode& node, const std::string& path, double value)
+    {
+        size_t dot = path.find('.');
+        std::string head = path.substr(0, dot);
+
+        size_t child = 0;
+
+        while (child < node.children.size() && node.children[child].name != head)
+        {
+            child++;
+        }
+
+        if (child == node.children.size())
+        {
+            node.children.push_back(JsonNode());
+            node.children.back().name = head;
+        }
+
+        if (dot == std::string::npos)
+        {
+            node.children[child].value = value;
+        }
+        else
+        {
+            Insert(node.children[child], path.substr(dot + 1), value);
+        }
+    }
+
+    void Write(std::ostream& out, const JsonNode& node, int depth)
+    {
+        std::string indent((depth + 1) * 2, ' ');
+
+        out << "{\n";
+
+        for (size_t i = 0; i < node.children.size(); i++)
+        {
+            const JsonNode& child = node.children[i];
+            out << indent << "\"" << child.name << "\": ";
+
+            if (child.children.empty())
+            {
+                out << (std::isfinite(child.value) ? child.value : 0.0);
+            }
+            else
+            {
+                Write(out, child, depth + 1);
+            }
+
+            out << (i + 1 < node.children.size() ? ",\n" : "\n");
+        }
+
+        out << std::string(depth * 2, ' ') << "}";
+    }
+
+    void SkipSpace(const std::string& text, size_t& position)
+    {
+        while (position < text.size() && std::isspace((unsigned char) text[position]))
+        {
+            position++;
+        }
+    }
+
+    bool ParseString(const std::string& text, size_t& position, std::string& result)
+    {
+        if (position >= text.size() || text[position] != '"')
+        {
+            return false;
+        }
+
+        result.clear();
+        position++;
+
+        while (position < text.size() && text[position] != '"')
+        {
+            // Escapes are kept as they are, names in our files have none
+            if (text[position] == '\\' && position + 1 < text.size())
+            {
+                result += text[position++];
+            }
+
+            result += text[position++];
+        }
+
+        if (position >= text.size())
+        {
+            return false;
+        }
+
+        position++;
+        return true;
+    }
+
+    bool ParseValue(const std::string& text, size_t& position, const std::string& path, BenchmarkReport& report)
+    {
+        SkipSpace(text, position);
+
+        if (position >= text.size())
+        {
+            return false;
+        }
+
+        char first = text[position];
+
+        if (first == '{' || first == '[')
+        {
+            char close = first == '{' ? '}' : ']';
+            position++;
+            SkipSpace(text, position);
+
+            if (position < text.size() && text[position] == close)
+            {
+                position++;
+                return true;
+            }
+
+            for (;;)
+            {
+                std::string childPath;
+
+                if (first == '{')
+                {
+                    std::string name;
+                    SkipSpace(text, position);
+
+                    if (!ParseString(text, position, name))
+                    {
+                        return false;
+                    }
+
+                    SkipSpace(text, position);
+
+                    if (position >= text.size() || text[position] != ':')
+                    {
+                        return false;
+                    }
+
+                    position++;
+                    childPath = path.empty() ? name : path + "." + name;
+                }
+
+                // Array elements are parsed but not reported
+                BenchmarkReport ignored;
+
+                if (!ParseValue(text, position, childPath, first == '{' ? report : ignored))
+                {
+                    return false;
+                }
+
+                SkipSpace(text, position);
+
+                if (position < text.size() && text[position] == ',')
+                {
+                    position++;
+                    continue;
+                }
+
+                if (position < text.size() && text[position] == close)
+                {
+                    position++;
+                    return true;
+                }
+
+                return false;
+            }
+        }
+
+        if (first == '"')
+        {
+            std::string ignored;
+            return ParseString(text, position, ignored);
+        }
+
+        if (text.compare(position, 4, "true") == 0 || text.compare(position, 4, "null") == 0)
+        {
+            position += 4;
+            return true;
+        }
+
+        if (text.compare(position, 5, "false") == 0)
+        {
+            position += 5;
+            return true;
+        }
+
+        const char* begin = text.c_str() + position;
+        char* end = nullptr;
+        double value = std::strtod(begin, &end);
+
+        if (end == begin)
+        {
+            return false;
+        }
+
+        position += end - begin;
+
+        if (!path.empty())
+        {
+            AddMetric(report, path, value);
+        }
+
+        return true;
+    }
+
+    const BenchmarkMetric* FindMetric(const BenchmarkReport& report, const std::string& name)
+    {
+        for (size_t i = 0; i < report.size(); i++)
+        {
+            if (report[i].name == name)
+            {
+                return &report[i];
+            }
+        }
+
+        return nullptr;
+    }
+}
+
+double Percentile(std::vector<double> samples, double percentile)
+{
+    if (samples.empty())
+    {
+        return 0.0;
+    }
+
+    std::sort(samples.begin(), samples.end());
+
+    size_t rank = (size_t) std::ceil(percentile / 100.0 * samples.size());
+    rank = std::min(std::max(rank, (size_t) 1), samples.size());
+
+    return samples[rank - 1];
+}
+
+void AddSummary(BenchmarkReport& report, const std::string& name, const std::vector<double>& samples)
+{
+    double sum = 0.0;
+    double maximum = 0.0;
+
+    for (size_t i = 0; i < samples.size(); i++)
+    {
+        sum += samples[i];
+        maximum = std::max(maximum, samples[i]);
+    }
+
+    AddMetric(report, name + ".mean", samples.empty() ? 0.0 : sum / samples.size());
+    AddMetric(report, name + ".p50", Percentile(samples, 50.0));
+    AddMetric(report, name + ".p95", Percentile(samples, 95.0));
+    AddMetric(report, name + ".p99", Percentile(samples, 99.0));
+    AddMetric(report, name + ".max", maximum);
+}
+
+void AddMetric(BenchmarkReport& report, const std::string& name, double value)
+{
+    BenchmarkMetric metric;
+    metric.name = name;
+    metric.value = value;
+    report.push_back(metric);
+}
+
+bool SaveBenchmarkReport(const std::string& fileName, const BenchmarkReport& report)
+{
+    JsonNode root;
+
+    for (size_t i = 0; i < report.size(); i++)
+    {
+        Insert(root, report[i].name, report[i].value);
+    }
+
+    std::ofstream myFile(fileName.c_str());
+
+    if (!myFile.is_open())
+    {
+        std::cout << "Could not open " << fileName << " for writing" << std::endl;
+        return false;
+    }
+
+    myFile.precision(9);
+    Write(myFile, root, 0);
+    myFile << "\n";
+
+    return myFile.good();
+}
+
+bool LoadBenchmarkReport(const std::string& fileName, BenchmarkReport& report)
+{
+    std::ifstream myFile(fileName.c_str());
+
+    if (!myFile.is_open())
+    {
+        std::cout << "Could not open " << fileName << std::endl;
+        return false;
+    }
+
+    std::stringstream contents;
+    contents << myFile.rdbuf();
+    std::string text = contents.str();
+
+    size_t position = 0;
+    report.clear();
+
+    if (!ParseValue(text, position, "", report))
+    {
+        std::cout << fileName << " is not valid JSON (near byte " << position << ")" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+bool CompareBenchmarkReports(const BenchmarkReport& baseline, const BenchmarkReport& current,
+                             double tolerance, double minimumMilliseconds,
+                             std::vector<BenchmarkComparison>& comparisons)
+{
+    bool passed = true;
+    comparisons.clear();
+
+    for (size_t i = 0; i < baseline.size(); i++)
+    {
+        const BenchmarkMetric* metric = FindMetric(current, baseline[i].name);
+
+        if (metric == nullptr)
+        {
+            continue;
+        }
+
+        BenchmarkComparison comparison;
+        comparison.name = baseline[i].name;
+        comparison.baseline = baseline[i].value;
+        comparison.current = metric->value;
+
+        if (comparison.name.compare(0, 6, "scene.") == 0)
+        {
+            comparison.regression = comparison.current != comparison.baseline;
+        }
+        else
+        {
+            double growth = comparison.current - comparison.baseline;
+            bool isTime = comparison.name.find("_ms") != std::string::npos;
+
+            comparison.regression = growth > tolerance * std::fabs(comparison.baseline)
+                                    && (!isTime || growth >= minimumMilliseconds);
+        }
+
+        passed = passed && !comparison.regression;
+        comparisons.push_back(comparison);
+    }
+
+    return passed;
+}
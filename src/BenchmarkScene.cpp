@@ -0,0 +1,277 @@
+#include "BenchmarkScene.hpp"
+
+#include "MeshGenerator.hpp"
+#include "MipGenerator.hpp"
+
+#include <glm/ext/matrix_transform.hpp>
+#include <glm/ext/scalar_constants.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+namespace {
+    // Everything has to stay within the far plane of the camera (10 units)
+    const glm::vec3 SCENE_CENTER(0.0f, 0.0f, -5.0f);
+    const float SCENE_SIZE = 5.0f;
+    const float ORBIT_RADIUS = 3.5f;
+
+    bool ReadCount(const char* text, unsigned int& value)
+    {
+        char* end = nullptr;
+        long parsed = std::strtol(text, &end, 10);
+
+        if (end == text || *end != '\0' || parsed < 1)
+        {
+            return false;
+        }
+
+        value = (unsigned int) parsed;
+        return true;
+    }
+
+    // Cheap deterministic hash, the layout must not change between runs
+    unsigned int Hash(unsigned int value)
+    {
+        value ^= value >> 16;
+        value *= 0x7FEB352Du;
+        value ^= value >> 15;
+        value *= 0x846CA68Bu;
+        value ^= value >> 16;
+        return value;
+    }
+}
+
+bool ParseBenchmarkOptions(int argc, char* argv[], BenchmarkConfig& config)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        std::string option = argv[i];
+        bool hasValue = i + 1 < argc;
+        bool valid = true;
+
+        if (option == "--bench")
+        {
+            config.enabled = true;
+        }
+        else if (option == "--instances")
+        {
+            valid = hasValue && ReadCount(argv[++i], config.instances);
+        }
+        else if (option == "--meshes")
+        {
+            valid = hasValue && ReadCount(argv[++i], config.meshes);
+        }
+        else if (option == "--programs")
+        {
+            valid = hasValue && ReadCount(argv[++i], config.programs);
+        }
+        else if (option == "--textures")
+        {
+            valid = hasValue && ReadCount(argv[++i], config.textures);
+        }
+        else if (option == "--materials")
+        {
+            valid = hasValue && ReadCount(argv[++i], config.materials);
+        }
+        else if (option == "--lights")
+        {
+            valid = hasValue && ReadCount(argv[++i], config.lights);
+        }
+        else if (option == "--frames")
+        {
+            valid = hasValue && ReadCount(argv[++i], config.frames);
+        }
+        else if (option == "--warmup")
+        {
+            valid = hasValue && ReadCount(argv[++i], config.warmupFrames);
+        }
+        else if (option == "--output")
+        {
+            valid = hasValue;
+
+            if (valid)
+            {
+                config.output = argv[++i];
+            }
+        }
+
+        if (!valid)
+        {
+            std::cout << "Benchmark option " << option << " needs a positive number (or a file name)" << std::endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void GenerateBenchmarkMeshes(const BenchmarkConfig& config, std::vector<Mesh3D*>& meshes)
+{
+    meshes.clear();
+
+    for (unsigned int i = 0; i < config.meshes; i++)
+    {
+        // From 72 to about 9K triangles
+        unsigned int rings = 6 + 6 * (i % 8);
+
+        Mesh3D* mesh = new Mesh3D();
+        GenerateSphereMesh(mesh, rings, rings * 2);
+        mesh->mVertexFormat = VERTEX_FORMAT_PACKED;
+        meshes.push_back(mesh);
+    }
+}
+
+void GenerateBenchmarkTextures(const BenchmarkConfig& config, std::vector<TextureData>& textures)
+{
+    textures.clear();
+
+    for (unsigned int i = 0; i < config.textures; i++)
+    {
+        unsigned int size = 32u << (Hash(i + 4) % 4);
+        unsigned int color = Hash(i + 5);
+        std::vector<unsigned char> rgba((size_t) size * size * 4);
+
+        // Checkers of two colors, with a dark border to see the edges by
+        for (unsigned int y = 0; y < size; y++)
+        {
+            for (unsigned int x = 0; x < size; x++)
+            {
+                unsigned char* texel = &rgba[((size_t) y * size + x) * 4];
+                bool border = x < 2 || y < 2 || x + 2 >= size || y + 2 >= size;
+                bool checker = ((x * 8 / size) + (y * 8 / size)) % 2 == 0;
+                unsigned int shift = checker ? 0 : 8;
+
+                texel[0] = border ? 0 : (unsigned char) (color >> shift);
+                texel[1] = border ? 0 : (unsigned char) (color >> (shift + 4));
+                texel[2] = border ? 0 : (unsigned char) (color >> (shift + 12));
+                texel[3] = 255;
+            }
+        }
+
+        MipOptions options;
+        TextureData texture;
+        GenerateMips(rgba.data(), size, size, options, nullptr, texture);
+        textures.push_back(texture);
+    }
+}
+
+void GenerateBenchmarkMaterials(const BenchmarkConfig& config, const std::vector<TextureAsset*>& textures,
+                                MaterialSystem& materialSystem, std::vector<MaterialId>& materials)
+{
+    materials.clear();
+
+    unsigned int count = std::max(config.materials, (unsigned int) textures.size());
+
+    for (unsigned int i = 0; i < count; i++)
+    {
+        unsigned int tint = Hash(i + 6);
+
+        // Light tints, so the textures still show through
+        MaterialParameters parameters;
+        parameters.baseColor = glm::vec4(0.5f + (tint & 0xFF) / 510.0f,
+                                         0.5f + ((tint >> 8) & 0xFF) / 510.0f,
+                                         0.5f + ((tint >> 16) & 0xFF) / 510.0f, 1.0f);
+
+        // One in eight glows a little
+        if (tint >> 29 == 0)
+        {
+            parameters.emissive = glm::vec4(0.2f, 0.1f, 0.0f, 0.0f);
+        }
+
+        TextureAsset* albedo = textures.empty() ? nullptr : textures[i % textures.size()];
+        materials.push_back(materialSystem.Create(parameters, albedo, true));
+    }
+
+    // The spheres are closed, their back faces are never seen
+    materialSystem.SetCullBackFaces(DEFAULT_MATERIAL, true);
+}
+
+void GenerateBenchmarkLights(const BenchmarkConfig& config, std::vector<Light>& lights)
+{
+    lights.clear();
+
+    // As far apart as the instances
+    float spacing = SCENE_SIZE / (float) std::ceil(std::cbrt((double) config.instances));
+
+    for (unsigned int i = 0; i < config.lights; i++)
+    {
+        unsigned int position = Hash(i + 7);
+        unsigned int color = Hash(i + 8);
+        unsigned int shape = Hash(i + 9);
+
+        Light light;
+        light.position = SCENE_CENTER + glm::vec3((position & 0x3FF) / 1023.0f - 0.5f,
+                                                  ((position >> 10) & 0x3FF) / 1023.0f - 0.5f,
+                                                  ((position >> 20) & 0x3FF) / 1023.0f - 0.5f) * SCENE_SIZE;
+        light.range = spacing * (0.6f + (shape & 0xFF) / 425.0f);
+        light.color = glm::vec3(0.2f + (color & 0xFF) / 320.0f,
+                                0.2f + ((color >> 8) & 0xFF) / 320.0f,
+                                0.2f + ((color >> 16) & 0xFF) / 320.0f);
+        light.intensity = 1.0f;
+
+        if (i % 4 == 3)
+        {
+            float outer = (25.0f + ((shape >> 8) & 0xFF) / 12.75f) * glm::pi<float>() / 180.0f;
+            float tilt = ((shape >> 16) & 0xFF) / 255.0f - 0.5f;
+            float turn = ((shape >> 24) & 0xFF) / 255.0f * 2.0f * glm::pi<float>();
+
+            light.type = LIGHT_SPOT;
+            light.range *= 1.5f;
+            light.direction = glm::normalize(glm::vec3(std::sin(turn) * tilt, -1.0f, std::cos(turn) * tilt));
+            light.cosOuter = std::cos(outer);
+            light.cosInner = std::cos(outer * 0.8f);
+        }
+
+        lights.push_back(light);
+    }
+}
+
+void GenerateBenchmarkInstances(const BenchmarkConfig& config, const std::vector<Mesh3D*>& meshes,
+                                const std::vector<MaterialId>& materials, std::vector<SceneInstance>& instances)
+{
+    instances.clear();
+
+    if (meshes.empty())
+    {
+        return;
+    }
+
+    unsigned int perSide = (unsigned int) std::ceil(std::cbrt((double) config.instances));
+    float spacing = SCENE_SIZE / perSide;
+
+    for (unsigned int i = 0; i < config.instances; i++)
+    {
+        unsigned int x = i % perSide;
+        unsigned int y = (i / perSide) % perSide;
+        unsigned int z = i / (perSide * perSide);
+
+        glm::vec3 position = SCENE_CENTER
+                           + (glm::vec3((float) x, (float) y, (float) z) + 0.5f) * spacing
+                           - glm::vec3(SCENE_SIZE * 0.5f);
+        float angle = (Hash(i) % 360) * glm::pi<float>() / 180.0f;
+
+        SceneInstance instance;
+        // Neighbours use different meshes and programs, like a real scene
+        // that was not submitted in a friendly order
+        instance.mesh = meshes[Hash(i + 1) % meshes.size()];
+        instance.program = Hash(i + 2) % config.programs;
+        instance.material = materials.empty() ? DEFAULT_MATERIAL : materials[Hash(i + 3) % materials.size()];
+        instance.model = glm::translate(glm::mat4(1.0f), position);
+        instance.model = glm::rotate(instance.model, angle, glm::vec3(0.0f, 1.0f, 0.0f));
+        instance.model = glm::scale(instance.model, glm::vec3(spacing * 0.8f));
+        instances.push_back(instance);
+    }
+}
+
+void GetBenchmarkCameraPose(unsigned int frame, unsigned int frameCount, glm::vec3& eye, glm::vec3& viewDirection)
+{
+    float t = frameCount > 0 ? (float) (frame % frameCount) / frameCount : 0.0f;
+    float angle = t * 2.0f * glm::pi<float>();
+
+    eye = SCENE_CENTER + glm::vec3(std::sin(angle) * ORBIT_RADIUS,
+                                   std::sin(angle * 2.0f) * 0.5f,
+                                   std::cos(angle) * ORBIT_RADIUS);
+    viewDirection = glm::normalize(SCENE_CENTER - eye);
+}
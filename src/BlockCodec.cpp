@@ -0,0 +1,491 @@
+#include "BlockCodec.hpp"
+
+#include <atomic>
+#include <cstring>
+
+namespace {
+    const size_t MIN_MATCH = 4;
+    const size_t MAX_OFFSET = 65535;
+    const unsigned int HASH_LOG = 14;
+
+    // Matches never start in the last bytes of a block, which keeps the
+    // match finder from reading past the end
+    const size_t MATCH_FIND_LIMIT = 12;
+    const size_t LAST_LITERALS = 5;
+
+    // Room the decoder needs to be allowed to over-copy
+    const size_t WILDCOPY_SLACK = 16;
+
+    inline uint32_t Read32(const unsigned char* p)
+    {
+        uint32_t value;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    inline uint32_t Hash(uint32_t sequence)
+    {
+        return (sequence * 2654435761u) >> (32 - HASH_LOG);
+    }
+
+    // Copies in chunks of 16 bytes, may write up to 15 bytes past dst + size
+    inline void WildCopy16(unsigned char* dst, const unsigned char* src, size_t size)
+    {
+        unsigned char* end = dst + size;
+
+        do
+        {
+            std::memcpy(dst, src, 16);
+            dst += 16;
+            src += 16;
+        } while (dst < end);
+    }
+
+    inline bool WriteLength(unsigned char*& op, const unsigned char* oend, size_t length)
+    {
+        while (length >= 255)
+        {
+            if (op >= oend)
+            {
+                return false;
+            }
+
+            *op++ = 255;
+            length -= 255;
+        }
+
+        if (op >= oend)
+        {
+            return false;
+        }
+
+        *op++ = (unsigned char) length;
+
+        return true;
+    }
+
+    inline bool ReadLength(const unsigned char*& ip, const unsigned char* iend, size_t& length)
+    {
+        unsigned char byte;
+
+        do
+        {
+            if (ip >= iend)
+            {
+                return false;
+            }
+
+            byte = *ip++;
+            length += byte;
+        } while (byte == 255);
+
+        return true;
+    }
+
+    bool EmitSequence(unsigned char*& op, const unsigned char* oend,
+                      const unsigned char* literals, size_t literalLength,
+                      size_t offset, size_t matchLength)
+    {
+        if (op >= oend)
+        {
+            return false;
+        }
+
+        unsigned char* token = op++;
+        size_t matchCode = matchLength >= MIN_MATCH ? matchLength - MIN_MATCH : 0;
+
+        *token = (unsigned char) (((literalLength < 15 ? literalLength : 15) << 4)
+                                  | (matchCode < 15 ? matchCode : 15));
+
+        if (literalLength >= 15 && !WriteLength(op, oend, literalLength - 15))
+        {
+            return false;
+        }
+
+        if ((size_t) (oend - op) < literalLength)
+        {
+            return false;
+        }
+
+        std::memcpy(op, literals, literalLength);
+        op += literalLength;
+
+        // Last sequence, literals only
+        if (matchLength == 0)
+        {
+            return true;
+        }
+
+        if (oend - op < 2)
+        {
+            return false;
+        }
+
+        *op++ = (unsigned char) (offset & 0xff);
+        *op++ = (unsigned char) (offset >> 8);
+
+        if (matchCode >= 15 && !WriteLength(op, oend, matchCode - 15))
+        {
+            return false;
+        }
+
+        return true;
+    }
+}
+
+size_t LZCompressBlock(const unsigned char* src, size_t srcSize,
+                       unsigned char* dst, size_t dstCapacity)
+{
+    unsigned char* op = dst;
+    const unsigned char* oend = dst + dstCapacity;
+
+    size_t anchor = 0;
+
+    if (srcSize > MATCH_FIND_LIMIT)
+    {
+        // Positions of the last time we saw a 4 byte sequence
+        std::vector<uint32_t> table(1u << HASH_LOG, 0);
+
+        size_t ip = 0;
+        size_t limit = srcSize - MATCH_FIND_LIMIT;
+
+        while (ip < limit)
+        {
+            uint32_t sequence = Read32(src + ip);
+            uint32_t hash = Hash(sequence);
+            size_t candidate = table[hash];
+            table[hash] = (uint32_t) ip;
+
+            if (candidate < ip && ip - candidate <= MAX_OFFSET
+                && Read32(src + candidate) == sequence)
+            {
+                // Extend the match forward, leaving the last literals alone
+                size_t matchEnd = srcSize - LAST_LITERALS;
+                size_t length = MIN_MATCH;
+
+                while (ip + length < matchEnd && src[candidate + length] == src[ip + length])
+                {
+                    length++;
+                }
+
+                if (!EmitSequence(op, oend, src + anchor, ip - anchor, ip - candidate, length))
+                {
+                    return 0;
+                }
+
+                ip += length;
+                anchor = ip;
+
+                // Keep the table warm inside the match
+                if (ip - 2 < limit)
+                {
+                    table[Hash(Read32(src + ip - 2))] = (uint32_t) (ip - 2);
+                }
+            }
+            else
+            {
+                // Skip faster through data that does not compress
+                ip += 1 + ((ip - anchor) >> 6);
+            }
+        }
+    }
+
+    if (!EmitSequence(op, oend, src + anchor, srcSize - anchor, 0, 0))
+    {
+        return 0;
+    }
+
+    return op - dst;
+}
+
+bool LZDecompressBlock(const unsigned char* src, size_t srcSize,
+                       unsigned char* dst, size_t dstSize)
+{
+    const unsigned char* ip = src;
+    const unsigned char* iend = src + srcSize;
+    unsigned char* op = dst;
+    unsigned char* oend = dst + dstSize;
+
+    while (ip < iend)
+    {
+        unsigned int token = *ip++;
+
+        /* Literals */
+        size_t literalLength = token >> 4;
+
+        if (literalLength == 15 && !ReadLength(ip, iend, literalLength))
+        {
+            return false;
+        }
+
+        if ((size_t) (iend - ip) < literalLength || (size_t) (oend - op) < literalLength)
+        {
+            return false;
+        }
+
+        if ((size_t) (iend - ip) >= literalLength + WILDCOPY_SLACK
+            && (size_t) (oend - op) >= literalLength + WILDCOPY_SLACK)
+        {
+            WildCopy16(op, ip, literalLength);
+        }
+        else
+        {
+            std::memcpy(op, ip, literalLength);
+        }
+
+        ip += literalLength;
+        op += literalLength;
+
+        // The last sequence has no match
+        if (ip == iend)
+        {
+            break;
+        }
+
+        /* Match */
+        if (iend - ip < 2)
+        {
+            return false;
+        }
+
+        size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+
+        if (offset == 0 || offset > (size_t) (op - dst))
+        {
+            return false;
+        }
+
+        size_t matchLength = token & 15;
+
+        if (matchLength == 15 && !ReadLength(ip, iend, matchLength))
+        {
+            return false;
+        }
+
+        matchLength += MIN_MATCH;
+
+        if ((size_t) (oend - op) < matchLength)
+        {
+            return false;
+        }
+
+        const unsigned char* match = op - offset;
+
+        if (offset >= 16 && (size_t) (oend - op) >= matchLength + WILDCOPY_SLACK)
+        {
+            WildCopy16(op, match, matchLength);
+            op += matchLength;
+        }
+        else if (offset >= 8 && (size_t) (oend - op) >= matchLength + WILDCOPY_SLACK)
+        {
+            // Each 8 byte chunk only reads bytes that are already written
+            unsigned char* matchEnd = op + matchLength;
+
+            do
+            {
+                std::memcpy(op, match, 8);
+                op += 8;
+                match += 8;
+            } while (op < matchEnd);
+
+            op = matchEnd;
+        }
+        else
+        {
+            // Overlapping copy, repeats the last 'offset' bytes
+            unsigned char* matchEnd = op + matchLength;
+
+            while (op < matchEnd)
+            {
+                *op++ = *match++;
+            }
+        }
+    }
+
+    return op == oend;
+}
+
+void BlockCompress(const unsigned char* src, size_t srcSize, std::vector<unsigned char>& frame,
+                   uint32_t blockSize, ThreadPool* threadPool)
+{
+    uint32_t blockCount = (uint32_t) ((srcSize + blockSize - 1) / blockSize);
+
+    // Compress every block into its own slot first, then pack them
+    std::vector<std::vector<unsigned char> > blocks(blockCount);
+    std::vector<uint32_t> blockSizes(blockCount);
+
+    std::function<void(unsigned int, unsigned int)> compressBlocks =
+        [&](unsigned int begin, unsigned int end) {
+            for (unsigned int i = begin; i < end; i++)
+            {
+                const unsigned char* block = src + (size_t) i * blockSize;
+                size_t size = srcSize - (size_t) i * blockSize;
+                size = size < blockSize ? size : blockSize;
+
+                blocks[i].resize(size);
+                size_t compressed = LZCompressBlock(block, size, blocks[i].data(), size);
+
+                if (compressed == 0 || compressed >= size)
+                {
+                    std::memcpy(blocks[i].data(), block, size);
+                    blockSizes[i] = (uint32_t) size | BLOCK_CODEC_STORED_FLAG;
+                }
+                else
+                {
+                    blocks[i].resize(compressed);
+                    blockSizes[i] = (uint32_t) compressed;
+                }
+            }
+        };
+
+    if (threadPool != nullptr)
+    {
+        threadPool->ParallelFor(blockCount, 1, compressBlocks);
+    }
+    else
+    {
+        compressBlocks(0, blockCount);
+    }
+
+    BlockFrameHeader header;
+    std::memcpy(header.magic, "LZB1", 4);
+    header.blockSize = blockSize;
+    header.rawSize = srcSize;
+    header.blockCount = blockCount;
+    header.reserved = 0;
+
+    size_t frameSize = sizeof(header) + blockCount * sizeof(uint32_t);
+
+    for (uint32_t i = 0; i < blockCount; i++)
+    {
+        frameSize += blocks[i].size();
+    }
+
+    frame.resize(frameSize);
+    unsigned char* out = frame.data();
+
+    std::memcpy(out, &header, sizeof(header));
+    out += sizeof(header);
+
+    std::memcpy(out, blockSizes.data(), blockCount * sizeof(uint32_t));
+    out += blockCount * sizeof(uint32_t);
+
+    for (uint32_t i = 0; i < blockCount; i++)
+    {
+        std::memcpy(out, blocks[i].data(), blocks[i].size());
+        out += blocks[i].size();
+    }
+}
+
+bool BlockDecompressedSize(const unsigned char* frame, size_t frameSize, size_t& rawSize)
+{
+    BlockFrameHeader header;
+
+    if (frameSize < sizeof(header))
+    {
+        return false;
+    }
+
+    std::memcpy(&header, frame, sizeof(header));
+
+    if (std::memcmp(header.magic, "LZB1", 4) != 0 || header.blockSize == 0)
+    {
+        return false;
+    }
+
+    rawSize = (size_t) header.rawSize;
+
+    return true;
+}
+
+bool BlockDecompress(const unsigned char* frame, size_t frameSize,
+                     unsigned char* dst, size_t dstSize,
+                     ThreadPool* threadPool)
+{
+    size_t rawSize = 0;
+
+    if (!BlockDecompressedSize(frame, frameSize, rawSize) || rawSize != dstSize)
+    {
+        return false;
+    }
+
+    BlockFrameHeader header;
+    std::memcpy(&header, frame, sizeof(header));
+
+    size_t tableSize = header.blockCount * sizeof(uint32_t);
+    // Exactly as many blocks as the raw size needs, none for an empty frame
+    uint64_t blockCount = rawSize / header.blockSize + (rawSize % header.blockSize != 0 ? 1 : 0);
+
+    if (frameSize - sizeof(header) < tableSize || header.blockCount != blockCount)
+    {
+        return false;
+    }
+
+    // Where every block starts in the frame
+    std::vector<uint32_t> blockSizes(header.blockCount);
+    std::vector<size_t> blockOffsets(header.blockCount);
+    std::memcpy(blockSizes.data(), frame + sizeof(header), tableSize);
+
+    size_t offset = sizeof(header) + tableSize;
+
+    for (uint32_t i = 0; i < header.blockCount; i++)
+    {
+        blockOffsets[i] = offset;
+        offset += blockSizes[i] & ~BLOCK_CODEC_STORED_FLAG;
+    }
+
+    if (offset > frameSize)
+    {
+        return false;
+    }
+
+    std::atomic<bool> ok(true);
+
+    std::function<void(unsigned int, unsigned int)> decompressBlocks =
+        [&](unsigned int begin, unsigned int end) {
+            for (unsigned int i = begin; i < end; i++)
+            {
+                const unsigned char* block = frame + blockOffsets[i];
+                size_t storedSize = blockSizes[i] & ~BLOCK_CODEC_STORED_FLAG;
+                size_t start = (size_t) i * header.blockSize;
+
+                if (start >= dstSize)
+                {
+                    ok = false;
+                    return;
+                }
+
+                unsigned char* out = dst + start;
+                size_t size = dstSize - start;
+                size = size < header.blockSize ? size : header.blockSize;
+
+                if (blockSizes[i] & BLOCK_CODEC_STORED_FLAG)
+                {
+                    if (storedSize != size)
+                    {
+                        ok = false;
+                        return;
+                    }
+
+                    std::memcpy(out, block, size);
+                }
+                else if (!LZDecompressBlock(block, storedSize, out, size))
+                {
+                    ok = false;
+                    return;
+                }
+            }
+        };
+
+    if (threadPool != nullptr && header.blockCount > 1)
+    {
+        threadPool->ParallelFor(header.blockCount, 1, decompressBlocks);
+    }
+    else
+    {
+        decompressBlocks(0, header.blockCount);
+    }
+
+    return ok;
+}
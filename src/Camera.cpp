@@ -1,37 +1,91 @@
 #include "Camera.hpp"
+#include <cmath>
 #include <iostream>
 
-#include <glm/gtx/rotate_vector.hpp>
 #include "glm/ext.hpp"
 
+namespace {
+    // Radians per pixel of relative mouse motion
+    const float LOOK_SENSITIVITY = 0.0025f;
+    // Just short of straight up or down, where yaw would be undefined
+    const float MAX_PITCH = glm::radians(89.0f);
+    const float PI = glm::pi<float>();
+}
+
 Camera::Camera() {
     // Assume, we are placed at the origin
     mEye = glm::vec3(0.0f, 0.0f, 0.0f);
 
     // Assume we are looking out into the world
     // NOTE: This is along '-z', because outherwise, we'd be looking behind us
-    mViewDirection = glm::vec3(0.0f, 0.0f, -1.0f);
+    mYaw = 0.0f;
+    mPitch = 0.0f;
 
     // Assume we start on a perfect plane
     mUpVector = glm::vec3(0.0f, 1.0f, 0.0f);
+
+    UpdateBasis();
+}
+
+void Camera::UpdateBasis()
+{
+    float sinYaw = std::sin(mYaw);
+    float cosYaw = std::cos(mYaw);
+    float sinPitch = std::sin(mPitch);
+    float cosPitch = std::cos(mPitch);
+
+    mViewDirection = glm::vec3(cosPitch * sinYaw, sinPitch, -cosPitch * cosYaw);
+
+    // Gram-Schmidt against the world up, exact up to rounding of this call
+    mRightVector = glm::normalize(glm::cross(mViewDirection, mUpVector));
+    mCameraUpVector = glm::cross(mRightVector, mViewDirection);
 }
 
-void Camera::MouseLook(int mouseX, int mouseY)
+glm::mat4 Camera::GetViewMatrix() const
 {
-    glm::vec2 currentMouse = glm::vec2(mouseX, mouseY);
+    glm::mat4 view(1.0f);
 
-    static int firstLook = true;
-    if (firstLook)
-    {
-        mOldMousePosition = currentMouse;
-        firstLook = false;
-    }
+    view[0][0] = mRightVector.x;
+    view[1][0] = mRightVector.y;
+    view[2][0] = mRightVector.z;
+    view[0][1] = mCameraUpVector.x;
+    view[1][1] = mCameraUpVector.y;
+    view[2][1] = mCameraUpVector.z;
+    view[0][2] = -mViewDirection.x;
+    view[1][2] = -mViewDirection.y;
+    view[2][2] = -mViewDirection.z;
+    view[3][0] = -glm::dot(mRightVector, mEye);
+    view[3][1] = -glm::dot(mCameraUpVector, mEye);
+    view[3][2] = glm::dot(mViewDirection, mEye);
+
+    return view;
+}
 
-    glm::vec2 mouseDelta = mOldMousePosition - currentMouse; // gives us a vector
+glm::mat4 Camera::GetProjectionMatrix(float aspectRatio) const
+{
+    return glm::perspective(glm::radians(45.0f), aspectRatio, 0.1f, 10.0f);
+}
+
+void Camera::SetPose(const glm::vec3& eye, const glm::vec3& viewDirection)
+{
+    glm::vec3 direction = glm::normalize(viewDirection);
+
+    mEye = eye;
+    mYaw = std::atan2(direction.x, -direction.z);
+    mPitch = glm::clamp(std::asin(glm::clamp(direction.y, -1.0f, 1.0f)), -MAX_PITCH, MAX_PITCH);
+
+    UpdateBasis();
+}
+
+void Camera::MouseLook(float deltaX, float deltaY)
+{
+    mYaw += deltaX * LOOK_SENSITIVITY;
+    mPitch = glm::clamp(mPitch - deltaY * LOOK_SENSITIVITY, -MAX_PITCH, MAX_PITCH);
 
-    mViewDirection = glm::rotate(mViewDirection, glm::radians((float) mouseDelta.x), mUpVector);
+    // Keep the yaw within a turn, a float far from zero loses precision
+    mYaw = std::remainder(mYaw, 2.0f * PI);
 
-    mOldMousePosition = currentMouse;
+    UpdateBasis();
 }
 
 void Camera::MoveForward(float speed) {
@@ -44,12 +98,10 @@ void Camera::MoveBackward(float speed) {
 
 void Camera::MoveLeft(float speed)
 {
-    glm::vec3 rightVector = glm::cross(mViewDirection, mUpVector);
-    mEye -= (rightVector * speed);
+    mEye -= (mRightVector * speed);
 }
 
 void Camera::MoveRight(float speed)
 {
-    glm::vec3 rightVector = glm::cross(mViewDirection, mUpVector);
-    mEye += (rightVector * speed);
+    mEye += (mRightVector * speed);
 }
@@ -0,0 +1,38 @@
+#include "FixedTimestep.hpp"
+
+FixedTimestep::FixedTimestep(double stepSeconds, unsigned int maxStepsPerFrame)
+{
+    mStepSeconds = stepSeconds;
+    mMaxStepsPerFrame = maxStepsPerFrame;
+    mAccumulator = 0.0;
+}
+
+unsigned int FixedTimestep::Advance(double elapsedSeconds)
+{
+    mAccumulator += elapsedSeconds;
+
+    unsigned int steps = 0;
+
+    while (mAccumulator >= mStepSeconds && steps < mMaxStepsPerFrame)
+    {
+        mAccumulator -= mStepSeconds;
+        steps++;
+    }
+
+    if (steps == mMaxStepsPerFrame)
+    {
+        mAccumulator = 0.0;
+    }
+
+    return steps;
+}
+
+void FixedTimestep::SetStepSeconds(double stepSeconds)
+{
+    mStepSeconds = stepSeconds;
+}
+
+double FixedTimestep::GetStepSeconds() const
+{
+    return mStepSeconds;
+}
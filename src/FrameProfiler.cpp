@@ -0,0 +1,136 @@
+#include "FrameProfiler.hpp"
+
+FrameProfiler::FrameProfiler()
+{
+    mFrameStarted = false;
+}
+
+unsigned int FrameProfiler::AddSection(const std::string& name)
+{
+    Section section;
+    section.name = name;
+    section.thisFrame = 0.0;
+    mSections.push_back(section);
+
+    return (unsigned int) mSections.size() - 1;
+}
+
+unsigned int FrameProfiler::AddCounter(const std::string& name)
+{
+    Counter counter;
+    counter.name = name;
+    counter.thisFrame = 0;
+    mCounters.push_back(counter);
+
+    return (unsigned int) mCounters.size() - 1;
+}
+
+void FrameProfiler::BeginFrame()
+{
+    Clock::time_point now = Clock::now();
+
+    if (mFrameStarted)
+    {
+        mFrameMilliseconds.push_back(std::chrono::duration<double, std::milli>(now - mFrameStart).count());
+
+        for (size_t i = 0; i < mSections.size(); i++)
+        {
+            mSections[i].frames.push_back(mSections[i].thisFrame);
+        }
+
+        for (size_t i = 0; i < mCounters.size(); i++)
+        {
+            mCounters[i].frames.push_back((double) mCounters[i].thisFrame);
+        }
+    }
+
+    for (size_t i = 0; i < mSections.size(); i++)
+    {
+        mSections[i].thisFrame = 0.0;
+    }
+
+    for (size_t i = 0; i < mCounters.size(); i++)
+    {
+        mCounters[i].thisFrame = 0;
+    }
+
+    mFrameStarted = true;
+    mFrameStart = now;
+}
+
+void FrameProfiler::BeginSection(unsigned int section)
+{
+    mSections[section].start = Clock::now();
+}
+
+void FrameProfiler::EndSection(unsigned int section)
+{
+    Section& timed = mSections[section];
+    timed.thisFrame += std::chrono::duration<double, std::milli>(Clock::now() - timed.start).count();
+}
+
+void FrameProfiler::AddToCounter(unsigned int counter, unsigned long long amount)
+{
+    mCounters[counter].thisFrame += amount;
+}
+
+unsigned long long FrameProfiler::GetCounter(unsigned int counter) const
+{
+    return mCounters[counter].thisFrame;
+}
+
+void FrameProfiler::Reset()
+{
+    mFrameStarted = false;
+    mFrameMilliseconds.clear();
+
+    for (size_t i = 0; i < mSections.size(); i++)
+    {
+        mSections[i].frames.clear();
+    }
+
+    for (size_t i = 0; i < mCounters.size(); i++)
+    {
+        mCounters[i].frames.clear();
+    }
+}
+
+size_t FrameProfiler::GetFrameCount() const
+{
+    return mFrameMilliseconds.size();
+}
+
+const std::vector<double>& FrameProfiler::GetFrameMilliseconds() const
+{
+    return mFrameMilliseconds;
+}
+
+size_t FrameProfiler::GetSectionCount() const
+{
+    return mSections.size();
+}
+
+const std::string& FrameProfiler::GetSectionName(unsigned int section) const
+{
+    return mSections[section].name;
+}
+
+const std::vector<double>& FrameProfiler::GetSectionMilliseconds(unsigned int section) const
+{
+    return mSections[section].frames;
+}
+
+size_t FrameProfiler::GetCounterCount() const
+{
+    return mCounters.size();
+}
+
+const std::string& FrameProfiler::GetCounterName(unsigned int counter) const
+{
+    return mCounters[counter].name;
+}
+
+const std::vector<double>& FrameProfiler::GetCounterValues(unsigned int counter) const
+{
+    return mCounters[counter].frames;
+}
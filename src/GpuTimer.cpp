@@ -0,0 +1,98 @@
+#include "GpuTimer.hpp"
+
+GpuTimer::GpuTimer()
+{
+    for (unsigned int i = 0; i < QUERY_COUNT; i++)
+    {
+        mQueries[i] = 0;
+        mPending[i] = false;
+    }
+
+    mNext = 0;
+    mActive = false;
+    mMilliseconds = 0.0;
+}
+
+GpuTimer::~GpuTimer()
+{
+}
+
+void GpuTimer::Begin()
+{
+    if (mQueries[0] == 0)
+    {
+        glGenQueries(QUERY_COUNT, mQueries);
+    }
+
+    CollectResults();
+
+    // Every query still in flight, skip rather than stall
+    if (mPending[mNext])
+    {
+        mActive = false;
+        return;
+    }
+
+    glBeginQuery(GL_TIME_ELAPSED, mQueries[mNext]);
+    mActive = true;
+}
+
+void GpuTimer::End()
+{
+    if (!mActive)
+    {
+        return;
+    }
+
+    glEndQuery(GL_TIME_ELAPSED);
+    mPending[mNext] = true;
+    mNext = (mNext + 1) % QUERY_COUNT;
+    mActive = false;
+}
+
+double GpuTimer::GetMilliseconds() const
+{
+    return mMilliseconds;
+}
+
+void GpuTimer::Release()
+{
+    if (mQueries[0] != 0)
+    {
+        glDeleteQueries(QUERY_COUNT, mQueries);
+    }
+
+    for (unsigned int i = 0; i < QUERY_COUNT; i++)
+    {
+        mQueries[i] = 0;
+        mPending[i] = false;
+    }
+}
+
+void GpuTimer::CollectResults()
+{
+    // Oldest first, so the newest finished one wins
+    for (unsigned int i = 0; i < QUERY_COUNT; i++)
+    {
+        unsigned int query = (mNext + i) % QUERY_COUNT;
+
+        if (!mPending[query])
+        {
+            continue;
+        }
+
+        GLint available = 0;
+        glGetQueryObjectiv(mQueries[query], GL_QUERY_RESULT_AVAILABLE, &available);
+
+        if (!available)
+        {
+            // Queries finish in order, the later ones are not done either
+            break;
+        }
+
+        GLuint64 nanoseconds = 0;
+        glGetQueryObjectui64v(mQueries[query], GL_QUERY_RESULT, &nanoseconds);
+        mMilliseconds = nanoseconds / 1e6;
+        mPending[query] = false;
+    }
+}
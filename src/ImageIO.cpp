@@ -0,0 +1,273 @@
+#include "ImageIO.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+namespace {
+    void AppendBigEndian(std::vector<unsigned char>& bytes, unsigned int value)
+    {
+        bytes.push_back((unsigned char) (value >> 24));
+        bytes.push_back((unsigned char) (value >> 16));
+        bytes.push_back((unsigned char) (value >> 8));
+        bytes.push_back((unsigned char) value);
+    }
+
+    std::vector<unsigned int> MakeCrcTable()
+    {
+        std::vector<unsigned int> table(256);
+
+        for (unsigned int i = 0; i < 256; i++)
+        {
+            unsigned int value = i;
+
+            for (int bit = 0; bit < 8; bit++)
+            {
+                value = (value & 1) ? 0xEDB88320u ^ (value >> 1) : value >> 1;
+            }
+
+            table[i] = value;
+        }
+
+        return table;
+    }
+
+    unsigned int Crc32(const unsigned char* data, size_t size, unsigned int crc)
+    {
+        static const std::vector<unsigned int> table = MakeCrcTable();
+
+        crc = ~crc;
+
+        for (size_t i = 0; i < size; i++)
+        {
+            crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+        }
+
+        return ~crc;
+    }
+
+    void AppendChunk(std::vector<unsigned char>& png, const char* type, const std::vector<unsigned char>& data)
+    {
+        AppendBigEndian(png, (unsigned int) data.size());
+
+        size_t typeOffset = png.size();
+        png.insert(png.end(), type, type + 4);
+        png.insert(png.end(), data.begin(), data.end());
+
+        AppendBigEndian(png, Crc32(&png[typeOffset], png.size() - typeOffset, 0));
+    }
+
+    bool WriteFile(const std::string& fileName, const std::vector<unsigned char>& bytes)
+    {
+        std::ofstream myFile(fileName.c_str(), std::ios::binary);
+
+        if (!myFile.is_open())
+        {
+            std::cout << "Could not open " << fileName << " for writing" << std::endl;
+            return false;
+        }
+
+        myFile.write((const char*) bytes.data(), bytes.size());
+
+        return myFile.good();
+    }
+}
+
+bool SavePPM(const std::string& fileName, unsigned int width, unsigned int height,
+             const unsigned char* rgba)
+{
+    std::string header = "P6\n" + std::to_string(width) + " " + std::to_string(height) + "\n255\n";
+    std::vector<unsigned char> bytes(header.begin(), header.end());
+
+    for (unsigned int y = 0; y < height; y++)
+    {
+        const unsigned char* row = rgba + (size_t) (height - 1 - y) * width * 4;
+
+        for (unsigned int x = 0; x < width; x++)
+        {
+            bytes.insert(bytes.end(), row + x * 4, row + x * 4 + 3);
+        }
+    }
+
+    return WriteFile(fileName, bytes);
+}
+
+bool SavePNG(const std::string& fileName, unsigned int width, unsigned int height,
+             const unsigned char* rgba)
+{
+    static const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    std::vector<unsigned char> png(signature, signature + 8);
+
+    std::vector<unsigned char> header;
+    AppendBigEndian(header, width);
+    AppendBigEndian(header, height);
+    header.push_back(8); // bits per channel
+    header.push_back(6); // RGBA
+    header.push_back(0); // deflate
+    header.push_back(0); // adaptive filtering
+    header.push_back(0); // not interlaced
+    AppendChunk(png, "IHDR", header);
+
+    // Every row starts with its filter type, 0 = none
+    std::vector<unsigned char> raw;
+    raw.reserve((size_t) height * (width * 4 + 1));
+
+    for (unsigned int y = 0; y < height; y++)
+    {
+        const unsigned char* row = rgba + (size_t) (height - 1 - y) * width * 4;
+        raw.push_back(0);
+        raw.insert(raw.end(), row, row + width * 4);
+    }
+
+    // zlib stream made of stored deflate blocks
+    std::vector<unsigned char> zlib;
+    zlib.push_back(0x78);
+    zlib.push_back(0x01);
+
+    const size_t maxBlock = 65535;
+    size_t offset = 0;
+
+    do
+    {
+        size_t length = raw.size() - offset < maxBlock ? raw.size() - offset : maxBlock;
+        bool last = offset + length == raw.size();
+
+        zlib.push_back(last ? 1 : 0);
+        zlib.push_back((unsigned char) length);
+        zlib.push_back((unsigned char) (length >> 8));
+        zlib.push_back((unsigned char) ~length);
+        zlib.push_back((unsigned char) (~length >> 8));
+        zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + length);
+
+        offset += length;
+    } while (offset < raw.size());
+
+    unsigned int a = 1;
+    unsigned int b = 0;
+
+    for (size_t i = 0; i < raw.size(); i++)
+    {
+        a = (a + raw[i]) % 65521;
+        b = (b + a) % 65521;
+    }
+
+    AppendBigEndian(zlib, (b << 16) | a);
+
+    AppendChunk(png, "IDAT", zlib);
+    AppendChunk(png, "IEND", std::vector<unsigned char>());
+
+    return WriteFile(fileName, png);
+}
+
+bool LoadPPM(const std::string& fileName, unsigned int& width, unsigned int& height,
+             std::vector<unsigned char>& rgba)
+{
+    std::ifstream myFile(fileName.c_str(), std::ios::binary);
+
+    if (!myFile.is_open())
+    {
+        std::cout << "Could not open image " << fileName << std::endl;
+        return false;
+    }
+
+    std::string magic;
+    unsigned int depth = 3;
+    unsigned int maximum = 0;
+    width = 0;
+    height = 0;
+    myFile >> magic;
+
+    if (magic == "P6")
+    {
+        // Comment lines are only skipped between the magic and the size
+        while (myFile >> std::ws && myFile.peek() == '#')
+        {
+            std::string comment;
+            std::getline(myFile, comment);
+        }
+
+        myFile >> width >> height >> maximum;
+    }
+    else if (magic == "P7")
+    {
+        std::string line;
+
+        while (std::getline(myFile, line) && line != "ENDHDR")
+        {
+            std::istringstream field(line);
+            std::string name;
+            field >> name;
+
+            if (name == "WIDTH")
+            {
+                field >> width;
+            }
+            else if (name == "HEIGHT")
+            {
+                field >> height;
+            }
+            else if (name == "DEPTH")
+            {
+                field >> depth;
+            }
+            else if (name == "MAXVAL")
+            {
+                field >> maximum;
+            }
+        }
+    }
+
+    // Exactly one whitespace byte separates a P6 header from the pixels
+    if (magic == "P6")
+    {
+        myFile.get();
+    }
+
+    if (!myFile || width == 0 || height == 0 || maximum != 255 || (depth != 3 && depth != 4))
+    {
+        std::cout << fileName << " is not an 8 bit binary PPM or PAM image" << std::endl;
+        return false;
+    }
+
+    std::vector<unsigned char> pixels((size_t) width * height * depth);
+    myFile.read((char*) pixels.data(), pixels.size());
+
+    if (!myFile)
+    {
+        std::cout << fileName << " is truncated" << std::endl;
+        return false;
+    }
+
+    rgba.resize((size_t) width * height * 4);
+
+    for (unsigned int y = 0; y < height; y++)
+    {
+        const unsigned char* source = &pixels[(size_t) (height - 1 - y) * width * depth];
+        unsigned char* destination = &rgba[(size_t) y * width * 4];
+
+        for (unsigned int x = 0; x < width; x++)
+        {
+            destination[x * 4 + 0] = source[x * depth + 0];
+            destination[x * 4 + 1] = source[x * depth + 1];
+            destination[x * 4 + 2] = source[x * depth + 2];
+            destination[x * 4 + 3] = depth == 4 ? source[x * depth + 3] : 255;
+        }
+    }
+
+    return true;
+}
+
+bool SaveImage(const std::string& fileName, unsigned int width, unsigned int height,
+               const unsigned char* rgba)
+{
+    size_t dot = fileName.rfind('.');
+    std::string extension = dot == std::string::npos ? "" : fileName.substr(dot);
+
+    if (extension == ".png" || extension == ".PNG")
+    {
+        return SavePNG(fileName, width, height, rgba);
+    }
+
+    return SavePPM(fileName, width, height, rgba);
+}
@@ -0,0 +1,121 @@
+#include "InputMap.hpp"
+
+InputMap::InputMap()
+{
+    for (int i = 0; i < INPUT_ACTION_COUNT; i++)
+    {
+        mHeldKeys[i] = 0;
+        mPresses[i] = 0;
+    }
+
+    for (int i = 0; i < INPUT_AXIS_COUNT; i++)
+    {
+        mAxes[i] = 0.0f;
+    }
+}
+
+void InputMap::Bind(unsigned int scancode, InputAction action)
+{
+    Binding binding;
+    binding.scancode = scancode;
+    binding.action = action;
+    mBindings.push_back(binding);
+
+    if (scancode >= mKeys.size())
+    {
+        mKeys.resize(scancode + 1, 0);
+    }
+
+    // A key that is already down counts from now on
+    if (mKeys[scancode])
+    {
+        mHeldKeys[action]++;
+    }
+}
+
+void InputMap::SetKey(unsigned int scancode, bool down)
+{
+    if (scancode >= mKeys.size() || (mKeys[scancode] != 0) == down)
+    {
+        return;
+    }
+
+    mKeys[scancode] = down ? 1 : 0;
+
+    for (size_t i = 0; i < mBindings.size(); i++)
+    {
+        if (mBindings[i].scancode != scancode)
+        {
+            continue;
+        }
+
+        InputAction action = mBindings[i].action;
+
+        if (down)
+        {
+            mHeldKeys[action]++;
+            mPresses[action]++;
+        }
+        else
+        {
+            mHeldKeys[action]--;
+        }
+    }
+}
+
+void InputMap::Process(const InputFrame& frame)
+{
+    for (int i = 0; i < INPUT_ACTION_COUNT; i++)
+    {
+        mPresses[i] = 0;
+    }
+
+    for (int i = 0; i < INPUT_AXIS_COUNT; i++)
+    {
+        mAxes[i] = 0.0f;
+    }
+
+    for (size_t i = 0; i < frame.events.size(); i++)
+    {
+        const InputEvent& event = frame.events[i];
+
+        switch (event.type)
+        {
+            case INPUT_EVENT_MOUSE_MOTION:
+                mAxes[INPUT_AXIS_LOOK_X] += event.x;
+                mAxes[INPUT_AXIS_LOOK_Y] += event.y;
+                break;
+            case INPUT_EVENT_KEY_DOWN:
+                SetKey((unsigned short) event.x, true);
+                break;
+            case INPUT_EVENT_KEY_UP:
+                SetKey((unsigned short) event.x, false);
+                break;
+        }
+    }
+
+    for (size_t i = 0; i < mBindings.size(); i++)
+    {
+        unsigned int scancode = mBindings[i].scancode;
+
+        if (scancode < frame.keys.size())
+        {
+            SetKey(scancode, frame.keys[scancode] != 0);
+        }
+    }
+}
+
+bool InputMap::IsHeld(InputAction action) const
+{
+    return mHeldKeys[action] > 0;
+}
+
+unsigned int InputMap::GetPresses(InputAction action) const
+{
+    return mPresses[action];
+}
+
+float InputMap::GetAxis(InputAxis axis) const
+{
+    return mAxes[axis];
+}
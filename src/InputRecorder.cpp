@@ -0,0 +1,259 @@
+#include "InputRecorder.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+namespace {
+    // type, timestamp, x, y without padding
+    const size_t EVENT_BYTES = 1 + sizeof(unsigned int) + 2 * sizeof(short);
+
+    template <typename T>
+    void Append(std::vector<unsigned char>& bytes, const T& value)
+    {
+        const unsigned char* begin = (const unsigned char*) &value;
+        bytes.insert(bytes.end(), begin, begin + sizeof(T));
+    }
+
+    template <typename T>
+    T Read(const unsigned char*& read)
+    {
+        T value;
+        std::memcpy(&value, read, sizeof(T));
+        read += sizeof(T);
+        return value;
+    }
+}
+
+InputRecorder::InputRecorder()
+{
+    mReplayOffset = 0;
+    mRecording = false;
+    mReplaying = false;
+    mKeyCount = 0;
+    mStepSeconds = 0.0;
+    mStepCount = 0;
+}
+
+InputRecorder::~InputRecorder()
+{
+    Stop();
+}
+
+bool InputRecorder::StartRecording(const std::string& fileName, double stepSeconds, unsigned int keyCount)
+{
+    Stop();
+
+    mOutput.open(fileName.c_str(), std::ios::binary);
+
+    if (!mOutput.is_open())
+    {
+        std::cout << "Could not open " << fileName << " for recording" << std::endl;
+        return false;
+    }
+
+    InputFileHeader header;
+    std::memcpy(header.magic, "INP1", 4);
+    header.version = INPUT_FILE_VERSION;
+    header.stepMicroseconds = (unsigned int) std::lround(stepSeconds * 1e6);
+    header.keyCount = keyCount;
+    mOutput.write((const char*) &header, sizeof(header));
+
+    mRecording = true;
+    mKeyCount = keyCount;
+    mStepSeconds = stepSeconds;
+    mStepCount = 0;
+    mKeyBits.assign((keyCount + 7) / 8, 0);
+
+    return true;
+}
+
+bool InputRecorder::StartReplay(const std::string& fileName)
+{
+    Stop();
+
+    std::ifstream myFile(fileName.c_str(), std::ios::binary);
+
+    if (!myFile.is_open())
+    {
+        std::cout << "Could not open recording " << fileName << std::endl;
+        return false;
+    }
+
+    std::stringstream contents;
+    contents << myFile.rdbuf();
+    std::string bytes = contents.str();
+
+    InputFileHeader header;
+
+    if (bytes.size() < sizeof(header))
+    {
+        std::cout << "Recording " << fileName << " is truncated" << std::endl;
+        return false;
+    }
+
+    std::memcpy(&header, bytes.data(), sizeof(header));
+
+    if (std::memcmp(header.magic, "INP1", 4) != 0 || header.version != INPUT_FILE_VERSION
+        || header.stepMicroseconds == 0)
+    {
+        std::cout << fileName << " is not an input recording (or wrong version)" << std::endl;
+        return false;
+    }
+
+    mReplay.assign(bytes.begin() + sizeof(header), bytes.end());
+    mReplayOffset = 0;
+    mReplaying = true;
+    mKeyCount = header.keyCount;
+    mStepSeconds = header.stepMicroseconds * 1e-6;
+    mStepCount = 0;
+    mKeyBits.assign((header.keyCount + 7) / 8, 0);
+
+    return true;
+}
+
+void InputRecorder::Stop()
+{
+    if (mRecording)
+    {
+        mOutput.close();
+        std::cout << "Recorded " << mStepCount << " input steps" << std::endl;
+    }
+
+    mRecording = false;
+    mReplaying = false;
+    mReplay.clear();
+    mReplayOffset = 0;
+}
+
+bool InputRecorder::IsRecording() const
+{
+    return mRecording;
+}
+
+bool InputRecorder::IsReplaying() const
+{
+    return mReplaying;
+}
+
+void InputRecorder::RecordStep(const InputFrame& frame)
+{
+    if (!mRecording)
+    {
+        return;
+    }
+
+    std::vector<unsigned char> keyBits(mKeyBits.size(), 0);
+
+    for (size_t key = 0; key < frame.keys.size() && key < mKeyCount; key++)
+    {
+        if (frame.keys[key] != 0)
+        {
+            keyBits[key / 8] |= (unsigned char) (1 << (key % 8));
+        }
+    }
+
+    bool keysChanged = keyBits != mKeyBits;
+    unsigned short eventCount = (unsigned short) std::min(frame.events.size(), (size_t) 0xFFFF);
+
+    std::vector<unsigned char> bytes;
+    bytes.reserve(3 + (keysChanged ? keyBits.size() : 0) + eventCount * EVENT_BYTES);
+
+    Append(bytes, eventCount);
+    Append(bytes, (unsigned char) (keysChanged ? 1 : 0));
+
+    if (keysChanged)
+    {
+        bytes.insert(bytes.end(), keyBits.begin(), keyBits.end());
+        mKeyBits.swap(keyBits);
+    }
+
+    for (unsigned short i = 0; i < eventCount; i++)
+    {
+        const InputEvent& event = frame.events[i];
+        Append(bytes, event.type);
+        Append(bytes, event.timestamp);
+        Append(bytes, event.x);
+        Append(bytes, event.y);
+    }
+
+    mOutput.write((const char*) bytes.data(), bytes.size());
+    mStepCount++;
+}
+
+bool InputRecorder::ReplayStep(InputFrame& frame)
+{
+    frame.events.clear();
+
+    if (!mReplaying)
+    {
+        return false;
+    }
+
+    const unsigned char* begin = mReplay.data() + mReplayOffset;
+    size_t remaining = mReplay.size() - mReplayOffset;
+
+    if (remaining < 3)
+    {
+        if (remaining != 0)
+        {
+            std::cout << "Input recording is truncated" << std::endl;
+        }
+
+        std::cout << "Replayed " << mStepCount << " input steps" << std::endl;
+        Stop();
+        return false;
+    }
+
+    const unsigned char* read = begin;
+    unsigned short eventCount = Read<unsigned short>(read);
+    bool keysChanged = Read<unsigned char>(read) != 0;
+    size_t needed = (keysChanged ? mKeyBits.size() : 0) + eventCount * EVENT_BYTES;
+
+    if (remaining - 3 < needed)
+    {
+        std::cout << "Input recording is truncated" << std::endl;
+        Stop();
+        return false;
+    }
+
+    if (keysChanged)
+    {
+        std::memcpy(mKeyBits.data(), read, mKeyBits.size());
+        read += mKeyBits.size();
+    }
+
+    frame.events.resize(eventCount);
+
+    for (unsigned short i = 0; i < eventCount; i++)
+    {
+        InputEvent& event = frame.events[i];
+        event.type = Read<unsigned char>(read);
+        event.timestamp = Read<unsigned int>(read);
+        event.x = Read<short>(read);
+        event.y = Read<short>(read);
+    }
+
+    // The keyboard array keeps the size the caller gave it
+    for (size_t key = 0; key < frame.keys.size(); key++)
+    {
+        frame.keys[key] = key < mKeyCount && (mKeyBits[key / 8] & (1 << (key % 8))) != 0;
+    }
+
+    mReplayOffset += read - begin;
+    mStepCount++;
+
+    return true;
+}
+
+double InputRecorder::GetStepSeconds() const
+{
+    return mStepSeconds;
+}
+
+unsigned long long InputRecorder::GetStepCount() const
+{
+    return mStepCount;
+}
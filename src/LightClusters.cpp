@@ -0,0 +1,417 @@
+#include "LightClusters.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+// SSE2 is always there on x86-64, anything else takes the scalar path
+#if defined(__SSE2__) || defined(_M_X64)
+#define CLUSTER_SIMD 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+    const unsigned int TILES_PER_SLICE = CLUSTER_TILES_X * CLUSTER_TILES_Y;
+
+    // Texels per light in u_Lights
+    const unsigned int LIGHT_TEXELS = 3;
+
+    // Point lights get a cone that takes everything in
+    const float POINT_LIGHT_COS_OUTER = -2.0f;
+
+    double MillisecondsSince(std::chrono::high_resolution_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+
+    /*
+        The smallest sphere around a light's reach. A wide spot cone fits in
+        the sphere through its rim, a narrow one in the sphere through its
+        apex and around its rim.
+    */
+    glm::vec4 GetBoundingSphere(const Light& light, const glm::vec3& position, const glm::vec3& direction)
+    {
+        if (light.type != LIGHT_SPOT)
+        {
+            return glm::vec4(position, light.range);
+        }
+
+        float cosOuter = std::max(light.cosOuter, 1e-3f);
+
+        if (cosOuter < 0.70710678f)
+        {
+            float sinOuter = std::sqrt(1.0f - cosOuter * cosOuter);
+            return glm::vec4(position + direction * (light.range * cosOuter), light.range * sinOuter);
+        }
+
+        float radius = light.range / (2.0f * cosOuter);
+        return glm::vec4(position + direction * radius, radius);
+    }
+}
+
+LightClusters::LightClusters(ThreadPool* threadPool)
+{
+    mThreadPool = threadPool;
+    mProjection = glm::mat4(0.0f);
+    mNear = 0.1f;
+    mFar = 10.0f;
+    mTanHalfX = 1.0f;
+    mTanHalfY = 1.0f;
+
+    mSliceLights.resize(CLUSTER_SLICES);
+    mScratch.resize(CLUSTER_COUNT * MAX_LIGHTS_PER_CLUSTER);
+    mScratchCounts.resize(CLUSTER_COUNT);
+    mDropped.resize(CLUSTER_SLICES);
+    mRanges.resize(CLUSTER_COUNT);
+
+    for (int i = 0; i < 3; i++)
+    {
+        mBuffers[i] = 0;
+        mTextures[i] = 0;
+    }
+}
+
+/*
+    Recover near, far and the field of view from a glm::perspective matrix
+    and rebuild every cluster's view space box.
+*/
+void LightClusters::BuildClusterBounds()
+{
+    const glm::mat4& p = mProjection;
+
+    mNear = p[3][2] / (p[2][2] - 1.0f);
+    mFar = p[3][2] / (p[2][2] + 1.0f);
+    mTanHalfX = 1.0f / p[0][0];
+    mTanHalfY = 1.0f / p[1][1];
+
+    mMinX.resize(CLUSTER_COUNT);
+    mMinY.resize(CLUSTER_COUNT);
+    mMinZ.resize(CLUSTER_COUNT);
+    mMaxX.resize(CLUSTER_COUNT);
+    mMaxY.resize(CLUSTER_COUNT);
+    mMaxZ.resize(CLUSTER_COUNT);
+
+    float ratio = mFar / mNear;
+
+    for (unsigned int slice = 0; slice < CLUSTER_SLICES; slice++)
+    {
+        // View space looks down -z
+        float nearDepth = mNear * std::pow(ratio, (float) slice / CLUSTER_SLICES);
+        float farDepth = mNear * std::pow(ratio, (float) (slice + 1) / CLUSTER_SLICES);
+
+        for (unsigned int y = 0; y < CLUSTER_TILES_Y; y++)
+        {
+            float bottom = (-1.0f + 2.0f * y / CLUSTER_TILES_Y) * mTanHalfY;
+            float top = (-1.0f + 2.0f * (y + 1) / CLUSTER_TILES_Y) * mTanHalfY;
+
+            for (unsigned int x = 0; x < CLUSTER_TILES_X; x++)
+            {
+                float left = (-1.0f + 2.0f * x / CLUSTER_TILES_X) * mTanHalfX;
+                float right = (-1.0f + 2.0f * (x + 1) / CLUSTER_TILES_X) * mTanHalfX;
+                unsigned int cluster = (slice * CLUSTER_TILES_Y + y) * CLUSTER_TILES_X + x;
+
+                // The tile's edges are planes through the eye, so the box
+                // spans them at both depths
+                mMinX[cluster] = std::min(left * nearDepth, left * farDepth);
+                mMaxX[cluster] = std::max(right * nearDepth, right * farDepth);
+                mMinY[cluster] = std::min(bottom * nearDepth, bottom * farDepth);
+                mMaxY[cluster] = std::max(top * nearDepth, top * farDepth);
+                mMinZ[cluster] = -farDepth;
+                mMaxZ[cluster] = -nearDepth;
+            }
+        }
+    }
+}
+
+void LightClusters::Build(const std::vector<Light>& lights, const glm::mat4& view, const glm::mat4& projection)
+{
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+    mStats = LightClusterStats();
+    mStats.lights = (unsigned int) lights.size();
+
+    if (projection != mProjection)
+    {
+        mProjection = projection;
+        BuildClusterBounds();
+    }
+
+    // Indices have to fit the R16UI texels
+    size_t lightCount = std::min<size_t>(lights.size(), 65536);
+
+    mSpheres.resize(lightCount);
+    mGpuLights.resize(lightCount * LIGHT_TEXELS);
+
+    for (unsigned int slice = 0; slice < CLUSTER_SLICES; slice++)
+    {
+        mSliceLights[slice].clear();
+    }
+
+    float scale = GetDepthScale();
+    float bias = GetDepthBias();
+    glm::mat3 rotation(view);
+
+    for (size_t i = 0; i < lightCount; i++)
+    {
+        const Light& light = lights[i];
+        glm::vec3 position = glm::vec3(view * glm::vec4(light.position, 1.0f));
+        glm::vec3 direction = glm::normalize(rotation * light.direction);
+        bool spot = light.type == LIGHT_SPOT;
+
+        mGpuLights[i * LIGHT_TEXELS] = glm::vec4(position, light.range);
+        mGpuLights[i * LIGHT_TEXELS + 1] = glm::vec4(light.color * light.intensity,
+                                                     spot ? light.cosInner : POINT_LIGHT_COS_OUTER + 1.0f);
+        mGpuLights[i * LIGHT_TEXELS + 2] = glm::vec4(direction, spot ? light.cosOuter : POINT_LIGHT_COS_OUTER);
+
+        glm::vec4 sphere = GetBoundingSphere(light, position, direction);
+        mSpheres[i] = sphere;
+
+        // The slices the sphere reaches into
+        float nearest = std::max(-sphere.z - sphere.w, mNear);
+        float farthest = std::min(-sphere.z + sphere.w, mFar);
+
+        if (nearest > farthest)
+        {
+            continue;
+        }
+
+        int first = (int) std::floor(std::log(nearest) * scale - bias);
+        int last = (int) std::floor(std::log(farthest) * scale - bias);
+        first = std::max(first, 0);
+        last = std::min(last, (int) CLUSTER_SLICES - 1);
+
+        for (int slice = first; slice <= last; slice++)
+        {
+            mSliceLights[slice].push_back((unsigned int) i);
+        }
+    }
+
+    if (mThreadPool != nullptr && lightCount > 0)
+    {
+        mThreadPool->ParallelFor(CLUSTER_SLICES, 1, [this](unsigned int begin, unsigned int end) {
+            for (unsigned int slice = begin; slice < end; slice++)
+            {
+                BinSlice(slice);
+            }
+        });
+    }
+    else
+    {
+        for (unsigned int slice = 0; slice < CLUSTER_SLICES; slice++)
+        {
+            BinSlice(slice);
+        }
+    }
+
+    // One list after the other, in cluster order
+    mIndices.clear();
+    std::vector<unsigned char> visible(lights.size(), 0);
+
+    for (unsigned int cluster = 0; cluster < CLUSTER_COUNT; cluster++)
+    {
+        unsigned int count = mScratchCounts[cluster];
+        const unsigned short* indices = &mScratch[cluster * MAX_LIGHTS_PER_CLUSTER];
+
+        mRanges[cluster] = glm::uvec2((unsigned int) mIndices.size(), count);
+        mIndices.insert(mIndices.end(), indices, indices + count);
+
+        for (unsigned int i = 0; i < count; i++)
+        {
+            visible[indices[i]] = 1;
+        }
+
+        if (count > 0)
+        {
+            mStats.litClusters++;
+        }
+
+        mStats.maxLightsPerCluster = std::max(mStats.maxLightsPerCluster, count);
+    }
+
+    for (unsigned int slice = 0; slice < CLUSTER_SLICES; slice++)
+    {
+        mStats.droppedLights += mDropped[slice];
+    }
+
+    mStats.visibleLights = (unsigned int) std::count(visible.begin(), visible.end(), 1);
+    mStats.lightIndices = (unsigned int) mIndices.size();
+    mStats.averageLightsPerCluster = (double) mIndices.size() / CLUSTER_COUNT;
+
+    if (mStats.litClusters > 0)
+    {
+        mStats.averageLightsPerLitCluster = (double) mIndices.size() / mStats.litClusters;
+    }
+
+    mStats.binMilliseconds = MillisecondsSince(start);
+}
+
+/*
+    Test every light reaching into a slice against the slice's clusters.
+    Slices write to clusters of their own only, so they bin in parallel.
+*/
+void LightClusters::BinSlice(unsigned int slice)
+{
+    unsigned int firstCluster = slice * TILES_PER_SLICE;
+    unsigned int* counts = &mScratchCounts[firstCluster];
+    const std::vector<unsigned int>& lights = mSliceLights[slice];
+
+    std::fill(counts, counts + TILES_PER_SLICE, 0u);
+    mDropped[slice] = 0;
+
+    for (size_t l = 0; l < lights.size(); l++)
+    {
+        unsigned int light = lights[l];
+        const glm::vec4& sphere = mSpheres[light];
+
+        // Squared distance from the center to each box against the
+        // squared radius, four clusters at a time
+#ifdef CLUSTER_SIMD
+        __m128 centerX = _mm_set1_ps(sphere.x);
+        __m128 centerY = _mm_set1_ps(sphere.y);
+        __m128 centerZ = _mm_set1_ps(sphere.z);
+        __m128 radius2 = _mm_set1_ps(sphere.w * sphere.w);
+        __m128 zero = _mm_setzero_ps();
+
+        for (unsigned int tile = 0; tile < TILES_PER_SLICE; tile += 4)
+        {
+            unsigned int cluster = firstCluster + tile;
+
+            __m128 dx = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&mMinX[cluster]), centerX),
+                                              _mm_sub_ps(centerX, _mm_loadu_ps(&mMaxX[cluster]))), zero);
+            __m128 dy = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&mMinY[cluster]), centerY),
+                                              _mm_sub_ps(centerY, _mm_loadu_ps(&mMaxY[cluster]))), zero);
+            __m128 dz = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&mMinZ[cluster]), centerZ),
+                                              _mm_sub_ps(centerZ, _mm_loadu_ps(&mMaxZ[cluster]))), zero);
+            __m128 distance2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+            int hits = _mm_movemask_ps(_mm_cmple_ps(distance2, radius2));
+
+            while (hits != 0)
+            {
+                unsigned int hit = tile;
+
+                for (int bit = hits; (bit & 1) == 0; bit >>= 1)
+                {
+                    hit++;
+                }
+
+                hits &= hits - 1;
+
+                if (counts[hit] < MAX_LIGHTS_PER_CLUSTER)
+                {
+                    mScratch[(firstCluster + hit) * MAX_LIGHTS_PER_CLUSTER + counts[hit]++] = (unsigned short) light;
+                }
+                else
+                {
+                    mDropped[slice]++;
+                }
+            }
+        }
+#else
+        float radius2 = sphere.w * sphere.w;
+
+        for (unsigned int tile = 0; tile < TILES_PER_SLICE; tile++)
+        {
+            unsigned int cluster = firstCluster + tile;
+
+            float dx = std::max(std::max(mMinX[cluster] - sphere.x, sphere.x - mMaxX[cluster]), 0.0f);
+            float dy = std::max(std::max(mMinY[cluster] - sphere.y, sphere.y - mMaxY[cluster]), 0.0f);
+            float dz = std::max(std::max(mMinZ[cluster] - sphere.z, sphere.z - mMaxZ[cluster]), 0.0f);
+
+            if (dx * dx + dy * dy + dz * dz > radius2)
+            {
+                continue;
+            }
+
+            if (counts[tile] < MAX_LIGHTS_PER_CLUSTER)
+            {
+                mScratch[cluster * MAX_LIGHTS_PER_CLUSTER + counts[tile]++] = (unsigned short) light;
+            }
+            else
+            {
+                mDropped[slice]++;
+            }
+        }
+#endif
+    }
+}
+
+void LightClusters::Upload()
+{
+    static const GLenum formats[3] = { GL_RGBA32F, GL_RG32UI, GL_R16UI };
+
+    if (mBuffers[0] == 0)
+    {
+        glGenBuffers(3, mBuffers);
+        glGenTextures(3, mTextures);
+    }
+
+    // Empty buffers make incomplete textures, every one gets a texel at least
+    const void* data[3] = { mGpuLights.data(), mRanges.data(), mIndices.data() };
+    GLsizeiptr bytes[3] = {
+        (GLsizeiptr) (mGpuLights.size() * sizeof(glm::vec4)),
+        (GLsizeiptr) (mRanges.size() * sizeof(glm::uvec2)),
+        (GLsizeiptr) (mIndices.size() * sizeof(unsigned short))
+    };
+    const glm::vec4 empty(0.0f);
+
+    for (int i = 0; i < 3; i++)
+    {
+        if (bytes[i] == 0)
+        {
+            data[i] = &empty;
+            bytes[i] = (GLsizeiptr) sizeof(empty);
+        }
+
+        // A fresh store every frame, the last frame's draws may still read
+        // the old one
+        glBindBuffer(GL_TEXTURE_BUFFER, mBuffers[i]);
+        glBufferData(GL_TEXTURE_BUFFER, bytes[i], data[i], GL_STREAM_DRAW);
+
+        glBindTexture(GL_TEXTURE_BUFFER, mTextures[i]);
+        glTexBuffer(GL_TEXTURE_BUFFER, formats[i], mBuffers[i]);
+    }
+
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void LightClusters::Bind(GLuint firstUnit) const
+{
+    for (GLuint i = 0; i < 3; i++)
+    {
+        glActiveTexture(GL_TEXTURE0 + firstUnit + i);
+        glBindTexture(GL_TEXTURE_BUFFER, mTextures[i]);
+    }
+
+    glActiveTexture(GL_TEXTURE0);
+}
+
+float LightClusters::GetDepthScale() const
+{
+    return CLUSTER_SLICES / std::log(mFar / mNear);
+}
+
+float LightClusters::GetDepthBias() const
+{
+    return CLUSTER_SLICES * std::log(mNear) / std::log(mFar / mNear);
+}
+
+const LightClusterStats& LightClusters::GetStats() const
+{
+    return mStats;
+}
+
+void LightClusters::Release()
+{
+    if (mBuffers[0] != 0)
+    {
+        glDeleteTextures(3, mTextures);
+        glDeleteBuffers(3, mBuffers);
+
+        for (int i = 0; i < 3; i++)
+        {
+            mBuffers[i] = 0;
+            mTextures[i] = 0;
+        }
+    }
+}
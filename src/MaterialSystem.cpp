@@ -0,0 +1,153 @@
+#include "MaterialSystem.hpp"
+
+#include <iostream>
+
+MaterialSystem::MaterialSystem(unsigned int capacity)
+{
+    mCapacity = capacity;
+    mBuffer = 0;
+
+    mMaterials.push_back(Material());
+    mDirty.push_back(true);
+    mStats.materials = 1;
+}
+
+MaterialId MaterialSystem::Create(const MaterialParameters& parameters, TextureAsset* albedo, bool cullBackFaces)
+{
+    if (mMaterials.size() >= mCapacity)
+    {
+        std::cout << "Out of materials (" << mCapacity << "), using the default one" << std::endl;
+        return DEFAULT_MATERIAL;
+    }
+
+    Material material;
+    material.parameters = parameters;
+    material.parameters.albedo = glm::ivec4(0, -1, 0, 0);
+    material.albedo = albedo;
+    material.cullBackFaces = cullBackFaces;
+
+    mMaterials.push_back(material);
+    mDirty.push_back(true);
+    mStats.materials++;
+
+    return (MaterialId) mMaterials.size() - 1;
+}
+
+const Material& MaterialSystem::Get(MaterialId material) const
+{
+    return mMaterials[material];
+}
+
+TextureAsset* MaterialSystem::GetBoundAlbedo(MaterialId material) const
+{
+    return IsAtlased(material) ? nullptr : mMaterials[material].albedo;
+}
+
+bool MaterialSystem::IsAtlased(MaterialId material) const
+{
+    return mMaterials[material].parameters.albedo.y >= 0;
+}
+
+void MaterialSystem::SetParameters(MaterialId material, const MaterialParameters& parameters)
+{
+    // The albedo flags follow the texture, not the caller
+    glm::ivec4 albedo = mMaterials[material].parameters.albedo;
+    mMaterials[material].parameters = parameters;
+    mMaterials[material].parameters.albedo = albedo;
+    mDirty[material] = true;
+}
+
+// Nothing to upload, the draw loop reads it
+void MaterialSystem::SetCullBackFaces(MaterialId material, bool cullBackFaces)
+{
+    mMaterials[material].cullBackFaces = cullBackFaces;
+}
+
+void MaterialSystem::SetAtlasEntry(MaterialId material, int layer, const glm::vec4& rect)
+{
+    mMaterials[material].parameters.albedo.y = layer;
+    mMaterials[material].parameters.atlasRect = rect;
+    mDirty[material] = true;
+}
+
+unsigned int MaterialSystem::GetCount() const
+{
+    return (unsigned int) mMaterials.size();
+}
+
+void MaterialSystem::Update(GLuint blockBinding)
+{
+    mStats.uploadsThisFrame = 0;
+    mStats.uploadedBytesThisFrame = 0;
+
+    if (mBuffer == 0)
+    {
+        glGenBuffers(1, &mBuffer);
+        glBindBuffer(GL_UNIFORM_BUFFER, mBuffer);
+        glBufferData(GL_UNIFORM_BUFFER, mCapacity * sizeof(MaterialParameters), nullptr, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        glBindBufferBase(GL_UNIFORM_BUFFER, blockBinding, mBuffer);
+    }
+
+    // Textures are only sampled once they are on the GPU
+    for (size_t i = 0; i < mMaterials.size(); i++)
+    {
+        Material& material = mMaterials[i];
+        int textured = IsAtlased((MaterialId) i) || (material.albedo != nullptr && material.albedo->IsReady());
+
+        if (material.parameters.albedo.x != textured)
+        {
+            material.parameters.albedo.x = textured;
+            mDirty[i] = true;
+        }
+    }
+
+    glBindBuffer(GL_UNIFORM_BUFFER, mBuffer);
+
+    for (size_t first = 0; first < mMaterials.size(); first++)
+    {
+        if (!mDirty[first])
+        {
+            continue;
+        }
+
+        size_t end = first;
+
+        while (end < mMaterials.size() && mDirty[end])
+        {
+            mDirty[end] = false;
+            end++;
+        }
+
+        // Materials are not contiguous in memory, the range is staged
+        std::vector<MaterialParameters> range;
+
+        for (size_t i = first; i < end; i++)
+        {
+            range.push_back(mMaterials[i].parameters);
+        }
+
+        GLsizeiptr bytes = (GLsizeiptr) (range.size() * sizeof(MaterialParameters));
+        glBufferSubData(GL_UNIFORM_BUFFER, (GLintptr) (first * sizeof(MaterialParameters)), bytes, range.data());
+
+        mStats.uploadsThisFrame++;
+        mStats.uploadedBytesThisFrame += bytes;
+        first = end;
+    }
+
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+const MaterialStats& MaterialSystem::GetStats() const
+{
+    return mStats;
+}
+
+void MaterialSystem::Release()
+{
+    if (mBuffer != 0)
+    {
+        glDeleteBuffers(1, &mBuffer);
+        mBuffer = 0;
+    }
+}
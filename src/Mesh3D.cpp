@@ -0,0 +1,278 @@
+#include "Mesh3D.hpp"
+
+#include <glm/ext/matrix_transform.hpp>
+
+#include <cstring>
+
+/*
+
+Setup your geometry during the vertex specification step
+@return void
+
+*/
+void VertexSpecification(Mesh3D* meshData, bool uploadData)
+{
+    /*
+    
+    Geometry data
+    here we are going to store x, y and z position attributes within vertexPositions
+    for the data.
+    
+    For now, this information is just stored in the CPU, and we are going to store
+    this data on the GPU shortly, in a call to glBufferData which will store
+    the information into a vertex buffer object.
+
+    Note: That I have segregated the data from the OpenGL calls this function.
+
+    */
+
+    // Lives on the cpu
+    // Interleaved (and possibly quantized) in the mesh's vertex format
+    if (meshData->mVertexStream.empty())
+    {
+        BuildMeshStreams(meshData);
+    }
+
+    const std::vector<unsigned char>& vertexData = meshData->mVertexStream;
+
+    /*
+    
+    Vertex Array Object (VAO) Setup
+    Note: We can think of the VAO as a 'wrapper around' all of the vertex buffer
+    objects, in the sense that it encapsulates all vbo state that we are setting up
+    Thus, it is also important that we glBindVertexArray (i. e. select the vao we
+    want to use) before our vertex buffer object operations.
+
+    We bind (i.e. select) to the vertex array object (vao) that we want to work
+    with.
+    
+    */
+
+/*
+        We are working with gl_array_buffer or gl_element_array_buffer
+        size of the data in bytes
+        raw array of data
+        how we intend to use the data
+
+
+        For our given vertex array object, we need to tell OpenGL
+        how the information our buffer will be used.
+
+        for the specific attribute in our vertex specification, we use
+        glVertexAttribPointer to figure out how we are going to move through
+        the data
+
+        attribute 0 corresponds to the enabled glEnableVertexAttribArray
+
+        In the future, you will see in our vertex shader this also correspond to (layout=0)
+        which selects these attributes
+
+        the number of components (e.g. x, y, z = 3 components)
+    */
+
+   /*
+    
+    Vertex Buffer Object (VBO) creation
+    Create a new vertex buffer object
+    Note: We'll see this pattern of code often in OpenGL of creating and
+    binding to a buffer.
+
+    Next we will do glBindBuffer
+    Bind is equivalent to 'selecting the active buffer object' that we want to
+    work with in OpenGL.
+
+    Now, in our currently binded buffer, we populate the data from our
+    'vertexPositions' which is on the CPU, onto a buffer that will store
+    on the GPU.
+
+    */
+    // Start generating our VBO
+
+    // We start setting things up on the GPU
+    glGenVertexArrays(1, &meshData->mVertexArrayObject);
+    glBindVertexArray(meshData->mVertexArrayObject);
+
+    /* Vertex coords buffer */
+    glGenBuffers(1, &meshData->mVertexBufferObject);
+    glBindBuffer(GL_ARRAY_BUFFER, meshData->mVertexBufferObject);
+    glBufferData(GL_ARRAY_BUFFER,
+                 vertexData.size(),
+                uploadData ? vertexData.data() : nullptr,
+                GL_STATIC_DRAW);
+
+    /*
+        One glVertexAttribPointer per attribute in the layout: the number of
+        components, the type, whether it is normalized, the stride (how to
+        get to the next vertex) and the offset inside a vertex.
+        Position is layout=0, color layout=1 (see VertexFormat.hpp).
+    */
+    ApplyVertexLayout(meshData->mVertexLayout, GetMeshVertexCount(meshData));
+
+    /* Setup the index buffer object (IBO) or EBO(Element Array Object Buffer)  */
+    // 16 or 32 bit, see BuildMeshStreams
+    const std::vector<unsigned char>& indexBufferData = meshData->mIndexStream;
+
+    glGenBuffers(1, &meshData->mIndexBufferObject);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, meshData->mIndexBufferObject);
+    /* Populate our Index Buffer */
+    glBufferData(
+        GL_ELEMENT_ARRAY_BUFFER,
+        indexBufferData.size(),
+        uploadData ? indexBufferData.data() : nullptr,
+        GL_STATIC_DRAW
+    );
+
+    /* The depth pre-pass only fetches positions, from the same buffers */
+    glGenVertexArrays(1, &meshData->mPositionArrayObject);
+    glBindVertexArray(meshData->mPositionArrayObject);
+    glBindBuffer(GL_ARRAY_BUFFER, meshData->mVertexBufferObject);
+    ApplyPositionLayout(meshData->mVertexLayout);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, meshData->mIndexBufferObject);
+
+    glBindVertexArray(0);
+
+    /* Keep track of what now lives on the GPU */
+    meshData->mVertexBufferSize = vertexData.size();
+    meshData->mIndexBufferSize = indexBufferData.size();
+    meshData->mIndexCount = (GLsizei) meshData->indexBufferData.size();
+
+    // The float data stays the reference copy, no need to keep both
+    if (uploadData)
+    {
+        ReleaseMeshStreams(meshData);
+    }
+}
+
+void BuildMeshStreams(Mesh3D* meshData)
+{
+    size_t vertexCount = GetMeshVertexCount(meshData);
+    bool hasNormals = meshData->normalData.size() == vertexCount * 3 && vertexCount > 0;
+    bool hasUVs = meshData->uvData.size() == vertexCount * 2 && vertexCount > 0;
+
+    meshData->mVertexLayout = MakeVertexLayout(meshData->mVertexFormat, meshData->mNormalEncoding,
+                                               hasNormals, hasUVs);
+
+    glm::vec3 boundsMin(0.0f);
+    glm::vec3 boundsMax(0.0f);
+
+    if (vertexCount > 0)
+    {
+        const GLfloat* p = meshData->vertexData.data();
+        boundsMin = boundsMax = glm::vec3(p[0], p[1], p[2]);
+
+        for (size_t i = 1; i < vertexCount; i++)
+        {
+            glm::vec3 position(p[i * 6], p[i * 6 + 1], p[i * 6 + 2]);
+            boundsMin = glm::min(boundsMin, position);
+            boundsMax = glm::max(boundsMax, position);
+        }
+    }
+
+    meshData->mBoundsMin = boundsMin;
+    meshData->mBoundsMax = boundsMax;
+
+    // Quantized positions are relative to the bounding box
+    if (meshData->mVertexFormat == VERTEX_FORMAT_PACKED)
+    {
+        meshData->mPositionBoundsMin = boundsMin;
+        meshData->mPositionBoundsExtent = boundsMax - boundsMin;
+    }
+    else
+    {
+        meshData->mPositionBoundsMin = glm::vec3(0.0f);
+        meshData->mPositionBoundsExtent = glm::vec3(1.0f);
+    }
+
+    EncodeVertices(meshData->mVertexLayout, meshData->mVertexFormat, meshData->mNormalEncoding,
+                   vertexCount, meshData->vertexData.data(),
+                   hasNormals ? meshData->normalData.data() : nullptr,
+                   hasUVs ? meshData->uvData.data() : nullptr,
+                   meshData->mPositionBoundsMin, meshData->mPositionBoundsExtent,
+                   meshData->mVertexStream);
+
+    // Half the index bandwidth whenever every index fits in 16 bits
+    const std::vector<GLuint>& indices = meshData->indexBufferData;
+
+    if (vertexCount <= 65536)
+    {
+        meshData->mIndexType = GL_UNSIGNED_SHORT;
+        meshData->mIndexStream.resize(indices.size() * sizeof(GLushort));
+
+        GLushort* shortIndices = (GLushort*) meshData->mIndexStream.data();
+
+        for (size_t i = 0; i < indices.size(); i++)
+        {
+            shortIndices[i] = (GLushort) indices[i];
+        }
+    }
+    else
+    {
+        meshData->mIndexType = GL_UNSIGNED_INT;
+        meshData->mIndexStream.resize(indices.size() * sizeof(GLuint));
+
+        if (!indices.empty())
+        {
+            std::memcpy(meshData->mIndexStream.data(), indices.data(), indices.size() * sizeof(GLuint));
+        }
+    }
+}
+
+void ReleaseMeshStreams(Mesh3D* meshData)
+{
+    std::vector<unsigned char>().swap(meshData->mVertexStream);
+    std::vector<unsigned char>().swap(meshData->mIndexStream);
+}
+
+size_t GetMeshVertexCount(const Mesh3D* meshData)
+{
+    return meshData->vertexData.size() / 6;
+}
+
+glm::mat4 GetMeshModelMatrix(const Mesh3D* meshData)
+{
+    glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, meshData->m_uOffset));
+    model = glm::rotate(model, glm::radians(meshData->m_uRotate), glm::vec3(1.0f, 1.0f, 1.0f));
+    model = glm::scale(model, glm::vec3(meshData->m_uScale));
+
+    return model;
+}
+
+void ReleaseMeshBuffers(Mesh3D* meshData)
+{
+    glDeleteBuffers(1, &meshData->mVertexBufferObject);
+    glDeleteBuffers(1, &meshData->mIndexBufferObject);
+    glDeleteVertexArrays(1, &meshData->mVertexArrayObject);
+    glDeleteVertexArrays(1, &meshData->mPositionArrayObject);
+
+    meshData->mVertexBufferObject = 0;
+    meshData->mIndexBufferObject = 0;
+    meshData->mVertexArrayObject = 0;
+    meshData->mPositionArrayObject = 0;
+
+    meshData->mVertexBufferSize = 0;
+    meshData->mIndexBufferSize = 0;
+}
+
+bool IsMeshResident(const Mesh3D* meshData)
+{
+    return meshData->mVertexArrayObject != 0;
+}
+
+GLsizeiptr GetMeshResidentBytes(const Mesh3D* meshData)
+{
+    return meshData->mVertexBufferSize + meshData->mIndexBufferSize;
+}
+
+GLsizeiptr GetMeshUploadBytes(const Mesh3D* meshData)
+{
+    size_t vertexCount = GetMeshVertexCount(meshData);
+    VertexLayout layout = MakeVertexLayout(meshData->mVertexFormat, meshData->mNormalEncoding,
+                                           meshData->normalData.size() == vertexCount * 3 && vertexCount > 0,
+                                           meshData->uvData.size() == vertexCount * 2 && vertexCount > 0);
+
+    size_t indexSize = vertexCount <= 65536 ? sizeof(GLushort) : sizeof(GLuint);
+
+    return GetVertexBytes(layout, vertexCount)
+         + meshData->indexBufferData.size() * indexSize;
+}
+
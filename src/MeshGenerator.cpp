@@ -0,0 +1,113 @@
+#include "MeshGenerator.hpp"
+
+#include <glm/ext/scalar_constants.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+namespace {
+    void ClearMesh(Mesh3D* meshData)
+    {
+        meshData->vertexData.clear();
+        meshData->indexBufferData.clear();
+        meshData->normalData.clear();
+        meshData->uvData.clear();
+    }
+
+    void AddVertex(Mesh3D* meshData, glm::vec3 position, glm::vec3 color, glm::vec3 normal, glm::vec2 uv)
+    {
+        meshData->vertexData.insert(meshData->vertexData.end(), { position.x, position.y, position.z });
+        meshData->vertexData.insert(meshData->vertexData.end(), { color.r, color.g, color.b });
+        meshData->normalData.insert(meshData->normalData.end(), { normal.x, normal.y, normal.z });
+        meshData->uvData.insert(meshData->uvData.end(), { uv.x, uv.y });
+    }
+}
+
+void GenerateGridMesh(Mesh3D* meshData, unsigned int size, bool shuffleTriangles)
+{
+    ClearMesh(meshData);
+
+    for (unsigned int y = 0; y <= size; y++)
+    {
+        for (unsigned int x = 0; x <= size; x++)
+        {
+            float u = (float) x / size;
+            float v = (float) y / size;
+
+            // z = 0.1 * u * v, so the normal is (-0.1v, -0.1u, 1)
+            AddVertex(meshData,
+                      glm::vec3(u - 0.5f, v - 0.5f, 0.1f * u * v),
+                      glm::vec3(u, v, 1.0f - u),
+                      glm::normalize(glm::vec3(-0.1f * v, -0.1f * u, 1.0f)),
+                      glm::vec2(u, v));
+        }
+    }
+
+    for (unsigned int y = 0; y < size; y++)
+    {
+        for (unsigned int x = 0; x < size; x++)
+        {
+            GLuint i = y * (size + 1) + x;
+            meshData->indexBufferData.insert(meshData->indexBufferData.end(),
+                                             { i, i + 1, i + size + 1, i + 1, i + size + 2, i + size + 1 });
+        }
+    }
+
+    if (shuffleTriangles)
+    {
+        size_t triangleCount = meshData->indexBufferData.size() / 3;
+        std::vector<size_t> order(triangleCount);
+
+        for (size_t i = 0; i < triangleCount; i++)
+        {
+            order[i] = i;
+        }
+
+        std::mt19937 random(1234);
+        std::shuffle(order.begin(), order.end(), random);
+
+        std::vector<GLuint> shuffled(meshData->indexBufferData.size());
+
+        for (size_t i = 0; i < triangleCount; i++)
+        {
+            std::copy(meshData->indexBufferData.begin() + order[i] * 3,
+                      meshData->indexBufferData.begin() + order[i] * 3 + 3,
+                      shuffled.begin() + i * 3);
+        }
+
+        meshData->indexBufferData.swap(shuffled);
+    }
+}
+
+void GenerateSphereMesh(Mesh3D* meshData, unsigned int rings, unsigned int segments)
+{
+    ClearMesh(meshData);
+
+    const float pi = glm::pi<float>();
+
+    for (unsigned int ring = 0; ring <= rings; ring++)
+    {
+        float theta = pi * ring / rings;
+
+        for (unsigned int segment = 0; segment <= segments; segment++)
+        {
+            float phi = 2.0f * pi * segment / segments;
+            glm::vec3 normal(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+
+            AddVertex(meshData, normal * 0.5f, normal * 0.5f + 0.5f, normal,
+                      glm::vec2((float) segment / segments, (float) ring / rings));
+        }
+    }
+
+    for (unsigned int ring = 0; ring < rings; ring++)
+    {
+        for (unsigned int segment = 0; segment < segments; segment++)
+        {
+            GLuint i = ring * (segments + 1) + segment;
+            GLuint below = i + segments + 1;
+            meshData->indexBufferData.insert(meshData->indexBufferData.end(),
+                                             { i, below, i + 1, i + 1, below, below + 1 });
+        }
+    }
+}
@@ -0,0 +1,136 @@
+#include "MeshIO.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace {
+    template <typename T>
+    void Append(std::vector<unsigned char>& bytes, const std::vector<T>& values)
+    {
+        const unsigned char* data = (const unsigned char*) values.data();
+        bytes.insert(bytes.end(), data, data + values.size() * sizeof(T));
+    }
+
+    template <typename T>
+    void Extract(const unsigned char*& data, std::vector<T>& values, unsigned int count)
+    {
+        values.resize(count);
+        std::memcpy(values.data(), data, count * sizeof(T));
+        data += count * sizeof(T);
+    }
+}
+
+void SerializeMesh(const Mesh3D* meshData, std::vector<unsigned char>& bytes)
+{
+    MeshFileHeader header;
+    std::memcpy(header.magic, "MSH1", 4);
+    header.version = MESH_FILE_VERSION;
+    header.vertexFloatCount = (unsigned int) meshData->vertexData.size();
+    header.indexCount = (unsigned int) meshData->indexBufferData.size();
+    header.normalFloatCount = (unsigned int) meshData->normalData.size();
+    header.uvFloatCount = (unsigned int) meshData->uvData.size();
+    header.lodCount = (unsigned int) meshData->mLODs.size();
+
+    bytes.assign((const unsigned char*) &header, (const unsigned char*) &header + sizeof(header));
+    Append(bytes, meshData->vertexData);
+    Append(bytes, meshData->indexBufferData);
+    Append(bytes, meshData->normalData);
+    Append(bytes, meshData->uvData);
+    Append(bytes, meshData->mLODs);
+}
+
+bool SaveMeshBinary(const std::string& fileName, const Mesh3D* meshData)
+{
+    std::ofstream myFile(fileName.c_str(), std::ios::binary);
+
+    if (!myFile.is_open())
+    {
+        std::cout << "Could not open " << fileName << " for writing" << std::endl;
+        return false;
+    }
+
+    std::vector<unsigned char> bytes;
+    SerializeMesh(meshData, bytes);
+
+    myFile.write((const char*) bytes.data(), bytes.size());
+
+    return myFile.good();
+}
+
+bool LoadMeshBinary(const std::string& fileName, Mesh3D* meshData)
+{
+    std::ifstream myFile(fileName.c_str(), std::ios::binary);
+
+    if (!myFile.is_open())
+    {
+        std::cout << "Could not open mesh " << fileName << std::endl;
+        return false;
+    }
+
+    std::stringstream contents;
+    contents << myFile.rdbuf();
+    std::string bytes = contents.str();
+
+    if (!LoadMeshFromMemory((const unsigned char*) bytes.data(), bytes.size(), meshData))
+    {
+        std::cout << "While loading " << fileName << std::endl;
+        return false;
+    }
+
+    meshData->mSourcePath = fileName;
+
+    return true;
+}
+
+bool LoadMeshFromMemory(const unsigned char* data, size_t size, Mesh3D* meshData)
+{
+    MeshFileHeader header;
+
+    if (size < sizeof(header))
+    {
+        std::cout << "Mesh data is truncated" << std::endl;
+        return false;
+    }
+
+    std::memcpy(&header, data, sizeof(header));
+
+    if (std::memcmp(header.magic, "MSH1", 4) != 0 || header.version != MESH_FILE_VERSION)
+    {
+        std::cout << "Not mesh data (or wrong version)" << std::endl;
+        return false;
+    }
+
+    size_t payload = (size_t) header.vertexFloatCount * sizeof(GLfloat)
+                   + (size_t) header.indexCount * sizeof(GLuint)
+                   + (size_t) header.normalFloatCount * sizeof(GLfloat)
+                   + (size_t) header.uvFloatCount * sizeof(GLfloat)
+                   + (size_t) header.lodCount * sizeof(MeshLOD);
+
+    if (size < sizeof(header) + payload)
+    {
+        std::cout << "Mesh data is truncated" << std::endl;
+        return false;
+    }
+
+    const unsigned char* read = data + sizeof(header);
+    Extract(read, meshData->vertexData, header.vertexFloatCount);
+    Extract(read, meshData->indexBufferData, header.indexCount);
+    Extract(read, meshData->normalData, header.normalFloatCount);
+    Extract(read, meshData->uvData, header.uvFloatCount);
+    Extract(read, meshData->mLODs, header.lodCount);
+
+    for (size_t i = 0; i < meshData->mLODs.size(); i++)
+    {
+        const MeshLOD& lod = meshData->mLODs[i];
+
+        if ((size_t) lod.firstIndex + lod.indexCount > meshData->indexBufferData.size())
+        {
+            std::cout << "Mesh level of detail " << i << " is out of range" << std::endl;
+            return false;
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,150 @@
+#include "MeshLOD.hpp"
+#include "MeshOptimizer.hpp"
+#include "MeshSimplifier.hpp"
+
+#include <cmath>
+
+namespace {
+    // A level has to drop at least this fraction of the previous level's
+    // triangles to be worth keeping
+    const float MIN_LOD_REDUCTION = 0.1f;
+
+    float BoundingDiagonal(const std::vector<GLfloat>& positions)
+    {
+        size_t vertexCount = positions.size() / 6;
+
+        if (vertexCount == 0)
+        {
+            return 0.0f;
+        }
+
+        glm::vec3 boundsMin(positions[0], positions[1], positions[2]);
+        glm::vec3 boundsMax = boundsMin;
+
+        for (size_t i = 1; i < vertexCount; i++)
+        {
+            glm::vec3 position(positions[i * 6], positions[i * 6 + 1], positions[i * 6 + 2]);
+            boundsMin = glm::min(boundsMin, position);
+            boundsMax = glm::max(boundsMax, position);
+        }
+
+        return glm::length(boundsMax - boundsMin);
+    }
+}
+
+size_t GenerateMeshLODs(Mesh3D* meshData, size_t maxLODs, float reduction, float maxRelativeError)
+{
+    // Start over from whatever level 0 is
+    if (!meshData->mLODs.empty())
+    {
+        meshData->indexBufferData.resize(meshData->mLODs[0].indexCount);
+    }
+
+    const std::vector<GLuint> fullDetail = meshData->indexBufferData;
+    size_t vertexCount = GetMeshVertexCount(meshData);
+    float maxError = maxRelativeError * BoundingDiagonal(meshData->vertexData);
+
+    meshData->mLODs.clear();
+
+    MeshLOD level;
+    level.firstIndex = 0;
+    level.indexCount = (GLuint) fullDetail.size();
+    level.error = 0.0f;
+    meshData->mLODs.push_back(level);
+
+    std::vector<GLuint> simplified;
+
+    while (meshData->mLODs.size() < maxLODs)
+    {
+        size_t previousCount = meshData->mLODs.back().indexCount;
+        size_t target = (size_t) (previousCount / 3 * reduction) * 3;
+        float error = 0.0f;
+
+        size_t count = SimplifyMesh(fullDetail, meshData->vertexData, target, maxError, simplified, error);
+
+        if (count == 0 || count > previousCount * (1.0f - MIN_LOD_REDUCTION))
+        {
+            break;
+        }
+
+        OptimizeVertexCache(simplified, vertexCount);
+
+        level.firstIndex = (GLuint) meshData->indexBufferData.size();
+        level.indexCount = (GLuint) count;
+        // Errors only grow along the chain, selection relies on it
+        level.error = std::max(error, meshData->mLODs.back().error);
+
+        meshData->indexBufferData.insert(meshData->indexBufferData.end(), simplified.begin(), simplified.end());
+        meshData->mLODs.push_back(level);
+    }
+
+    // A chain of one is no chain
+    if (meshData->mLODs.size() == 1)
+    {
+        meshData->mLODs.clear();
+        return 1;
+    }
+
+    return meshData->mLODs.size();
+}
+
+MeshLOD GetMeshLOD(const Mesh3D* meshData, size_t lod)
+{
+    if (meshData->mLODs.empty())
+    {
+        MeshLOD whole;
+        whole.indexCount = (GLuint) meshData->mIndexCount;
+        return whole;
+    }
+
+    return meshData->mLODs[lod < meshData->mLODs.size() ? lod : meshData->mLODs.size() - 1];
+}
+
+size_t GetMeshLODCount(const Mesh3D* meshData)
+{
+    return meshData->mLODs.empty() ? 1 : meshData->mLODs.size();
+}
+
+float PixelsPerObjectUnit(const glm::mat4& projection, float viewportHeight,
+                          float distance, float objectScale)
+{
+    // projection[1][1] is 1 / tan(fovY / 2)
+    return objectScale * projection[1][1] * viewportHeight * 0.5f / std::max(distance, 1e-6f);
+}
+
+size_t SelectMeshLOD(const Mesh3D* meshData, size_t currentLOD, float pixelsPerUnit,
+                     float pixelThreshold, float hysteresis)
+{
+    size_t lodCount = meshData->mLODs.size();
+
+    if (lodCount == 0)
+    {
+        return 0;
+    }
+
+    size_t current = currentLOD < lodCount ? currentLOD : lodCount - 1;
+
+    // Coarsest level comfortably under the threshold
+    float coarserLimit = pixelThreshold * (1.0f - hysteresis);
+    size_t coarser = 0;
+
+    while (coarser + 1 < lodCount && meshData->mLODs[coarser + 1].error * pixelsPerUnit <= coarserLimit)
+    {
+        coarser++;
+    }
+
+    if (coarser > current)
+    {
+        current = coarser;
+    }
+    else if (meshData->mLODs[current].error * pixelsPerUnit > pixelThreshold * (1.0f + hysteresis))
+    {
+        // Too coarse: the coarsest level that is under the threshold at all
+        while (current > 0 && meshData->mLODs[current].error * pixelsPerUnit > pixelThreshold)
+        {
+            current--;
+        }
+    }
+
+    return current;
+}
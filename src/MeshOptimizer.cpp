@@ -0,0 +1,424 @@
+#include "MeshOptimizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    /*
+        Forsyth's scoring, see
+        https://tomforsyth1000.github.io/papers/fast_vert_cache_opt.html
+    */
+    const int FORSYTH_CACHE_SIZE = 32;
+    const float CACHE_DECAY_POWER = 1.5f;
+    const float LAST_TRIANGLE_SCORE = 0.75f;
+    const float VALENCE_BOOST_SCALE = 2.0f;
+    const float VALENCE_BOOST_POWER = 0.5f;
+
+    // Smaller clusters sort better but cost more cache misses at the seams
+    const size_t MIN_OVERDRAW_CLUSTER_TRIANGLES = 32;
+
+    float VertexScore(int cachePosition, unsigned int remainingTriangles)
+    {
+        if (remainingTriangles == 0)
+        {
+            // Not used by any triangle we still have to emit
+            return -1.0f;
+        }
+
+        float score = 0.0f;
+
+        if (cachePosition >= 0)
+        {
+            if (cachePosition < 3)
+            {
+                // Used by the triangle we just emitted
+                score = LAST_TRIANGLE_SCORE;
+            }
+            else
+            {
+                float scale = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+                score = std::pow(1.0f - (cachePosition - 3) * scale, CACHE_DECAY_POWER);
+            }
+        }
+
+        // Prefer vertices with few triangles left, so they get finished off
+        score += VALENCE_BOOST_SCALE * std::pow((float) remainingTriangles, -VALENCE_BOOST_POWER);
+
+        return score;
+    }
+
+    glm::vec3 Position(const std::vector<GLfloat>& positions, GLuint vertex)
+    {
+        return glm::vec3(positions[vertex * 6], positions[vertex * 6 + 1], positions[vertex * 6 + 2]);
+    }
+
+    struct Cluster {
+        size_t firstTriangle;
+        size_t triangleCount;
+        float sortKey;
+    };
+
+    bool ByKeyDescending(const Cluster& a, const Cluster& b)
+    {
+        return a.sortKey > b.sortKey;
+    }
+
+    template <typename T>
+    void RemapStream(std::vector<T>& stream, const std::vector<GLuint>& newIndexOf,
+                     size_t components, size_t newVertexCount)
+    {
+        if (stream.empty())
+        {
+            return;
+        }
+
+        std::vector<T> remapped(newVertexCount * components);
+
+        for (size_t vertex = 0; vertex < newIndexOf.size(); vertex++)
+        {
+            if (newIndexOf[vertex] != (GLuint) -1)
+            {
+                std::copy(stream.begin() + vertex * components,
+                          stream.begin() + (vertex + 1) * components,
+                          remapped.begin() + newIndexOf[vertex] * components);
+            }
+        }
+
+        stream.swap(remapped);
+    }
+}
+
+VertexCacheStats AnalyzeVertexCache(const std::vector<GLuint>& indices, size_t vertexCount,
+                                    unsigned int cacheSize)
+{
+    VertexCacheStats stats;
+
+    // FIFO cache: a vertex is in the cache if it was inserted within the
+    // last cacheSize insertions
+    std::vector<unsigned int> insertedAt(vertexCount, 0);
+    unsigned int timestamp = cacheSize + 1;
+
+    for (size_t i = 0; i < indices.size(); i++)
+    {
+        GLuint vertex = indices[i];
+
+        if (timestamp - insertedAt[vertex] > cacheSize)
+        {
+            insertedAt[vertex] = timestamp++;
+            stats.vertexShaderRuns++;
+        }
+    }
+
+    size_t triangleCount = indices.size() / 3;
+
+    stats.acmr = triangleCount > 0 ? (float) stats.vertexShaderRuns / triangleCount : 0.0f;
+    stats.atvr = vertexCount > 0 ? (float) stats.vertexShaderRuns / vertexCount : 0.0f;
+
+    return stats;
+}
+
+void OptimizeVertexCache(std::vector<GLuint>& indices, size_t vertexCount)
+{
+    size_t triangleCount = indices.size() / 3;
+
+    if (triangleCount == 0)
+    {
+        return;
+    }
+
+    // Triangles using each vertex; the first 'remaining' of them are not emitted yet
+    std::vector<unsigned int> remaining(vertexCount, 0);
+    std::vector<unsigned int> adjacencyOffset(vertexCount + 1, 0);
+
+    for (size_t i = 0; i < indices.size(); i++)
+    {
+        remaining[indices[i]]++;
+    }
+
+    for (size_t vertex = 0; vertex < vertexCount; vertex++)
+    {
+        adjacencyOffset[vertex + 1] = adjacencyOffset[vertex] + remaining[vertex];
+    }
+
+    std::vector<unsigned int> adjacency(indices.size());
+    std::vector<unsigned int> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+
+    for (size_t triangle = 0; triangle < triangleCount; triangle++)
+    {
+        for (int corner = 0; corner < 3; corner++)
+        {
+            GLuint vertex = indices[triangle * 3 + corner];
+            adjacency[fill[vertex]++] = (unsigned int) triangle;
+        }
+    }
+
+    std::vector<int> cachePosition(vertexCount, -1);
+    std::vector<float> vertexScore(vertexCount);
+    std::vector<bool> emitted(triangleCount, false);
+
+    for (size_t vertex = 0; vertex < vertexCount; vertex++)
+    {
+        vertexScore[vertex] = VertexScore(-1, remaining[vertex]);
+    }
+
+    std::vector<GLuint> output;
+    output.reserve(indices.size());
+
+    std::vector<GLuint> cache;
+    std::vector<GLuint> newCache;
+    cache.reserve(FORSYTH_CACHE_SIZE + 3);
+    newCache.reserve(FORSYTH_CACHE_SIZE + 3);
+
+    int bestTriangle = -1;
+    size_t scanCursor = 0;
+
+    for (size_t emittedCount = 0; emittedCount < triangleCount; emittedCount++)
+    {
+        if (bestTriangle < 0)
+        {
+            // Nothing useful in the cache, start somewhere new
+            while (emitted[scanCursor])
+            {
+                scanCursor++;
+            }
+
+            bestTriangle = (int) scanCursor;
+        }
+
+        emitted[bestTriangle] = true;
+        const GLuint* corners = &indices[bestTriangle * 3];
+        output.insert(output.end(), corners, corners + 3);
+
+        // Take the triangle out of its vertices' to-do lists
+        for (int corner = 0; corner < 3; corner++)
+        {
+            GLuint vertex = corners[corner];
+            unsigned int* begin = &adjacency[adjacencyOffset[vertex]];
+            unsigned int* end = begin + remaining[vertex];
+            unsigned int* found = std::find(begin, end, (unsigned int) bestTriangle);
+
+            std::swap(*found, *(end - 1));
+            remaining[vertex]--;
+        }
+
+        // The triangle's vertices go to the front of the cache
+        newCache.assign(corners, corners + 3);
+
+        for (size_t i = 0; i < cache.size(); i++)
+        {
+            if (cache[i] != corners[0] && cache[i] != corners[1] && cache[i] != corners[2])
+            {
+                newCache.push_back(cache[i]);
+            }
+        }
+
+        // Vertices pushed out of the cache lose their cache bonus
+        for (size_t i = FORSYTH_CACHE_SIZE; i < newCache.size(); i++)
+        {
+            cachePosition[newCache[i]] = -1;
+            vertexScore[newCache[i]] = VertexScore(-1, remaining[newCache[i]]);
+        }
+
+        if (newCache.size() > (size_t) FORSYTH_CACHE_SIZE)
+        {
+            newCache.resize(FORSYTH_CACHE_SIZE);
+        }
+
+        cache.swap(newCache);
+
+        for (size_t i = 0; i < cache.size(); i++)
+        {
+            cachePosition[cache[i]] = (int) i;
+            vertexScore[cache[i]] = VertexScore((int) i, remaining[cache[i]]);
+        }
+
+        // Re-score every triangle touching the cache and pick the best one
+        bestTriangle = -1;
+        float bestScore = -1.0f;
+
+        for (size_t i = 0; i < cache.size(); i++)
+        {
+            GLuint vertex = cache[i];
+
+            for (unsigned int j = 0; j < remaining[vertex]; j++)
+            {
+                unsigned int triangle = adjacency[adjacencyOffset[vertex] + j];
+                const GLuint* triangleCorners = &indices[triangle * 3];
+
+                float score = vertexScore[triangleCorners[0]]
+                            + vertexScore[triangleCorners[1]]
+                            + vertexScore[triangleCorners[2]];
+
+                if (score > bestScore)
+                {
+                    bestScore = score;
+                    bestTriangle = (int) triangle;
+                }
+            }
+        }
+    }
+
+    indices.swap(output);
+}
+
+void OptimizeOverdraw(std::vector<GLuint>& indices, const std::vector<GLfloat>& positions,
+                      float threshold)
+{
+    size_t triangleCount = indices.size() / 3;
+    size_t vertexCount = positions.size() / 6;
+
+    if (triangleCount < 2)
+    {
+        return;
+    }
+
+    VertexCacheStats before = AnalyzeVertexCache(indices, vertexCount);
+
+    // Cut clusters where the vertex cache optimizer jumped (a triangle
+    // missing the cache on two or more vertices): starting a cluster there
+    // costs little extra
+    std::vector<Cluster> clusters;
+    std::vector<unsigned int> insertedAt(vertexCount, 0);
+    unsigned int timestamp = DEFAULT_VERTEX_CACHE_SIZE + 1;
+
+    for (size_t triangle = 0; triangle < triangleCount; triangle++)
+    {
+        int misses = 0;
+
+        for (int corner = 0; corner < 3; corner++)
+        {
+            GLuint vertex = indices[triangle * 3 + corner];
+
+            if (timestamp - insertedAt[vertex] > DEFAULT_VERTEX_CACHE_SIZE)
+            {
+                insertedAt[vertex] = timestamp++;
+                misses++;
+            }
+        }
+
+        if (clusters.empty()
+            || (misses >= 2 && clusters.back().triangleCount >= MIN_OVERDRAW_CLUSTER_TRIANGLES))
+        {
+            Cluster cluster;
+            cluster.firstTriangle = triangle;
+            cluster.triangleCount = 0;
+            cluster.sortKey = 0.0f;
+            clusters.push_back(cluster);
+        }
+
+        clusters.back().triangleCount++;
+    }
+
+    if (clusters.size() < 2)
+    {
+        return;
+    }
+
+    // Area weighted centroid of the whole mesh
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+
+    for (size_t triangle = 0; triangle < triangleCount; triangle++)
+    {
+        glm::vec3 a = Position(positions, indices[triangle * 3]);
+        glm::vec3 b = Position(positions, indices[triangle * 3 + 1]);
+        glm::vec3 c = Position(positions, indices[triangle * 3 + 2]);
+        float area = glm::length(glm::cross(b - a, c - a));
+
+        meshCentroid += (a + b + c) * (area / 3.0f);
+        meshArea += area;
+    }
+
+    if (meshArea > 0.0f)
+    {
+        meshCentroid /= meshArea;
+    }
+
+    // Clusters far out along their own normal are likely to occlude the rest
+    for (size_t i = 0; i < clusters.size(); i++)
+    {
+        glm::vec3 centroid(0.0f);
+        glm::vec3 normal(0.0f);
+        float area = 0.0f;
+
+        for (size_t t = 0; t < clusters[i].triangleCount; t++)
+        {
+            size_t triangle = clusters[i].firstTriangle + t;
+            glm::vec3 a = Position(positions, indices[triangle * 3]);
+            glm::vec3 b = Position(positions, indices[triangle * 3 + 1]);
+            glm::vec3 c = Position(positions, indices[triangle * 3 + 2]);
+            glm::vec3 crossProduct = glm::cross(b - a, c - a);
+            float triangleArea = glm::length(crossProduct);
+
+            centroid += (a + b + c) * (triangleArea / 3.0f);
+            normal += crossProduct;
+            area += triangleArea;
+        }
+
+        if (area > 0.0f)
+        {
+            centroid /= area;
+        }
+
+        float normalLength = glm::length(normal);
+        clusters[i].sortKey = normalLength > 0.0f
+                              ? glm::dot(centroid - meshCentroid, normal / normalLength)
+                              : 0.0f;
+    }
+
+    std::stable_sort(clusters.begin(), clusters.end(), ByKeyDescending);
+
+    std::vector<GLuint> reordered;
+    reordered.reserve(indices.size());
+
+    for (size_t i = 0; i < clusters.size(); i++)
+    {
+        reordered.insert(reordered.end(),
+                         indices.begin() + clusters[i].firstTriangle * 3,
+                         indices.begin() + (clusters[i].firstTriangle + clusters[i].triangleCount) * 3);
+    }
+
+    VertexCacheStats after = AnalyzeVertexCache(reordered, vertexCount);
+
+    if (after.acmr <= before.acmr * threshold)
+    {
+        indices.swap(reordered);
+    }
+}
+
+void OptimizeVertexFetch(Mesh3D* meshData)
+{
+    size_t vertexCount = GetMeshVertexCount(meshData);
+    std::vector<GLuint> newIndexOf(vertexCount, (GLuint) -1);
+    GLuint nextVertex = 0;
+
+    for (size_t i = 0; i < meshData->indexBufferData.size(); i++)
+    {
+        GLuint& index = meshData->indexBufferData[i];
+
+        if (newIndexOf[index] == (GLuint) -1)
+        {
+            newIndexOf[index] = nextVertex++;
+        }
+
+        index = newIndexOf[index];
+    }
+
+    RemapStream(meshData->vertexData, newIndexOf, 6, nextVertex);
+    RemapStream(meshData->normalData, newIndexOf, 3, nextVertex);
+    RemapStream(meshData->uvData, newIndexOf, 2, nextVertex);
+}
+
+void OptimizeMesh(Mesh3D* meshData)
+{
+    // Reordering would break the levels' index ranges, and whatever has
+    // levels came out of meshopt already optimized
+    if (!meshData->mLODs.empty())
+    {
+        return;
+    }
+
+    OptimizeVertexCache(meshData->indexBufferData, GetMeshVertexCount(meshData));
+    OptimizeOverdraw(meshData->indexBufferData, meshData->vertexData);
+    OptimizeVertexFetch(meshData);
+}
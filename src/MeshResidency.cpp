@@ -0,0 +1,215 @@
+#include "MeshResidency.hpp"
+#include "MeshIO.hpp"
+#include "MeshOptimizer.hpp"
+
+#include <iostream>
+
+MeshResidencyManager::MeshResidencyManager(GLsizeiptr budgetBytes)
+{
+    mFileSystem = nullptr;
+    mFrame = 0;
+    mStats.budgetBytes = budgetBytes;
+}
+
+void MeshResidencyManager::SetFileSystem(const VirtualFileSystem* fileSystem)
+{
+    mFileSystem = fileSystem;
+}
+
+void MeshResidencyManager::SetBudget(GLsizeiptr budgetBytes)
+{
+    mStats.budgetBytes = budgetBytes;
+}
+
+GLsizeiptr MeshResidencyManager::GetBudget() const
+{
+    return mStats.budgetBytes;
+}
+
+void MeshResidencyManager::Register(Mesh3D* mesh)
+{
+    if (mLookup.find(mesh) != mLookup.end())
+    {
+        return;
+    }
+
+    // New meshes go to the back, they have not been used yet
+    Entry entry;
+    entry.mesh = mesh;
+    entry.lastUsedFrame = 0;
+    entry.evicted = false;
+    mLRU.push_back(entry);
+    mLookup[mesh] = --mLRU.end();
+
+    mStats.trackedMeshes++;
+
+    // The mesh may have been uploaded before it was handed to us
+    if (IsMeshResident(mesh))
+    {
+        mStats.residentBytes += GetMeshResidentBytes(mesh);
+        mStats.residentMeshes++;
+    }
+}
+
+void MeshResidencyManager::Unregister(Mesh3D* mesh)
+{
+    std::unordered_map<Mesh3D*, std::list<Entry>::iterator>::iterator it = mLookup.find(mesh);
+
+    if (it == mLookup.end())
+    {
+        return;
+    }
+
+    if (IsMeshResident(mesh))
+    {
+        mStats.residentBytes -= GetMeshResidentBytes(mesh);
+        mStats.residentMeshes--;
+    }
+
+    mLRU.erase(it->second);
+    mLookup.erase(it);
+    mStats.trackedMeshes--;
+}
+
+void MeshResidencyManager::BeginFrame()
+{
+    mFrame++;
+
+    mStats.uploadedBytesThisFrame = 0;
+    mStats.evictionsThisFrame = 0;
+    mStats.restreamsThisFrame = 0;
+}
+
+/*
+    Mark a mesh as used in the current frame, streaming it back onto the GPU
+    if it was evicted.
+
+    @return true if the mesh can be drawn.
+*/
+bool MeshResidencyManager::MakeResident(Mesh3D* mesh)
+{
+    Register(mesh);
+
+    std::list<Entry>::iterator entry = mLookup[mesh];
+    entry->lastUsedFrame = mFrame;
+
+    // Move to the front of the LRU list
+    mLRU.splice(mLRU.begin(), mLRU, entry);
+
+    if (IsMeshResident(mesh))
+    {
+        return true;
+    }
+
+    return Restream(mesh, entry->evicted);
+}
+
+void MeshResidencyManager::EndFrame()
+{
+    EvictUntil(mStats.budgetBytes);
+
+    mStats.overBudget = mStats.residentBytes > mStats.budgetBytes;
+}
+
+const ResidencyStats& MeshResidencyManager::GetStats() const
+{
+    return mStats;
+}
+
+bool MeshResidencyManager::Restream(Mesh3D* mesh, bool evicted)
+{
+    // The CPU copy was dropped when we evicted it, go back to the source
+    if (mesh->vertexData.empty() && !mesh->mSourcePath.empty())
+    {
+        bool loaded = false;
+
+        if (mFileSystem != nullptr)
+        {
+            std::vector<unsigned char> contents;
+            loaded = mFileSystem->ReadFile(mesh->mSourcePath, contents)
+                     && LoadMeshFromMemory(contents.data(), contents.size(), mesh);
+        }
+        else
+        {
+            loaded = LoadMeshBinary(mesh->mSourcePath, mesh);
+        }
+
+        if (!loaded)
+        {
+            return false;
+        }
+
+        // The same order as when it was first loaded, the meshlets rely on it
+        OptimizeMesh(mesh);
+    }
+
+    GLsizeiptr bytes = GetMeshUploadBytes(mesh);
+
+    // Make room before uploading so we never go over budget for a moment
+    if (bytes <= mStats.budgetBytes)
+    {
+        EvictUntil(mStats.budgetBytes - bytes);
+    }
+
+    VertexSpecification(mesh);
+
+    mStats.residentBytes += GetMeshResidentBytes(mesh);
+    mStats.residentMeshes++;
+
+    mStats.uploadedBytesThisFrame += bytes;
+    mStats.uploadedBytesTotal += bytes;
+
+    if (evicted)
+    {
+        mStats.restreamsThisFrame++;
+        mStats.restreamsTotal++;
+    }
+
+    return true;
+}
+
+void MeshResidencyManager::Evict(Mesh3D* mesh)
+{
+    mStats.residentBytes -= GetMeshResidentBytes(mesh);
+    mStats.residentMeshes--;
+
+    ReleaseMeshBuffers(mesh);
+
+    // We can get it back from disk, so don't keep the CPU copy around either
+    if (!mesh->mSourcePath.empty())
+    {
+        std::vector<GLfloat>().swap(mesh->vertexData);
+        std::vector<GLuint>().swap(mesh->indexBufferData);
+        std::vector<GLfloat>().swap(mesh->normalData);
+        std::vector<GLfloat>().swap(mesh->uvData);
+    }
+
+    mStats.evictionsThisFrame++;
+    mStats.evictionsTotal++;
+}
+
+/*
+    Evict least recently used meshes until at most targetBytes are resident.
+    Meshes used in the current frame are never evicted.
+*/
+void MeshResidencyManager::EvictUntil(GLsizeiptr targetBytes)
+{
+    std::list<Entry>::reverse_iterator it = mLRU.rbegin();
+
+    while (mStats.residentBytes > targetBytes && it != mLRU.rend())
+    {
+        if (it->lastUsedFrame == mFrame)
+        {
+            // Everything in front of this one was used this frame as well
+            break;
+        }
+
+        if (IsMeshResident(it->mesh))
+        {
+            Evict(it->mesh);
+            it->evicted = true;
+        }
+
+        ++it;
+    }
+}
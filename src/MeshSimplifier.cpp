@@ -0,0 +1,373 @@
+#include "MeshSimplifier.hpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    // Border edges are held in place by planes perpendicular to the surface
+    const float BORDER_WEIGHT = 10.0f;
+
+    // Largest normal rotation (cos 75 degrees) a collapse may cause, so
+    // triangles do not flip over
+    const float MIN_NORMAL_COS = 0.25f;
+
+    enum VertexKind {
+        VERTEX_MANIFOLD,
+        VERTEX_BORDER,
+        VERTEX_LOCKED
+    };
+
+    /* Symmetric 4x4 matrix, plus the area it was accumulated over */
+    struct Quadric {
+        float a2 = 0.0f, ab = 0.0f, ac = 0.0f, ad = 0.0f;
+        float b2 = 0.0f, bc = 0.0f, bd = 0.0f;
+        float c2 = 0.0f, cd = 0.0f;
+        float d2 = 0.0f;
+        float weight = 0.0f;
+    };
+
+    void AddPlane(Quadric& q, glm::vec3 normal, float distance, float weight)
+    {
+        q.a2 += normal.x * normal.x * weight;
+        q.ab += normal.x * normal.y * weight;
+        q.ac += normal.x * normal.z * weight;
+        q.ad += normal.x * distance * weight;
+        q.b2 += normal.y * normal.y * weight;
+        q.bc += normal.y * normal.z * weight;
+        q.bd += normal.y * distance * weight;
+        q.c2 += normal.z * normal.z * weight;
+        q.cd += normal.z * distance * weight;
+        q.d2 += distance * distance * weight;
+        q.weight += weight;
+    }
+
+    void AddQuadric(Quadric& q, const Quadric& other)
+    {
+        q.a2 += other.a2; q.ab += other.ab; q.ac += other.ac; q.ad += other.ad;
+        q.b2 += other.b2; q.bc += other.bc; q.bd += other.bd;
+        q.c2 += other.c2; q.cd += other.cd;
+        q.d2 += other.d2;
+        q.weight += other.weight;
+    }
+
+    /* @return the weighted mean squared distance of p to the planes in q. */
+    float QuadricError(const Quadric& q, glm::vec3 p)
+    {
+        float error = q.a2 * p.x * p.x + q.b2 * p.y * p.y + q.c2 * p.z * p.z
+                    + 2.0f * (q.ab * p.x * p.y + q.ac * p.x * p.z + q.bc * p.y * p.z)
+                    + 2.0f * (q.ad * p.x + q.bd * p.y + q.cd * p.z)
+                    + q.d2;
+
+        return q.weight > 0.0f ? std::fabs(error) / q.weight : 0.0f;
+    }
+
+    struct Collapse {
+        GLuint from;
+        GLuint to;
+        float error;
+    };
+
+    bool ByError(const Collapse& a, const Collapse& b)
+    {
+        return a.error < b.error;
+    }
+
+    /* Triangles around each vertex, rebuilt after every pass */
+    struct Adjacency {
+        std::vector<unsigned int> offsets;
+        std::vector<unsigned int> triangles;
+
+        void Build(const std::vector<GLuint>& indices, size_t vertexCount)
+        {
+            offsets.assign(vertexCount + 1, 0);
+            triangles.resize(indices.size());
+
+            for (size_t i = 0; i < indices.size(); i++)
+            {
+                offsets[indices[i] + 1]++;
+            }
+
+            for (size_t vertex = 0; vertex < vertexCount; vertex++)
+            {
+                offsets[vertex + 1] += offsets[vertex];
+            }
+
+            std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+
+            for (size_t i = 0; i < indices.size(); i++)
+            {
+                triangles[fill[indices[i]]++] = (unsigned int) (i / 3);
+            }
+        }
+
+        /* @return how many triangles use the edge a-b. */
+        unsigned int EdgeValence(const std::vector<GLuint>& indices, GLuint a, GLuint b) const
+        {
+            unsigned int count = 0;
+
+            for (unsigned int i = offsets[a]; i < offsets[a + 1]; i++)
+            {
+                const GLuint* corners = &indices[triangles[i] * 3];
+                count += corners[0] == b || corners[1] == b || corners[2] == b;
+            }
+
+            return count;
+        }
+    };
+
+    glm::vec3 Position(const std::vector<GLfloat>& positions, GLuint vertex)
+    {
+        return glm::vec3(positions[vertex * 6], positions[vertex * 6 + 1], positions[vertex * 6 + 2]);
+    }
+
+    /* Vertices sharing a position with another vertex sit on a seam */
+    void LockSeams(const std::vector<GLfloat>& positions, std::vector<unsigned char>& kind)
+    {
+        std::vector<GLuint> order(kind.size());
+
+        for (size_t i = 0; i < order.size(); i++)
+        {
+            order[i] = (GLuint) i;
+        }
+
+        std::sort(order.begin(), order.end(), [&positions](GLuint a, GLuint b) {
+            const GLfloat* pa = &positions[a * 6];
+            const GLfloat* pb = &positions[b * 6];
+            return std::lexicographical_compare(pa, pa + 3, pb, pb + 3);
+        });
+
+        for (size_t i = 1; i < order.size(); i++)
+        {
+            const GLfloat* previous = &positions[order[i - 1] * 6];
+            const GLfloat* current = &positions[order[i] * 6];
+
+            if (std::equal(previous, previous + 3, current))
+            {
+                kind[order[i - 1]] = VERTEX_LOCKED;
+                kind[order[i]] = VERTEX_LOCKED;
+            }
+        }
+    }
+
+    /* @return false if replacing 'from' by 'to' would flip a triangle over. */
+    bool KeepsOrientation(const std::vector<GLuint>& indices, const std::vector<GLfloat>& positions,
+                          const Adjacency& adjacency, GLuint from, GLuint to)
+    {
+        glm::vec3 target = Position(positions, to);
+
+        for (unsigned int i = adjacency.offsets[from]; i < adjacency.offsets[from + 1]; i++)
+        {
+            const GLuint* corners = &indices[adjacency.triangles[i] * 3];
+
+            // These triangles disappear
+            if (corners[0] == to || corners[1] == to || corners[2] == to)
+            {
+                continue;
+            }
+
+            // Rotate so 'from' comes first, keeping the winding
+            int first = corners[0] == from ? 0 : (corners[1] == from ? 1 : 2);
+            glm::vec3 b = Position(positions, corners[(first + 1) % 3]);
+            glm::vec3 c = Position(positions, corners[(first + 2) % 3]);
+
+            glm::vec3 before = glm::cross(b - Position(positions, from), c - Position(positions, from));
+            glm::vec3 after = glm::cross(b - target, c - target);
+
+            if (glm::dot(before, after) < MIN_NORMAL_COS * glm::length(before) * glm::length(after))
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+}
+
+size_t SimplifyMesh(const std::vector<GLuint>& indices, const std::vector<GLfloat>& positions,
+                    size_t targetIndexCount, float maxError,
+                    std::vector<GLuint>& result, float& resultError)
+{
+    size_t vertexCount = positions.size() / 6;
+
+    result = indices;
+    resultError = 0.0f;
+
+    if (result.size() <= targetIndexCount || vertexCount == 0)
+    {
+        return result.size();
+    }
+
+    Adjacency adjacency;
+    adjacency.Build(result, vertexCount);
+
+    std::vector<unsigned char> kind(vertexCount, VERTEX_MANIFOLD);
+    LockSeams(positions, kind);
+
+    // Every vertex starts with the planes of the triangles around it
+    std::vector<Quadric> quadrics(vertexCount);
+
+    for (size_t triangle = 0; triangle < result.size() / 3; triangle++)
+    {
+        const GLuint* corners = &result[triangle * 3];
+        glm::vec3 p[3] = { Position(positions, corners[0]),
+                           Position(positions, corners[1]),
+                           Position(positions, corners[2]) };
+
+        glm::vec3 normal = glm::cross(p[1] - p[0], p[2] - p[0]);
+        float area = glm::length(normal);
+
+        if (area <= 0.0f)
+        {
+            continue;
+        }
+
+        normal /= area;
+
+        for (int corner = 0; corner < 3; corner++)
+        {
+            AddPlane(quadrics[corners[corner]], normal, -glm::dot(normal, p[0]), area);
+        }
+
+        // Open edges: a plane through the edge, perpendicular to the triangle
+        for (int edge = 0; edge < 3; edge++)
+        {
+            GLuint a = corners[edge];
+            GLuint b = corners[(edge + 1) % 3];
+
+            if (adjacency.EdgeValence(result, a, b) != 1)
+            {
+                continue;
+            }
+
+            glm::vec3 direction = p[(edge + 1) % 3] - p[edge];
+            float length = glm::length(direction);
+            glm::vec3 edgeNormal = glm::cross(direction / length, normal);
+            float distance = -glm::dot(edgeNormal, p[edge]);
+
+            AddPlane(quadrics[a], edgeNormal, distance, length * length * BORDER_WEIGHT);
+            AddPlane(quadrics[b], edgeNormal, distance, length * length * BORDER_WEIGHT);
+
+            if (kind[a] != VERTEX_LOCKED) kind[a] = VERTEX_BORDER;
+            if (kind[b] != VERTEX_LOCKED) kind[b] = VERTEX_BORDER;
+        }
+    }
+
+    float maxErrorSquared = maxError * maxError;
+    float largestErrorSquared = 0.0f;
+
+    std::vector<Collapse> collapses;
+    std::vector<GLuint> remap(vertexCount);
+    std::vector<bool> touched(vertexCount);
+
+    // Each pass collapses a batch of independent edges, cheapest first
+    while (result.size() > targetIndexCount)
+    {
+        collapses.clear();
+
+        for (size_t i = 0; i < result.size(); i++)
+        {
+            GLuint from = result[i];
+            GLuint to = result[i - i % 3 + (i + 1) % 3];
+
+            if (kind[from] == VERTEX_LOCKED)
+            {
+                continue;
+            }
+
+            // Border vertices may only slide along the border
+            if (kind[from] == VERTEX_BORDER && adjacency.EdgeValence(result, from, to) != 1)
+            {
+                continue;
+            }
+
+            Collapse collapse;
+            collapse.from = from;
+            collapse.to = to;
+            collapse.error = QuadricError(quadrics[from], Position(positions, to));
+            collapses.push_back(collapse);
+
+            // The same edge the other way around
+            if (kind[to] == VERTEX_MANIFOLD
+                || (kind[to] == VERTEX_BORDER && adjacency.EdgeValence(result, from, to) == 1))
+            {
+                collapse.from = to;
+                collapse.to = from;
+                collapse.error = QuadricError(quadrics[to], Position(positions, from));
+                collapses.push_back(collapse);
+            }
+        }
+
+        std::sort(collapses.begin(), collapses.end(), ByError);
+
+        for (size_t vertex = 0; vertex < vertexCount; vertex++)
+        {
+            remap[vertex] = (GLuint) vertex;
+        }
+
+        std::fill(touched.begin(), touched.end(), false);
+
+        // An interior collapse removes two triangles, do not overshoot much
+        size_t trianglesToRemove = (result.size() - targetIndexCount) / 3;
+        size_t trianglesRemoved = 0;
+
+        for (size_t i = 0; i < collapses.size() && trianglesRemoved < trianglesToRemove; i++)
+        {
+            const Collapse& collapse = collapses[i];
+
+            if (collapse.error > maxErrorSquared)
+            {
+                break;
+            }
+
+            if (touched[collapse.from] || touched[collapse.to]
+                || !KeepsOrientation(result, positions, adjacency, collapse.from, collapse.to))
+            {
+                continue;
+            }
+
+            // Nothing around 'from' may change again in this pass, so the
+            // adjacency stays valid for the other collapses
+            for (unsigned int j = adjacency.offsets[collapse.from]; j < adjacency.offsets[collapse.from + 1]; j++)
+            {
+                const GLuint* corners = &result[adjacency.triangles[j] * 3];
+                touched[corners[0]] = touched[corners[1]] = touched[corners[2]] = true;
+            }
+
+            trianglesRemoved += adjacency.EdgeValence(result, collapse.from, collapse.to);
+            remap[collapse.from] = collapse.to;
+            AddQuadric(quadrics[collapse.to], quadrics[collapse.from]);
+            largestErrorSquared = std::max(largestErrorSquared, collapse.error);
+        }
+
+        if (trianglesRemoved == 0)
+        {
+            break;
+        }
+
+        // Apply the collapses and drop the triangles that became degenerate
+        size_t write = 0;
+
+        for (size_t i = 0; i < result.size(); i += 3)
+        {
+            GLuint a = remap[result[i]];
+            GLuint b = remap[result[i + 1]];
+            GLuint c = remap[result[i + 2]];
+
+            if (a != b && b != c && a != c)
+            {
+                result[write++] = a;
+                result[write++] = b;
+                result[write++] = c;
+            }
+        }
+
+        result.resize(write);
+        adjacency.Build(result, vertexCount);
+    }
+
+    resultError = std::sqrt(largestErrorSquared);
+
+    return result.size();
+}
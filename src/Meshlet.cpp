@@ -0,0 +1,391 @@
+#include "Meshlet.hpp"
+#include "Mesh3D.hpp"
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+// SSE2 is always there on x86-64, anything else takes the scalar path
+#if defined(__SSE2__) || defined(_M_X64)
+#define MESHLET_SIMD 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+    // Below this the normals spread too far for the cone to ever reject
+    const float MIN_CONE_SPREAD_COS = 0.1f;
+
+    // Meshlets per ParallelFor chunk
+    const unsigned int CULL_GRAIN = 256;
+
+    enum MeshletVisibility {
+        MESHLET_FRUSTUM_CULLED = 0,
+        MESHLET_VISIBLE = 1,
+        MESHLET_BACKFACE_CULLED = 2
+    };
+
+    glm::vec3 Position(const std::vector<GLfloat>& positions, GLuint vertex)
+    {
+        return glm::vec3(positions[vertex * 6], positions[vertex * 6 + 1], positions[vertex * 6 + 2]);
+    }
+
+    void ComputeBounds(const Mesh3D* meshData, Meshlet& meshlet, const std::vector<GLuint>& vertices)
+    {
+        const std::vector<GLfloat>& positions = meshData->vertexData;
+        const GLuint* indices = &meshData->indexBufferData[meshlet.firstIndex];
+
+        glm::vec3 boundsMin = Position(positions, vertices[0]);
+        glm::vec3 boundsMax = boundsMin;
+
+        for (size_t i = 1; i < vertices.size(); i++)
+        {
+            boundsMin = glm::min(boundsMin, Position(positions, vertices[i]));
+            boundsMax = glm::max(boundsMax, Position(positions, vertices[i]));
+        }
+
+        meshlet.center = (boundsMin + boundsMax) * 0.5f;
+        meshlet.radius = 0.0f;
+
+        for (size_t i = 0; i < vertices.size(); i++)
+        {
+            meshlet.radius = std::max(meshlet.radius, glm::length(Position(positions, vertices[i]) - meshlet.center));
+        }
+
+        // Normal cone: average direction, then the widest deviation from it
+        size_t triangleCount = meshlet.indexCount / 3;
+        std::vector<glm::vec3> normals(triangleCount, glm::vec3(0.0f));
+        glm::vec3 axis(0.0f);
+
+        for (size_t triangle = 0; triangle < triangleCount; triangle++)
+        {
+            glm::vec3 a = Position(positions, indices[triangle * 3]);
+            glm::vec3 b = Position(positions, indices[triangle * 3 + 1]);
+            glm::vec3 c = Position(positions, indices[triangle * 3 + 2]);
+            glm::vec3 normal = glm::cross(b - a, c - a);
+            float length = glm::length(normal);
+
+            if (length > 0.0f)
+            {
+                normals[triangle] = normal / length;
+                axis += normals[triangle];
+            }
+        }
+
+        meshlet.coneApex = meshlet.center;
+        meshlet.coneCutoff = 1.0f;
+
+        float axisLength = glm::length(axis);
+
+        if (axisLength <= 0.0f)
+        {
+            return;
+        }
+
+        axis /= axisLength;
+        meshlet.coneAxis = axis;
+
+        float minDot = 1.0f;
+
+        for (size_t triangle = 0; triangle < triangleCount; triangle++)
+        {
+            if (normals[triangle] != glm::vec3(0.0f))
+            {
+                minDot = std::min(minDot, glm::dot(axis, normals[triangle]));
+            }
+        }
+
+        if (minDot < MIN_CONE_SPREAD_COS)
+        {
+            return;
+        }
+
+        // Move the apex back along the axis until it is behind every triangle
+        float maxT = 0.0f;
+
+        for (size_t triangle = 0; triangle < triangleCount; triangle++)
+        {
+            if (normals[triangle] != glm::vec3(0.0f))
+            {
+                glm::vec3 corner = Position(positions, indices[triangle * 3]);
+                float t = glm::dot(meshlet.center - corner, normals[triangle])
+                        / glm::dot(axis, normals[triangle]);
+                maxT = std::max(maxT, t);
+            }
+        }
+
+        meshlet.coneApex = meshlet.center - axis * maxT;
+        meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+    }
+
+    void BuildBounds(const std::vector<Meshlet>& meshlets, MeshletBounds& bounds)
+    {
+        size_t padded = (meshlets.size() + 3) & ~(size_t) 3;
+
+        bounds.count = meshlets.size();
+
+        // The padding lanes are tested but never read
+        bounds.centerX.assign(padded, 0.0f);
+        bounds.centerY.assign(padded, 0.0f);
+        bounds.centerZ.assign(padded, 0.0f);
+        bounds.radius.assign(padded, -1.0f);
+        bounds.apexX.assign(padded, 0.0f);
+        bounds.apexY.assign(padded, 0.0f);
+        bounds.apexZ.assign(padded, 0.0f);
+        bounds.axisX.assign(padded, 0.0f);
+        bounds.axisY.assign(padded, 0.0f);
+        bounds.axisZ.assign(padded, 1.0f);
+        bounds.cutoff.assign(padded, 1.0f);
+
+        for (size_t i = 0; i < meshlets.size(); i++)
+        {
+            const Meshlet& meshlet = meshlets[i];
+
+            bounds.centerX[i] = meshlet.center.x;
+            bounds.centerY[i] = meshlet.center.y;
+            bounds.centerZ[i] = meshlet.center.z;
+            bounds.radius[i] = meshlet.radius;
+            bounds.apexX[i] = meshlet.coneApex.x;
+            bounds.apexY[i] = meshlet.coneApex.y;
+            bounds.apexZ[i] = meshlet.coneApex.z;
+            bounds.axisX[i] = meshlet.coneAxis.x;
+            bounds.axisY[i] = meshlet.coneAxis.y;
+            bounds.axisZ[i] = meshlet.coneAxis.z;
+            bounds.cutoff[i] = meshlet.coneCutoff;
+        }
+    }
+
+    /* Gribb & Hartmann: the frustum planes straight from the matrix rows */
+    void ExtractFrustumPlanes(const glm::mat4& matrix, glm::vec4 planes[6])
+    {
+        glm::vec4 rows[4];
+
+        for (int row = 0; row < 4; row++)
+        {
+            rows[row] = glm::vec4(matrix[0][row], matrix[1][row], matrix[2][row], matrix[3][row]);
+        }
+
+        for (int axis = 0; axis < 3; axis++)
+        {
+            planes[axis * 2] = rows[3] + rows[axis];
+            planes[axis * 2 + 1] = rows[3] - rows[axis];
+        }
+
+        for (int i = 0; i < 6; i++)
+        {
+            planes[i] /= glm::length(glm::vec3(planes[i]));
+        }
+    }
+
+    /* Cull meshlets [begin, end), begin and end are multiples of 4 */
+    void CullRange(const MeshletBounds& bounds, const glm::vec4 planes[6], glm::vec3 eye,
+                   bool backfaceCulling, size_t begin, size_t end, unsigned char* visibility)
+    {
+#ifdef MESHLET_SIMD
+        for (size_t i = begin; i < end; i += 4)
+        {
+            __m128 cx = _mm_loadu_ps(&bounds.centerX[i]);
+            __m128 cy = _mm_loadu_ps(&bounds.centerY[i]);
+            __m128 cz = _mm_loadu_ps(&bounds.centerZ[i]);
+            __m128 negativeRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&bounds.radius[i]));
+
+            __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+            for (int plane = 0; plane < 6; plane++)
+            {
+                __m128 distance = _mm_add_ps(
+                    _mm_add_ps(_mm_mul_ps(cx, _mm_set1_ps(planes[plane].x)),
+                               _mm_mul_ps(cy, _mm_set1_ps(planes[plane].y))),
+                    _mm_add_ps(_mm_mul_ps(cz, _mm_set1_ps(planes[plane].z)),
+                               _mm_set1_ps(planes[plane].w)));
+
+                inside = _mm_and_ps(inside, _mm_cmpgt_ps(distance, negativeRadius));
+            }
+
+            int insideMask = _mm_movemask_ps(inside);
+            int backMask = 0;
+
+            if (backfaceCulling)
+            {
+                __m128 vx = _mm_sub_ps(_mm_loadu_ps(&bounds.apexX[i]), _mm_set1_ps(eye.x));
+                __m128 vy = _mm_sub_ps(_mm_loadu_ps(&bounds.apexY[i]), _mm_set1_ps(eye.y));
+                __m128 vz = _mm_sub_ps(_mm_loadu_ps(&bounds.apexZ[i]), _mm_set1_ps(eye.z));
+
+                __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)),
+                                                       _mm_mul_ps(vz, vz)));
+                __m128 along = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, _mm_loadu_ps(&bounds.axisX[i])),
+                                                     _mm_mul_ps(vy, _mm_loadu_ps(&bounds.axisY[i]))),
+                                          _mm_mul_ps(vz, _mm_loadu_ps(&bounds.axisZ[i])));
+
+                backMask = _mm_movemask_ps(_mm_cmpge_ps(along, _mm_mul_ps(_mm_loadu_ps(&bounds.cutoff[i]), length)));
+            }
+
+            for (int lane = 0; lane < 4; lane++)
+            {
+                if ((insideMask & (1 << lane)) == 0)
+                {
+                    visibility[i + lane] = MESHLET_FRUSTUM_CULLED;
+                }
+                else
+                {
+                    visibility[i + lane] = (backMask & (1 << lane)) ? MESHLET_BACKFACE_CULLED : MESHLET_VISIBLE;
+                }
+            }
+        }
+#else
+        for (size_t i = begin; i < end; i++)
+        {
+            glm::vec3 center(bounds.centerX[i], bounds.centerY[i], bounds.centerZ[i]);
+            bool inside = true;
+
+            for (int plane = 0; plane < 6; plane++)
+            {
+                inside = inside && glm::dot(glm::vec3(planes[plane]), center) + planes[plane].w > -bounds.radius[i];
+            }
+
+            if (!inside)
+            {
+                visibility[i] = MESHLET_FRUSTUM_CULLED;
+                continue;
+            }
+
+            glm::vec3 view = glm::vec3(bounds.apexX[i], bounds.apexY[i], bounds.apexZ[i]) - eye;
+            glm::vec3 axis(bounds.axisX[i], bounds.axisY[i], bounds.axisZ[i]);
+
+            visibility[i] = backfaceCulling && glm::dot(view, axis) >= bounds.cutoff[i] * glm::length(view)
+                            ? MESHLET_BACKFACE_CULLED : MESHLET_VISIBLE;
+        }
+#endif
+    }
+}
+
+void BuildMeshlets(Mesh3D* meshData, size_t maxVertices, size_t maxTriangles)
+{
+    meshData->mMeshlets.clear();
+
+    // Only the full detail level, the coarser ones are small anyway
+    size_t indexCount = meshData->mLODs.empty() ? meshData->indexBufferData.size()
+                                                : meshData->mLODs[0].indexCount;
+    size_t vertexCount = GetMeshVertexCount(meshData);
+    const std::vector<GLuint>& indices = meshData->indexBufferData;
+
+    // Which meshlet last used each vertex, to count unique vertices
+    std::vector<size_t> usedBy(vertexCount, (size_t) -1);
+    std::vector<GLuint> vertices;
+
+    Meshlet meshlet;
+
+    for (size_t i = 0; i + 2 < indexCount; i += 3)
+    {
+        size_t meshletIndex = meshData->mMeshlets.size();
+        size_t newVertices = (usedBy[indices[i]] != meshletIndex)
+                           + (usedBy[indices[i + 1]] != meshletIndex && indices[i + 1] != indices[i])
+                           + (usedBy[indices[i + 2]] != meshletIndex && indices[i + 2] != indices[i]
+                                                                      && indices[i + 2] != indices[i + 1]);
+
+        if (meshlet.indexCount > 0
+            && (vertices.size() + newVertices > maxVertices || meshlet.indexCount / 3 >= maxTriangles))
+        {
+            ComputeBounds(meshData, meshlet, vertices);
+            meshData->mMeshlets.push_back(meshlet);
+            meshletIndex++;
+
+            meshlet = Meshlet();
+            meshlet.firstIndex = (GLuint) i;
+            vertices.clear();
+        }
+
+        for (int corner = 0; corner < 3; corner++)
+        {
+            if (usedBy[indices[i + corner]] != meshletIndex)
+            {
+                usedBy[indices[i + corner]] = meshletIndex;
+                vertices.push_back(indices[i + corner]);
+            }
+        }
+
+        meshlet.indexCount += 3;
+    }
+
+    if (meshlet.indexCount > 0)
+    {
+        ComputeBounds(meshData, meshlet, vertices);
+        meshData->mMeshlets.push_back(meshlet);
+    }
+
+    BuildBounds(meshData->mMeshlets, meshData->mMeshletBounds);
+}
+
+size_t CullMeshlets(const Mesh3D* meshData, const glm::mat4& modelViewProjection,
+                    glm::vec3 eye, bool backfaceCulling, ThreadPool* threadPool,
+                    MeshletDrawList& drawList, MeshletCullStats& stats)
+{
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+    const MeshletBounds& bounds = meshData->mMeshletBounds;
+    const std::vector<Meshlet>& meshlets = meshData->mMeshlets;
+    size_t padded = bounds.radius.size();
+
+    glm::vec4 planes[6];
+    ExtractFrustumPlanes(modelViewProjection, planes);
+
+    drawList.visible.resize(padded);
+    unsigned char* visibility = drawList.visible.data();
+
+    if (threadPool != nullptr && padded > CULL_GRAIN)
+    {
+        threadPool->ParallelFor((unsigned int) (padded / 4), CULL_GRAIN / 4,
+                                [&](unsigned int begin, unsigned int end) {
+            CullRange(bounds, planes, eye, backfaceCulling, begin * 4, end * 4, visibility);
+        });
+    }
+    else
+    {
+        CullRange(bounds, planes, eye, backfaceCulling, 0, padded, visibility);
+    }
+
+    // Compact the survivors into as few ranges as possible
+    size_t indexSize = meshData->mIndexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+    size_t rangeEnd = (size_t) -1;
+
+    drawList.counts.clear();
+    drawList.offsets.clear();
+
+    for (size_t i = 0; i < meshlets.size(); i++)
+    {
+        stats.meshlets++;
+
+        if (visibility[i] == MESHLET_FRUSTUM_CULLED)
+        {
+            stats.frustumCulled++;
+            continue;
+        }
+
+        if (visibility[i] == MESHLET_BACKFACE_CULLED)
+        {
+            stats.backfaceCulled++;
+            continue;
+        }
+
+        stats.visible++;
+        stats.trianglesSubmitted += meshlets[i].indexCount / 3;
+
+        if (meshlets[i].firstIndex == rangeEnd)
+        {
+            drawList.counts.back() += meshlets[i].indexCount;
+        }
+        else
+        {
+            drawList.counts.push_back(meshlets[i].indexCount);
+            drawList.offsets.push_back((const GLvoid*) (meshlets[i].firstIndex * indexSize));
+        }
+
+        rangeEnd = meshlets[i].firstIndex + meshlets[i].indexCount;
+    }
+
+    stats.drawRanges += (unsigned int) drawList.counts.size();
+    stats.cullMilliseconds += std::chrono::duration<double, std::milli>(
+                                  std::chrono::high_resolution_clock::now() - start).count();
+
+    return drawList.counts.size();
+}
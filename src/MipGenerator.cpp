@@ -0,0 +1,541 @@
+#include "MipGenerator.hpp"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/color_space.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+// SSE2 is always there on x86-64, anything else takes the scalar path
+#if defined(__SSE2__) || defined(_M_X64)
+#define MIPGENERATOR_SIMD 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+    // Rows are handed to the workers in chunks of about this many texels
+    const unsigned int TEXELS_PER_CHUNK = 32768;
+
+    // The Kaiser kernel covers 8 source texels, 2 destination texels to
+    // each side of the center
+    const int KAISER_TAPS = 8;
+    const float KAISER_RADIUS = 2.0f;
+    const float KAISER_ALPHA = 4.0f;
+
+    // Linear to sRGB by table, fine enough that no byte comes out wrong
+    // in the steep part near black
+    const int LINEAR_TABLE_SIZE = 16384;
+
+    struct FloatImage {
+        unsigned int width = 0;
+        unsigned int height = 0;
+        std::vector<float> texels; // RGBA
+    };
+
+    struct ColorTables {
+        float srgbToLinear[256];
+        unsigned char linearToSrgb[LINEAR_TABLE_SIZE];
+
+        ColorTables()
+        {
+            for (int i = 0; i < 256; i++)
+            {
+                srgbToLinear[i] = glm::convertSRGBToLinear(glm::vec3(i / 255.0f)).x;
+            }
+
+            for (int i = 0; i < LINEAR_TABLE_SIZE; i++)
+            {
+                float srgb = glm::convertLinearToSRGB(glm::vec3((float) i / (LINEAR_TABLE_SIZE - 1))).x;
+                linearToSrgb[i] = (unsigned char) (srgb * 255.0f + 0.5f);
+            }
+        }
+    };
+
+    const ColorTables& GetColorTables()
+    {
+        static const ColorTables tables;
+        return tables;
+    }
+
+    typedef std::function<void(unsigned int begin, unsigned int end)> RowBody;
+
+    void ForRows(ThreadPool* threadPool, unsigned int rows, unsigned int width, const RowBody& body)
+    {
+        unsigned int grain = std::max(1u, TEXELS_PER_CHUNK / std::max(width, 1u));
+
+        if (threadPool == nullptr || rows <= grain)
+        {
+            body(0, rows);
+        }
+        else
+        {
+            threadPool->ParallelFor(rows, grain, body);
+        }
+    }
+
+    unsigned char ToByte(float value)
+    {
+        return (unsigned char) (std::min(std::max(value, 0.0f), 1.0f) * 255.0f + 0.5f);
+    }
+
+    // Modified Bessel function of the first kind, order 0
+    float BesselI0(float x)
+    {
+        float sum = 1.0f;
+        float term = 1.0f;
+
+        for (int k = 1; k < 20; k++)
+        {
+            term *= (x / (2.0f * k)) * (x / (2.0f * k));
+            sum += term;
+        }
+
+        return sum;
+    }
+
+    /*
+        Weights for source texels 2x - 3 ... 2x + 4 of destination texel x,
+        whose center lies between 2x and 2x + 1.
+    */
+    void MakeKaiserWeights(float weights[KAISER_TAPS])
+    {
+        float sum = 0.0f;
+
+        for (int tap = 0; tap < KAISER_TAPS; tap++)
+        {
+            // Distance from the center in destination texels
+            float distance = (tap - KAISER_TAPS / 2 + 0.5f) * 0.5f;
+            float sinc = std::sin(glm::pi<float>() * distance) / (glm::pi<float>() * distance);
+            float ratio = distance / KAISER_RADIUS;
+            float window = BesselI0(KAISER_ALPHA * std::sqrt(std::max(0.0f, 1.0f - ratio * ratio)))
+                         / BesselI0(KAISER_ALPHA);
+
+            weights[tap] = sinc * window;
+            sum += weights[tap];
+        }
+
+        for (int tap = 0; tap < KAISER_TAPS; tap++)
+        {
+            weights[tap] /= sum;
+        }
+    }
+
+    /*
+        The level a filter reads from: float texels, or for the first level
+        the input bytes, decoded a row at a time so the full size image is
+        never held in floats.
+    */
+    struct SourceImage {
+        unsigned int width;
+        unsigned int height;
+        const float* texels;
+        const unsigned char* bytes;
+        // 256 values per channel, for the bytes
+        const float* decode;
+
+        const float* GetRow(unsigned int y, std::vector<float>& scratch) const
+        {
+            if (texels != nullptr)
+            {
+                return texels + (size_t) y * width * 4;
+            }
+
+            const unsigned char* row = bytes + (size_t) y * width * 4;
+            scratch.resize((size_t) width * 4);
+
+            for (size_t i = 0; i < (size_t) width * 4; i += 4)
+            {
+                scratch[i + 0] = decode[row[i + 0]];
+                scratch[i + 1] = decode[256 + row[i + 1]];
+                scratch[i + 2] = decode[512 + row[i + 2]];
+                scratch[i + 3] = decode[768 + row[i + 3]];
+            }
+
+            return scratch.data();
+        }
+    };
+
+    SourceImage MakeSource(const FloatImage& image)
+    {
+        SourceImage source;
+        source.width = image.width;
+        source.height = image.height;
+        source.texels = image.texels.data();
+        source.bytes = nullptr;
+        source.decode = nullptr;
+        return source;
+    }
+
+    // Byte to float for every channel, rgb by options, alpha always linear
+    void MakeDecodeTable(const MipOptions& options, float table[1024])
+    {
+        const ColorTables& tables = GetColorTables();
+
+        for (int value = 0; value < 256; value++)
+        {
+            float color = value / 255.0f;
+
+            if (options.normalMap)
+            {
+                color = value / 127.5f - 1.0f;
+            }
+            else if (options.srgb)
+            {
+                color = tables.srgbToLinear[value];
+            }
+
+            table[value] = color;
+            table[256 + value] = color;
+            table[512 + value] = color;
+            table[768 + value] = value / 255.0f;
+        }
+    }
+
+    /*
+        Back to bytes. Normals are renormalized in the float level as well,
+        so the next level is filtered from unit vectors.
+    */
+    void Encode(FloatImage& image, const MipOptions& options, ThreadPool* threadPool, TextureImage& level)
+    {
+        const ColorTables& tables = GetColorTables();
+
+        level.width = image.width;
+        level.height = image.height;
+        level.data.resize((size_t) image.width * image.height * 4);
+
+        ForRows(threadPool, image.height, image.width, [&](unsigned int begin, unsigned int end) {
+            for (size_t i = (size_t) begin * image.width * 4; i < (size_t) end * image.width * 4; i += 4)
+            {
+                float* texel = &image.texels[i];
+                unsigned char* out = &level.data[i];
+
+                if (options.normalMap)
+                {
+                    float length = std::sqrt(texel[0] * texel[0] + texel[1] * texel[1] + texel[2] * texel[2]);
+                    float scale = length > 0.0f ? 1.0f / length : 0.0f;
+
+                    for (int channel = 0; channel < 3; channel++)
+                    {
+                        texel[channel] *= scale;
+                        out[channel] = ToByte(texel[channel] * 0.5f + 0.5f);
+                    }
+                }
+                else if (options.srgb)
+                {
+                    for (int channel = 0; channel < 3; channel++)
+                    {
+                        float value = std::min(std::max(texel[channel], 0.0f), 1.0f);
+                        out[channel] = tables.linearToSrgb[(int) (value * (LINEAR_TABLE_SIZE - 1) + 0.5f)];
+                    }
+                }
+                else
+                {
+                    for (int channel = 0; channel < 3; channel++)
+                    {
+                        out[channel] = ToByte(texel[channel]);
+                    }
+                }
+
+                out[3] = ToByte(texel[3]);
+            }
+        });
+    }
+
+    // Up to 3 source texels along one axis for each destination texel
+    struct BoxTaps {
+        unsigned int index[3];
+        float weight[3];
+    };
+
+    /*
+        Every source texel counts as much as every other: even sizes average
+        pairs, odd sizes (2n + 1 to n) spread 3 texels over each destination
+        texel with weights (n - x, n, x + 1) / (2n + 1), so the last row and
+        column are not dropped.
+    */
+    std::vector<BoxTaps> MakeBoxTaps(unsigned int sourceSize, unsigned int destinationSize)
+    {
+        std::vector<BoxTaps> taps(destinationSize);
+
+        for (unsigned int x = 0; x < destinationSize; x++)
+        {
+            BoxTaps& tap = taps[x];
+
+            if (sourceSize == 1)
+            {
+                tap = { { 0, 0, 0 }, { 1.0f, 0.0f, 0.0f } };
+            }
+            else if (sourceSize % 2 == 0)
+            {
+                tap = { { 2 * x, 2 * x + 1, 2 * x + 1 }, { 0.5f, 0.5f, 0.0f } };
+            }
+            else
+            {
+                float n = (float) destinationSize;
+                float scale = 1.0f / sourceSize;
+                tap = { { 2 * x, 2 * x + 1, 2 * x + 2 }, { (n - x) * scale, n * scale, (x + 1) * scale } };
+            }
+        }
+
+        return taps;
+    }
+
+    void DownsampleBoxOdd(const SourceImage& source, ThreadPool* threadPool, FloatImage& destination)
+    {
+        std::vector<BoxTaps> columns = MakeBoxTaps(source.width, destination.width);
+        std::vector<BoxTaps> rows = MakeBoxTaps(source.height, destination.height);
+
+        ForRows(threadPool, destination.height, destination.width, [&](unsigned int begin, unsigned int end) {
+            std::vector<float> scratch[3];
+
+            for (unsigned int y = begin; y < end; y++)
+            {
+                const BoxTaps& rowTaps = rows[y];
+                const float* row[3];
+
+                for (int tap = 0; tap < 3; tap++)
+                {
+                    row[tap] = rowTaps.weight[tap] > 0.0f ? source.GetRow(rowTaps.index[tap], scratch[tap]) : nullptr;
+                }
+
+                float* out = &destination.texels[(size_t) y * destination.width * 4];
+
+                for (unsigned int x = 0; x < destination.width; x++)
+                {
+                    const BoxTaps& columnTaps = columns[x];
+#ifdef MIPGENERATOR_SIMD
+                    __m128 sum = _mm_setzero_ps();
+
+                    for (int ty = 0; ty < 3; ty++)
+                    {
+                        for (int tx = 0; tx < 3 && row[ty] != nullptr; tx++)
+                        {
+                            __m128 weight = _mm_set1_ps(rowTaps.weight[ty] * columnTaps.weight[tx]);
+                            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(row[ty] + columnTaps.index[tx] * 4), weight));
+                        }
+                    }
+
+                    _mm_storeu_ps(out + x * 4, sum);
+#else
+                    for (int channel = 0; channel < 4; channel++)
+                    {
+                        float sum = 0.0f;
+
+                        for (int ty = 0; ty < 3; ty++)
+                        {
+                            for (int tx = 0; tx < 3 && row[ty] != nullptr; tx++)
+                            {
+                                sum += row[ty][columnTaps.index[tx] * 4 + channel]
+                                       * rowTaps.weight[ty] * columnTaps.weight[tx];
+                            }
+                        }
+
+                        out[x * 4 + channel] = sum;
+                    }
+#endif
+                }
+            }
+        });
+    }
+
+    void DownsampleBox(const SourceImage& source, ThreadPool* threadPool, FloatImage& destination)
+    {
+        // Odd sizes take the 3 tap path
+        if (source.width % 2 != 0 || source.height % 2 != 0)
+        {
+            DownsampleBoxOdd(source, threadPool, destination);
+            return;
+        }
+
+        ForRows(threadPool, destination.height, destination.width, [&](unsigned int begin, unsigned int end) {
+            std::vector<float> scratch0;
+            std::vector<float> scratch1;
+
+            for (unsigned int y = begin; y < end; y++)
+            {
+                const float* row0 = source.GetRow(2 * y, scratch0);
+                const float* row1 = source.GetRow(2 * y + 1, scratch1);
+                float* out = &destination.texels[(size_t) y * destination.width * 4];
+
+                for (unsigned int x = 0; x < destination.width; x++)
+                {
+                    unsigned int x0 = 2 * x * 4;
+                    unsigned int x1 = x0 + 4;
+#ifdef MIPGENERATOR_SIMD
+                    __m128 sum = _mm_add_ps(_mm_add_ps(_mm_loadu_ps(row0 + x0), _mm_loadu_ps(row0 + x1)),
+                                            _mm_add_ps(_mm_loadu_ps(row1 + x0), _mm_loadu_ps(row1 + x1)));
+                    _mm_storeu_ps(out + x * 4, _mm_mul_ps(sum, _mm_set1_ps(0.25f)));
+#else
+                    for (int channel = 0; channel < 4; channel++)
+                    {
+                        out[x * 4 + channel] = 0.25f * (row0[x0 + channel] + row0[x1 + channel]
+                                                        + row1[x0 + channel] + row1[x1 + channel]);
+                    }
+#endif
+                }
+            }
+        });
+    }
+
+    // One destination texel from KAISER_TAPS source texels at the given float offsets
+    inline void FilterTaps(const float* source, const int* offsets, const float* weights, float* out)
+    {
+#ifdef MIPGENERATOR_SIMD
+        __m128 sum = _mm_setzero_ps();
+
+        for (int tap = 0; tap < KAISER_TAPS; tap++)
+        {
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(source + offsets[tap]), _mm_set1_ps(weights[tap])));
+        }
+
+        _mm_storeu_ps(out, sum);
+#else
+        for (int channel = 0; channel < 4; channel++)
+        {
+            float sum = 0.0f;
+
+            for (int tap = 0; tap < KAISER_TAPS; tap++)
+            {
+                sum += source[offsets[tap] + channel] * weights[tap];
+            }
+
+            out[channel] = sum;
+        }
+#endif
+    }
+
+    /*
+        Separable: halve the width into 'temporary', then the height. Taps
+        outside the image repeat the edge texel.
+    */
+    void DownsampleKaiser(const SourceImage& source, ThreadPool* threadPool, FloatImage& temporary,
+                          FloatImage& destination)
+    {
+        float weights[KAISER_TAPS];
+        MakeKaiserWeights(weights);
+
+        int interior[KAISER_TAPS];
+
+        for (int tap = 0; tap < KAISER_TAPS; tap++)
+        {
+            interior[tap] = tap * 4;
+        }
+
+        temporary.width = destination.width;
+        temporary.height = source.height;
+        temporary.texels.resize((size_t) temporary.width * temporary.height * 4);
+
+        ForRows(threadPool, temporary.height, temporary.width, [&](unsigned int begin, unsigned int end) {
+            int offsets[KAISER_TAPS];
+            std::vector<float> scratch;
+
+            for (unsigned int y = begin; y < end; y++)
+            {
+                const float* row = source.GetRow(y, scratch);
+                float* out = &temporary.texels[(size_t) y * temporary.width * 4];
+
+                for (unsigned int x = 0; x < temporary.width; x++)
+                {
+                    int first = (int) (2 * x) - KAISER_TAPS / 2 + 1;
+
+                    // Away from the edges the taps are just the next texels
+                    if (first >= 0 && first + KAISER_TAPS <= (int) source.width)
+                    {
+                        FilterTaps(row + first * 4, interior, weights, out + x * 4);
+                        continue;
+                    }
+
+                    for (int tap = 0; tap < KAISER_TAPS; tap++)
+                    {
+                        offsets[tap] = std::min(std::max(first + tap, 0), (int) source.width - 1) * 4;
+                    }
+
+                    FilterTaps(row, offsets, weights, out + x * 4);
+                }
+            }
+        });
+
+        ForRows(threadPool, destination.height, destination.width, [&](unsigned int begin, unsigned int end) {
+            int offsets[KAISER_TAPS];
+            size_t stride = (size_t) temporary.width * 4;
+
+            for (unsigned int y = begin; y < end; y++)
+            {
+                for (int tap = 0; tap < KAISER_TAPS; tap++)
+                {
+                    int row = (int) (2 * y) + tap - KAISER_TAPS / 2 + 1;
+                    offsets[tap] = std::min(std::max(row, 0), (int) temporary.height - 1) * (int) stride;
+                }
+
+                float* out = &destination.texels[(size_t) y * destination.width * 4];
+
+                for (unsigned int x = 0; x < destination.width; x++)
+                {
+                    FilterTaps(&temporary.texels[x * 4], offsets, weights, out + x * 4);
+                }
+            }
+        });
+    }
+}
+
+void GenerateMips(const unsigned char* rgba, unsigned int width, unsigned int height,
+                  const MipOptions& options, ThreadPool* threadPool, TextureData& texture)
+{
+    unsigned int levelCount = GetFullMipCount(width, height);
+
+    if (options.levelCount > 0)
+    {
+        levelCount = std::min(levelCount, options.levelCount);
+    }
+
+    texture.format = options.srgb ? TEXTURE_FORMAT_SRGB8_ALPHA8 : TEXTURE_FORMAT_RGBA8;
+    texture.levels.resize(levelCount);
+
+    TextureImage& first = texture.levels[0];
+    first.width = width;
+    first.height = height;
+    first.data.assign(rgba, rgba + (size_t) width * height * 4);
+
+    if (levelCount == 1)
+    {
+        return;
+    }
+
+    float decode[1024];
+    MakeDecodeTable(options, decode);
+
+    // Level 1 reads the input bytes, every level after that the floats of
+    // the level before
+    SourceImage source;
+    source.width = width;
+    source.height = height;
+    source.texels = nullptr;
+    source.bytes = rgba;
+    source.decode = decode;
+
+    FloatImage current;
+    FloatImage next;
+    FloatImage temporary;
+
+    for (unsigned int level = 1; level < levelCount; level++)
+    {
+        next.width = std::max(source.width / 2, 1u);
+        next.height = std::max(source.height / 2, 1u);
+        next.texels.resize((size_t) next.width * next.height * 4);
+
+        if (options.filter == MIP_FILTER_KAISER)
+        {
+            DownsampleKaiser(source, threadPool, temporary, next);
+        }
+        else
+        {
+            DownsampleBox(source, threadPool, next);
+        }
+
+        Encode(next, options, threadPool, texture.levels[level]);
+        std::swap(current, next);
+        source = MakeSource(current);
+    }
+}
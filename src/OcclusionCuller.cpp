@@ -0,0 +1,409 @@
+#include "OcclusionCuller.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+// SSE2 is always there on x86-64, anything else takes the scalar path
+#if defined(__SSE2__) || defined(_M_X64)
+#define OCCLUSION_SIMD 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+    // Triangles and boxes reaching behind this w are not clipped: triangles
+    // are dropped (fewer occluders is always safe) and boxes count as visible
+    const float NEAR_W = 1e-5f;
+
+    // Rows per ParallelFor chunk at the least
+    const unsigned int MIN_ROWS_PER_JOB = 8;
+
+    double MillisecondsSince(std::chrono::high_resolution_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+}
+
+OcclusionCuller::OcclusionCuller(unsigned int width, unsigned int height, ThreadPool* threadPool)
+{
+    mWidth = (std::max(width, 4u) + 3) & ~3u;
+    mHeight = std::max(height, 1u);
+    mThreadPool = threadPool;
+    mViewProjection = glm::mat4(1.0f);
+
+    // Every level keeps the farthest depth of the 2x2 texels below it
+    unsigned int levelWidth = mWidth;
+    unsigned int levelHeight = mHeight;
+
+    while (true)
+    {
+        mLevelWidths.push_back(levelWidth);
+        mLevelHeights.push_back(levelHeight);
+        mLevels.push_back(std::vector<float>(levelWidth * levelHeight, 1.0f));
+
+        if (levelWidth == 1 && levelHeight == 1)
+        {
+            break;
+        }
+
+        levelWidth = std::max(1u, (levelWidth + 1) / 2);
+        levelHeight = std::max(1u, (levelHeight + 1) / 2);
+    }
+}
+
+void OcclusionCuller::BeginFrame(const glm::mat4& viewProjection)
+{
+    mViewProjection = viewProjection;
+    mOccluders.clear();
+    mStats = OcclusionStats();
+}
+
+void OcclusionCuller::AddOccluder(const Mesh3D* mesh, const glm::mat4& model)
+{
+    Occluder occluder;
+    occluder.mesh = mesh;
+    occluder.model = model;
+    mOccluders.push_back(occluder);
+}
+
+void OcclusionCuller::RasterizeOccluders()
+{
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+    std::fill(mLevels[0].begin(), mLevels[0].end(), 1.0f);
+
+    SetupTriangles();
+
+    if (mThreadPool != nullptr && !mTriangles.empty())
+    {
+        unsigned int jobs = mThreadPool->GetWorkerCount() + 1;
+        unsigned int rowsPerJob = std::max(MIN_ROWS_PER_JOB, (mHeight + jobs - 1) / jobs);
+
+        mThreadPool->ParallelFor(mHeight, rowsPerJob, [this](unsigned int begin, unsigned int end) {
+            RasterizeRows((int) begin, (int) end);
+        });
+    }
+    else
+    {
+        RasterizeRows(0, (int) mHeight);
+    }
+
+    mStats.rasterMilliseconds += MillisecondsSince(start);
+
+    start = std::chrono::high_resolution_clock::now();
+    BuildPyramid();
+    mStats.pyramidMilliseconds += MillisecondsSince(start);
+}
+
+void OcclusionCuller::SetupTriangles()
+{
+    mTriangles.clear();
+
+    for (size_t o = 0; o < mOccluders.size(); o++)
+    {
+        const Mesh3D* mesh = mOccluders[o].mesh;
+        size_t vertexCount = GetMeshVertexCount(mesh);
+        // The full detail level; a coarser one could poke out of the real surface
+        size_t indexCount = mesh->mLODs.empty() ? mesh->indexBufferData.size() : mesh->mLODs[0].indexCount;
+
+        // Evicted meshes have no CPU data, they simply do not occlude
+        if (vertexCount == 0 || indexCount > mesh->indexBufferData.size())
+        {
+            continue;
+        }
+
+        glm::mat4 transform = mViewProjection * mOccluders[o].model;
+        const GLfloat* positions = mesh->vertexData.data();
+
+        mClipVertices.resize(vertexCount);
+
+        for (size_t i = 0; i < vertexCount; i++)
+        {
+            mClipVertices[i] = transform * glm::vec4(positions[i * 6], positions[i * 6 + 1], positions[i * 6 + 2], 1.0f);
+        }
+
+        mStats.occluders++;
+        mStats.occluderTriangles += indexCount / 3;
+
+        const GLuint* indices = mesh->indexBufferData.data();
+
+        for (size_t i = 0; i + 2 < indexCount; i += 3)
+        {
+            const glm::vec4& c0 = mClipVertices[indices[i]];
+            const glm::vec4& c1 = mClipVertices[indices[i + 1]];
+            const glm::vec4& c2 = mClipVertices[indices[i + 2]];
+
+            if (c0.w < NEAR_W || c1.w < NEAR_W || c2.w < NEAR_W)
+            {
+                continue;
+            }
+
+            // Viewport transform
+            glm::vec3 v[3];
+            const glm::vec4* clip[3] = { &c0, &c1, &c2 };
+
+            for (int corner = 0; corner < 3; corner++)
+            {
+                float inverseW = 1.0f / clip[corner]->w;
+                v[corner] = glm::vec3((clip[corner]->x * inverseW * 0.5f + 0.5f) * mWidth,
+                                      (clip[corner]->y * inverseW * 0.5f + 0.5f) * mHeight,
+                                      clip[corner]->z * inverseW * 0.5f + 0.5f);
+            }
+
+            float area = (v[1].x - v[0].x) * (v[2].y - v[0].y) - (v[1].y - v[0].y) * (v[2].x - v[0].x);
+
+            // Both sides occlude, so just make every triangle counter-clockwise
+            if (area < 0.0f)
+            {
+                std::swap(v[1], v[2]);
+                area = -area;
+            }
+
+            if (area < 1e-8f)
+            {
+                continue;
+            }
+
+            ScreenTriangle triangle;
+            triangle.minX = std::max(0, (int) std::floor(std::min(v[0].x, std::min(v[1].x, v[2].x))));
+            triangle.minY = std::max(0, (int) std::floor(std::min(v[0].y, std::min(v[1].y, v[2].y))));
+            triangle.maxX = std::min((int) mWidth - 1, (int) std::ceil(std::max(v[0].x, std::max(v[1].x, v[2].x))));
+            triangle.maxY = std::min((int) mHeight - 1, (int) std::ceil(std::max(v[0].y, std::max(v[1].y, v[2].y))));
+
+            if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY)
+            {
+                continue;
+            }
+
+            // Edge i runs from v[i] to v[i + 1], the inside is where all three are >= 0
+            for (int edge = 0; edge < 3; edge++)
+            {
+                const glm::vec3& from = v[edge];
+                const glm::vec3& to = v[(edge + 1) % 3];
+
+                triangle.edgeA[edge] = from.y - to.y;
+                triangle.edgeB[edge] = to.x - from.x;
+                triangle.edgeC[edge] = -(triangle.edgeA[edge] * from.x + triangle.edgeB[edge] * from.y);
+            }
+
+            // z / w is linear in screen space
+            glm::vec2 d1(v[1].x - v[0].x, v[1].y - v[0].y);
+            glm::vec2 d2(v[2].x - v[0].x, v[2].y - v[0].y);
+            float z1 = v[1].z - v[0].z;
+            float z2 = v[2].z - v[0].z;
+
+            triangle.depthX = (z1 * d2.y - z2 * d1.y) / area;
+            triangle.depthY = (z2 * d1.x - z1 * d2.x) / area;
+            triangle.depthC = v[0].z - triangle.depthX * v[0].x - triangle.depthY * v[0].y;
+
+            mTriangles.push_back(triangle);
+        }
+    }
+}
+
+void OcclusionCuller::RasterizeRows(int firstRow, int endRow)
+{
+    float* depth = mLevels[0].data();
+
+    for (size_t t = 0; t < mTriangles.size(); t++)
+    {
+        const ScreenTriangle& triangle = mTriangles[t];
+        int rowBegin = std::max(triangle.minY, firstRow);
+        int rowEnd = std::min(triangle.maxY + 1, endRow);
+
+        for (int y = rowBegin; y < rowEnd; y++)
+        {
+            float centerY = y + 0.5f;
+            float* row = depth + y * mWidth;
+
+            // Everything that does not depend on x
+            float rowEdge[3];
+
+            for (int edge = 0; edge < 3; edge++)
+            {
+                rowEdge[edge] = triangle.edgeB[edge] * centerY + triangle.edgeC[edge];
+            }
+
+            float rowDepth = triangle.depthY * centerY + triangle.depthC;
+
+#ifdef OCCLUSION_SIMD
+            __m128 edgeA0 = _mm_set1_ps(triangle.edgeA[0]);
+            __m128 edgeA1 = _mm_set1_ps(triangle.edgeA[1]);
+            __m128 edgeA2 = _mm_set1_ps(triangle.edgeA[2]);
+            __m128 rowEdge0 = _mm_set1_ps(rowEdge[0]);
+            __m128 rowEdge1 = _mm_set1_ps(rowEdge[1]);
+            __m128 rowEdge2 = _mm_set1_ps(rowEdge[2]);
+            __m128 depthX = _mm_set1_ps(triangle.depthX);
+            __m128 depthRow = _mm_set1_ps(rowDepth);
+            __m128 zero = _mm_setzero_ps();
+            __m128 one = _mm_set1_ps(1.0f);
+            __m128 laneOffsets = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+
+            // The rows are a multiple of 4 wide, so blocks never run off the end
+            for (int x = triangle.minX & ~3; x <= triangle.maxX; x += 4)
+            {
+                __m128 centerX = _mm_add_ps(_mm_set1_ps((float) x), laneOffsets);
+
+                __m128 e0 = _mm_add_ps(_mm_mul_ps(edgeA0, centerX), rowEdge0);
+                __m128 e1 = _mm_add_ps(_mm_mul_ps(edgeA1, centerX), rowEdge1);
+                __m128 e2 = _mm_add_ps(_mm_mul_ps(edgeA2, centerX), rowEdge2);
+
+                __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)),
+                                           _mm_cmpge_ps(e2, zero));
+
+                if (_mm_movemask_ps(inside) == 0)
+                {
+                    continue;
+                }
+
+                __m128 z = _mm_min_ps(_mm_max_ps(_mm_add_ps(_mm_mul_ps(depthX, centerX), depthRow), zero), one);
+                __m128 current = _mm_loadu_ps(row + x);
+                __m128 nearest = _mm_min_ps(current, z);
+
+                _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, current)));
+            }
+#else
+            for (int x = triangle.minX; x <= triangle.maxX; x++)
+            {
+                float centerX = x + 0.5f;
+
+                if (triangle.edgeA[0] * centerX + rowEdge[0] >= 0.0f
+                    && triangle.edgeA[1] * centerX + rowEdge[1] >= 0.0f
+                    && triangle.edgeA[2] * centerX + rowEdge[2] >= 0.0f)
+                {
+                    float z = std::min(std::max(triangle.depthX * centerX + rowDepth, 0.0f), 1.0f);
+                    row[x] = std::min(row[x], z);
+                }
+            }
+#endif
+        }
+    }
+}
+
+void OcclusionCuller::BuildPyramid()
+{
+    for (size_t level = 1; level < mLevels.size(); level++)
+    {
+        const std::vector<float>& below = mLevels[level - 1];
+        std::vector<float>& current = mLevels[level];
+        unsigned int belowWidth = mLevelWidths[level - 1];
+        unsigned int belowHeight = mLevelHeights[level - 1];
+
+        for (unsigned int y = 0; y < mLevelHeights[level]; y++)
+        {
+            // Odd sizes: the last texel also covers the leftover row / column
+            unsigned int y0 = y * 2;
+            unsigned int y1 = std::min(y0 + 1, belowHeight - 1);
+
+            for (unsigned int x = 0; x < mLevelWidths[level]; x++)
+            {
+                unsigned int x0 = x * 2;
+                unsigned int x1 = std::min(x0 + 1, belowWidth - 1);
+
+                current[y * mLevelWidths[level] + x] = std::max(
+                    std::max(below[y0 * belowWidth + x0], below[y0 * belowWidth + x1]),
+                    std::max(below[y1 * belowWidth + x0], below[y1 * belowWidth + x1]));
+            }
+        }
+    }
+}
+
+bool OcclusionCuller::IsVisible(const glm::mat4& model, glm::vec3 boundsMin, glm::vec3 boundsMax)
+{
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+    mStats.tested++;
+
+    glm::mat4 transform = mViewProjection * model;
+    glm::vec3 screenMin(1e30f);
+    glm::vec3 screenMax(-1e30f);
+
+    for (int corner = 0; corner < 8; corner++)
+    {
+        glm::vec4 position((corner & 1) ? boundsMax.x : boundsMin.x,
+                           (corner & 2) ? boundsMax.y : boundsMin.y,
+                           (corner & 4) ? boundsMax.z : boundsMin.z,
+                           1.0f);
+        glm::vec4 clip = transform * position;
+
+        // Reaches behind the eye, let it through
+        if (clip.w < NEAR_W)
+        {
+            mStats.testMilliseconds += MillisecondsSince(start);
+            return true;
+        }
+
+        glm::vec3 ndc = glm::vec3(clip) / clip.w;
+        screenMin = glm::min(screenMin, ndc);
+        screenMax = glm::max(screenMax, ndc);
+    }
+
+    // Off screen boxes are the frustum culling's business
+    if (screenMax.x < -1.0f || screenMin.x > 1.0f || screenMax.y < -1.0f || screenMin.y > 1.0f)
+    {
+        mStats.testMilliseconds += MillisecondsSince(start);
+        return true;
+    }
+
+    int x0 = std::max(0, (int) std::floor((screenMin.x * 0.5f + 0.5f) * mWidth));
+    int y0 = std::max(0, (int) std::floor((screenMin.y * 0.5f + 0.5f) * mHeight));
+    int x1 = std::min((int) mWidth - 1, (int) std::floor((screenMax.x * 0.5f + 0.5f) * mWidth));
+    int y1 = std::min((int) mHeight - 1, (int) std::floor((screenMax.y * 0.5f + 0.5f) * mHeight));
+    float nearestDepth = screenMin.z * 0.5f + 0.5f;
+
+    // The level where the box covers at most 2x2 texels
+    unsigned int level = 0;
+
+    while (level + 1 < mLevels.size() && ((x1 >> level) - (x0 >> level) > 1 || (y1 >> level) - (y0 >> level) > 1))
+    {
+        level++;
+    }
+
+    const std::vector<float>& depth = mLevels[level];
+    unsigned int levelWidth = mLevelWidths[level];
+    float farthest = 0.0f;
+
+    for (int y = y0 >> level; y <= (y1 >> level); y++)
+    {
+        for (int x = x0 >> level; x <= (x1 >> level); x++)
+        {
+            farthest = std::max(farthest, depth[y * levelWidth + x]);
+        }
+    }
+
+    bool visible = nearestDepth <= farthest;
+
+    if (!visible)
+    {
+        mStats.occluded++;
+    }
+
+    mStats.testMilliseconds += MillisecondsSince(start);
+
+    return visible;
+}
+
+const OcclusionStats& OcclusionCuller::GetStats() const
+{
+    return mStats;
+}
+
+unsigned int OcclusionCuller::GetLevelCount() const
+{
+    return (unsigned int) mLevels.size();
+}
+
+unsigned int OcclusionCuller::GetLevelWidth(unsigned int level) const
+{
+    return mLevelWidths[level];
+}
+
+unsigned int OcclusionCuller::GetLevelHeight(unsigned int level) const
+{
+    return mLevelHeights[level];
+}
+
+const float* OcclusionCuller::GetLevel(unsigned int level) const
+{
+    return mLevels[level].data();
+}
@@ -0,0 +1,144 @@
+#include "OverdrawMeter.hpp"
+
+#include <iostream>
+
+namespace {
+    // Shaded once (blue) to OVERDRAW_LEVELS times or more (red)
+    const float HEAT[OverdrawMeter::OVERDRAW_LEVELS][3] = {
+        { 0.0f, 0.0f, 0.6f },
+        { 0.0f, 0.4f, 1.0f },
+        { 0.0f, 0.8f, 0.8f },
+        { 0.0f, 0.8f, 0.0f },
+        { 0.6f, 0.9f, 0.0f },
+        { 1.0f, 0.8f, 0.0f },
+        { 1.0f, 0.4f, 0.0f },
+        { 1.0f, 0.0f, 0.0f },
+    };
+}
+
+const unsigned int OverdrawMeter::OVERDRAW_LEVELS;
+
+OverdrawMeter::OverdrawMeter()
+{
+    mProgram = 0;
+    mColorLocation = -1;
+    mVertexArray = 0;
+}
+
+bool OverdrawMeter::Initialize(GLuint program)
+{
+    if (program == 0)
+    {
+        std::cout << "Overdraw view has no shader program" << std::endl;
+        return false;
+    }
+
+    mProgram = program;
+    mColorLocation = glGetUniformLocation(mProgram, "u_Color");
+
+    // The core profile wants a vertex array bound, even without attributes
+    glGenVertexArrays(1, &mVertexArray);
+
+    return true;
+}
+
+bool OverdrawMeter::IsInitialized() const
+{
+    return mProgram != 0;
+}
+
+void OverdrawMeter::BeginCounting()
+{
+    glEnable(GL_STENCIL_TEST);
+    glStencilMask(0xFF);
+    glStencilFunc(GL_ALWAYS, 0, 0xFF);
+    glStencilOp(GL_KEEP, GL_KEEP, GL_INCR);
+}
+
+void OverdrawMeter::EndCounting()
+{
+    glDisable(GL_STENCIL_TEST);
+}
+
+void OverdrawMeter::Measure(int screenWidth, int screenHeight)
+{
+    mStencil.resize((size_t) screenWidth * screenHeight);
+
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, screenWidth, screenHeight, GL_STENCIL_INDEX, GL_UNSIGNED_BYTE, mStencil.data());
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+
+    mStats = ComputeOverdrawStats(mStencil.data(), mStencil.size());
+}
+
+void OverdrawMeter::Draw()
+{
+    if (!IsInitialized())
+    {
+        return;
+    }
+
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_CULL_FACE);
+    glEnable(GL_STENCIL_TEST);
+    glStencilMask(0x00);
+    glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+
+    glUseProgram(mProgram);
+    glBindVertexArray(mVertexArray);
+
+    for (unsigned int level = 1; level <= OVERDRAW_LEVELS; level++)
+    {
+        // The last level takes everything above it too
+        glStencilFunc(level == OVERDRAW_LEVELS ? GL_LEQUAL : GL_EQUAL, (GLint) level, 0xFF);
+        glUniform4f(mColorLocation, HEAT[level - 1][0], HEAT[level - 1][1], HEAT[level - 1][2], 1.0f);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+    }
+
+    glBindVertexArray(0);
+    glUseProgram(0);
+    glStencilMask(0xFF);
+    glDisable(GL_STENCIL_TEST);
+}
+
+const OverdrawStats& OverdrawMeter::GetStats() const
+{
+    return mStats;
+}
+
+void OverdrawMeter::Release()
+{
+    glDeleteVertexArrays(1, &mVertexArray);
+    glDeleteProgram(mProgram);
+
+    mVertexArray = 0;
+    mProgram = 0;
+}
+
+OverdrawStats ComputeOverdrawStats(const unsigned char* counts, size_t pixels)
+{
+    OverdrawStats stats;
+
+    for (size_t i = 0; i < pixels; i++)
+    {
+        unsigned int count = counts[i];
+
+        if (count > 0)
+        {
+            stats.coveredPixels++;
+            stats.shadedFragments += count;
+
+            if (count > stats.maxOverdraw)
+            {
+                stats.maxOverdraw = count;
+            }
+        }
+    }
+
+    if (stats.coveredPixels > 0)
+    {
+        stats.averageOverdraw = (double) stats.shadedFragments / (double) stats.coveredPixels;
+    }
+
+    return stats;
+}
@@ -0,0 +1,421 @@
+#include "PerfHud.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+namespace {
+    // 5x7 glyphs, one byte per row, the leftmost pixel in bit 4.
+    // Lower case letters are drawn as upper case.
+    struct Glyph {
+        char character;
+        unsigned char rows[7];
+    };
+
+    const Glyph FONT[] = {
+        { '0', { 0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E } },
+        { '1', { 0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E } },
+        { '2', { 0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F } },
+        { '3', { 0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E } },
+        { '4', { 0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02 } },
+        { '5', { 0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E } },
+        { '6', { 0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E } },
+        { '7', { 0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08 } },
+        { '8', { 0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E } },
+        { '9', { 0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C } },
+        { 'A', { 0x0E, 0x11, 0x11, 0x11, 0x1F, 0x11, 0x11 } },
+        { 'B', { 0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E } },
+        { 'C', { 0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E } },
+        { 'D', { 0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C } },
+        { 'E', { 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F } },
+        { 'F', { 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10 } },
+        { 'G', { 0x0E, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0F } },
+        { 'H', { 0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11 } },
+        { 'I', { 0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E } },
+        { 'J', { 0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0C } },
+        { 'K', { 0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11 } },
+        { 'L', { 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F } },
+        { 'M', { 0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11 } },
+        { 'N', { 0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11 } },
+        { 'O', { 0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E } },
+        { 'P', { 0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10 } },
+        { 'Q', { 0x0E, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0D } },
+        { 'R', { 0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11 } },
+        { 'S', { 0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E } },
+        { 'T', { 0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04 } },
+        { 'U', { 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E } },
+        { 'V', { 0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04 } },
+        { 'W', { 0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A } },
+        { 'X', { 0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11 } },
+        { 'Y', { 0x11, 0x11, 0x11, 0x0A, 0x04, 0x04, 0x04 } },
+        { 'Z', { 0x1F, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1F } },
+        { '.', { 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C } },
+        { ',', { 0x00, 0x00, 0x00, 0x00, 0x0C, 0x04, 0x08 } },
+        { ':', { 0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x0C, 0x00 } },
+        { '/', { 0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00 } },
+        { '%', { 0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03 } },
+        { '-', { 0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00 } },
+        { '+', { 0x00, 0x04, 0x04, 0x1F, 0x04, 0x04, 0x00 } },
+        { '=', { 0x00, 0x00, 0x1F, 0x00, 0x1F, 0x00, 0x00 } },
+        { '(', { 0x02, 0x04, 0x08, 0x08, 0x08, 0x04, 0x02 } },
+        { ')', { 0x08, 0x04, 0x02, 0x02, 0x02, 0x04, 0x08 } },
+        { '[', { 0x0E, 0x08, 0x08, 0x08, 0x08, 0x08, 0x0E } },
+        { ']', { 0x0E, 0x02, 0x02, 0x02, 0x02, 0x02, 0x0E } },
+        { '<', { 0x02, 0x04, 0x08, 0x10, 0x08, 0x04, 0x02 } },
+        { '>', { 0x08, 0x04, 0x02, 0x01, 0x02, 0x04, 0x08 } },
+        { '_', { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1F } },
+        { '!', { 0x04, 0x04, 0x04, 0x04, 0x04, 0x00, 0x04 } },
+        { '?', { 0x0E, 0x11, 0x01, 0x02, 0x04, 0x00, 0x04 } },
+        { '*', { 0x00, 0x04, 0x15, 0x0E, 0x15, 0x04, 0x00 } },
+        { '#', { 0x0A, 0x0A, 0x1F, 0x0A, 0x1F, 0x0A, 0x0A } },
+        { '\'', { 0x04, 0x04, 0x08, 0x00, 0x00, 0x00, 0x00 } },
+    };
+
+    // The atlas holds printable ASCII (32 - 126) in 6x8 cells, 16 to a row.
+    // Cell 127 is solid, for the background and the graph.
+    const int CELL_WIDTH = 6;
+    const int CELL_HEIGHT = 8;
+    const int ATLAS_COLUMNS = 16;
+    const int ATLAS_ROWS = 6;
+    const int ATLAS_WIDTH = CELL_WIDTH * ATLAS_COLUMNS;
+    const int ATLAS_HEIGHT = CELL_HEIGHT * ATLAS_ROWS;
+    const char SOLID_CELL = 127;
+
+    // Each font pixel becomes SCALE x SCALE screen pixels
+    const float SCALE = 2.0f;
+    const float ADVANCE = CELL_WIDTH * SCALE;
+    const float LINE_HEIGHT = (CELL_HEIGHT + 1) * SCALE;
+    const float MARGIN = 8.0f;
+
+    const size_t HISTORY_LENGTH = 120;
+    const float BAR_WIDTH = 2.0f;
+    const float GRAPH_HEIGHT = 60.0f;
+    // The top of the graph, 30 fps
+    const float GRAPH_MILLISECONDS = 33.3f;
+
+    const unsigned int WHITE = 0xFFFFFFFFu;
+    const unsigned int GREEN = 0xFF40E040u;
+    const unsigned int YELLOW = 0xFF20E0F0u;
+    const unsigned int RED = 0xFF3030F0u;
+    const unsigned int BACKGROUND = 0xB0000000u;
+
+    void CellOrigin(char character, int& x, int& y)
+    {
+        int index = (unsigned char) character - 32;
+        x = (index % ATLAS_COLUMNS) * CELL_WIDTH;
+        y = (index / ATLAS_COLUMNS) * CELL_HEIGHT;
+    }
+
+    void BakeAtlas(std::vector<unsigned char>& texels)
+    {
+        texels.assign(ATLAS_WIDTH * ATLAS_HEIGHT, 0);
+
+        for (size_t glyph = 0; glyph < sizeof(FONT) / sizeof(FONT[0]); glyph++)
+        {
+            int cellX, cellY;
+            CellOrigin(FONT[glyph].character, cellX, cellY);
+
+            for (int row = 0; row < 7; row++)
+            {
+                for (int column = 0; column < 5; column++)
+                {
+                    if (FONT[glyph].rows[row] & (0x10 >> column))
+                    {
+                        texels[(cellY + row) * ATLAS_WIDTH + cellX + column] = 255;
+                    }
+                }
+            }
+        }
+
+        int solidX, solidY;
+        CellOrigin(SOLID_CELL, solidX, solidY);
+
+        for (int row = 0; row < CELL_HEIGHT; row++)
+        {
+            std::fill(texels.begin() + (solidY + row) * ATLAS_WIDTH + solidX,
+                      texels.begin() + (solidY + row) * ATLAS_WIDTH + solidX + CELL_WIDTH, 255);
+        }
+    }
+
+    unsigned int FrameTimeColor(float milliseconds)
+    {
+        return milliseconds < 16.7f ? GREEN : milliseconds < 33.3f ? YELLOW : RED;
+    }
+}
+
+PerfHud::PerfHud()
+{
+    mProgram = 0;
+    mScreenSizeLocation = -1;
+    mAtlas = 0;
+    mVertexArray = 0;
+    mVertexBuffer = 0;
+    mBufferCapacity = 0;
+
+    mFrameHistory.assign(HISTORY_LENGTH, 0.0f);
+    mHistoryNext = 0;
+
+    mCpuMilliseconds = 0.0;
+}
+
+bool PerfHud::Initialize(GLuint program)
+{
+    if (program == 0)
+    {
+        std::cout << "Performance overlay has no shader program" << std::endl;
+        return false;
+    }
+
+    mProgram = program;
+    mScreenSizeLocation = glGetUniformLocation(mProgram, "u_ScreenSize");
+
+    glUseProgram(mProgram);
+    glUniform1i(glGetUniformLocation(mProgram, "u_Atlas"), 0);
+    glUseProgram(0);
+
+    std::vector<unsigned char> texels;
+    BakeAtlas(texels);
+
+    glGenTextures(1, &mAtlas);
+    glBindTexture(GL_TEXTURE_2D, mAtlas);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, ATLAS_WIDTH, ATLAS_HEIGHT, 0, GL_RED, GL_UNSIGNED_BYTE, texels.data());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenVertexArrays(1, &mVertexArray);
+    glBindVertexArray(mVertexArray);
+
+    glGenBuffers(1, &mVertexBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, mVertexBuffer);
+
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(HudVertex), (GLvoid*) offsetof(HudVertex, x));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(HudVertex), (GLvoid*) offsetof(HudVertex, u));
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(HudVertex), (GLvoid*) offsetof(HudVertex, color));
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    return true;
+}
+
+bool PerfHud::IsInitialized() const
+{
+    return mProgram != 0;
+}
+
+void PerfHud::AddFrameTime(double milliseconds)
+{
+    mFrameHistory[mHistoryNext] = (float) milliseconds;
+    mHistoryNext = (mHistoryNext + 1) % mFrameHistory.size();
+}
+
+void PerfHud::Draw(const HudStats& stats, int screenWidth, int screenHeight)
+{
+    if (!IsInitialized())
+    {
+        return;
+    }
+
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+    mGpuTimer.Begin();
+
+    BuildVertices(stats);
+
+    GLsizeiptr bytes = (GLsizeiptr) (mVertices.size() * sizeof(HudVertex));
+
+    glBindVertexArray(mVertexArray);
+    glBindBuffer(GL_ARRAY_BUFFER, mVertexBuffer);
+
+    // Orphan the old contents, the GPU may still be reading last frame's
+    if (bytes > mBufferCapacity)
+    {
+        mBufferCapacity = bytes * 2;
+    }
+
+    glBufferData(GL_ARRAY_BUFFER, mBufferCapacity, nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, mVertices.data());
+
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_CULL_FACE);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    glUseProgram(mProgram);
+    glUniform2f(mScreenSizeLocation, (float) screenWidth, (float) screenHeight);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, mAtlas);
+
+    glDrawArrays(GL_TRIANGLES, 0, (GLsizei) mVertices.size());
+
+    glDisable(GL_BLEND);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glUseProgram(0);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    mGpuTimer.End();
+    mCpuMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+void PerfHud::Release()
+{
+    glDeleteTextures(1, &mAtlas);
+    glDeleteBuffers(1, &mVertexBuffer);
+    glDeleteVertexArrays(1, &mVertexArray);
+    glDeleteProgram(mProgram);
+    mGpuTimer.Release();
+
+    mAtlas = 0;
+    mVertexBuffer = 0;
+    mVertexArray = 0;
+    mProgram = 0;
+    mBufferCapacity = 0;
+}
+
+void PerfHud::BuildVertices(const HudStats& stats)
+{
+    mVertices.clear();
+
+    // Average over the history, a single frame's FPS is too jumpy to read
+    float sum = 0.0f;
+    float worst = 0.0f;
+
+    for (size_t i = 0; i < mFrameHistory.size(); i++)
+    {
+        sum += mFrameHistory[i];
+        worst = std::max(worst, mFrameHistory[i]);
+    }
+
+    float average = sum / mFrameHistory.size();
+
+    const int LINE_COUNT = 6;
+    char lines[LINE_COUNT][64];
+    std::snprintf(lines[0], sizeof(lines[0]), "FPS %.1f  FRAME %.2f MS", average > 0.0f ? 1000.0f / average : 0.0f,
+                  stats.frameMilliseconds);
+    std::snprintf(lines[1], sizeof(lines[1]), "GPU %.2f MS  WORST %.2f MS", stats.gpuMilliseconds, worst);
+    std::snprintf(lines[2], sizeof(lines[2]), "DRAWS %llu  TRIS %llu", stats.drawCalls, stats.triangles);
+    std::snprintf(lines[3], sizeof(lines[3]), "MESH %.1f / %.0f  TEX %.1f / %.0f MB",
+                  stats.residentMegabytes, stats.budgetMegabytes, stats.textureMegabytes, stats.textureBudgetMegabytes);
+    std::snprintf(lines[4], sizeof(lines[4]), "INPUT %.2f MS  EVENT %.0f MS",
+                  stats.inputLatency.sampleToSubmitMilliseconds, stats.inputLatency.eventToSubmitMilliseconds);
+    std::snprintf(lines[5], sizeof(lines[5]), "HUD CPU %.3f MS  GPU %.3f MS", mCpuMilliseconds,
+                  mGpuTimer.GetMilliseconds());
+
+    size_t longest = 0;
+
+    for (int line = 0; line < LINE_COUNT; line++)
+    {
+        longest = std::max(longest, std::strlen(lines[line]));
+    }
+
+    float graphWidth = HISTORY_LENGTH * BAR_WIDTH;
+    float width = std::max(longest * ADVANCE, graphWidth) + 2.0f * MARGIN;
+    float graphTop = MARGIN + LINE_COUNT * LINE_HEIGHT + MARGIN;
+    float height = graphTop + GRAPH_HEIGHT + MARGIN;
+
+    AddSolidQuad(0.0f, 0.0f, width, height, BACKGROUND);
+
+    for (int line = 0; line < LINE_COUNT; line++)
+    {
+        AddText(MARGIN, MARGIN + line * LINE_HEIGHT, lines[line], WHITE);
+    }
+
+    // Oldest frame on the left
+    float graphBottom = graphTop + GRAPH_HEIGHT;
+
+    for (size_t i = 0; i < mFrameHistory.size(); i++)
+    {
+        float milliseconds = mFrameHistory[(mHistoryNext + i) % mFrameHistory.size()];
+        float barHeight = std::min(milliseconds / GRAPH_MILLISECONDS, 1.0f) * GRAPH_HEIGHT;
+        float x = MARGIN + i * BAR_WIDTH;
+
+        AddSolidQuad(x, graphBottom - barHeight, x + BAR_WIDTH, graphBottom, FrameTimeColor(milliseconds));
+    }
+
+    // 60 fps line
+    float target = graphBottom - 16.7f / GRAPH_MILLISECONDS * GRAPH_HEIGHT;
+    AddSolidQuad(MARGIN, target, MARGIN + graphWidth, target + 1.0f, WHITE);
+}
+
+void PerfHud::AddQuad(float x0, float y0, float x1, float y1, float u0, float v0, float u1, float v1,
+                      unsigned int color)
+{
+    HudVertex corners[4];
+    float xs[4] = { x0, x1, x1, x0 };
+    float ys[4] = { y0, y0, y1, y1 };
+    float us[4] = { u0, u1, u1, u0 };
+    float vs[4] = { v0, v0, v1, v1 };
+
+    for (int i = 0; i < 4; i++)
+    {
+        corners[i].x = xs[i];
+        corners[i].y = ys[i];
+        corners[i].u = us[i];
+        corners[i].v = vs[i];
+        corners[i].color[0] = (unsigned char) color;
+        corners[i].color[1] = (unsigned char) (color >> 8);
+        corners[i].color[2] = (unsigned char) (color >> 16);
+        corners[i].color[3] = (unsigned char) (color >> 24);
+    }
+
+    mVertices.push_back(corners[0]);
+    mVertices.push_back(corners[1]);
+    mVertices.push_back(corners[2]);
+    mVertices.push_back(corners[0]);
+    mVertices.push_back(corners[2]);
+    mVertices.push_back(corners[3]);
+}
+
+void PerfHud::AddSolidQuad(float x0, float y0, float x1, float y1, unsigned int color)
+{
+    int cellX, cellY;
+    CellOrigin(SOLID_CELL, cellX, cellY);
+
+    // The middle of the solid cell, away from any filtering at its edges
+    float u = (cellX + CELL_WIDTH * 0.5f) / ATLAS_WIDTH;
+    float v = (cellY + CELL_HEIGHT * 0.5f) / ATLAS_HEIGHT;
+
+    AddQuad(x0, y0, x1, y1, u, v, u, v, color);
+}
+
+void PerfHud::AddText(float x, float y, const char* text, unsigned int color)
+{
+    for (const char* character = text; *character != '\0'; character++, x += ADVANCE)
+    {
+        char printable = *character;
+
+        if (printable >= 'a' && printable <= 'z')
+        {
+            printable = (char) (printable - 'a' + 'A');
+        }
+
+        if (printable == ' ')
+        {
+            continue;
+        }
+
+        if (printable < 32 || printable >= SOLID_CELL)
+        {
+            printable = '?';
+        }
+
+        int cellX, cellY;
+        CellOrigin(printable, cellX, cellY);
+
+        AddQuad(x, y, x + CELL_WIDTH * SCALE, y + CELL_HEIGHT * SCALE,
+                (float) cellX / ATLAS_WIDTH, (float) cellY / ATLAS_HEIGHT,
+                (float) (cellX + CELL_WIDTH) / ATLAS_WIDTH, (float) (cellY + CELL_HEIGHT) / ATLAS_HEIGHT,
+                color);
+    }
+}
@@ -0,0 +1,308 @@
+#include "PostProcessor.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+
+namespace {
+    const char* PASS_NAMES[POST_PASS_COUNT] = { "bloom_downsample", "bloom_upsample", "tonemap", "fxaa" };
+
+    // Bloom levels smaller than this are not worth a pass
+    const GLsizei MIN_BLOOM_SIZE = 4;
+}
+
+PostProcessor::PostProcessor()
+{
+    mDownsampleProgram = 0;
+    mUpsampleProgram = 0;
+    mTonemapProgram = 0;
+    mFxaaProgram = 0;
+    mVertexArray = 0;
+    mDownsampleTexelSizeLocation = -1;
+    mPrefilterLocation = -1;
+    mThresholdLocation = -1;
+    mUpsampleTexelSizeLocation = -1;
+    mBloomStrengthLocation = -1;
+    mExposureLocation = -1;
+    mFxaaTexelSizeLocation = -1;
+
+    for (unsigned int i = 0; i < POST_PASS_COUNT; i++)
+    {
+        mRan[i] = false;
+    }
+}
+
+bool PostProcessor::Initialize(GLuint downsample, GLuint upsample, GLuint tonemap, GLuint fxaa)
+{
+    if (downsample == 0 || upsample == 0 || tonemap == 0 || fxaa == 0)
+    {
+        std::cout << "Post-processing is missing a shader program" << std::endl;
+        return false;
+    }
+
+    mDownsampleProgram = downsample;
+    mUpsampleProgram = upsample;
+    mTonemapProgram = tonemap;
+    mFxaaProgram = fxaa;
+
+    mDownsampleTexelSizeLocation = glGetUniformLocation(mDownsampleProgram, "u_TexelSize");
+    mPrefilterLocation = glGetUniformLocation(mDownsampleProgram, "u_Prefilter");
+    mThresholdLocation = glGetUniformLocation(mDownsampleProgram, "u_Threshold");
+    mUpsampleTexelSizeLocation = glGetUniformLocation(mUpsampleProgram, "u_TexelSize");
+    mBloomStrengthLocation = glGetUniformLocation(mTonemapProgram, "u_BloomStrength");
+    mExposureLocation = glGetUniformLocation(mTonemapProgram, "u_Exposure");
+    mFxaaTexelSizeLocation = glGetUniformLocation(mFxaaProgram, "u_TexelSize");
+
+    // Sources on unit 0, the bloom on unit 1
+    GLuint programs[4] = { mDownsampleProgram, mUpsampleProgram, mFxaaProgram, mTonemapProgram };
+
+    for (int i = 0; i < 4; i++)
+    {
+        glUseProgram(programs[i]);
+        glUniform1i(glGetUniformLocation(programs[i], "u_Source"), 0);
+    }
+
+    glUniform1i(glGetUniformLocation(mTonemapProgram, "u_Scene"), 0);
+    glUniform1i(glGetUniformLocation(mTonemapProgram, "u_Bloom"), 1);
+    glUseProgram(0);
+
+    // The core profile wants a vertex array bound, even without attributes
+    glGenVertexArrays(1, &mVertexArray);
+
+    return true;
+}
+
+bool PostProcessor::IsInitialized() const
+{
+    return mDownsampleProgram != 0;
+}
+
+PostSettings& PostProcessor::GetSettings()
+{
+    return mSettings;
+}
+
+void PostProcessor::BeginFullScreen(GLuint program)
+{
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_CULL_FACE);
+    glDisable(GL_STENCIL_TEST);
+    glDisable(GL_BLEND);
+    glBindVertexArray(mVertexArray);
+    glUseProgram(program);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+void PostProcessor::EndFullScreen()
+{
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindVertexArray(0);
+    glUseProgram(0);
+    glEnable(GL_DEPTH_TEST);
+}
+
+void PostProcessor::AddPasses(RenderGraph& graph, RenderResource sceneColor)
+{
+    for (unsigned int i = 0; i < POST_PASS_COUNT; i++)
+    {
+        mRan[i] = false;
+    }
+
+    GLsizei width = graph.GetWidth(sceneColor);
+    GLsizei height = graph.GetHeight(sceneColor);
+
+    /* Bloom: the bright parts, halved level by level */
+    RenderResource bloom[BLOOM_LEVELS];
+    unsigned int levels = 0;
+
+    if (mSettings.bloom && mSettings.bloomStrength > 0.0f)
+    {
+        GLsizei levelWidth = mSettings.halfResolutionBloom ? width / 2 : width;
+        GLsizei levelHeight = mSettings.halfResolutionBloom ? height / 2 : height;
+
+        while (levels < BLOOM_LEVELS && std::min(levelWidth, levelHeight) >= MIN_BLOOM_SIZE)
+        {
+            RenderTargetDesc desc;
+            desc.width = levelWidth;
+            desc.height = levelHeight;
+            desc.format = GL_R11F_G11F_B10F;
+
+            bloom[levels] = graph.CreateTarget("bloom_" + std::to_string(levels), desc);
+            levels++;
+            levelWidth /= 2;
+            levelHeight /= 2;
+        }
+    }
+
+    for (unsigned int level = 0; level < levels; level++)
+    {
+        RenderResource source = level == 0 ? sceneColor : bloom[level - 1];
+        bool last = level == levels - 1;
+
+        unsigned int pass = graph.AddPass("bloom_downsample_" + std::to_string(level),
+            [this, source, level, last](const RenderGraph& graph)
+            {
+                if (level == 0)
+                {
+                    mTimers[POST_PASS_BLOOM_DOWNSAMPLE].Begin();
+                }
+
+                BeginFullScreen(mDownsampleProgram);
+                glUniform1f(mThresholdLocation, mSettings.bloomThreshold);
+                glUniform2f(mDownsampleTexelSizeLocation, 1.0f / graph.GetWidth(source), 1.0f / graph.GetHeight(source));
+                glUniform1i(mPrefilterLocation, level == 0);
+                glBindTexture(GL_TEXTURE_2D, graph.GetTexture(source));
+                glDrawArrays(GL_TRIANGLES, 0, 3);
+
+                if (last)
+                {
+                    mTimers[POST_PASS_BLOOM_DOWNSAMPLE].End();
+                    mRan[POST_PASS_BLOOM_DOWNSAMPLE] = true;
+                }
+            });
+
+        graph.Read(pass, source);
+        graph.WriteColor(pass, bloom[level]);
+    }
+
+    // Level by level from the smallest, each added onto the one above
+    for (unsigned int level = levels - 1; levels > 0 && level > 0; level--)
+    {
+        RenderResource source = bloom[level];
+        bool first = level == levels - 1;
+
+        unsigned int pass = graph.AddPass("bloom_upsample_" + std::to_string(level - 1),
+            [this, source, level, first](const RenderGraph& graph)
+            {
+                if (first)
+                {
+                    mTimers[POST_PASS_BLOOM_UPSAMPLE].Begin();
+                }
+
+                BeginFullScreen(mUpsampleProgram);
+                glEnable(GL_BLEND);
+                glBlendFunc(GL_ONE, GL_ONE);
+                glUniform2f(mUpsampleTexelSizeLocation, 1.0f / graph.GetWidth(source), 1.0f / graph.GetHeight(source));
+                glBindTexture(GL_TEXTURE_2D, graph.GetTexture(source));
+                glDrawArrays(GL_TRIANGLES, 0, 3);
+                glDisable(GL_BLEND);
+
+                if (level == 1)
+                {
+                    mTimers[POST_PASS_BLOOM_UPSAMPLE].End();
+                    mRan[POST_PASS_BLOOM_UPSAMPLE] = true;
+                }
+            });
+
+        // Drawn on top of what the downsample left there
+        graph.Read(pass, source);
+        graph.WriteColor(pass, bloom[level - 1]);
+    }
+
+    /* Tonemap, to the screen or to FXAA's input */
+    bool fxaa = mSettings.fxaa;
+    RenderResource tonemapped = graph.GetScreen();
+
+    if (fxaa)
+    {
+        RenderTargetDesc desc;
+        desc.width = width;
+        desc.height = height;
+        desc.format = GL_RGBA8;
+        tonemapped = graph.CreateTarget("tonemapped", desc);
+    }
+
+    RenderResource bloomTop = levels > 0 ? bloom[0] : NO_RENDER_RESOURCE;
+
+    unsigned int tonemap = graph.AddPass("tonemap",
+        [this, sceneColor, bloomTop, fxaa](const RenderGraph& graph)
+        {
+            mTimers[POST_PASS_TONEMAP].Begin();
+            BeginFullScreen(mTonemapProgram);
+            glUniform1f(mExposureLocation, mSettings.exposure);
+            glUniform1f(mBloomStrengthLocation, bloomTop != NO_RENDER_RESOURCE ? mSettings.bloomStrength : 0.0f);
+            glActiveTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_2D, graph.GetTexture(bloomTop != NO_RENDER_RESOURCE ? bloomTop : sceneColor));
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, graph.GetTexture(sceneColor));
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+            mTimers[POST_PASS_TONEMAP].End();
+            mRan[POST_PASS_TONEMAP] = true;
+
+            if (!fxaa)
+            {
+                EndFullScreen();
+            }
+        });
+
+    graph.Read(tonemap, sceneColor);
+
+    if (bloomTop != NO_RENDER_RESOURCE)
+    {
+        graph.Read(tonemap, bloomTop);
+    }
+
+    graph.WriteColor(tonemap, tonemapped);
+
+    /* FXAA, to the screen */
+    if (fxaa)
+    {
+        unsigned int pass = graph.AddPass("fxaa",
+            [this, tonemapped](const RenderGraph& graph)
+            {
+                mTimers[POST_PASS_FXAA].Begin();
+                BeginFullScreen(mFxaaProgram);
+                glUniform2f(mFxaaTexelSizeLocation, 1.0f / graph.GetWidth(tonemapped), 1.0f / graph.GetHeight(tonemapped));
+                glBindTexture(GL_TEXTURE_2D, graph.GetTexture(tonemapped));
+                glDrawArrays(GL_TRIANGLES, 0, 3);
+                mTimers[POST_PASS_FXAA].End();
+                mRan[POST_PASS_FXAA] = true;
+
+                EndFullScreen();
+            });
+
+        graph.Read(pass, tonemapped);
+        graph.WriteColor(pass, graph.GetScreen());
+    }
+}
+
+double PostProcessor::GetPassMilliseconds(PostPass pass) const
+{
+    return mTimers[pass].GetMilliseconds();
+}
+
+bool PostProcessor::DidPassRun(PostPass pass) const
+{
+    return mRan[pass];
+}
+
+std::string PostProcessor::GetPassName(PostPass pass)
+{
+    return PASS_NAMES[pass];
+}
+
+void PostProcessor::Release()
+{
+    GLuint programs[4] = { mDownsampleProgram, mUpsampleProgram, mTonemapProgram, mFxaaProgram };
+
+    for (int i = 0; i < 4; i++)
+    {
+        glDeleteProgram(programs[i]);
+    }
+
+    glDeleteVertexArrays(1, &mVertexArray);
+
+    for (unsigned int i = 0; i < POST_PASS_COUNT; i++)
+    {
+        mTimers[i].Release();
+    }
+
+    mDownsampleProgram = 0;
+    mUpsampleProgram = 0;
+    mTonemapProgram = 0;
+    mFxaaProgram = 0;
+    mVertexArray = 0;
+}
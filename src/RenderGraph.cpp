@@ -0,0 +1,638 @@
+#include "RenderGraph.hpp"
+
+#include <chrono>
+#include <iostream>
+
+namespace {
+    // How declarations are told apart in the topology
+    enum Declaration {
+        DECLARE_TARGET = 1,
+        DECLARE_IMPORT,
+        DECLARE_PASS,
+        DECLARE_READ,
+        DECLARE_WRITE_COLOR,
+        DECLARE_WRITE_DEPTH,
+        DECLARE_WRITE
+    };
+
+    // The screen is always the first resource
+    const RenderResource SCREEN = 0;
+
+    // Where a pass draws into when it is not one of the graph's framebuffers
+    const int FRAMEBUFFER_SCREEN = -1;
+    const int FRAMEBUFFER_NONE = -2;
+}
+
+RenderGraph::RenderGraph(RenderTargetPool* pool)
+{
+    mPool = pool;
+    mScreenWidth = 0;
+    mScreenHeight = 0;
+    mCompiled = false;
+    mValid = false;
+    mFramebufferCount = 0;
+    mBoundFramebuffer = FRAMEBUFFER_NONE;
+}
+
+void RenderGraph::BeginFrame(GLsizei screenWidth, GLsizei screenHeight)
+{
+    mScreenWidth = screenWidth;
+    mScreenHeight = screenHeight;
+    mResources.clear();
+    mPasses.clear();
+    mTopology.clear();
+
+    Resource screen;
+    screen.name = "screen";
+    screen.kind = RESOURCE_SCREEN;
+    screen.texture = 0;
+    mResources.push_back(screen);
+}
+
+RenderResource RenderGraph::GetScreen() const
+{
+    return SCREEN;
+}
+
+RenderResource RenderGraph::CreateTarget(const std::string& name, const RenderTargetDesc& desc)
+{
+    Resource target;
+    target.name = name;
+    target.kind = RESOURCE_TRANSIENT;
+    target.desc = desc;
+    target.texture = 0;
+    mResources.push_back(target);
+
+    Declare(DECLARE_TARGET, (unsigned int) desc.width, (unsigned int) desc.height, desc.format);
+
+    return (RenderResource) (mResources.size() - 1);
+}
+
+RenderResource RenderGraph::ImportTexture(const std::string& name, GLuint texture)
+{
+    Resource imported;
+    imported.name = name;
+    imported.kind = RESOURCE_IMPORTED;
+    imported.texture = texture;
+    mResources.push_back(imported);
+
+    // Which texture it is does not change how the graph runs
+    Declare(DECLARE_IMPORT, 0, 0, 0);
+
+    return (RenderResource) (mResources.size() - 1);
+}
+
+unsigned int RenderGraph::AddPass(const std::string& name, const PassFunction& function)
+{
+    Pass pass;
+    pass.name = name;
+    pass.function = function;
+    pass.color = NO_RENDER_RESOURCE;
+    pass.depth = NO_RENDER_RESOURCE;
+    mPasses.push_back(pass);
+
+    Declare(DECLARE_PASS, (unsigned int) std::hash<std::string>()(name), 0, 0);
+
+    return (unsigned int) (mPasses.size() - 1);
+}
+
+void RenderGraph::Read(unsigned int pass, RenderResource resource)
+{
+    mPasses[pass].reads.push_back(resource);
+    Declare(DECLARE_READ, pass, resource, 0);
+}
+
+void RenderGraph::WriteColor(unsigned int pass, RenderResource resource)
+{
+    mPasses[pass].color = resource;
+    Declare(DECLARE_WRITE_COLOR, pass, resource, 0);
+}
+
+void RenderGraph::WriteDepth(unsigned int pass, RenderResource resource)
+{
+    mPasses[pass].depth = resource;
+    Declare(DECLARE_WRITE_DEPTH, pass, resource, 0);
+}
+
+void RenderGraph::Write(unsigned int pass, RenderResource resource)
+{
+    mPasses[pass].writes.push_back(resource);
+    Declare(DECLARE_WRITE, pass, resource, 0);
+}
+
+void RenderGraph::Declare(unsigned int a, unsigned int b, unsigned int c, unsigned int d)
+{
+    mTopology.push_back(a);
+    mTopology.push_back(b);
+    mTopology.push_back(c);
+    mTopology.push_back(d);
+}
+
+bool RenderGraph::Execute()
+{
+    if (!mCompiled || mTopology != mCompiledTopology)
+    {
+        std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+        mValid = Compile();
+        mCompiledTopology = mTopology;
+        mCompiled = true;
+        mStats.compiles++;
+        mStats.compileMilliseconds = std::chrono::duration<double, std::milli>(
+            std::chrono::high_resolution_clock::now() - start).count();
+    }
+
+    mStats.framebufferBinds = 0;
+    mRunOrder.clear();
+
+    if (!mValid)
+    {
+        return false;
+    }
+
+    mBoundFramebuffer = FRAMEBUFFER_NONE;
+
+    for (size_t i = 0; i < mOrder.size(); i++)
+    {
+        const Pass& pass = mPasses[mOrder[i]];
+
+        for (size_t j = 0; j < mAcquires[i].size(); j++)
+        {
+            Resource& target = mResources[mAcquires[i][j]];
+            target.texture = mPool->Acquire(target.desc);
+        }
+
+        if (BindFramebuffer(mPassFramebuffers[mOrder[i]], pass))
+        {
+            pass.function(*this);
+            mRunOrder.push_back(pass.name);
+        }
+
+        for (size_t j = 0; j < mReleases[i].size(); j++)
+        {
+            Resource& target = mResources[mReleases[i][j]];
+            mPool->Release(target.texture);
+            target.texture = 0;
+        }
+    }
+
+    if (mBoundFramebuffer != FRAMEBUFFER_SCREEN)
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    return true;
+}
+
+bool RenderGraph::Compile()
+{
+    mNeeded.clear();
+    mOrder.clear();
+    mPassFramebuffers.clear();
+    mAcquires.clear();
+    mReleases.clear();
+
+    if (!Validate())
+    {
+        mStats.passes = (unsigned int) mPasses.size();
+        mStats.culledPasses = 0;
+        mStats.transientTargets = 0;
+        return false;
+    }
+
+    Cull();
+    AssignFramebuffers();
+    Schedule();
+    ComputeLifetimes();
+
+    mStats.passes = (unsigned int) mPasses.size();
+    mStats.culledPasses = (unsigned int) (mPasses.size() - mOrder.size());
+
+    return true;
+}
+
+bool RenderGraph::Validate() const
+{
+    std::vector<bool> written(mResources.size(), false);
+
+    for (size_t i = 0; i < mPasses.size(); i++)
+    {
+        const Pass& pass = mPasses[i];
+        RenderResource attachments[2] = { pass.color, pass.depth };
+
+        for (int j = 0; j < 2; j++)
+        {
+            if (attachments[j] != NO_RENDER_RESOURCE
+                && (attachments[j] >= mResources.size() || mResources[attachments[j]].kind == RESOURCE_IMPORTED))
+            {
+                std::cout << "Render graph: pass " << pass.name << " can only draw into the screen or targets"
+                          << std::endl;
+                return false;
+            }
+        }
+
+        if (pass.depth == SCREEN || (pass.color == SCREEN && pass.depth != NO_RENDER_RESOURCE))
+        {
+            std::cout << "Render graph: pass " << pass.name << " mixes the screen with other attachments"
+                      << std::endl;
+            return false;
+        }
+
+        if (pass.color != NO_RENDER_RESOURCE && pass.depth != NO_RENDER_RESOURCE && pass.color != SCREEN
+            && (mResources[pass.color].desc.width != mResources[pass.depth].desc.width
+                || mResources[pass.color].desc.height != mResources[pass.depth].desc.height))
+        {
+            std::cout << "Render graph: the attachments of pass " << pass.name << " differ in size" << std::endl;
+            return false;
+        }
+
+        for (size_t j = 0; j < pass.reads.size(); j++)
+        {
+            RenderResource read = pass.reads[j];
+
+            if (read >= mResources.size() || read == SCREEN)
+            {
+                std::cout << "Render graph: pass " << pass.name << " reads a resource it cannot" << std::endl;
+                return false;
+            }
+
+            if (read == pass.color || read == pass.depth)
+            {
+                std::cout << "Render graph: pass " << pass.name << " reads " << mResources[read].name
+                          << ", which it draws into" << std::endl;
+                return false;
+            }
+
+            if (mResources[read].kind == RESOURCE_TRANSIENT && !written[read])
+            {
+                std::cout << "Render graph: pass " << pass.name << " reads " << mResources[read].name
+                          << " before anything writes it" << std::endl;
+                return false;
+            }
+        }
+
+        for (size_t j = 0; j < pass.writes.size(); j++)
+        {
+            if (pass.writes[j] >= mResources.size() || pass.writes[j] == SCREEN)
+            {
+                std::cout << "Render graph: pass " << pass.name << " writes a resource it cannot" << std::endl;
+                return false;
+            }
+
+            written[pass.writes[j]] = true;
+        }
+
+        for (int j = 0; j < 2; j++)
+        {
+            if (attachments[j] != NO_RENDER_RESOURCE)
+            {
+                written[attachments[j]] = true;
+            }
+        }
+    }
+
+    return true;
+}
+
+bool RenderGraph::Uses(const Pass& pass, RenderResource resource) const
+{
+    for (size_t i = 0; i < pass.reads.size(); i++)
+    {
+        if (pass.reads[i] == resource)
+        {
+            return true;
+        }
+    }
+
+    return Writes(pass, resource);
+}
+
+bool RenderGraph::Writes(const Pass& pass, RenderResource resource) const
+{
+    if (pass.color == resource || pass.depth == resource)
+    {
+        return true;
+    }
+
+    for (size_t i = 0; i < pass.writes.size(); i++)
+    {
+        if (pass.writes[i] == resource)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void RenderGraph::Cull()
+{
+    // Whether a pass declared later reads or draws on top of the resource,
+    // walking back from the last pass: those only ever depend on earlier ones
+    std::vector<bool> live(mResources.size(), false);
+    mNeeded.assign(mPasses.size(), false);
+
+    for (size_t i = mPasses.size(); i-- > 0;)
+    {
+        const Pass& pass = mPasses[i];
+        bool needed = false;
+
+        for (size_t r = 0; r < mResources.size() && !needed; r++)
+        {
+            // The screen and imported textures outlive the frame
+            needed = Writes(pass, (RenderResource) r) && (live[r] || mResources[r].kind != RESOURCE_TRANSIENT);
+        }
+
+        if (!needed)
+        {
+            continue;
+        }
+
+        mNeeded[i] = true;
+
+        for (size_t r = 0; r < mResources.size(); r++)
+        {
+            if (Uses(pass, (RenderResource) r))
+            {
+                live[r] = true;
+            }
+        }
+    }
+}
+
+void RenderGraph::AssignFramebuffers()
+{
+    std::vector<std::pair<RenderResource, RenderResource> > attachments;
+    mPassFramebuffers.assign(mPasses.size(), FRAMEBUFFER_NONE);
+
+    for (size_t i = 0; i < mPasses.size(); i++)
+    {
+        const Pass& pass = mPasses[i];
+
+        if (!mNeeded[i] || (pass.color == NO_RENDER_RESOURCE && pass.depth == NO_RENDER_RESOURCE))
+        {
+            continue;
+        }
+
+        if (pass.color == SCREEN)
+        {
+            mPassFramebuffers[i] = FRAMEBUFFER_SCREEN;
+            continue;
+        }
+
+        std::pair<RenderResource, RenderResource> key(pass.color, pass.depth);
+        size_t index = 0;
+
+        while (index < attachments.size() && attachments[index] != key)
+        {
+            index++;
+        }
+
+        if (index == attachments.size())
+        {
+            attachments.push_back(key);
+        }
+
+        mPassFramebuffers[i] = (int) index;
+    }
+
+    mFramebufferCount = (unsigned int) attachments.size();
+
+    while (mFramebuffers.size() < mFramebufferCount)
+    {
+        Framebuffer framebuffer;
+        glGenFramebuffers(1, &framebuffer.framebuffer);
+        mFramebuffers.push_back(framebuffer);
+    }
+
+    // The passes using each have changed, check them again
+    for (size_t i = 0; i < mFramebuffers.size(); i++)
+    {
+        mFramebuffers[i].attachedColor = 0;
+        mFramebuffers[i].attachedDepth = 0;
+        mFramebuffers[i].complete = false;
+    }
+}
+
+void RenderGraph::Schedule()
+{
+    // A pass waits for the earlier ones writing what it uses, and for the
+    // earlier ones using what it writes
+    std::vector<std::vector<unsigned int> > dependencies(mPasses.size());
+    std::vector<bool> scheduled(mPasses.size(), false);
+    size_t neededCount = 0;
+
+    for (size_t i = 0; i < mPasses.size(); i++)
+    {
+        if (!mNeeded[i])
+        {
+            continue;
+        }
+
+        neededCount++;
+
+        for (size_t j = 0; j < i; j++)
+        {
+            if (!mNeeded[j])
+            {
+                continue;
+            }
+
+            for (size_t r = 0; r < mResources.size(); r++)
+            {
+                if ((Writes(mPasses[j], (RenderResource) r) && Uses(mPasses[i], (RenderResource) r))
+                    || (Uses(mPasses[j], (RenderResource) r) && Writes(mPasses[i], (RenderResource) r)))
+                {
+                    dependencies[i].push_back((unsigned int) j);
+                    break;
+                }
+            }
+        }
+    }
+
+    int bound = FRAMEBUFFER_NONE;
+
+    while (mOrder.size() < neededCount)
+    {
+        int best = -1;
+        size_t bestShared = 0;
+
+        for (size_t i = 0; i < mPasses.size(); i++)
+        {
+            if (!mNeeded[i] || scheduled[i])
+            {
+                continue;
+            }
+
+            bool ready = true;
+
+            for (size_t j = 0; j < dependencies[i].size() && ready; j++)
+            {
+                ready = scheduled[dependencies[i][j]];
+            }
+
+            if (!ready)
+            {
+                continue;
+            }
+
+            int framebuffer = mPassFramebuffers[i];
+
+            if (framebuffer != FRAMEBUFFER_NONE && framebuffer == bound)
+            {
+                best = (int) i;
+                break;
+            }
+
+            size_t shared = 0;
+
+            for (size_t j = 0; j < mPasses.size() && framebuffer != FRAMEBUFFER_NONE; j++)
+            {
+                if (j != i && mNeeded[j] && !scheduled[j] && mPassFramebuffers[j] == framebuffer)
+                {
+                    shared++;
+                }
+            }
+
+            if (best < 0 || shared < bestShared)
+            {
+                best = (int) i;
+                bestShared = shared;
+            }
+        }
+
+        scheduled[best] = true;
+        mOrder.push_back((unsigned int) best);
+        bound = mPassFramebuffers[best];
+    }
+}
+
+void RenderGraph::ComputeLifetimes()
+{
+    std::vector<int> first(mResources.size(), -1);
+    std::vector<int> last(mResources.size(), -1);
+
+    for (size_t i = 0; i < mOrder.size(); i++)
+    {
+        for (size_t r = 0; r < mResources.size(); r++)
+        {
+            if (mResources[r].kind == RESOURCE_TRANSIENT && Uses(mPasses[mOrder[i]], (RenderResource) r))
+            {
+                if (first[r] < 0)
+                {
+                    first[r] = (int) i;
+                }
+
+                last[r] = (int) i;
+            }
+        }
+    }
+
+    mAcquires.assign(mOrder.size(), std::vector<RenderResource>());
+    mReleases.assign(mOrder.size(), std::vector<RenderResource>());
+    mStats.transientTargets = 0;
+
+    for (size_t r = 0; r < mResources.size(); r++)
+    {
+        if (first[r] >= 0)
+        {
+            mAcquires[first[r]].push_back((RenderResource) r);
+            mReleases[last[r]].push_back((RenderResource) r);
+            mStats.transientTargets++;
+        }
+    }
+}
+
+bool RenderGraph::BindFramebuffer(int framebuffer, const Pass& pass)
+{
+    if (framebuffer == FRAMEBUFFER_NONE)
+    {
+        // The pass binds its own, so nothing is known to be bound after it
+        mBoundFramebuffer = FRAMEBUFFER_NONE;
+        return true;
+    }
+
+    if (framebuffer != mBoundFramebuffer)
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer == FRAMEBUFFER_SCREEN ? 0 : mFramebuffers[framebuffer].framebuffer);
+        mBoundFramebuffer = framebuffer;
+        mStats.framebufferBinds++;
+    }
+
+    if (framebuffer == FRAMEBUFFER_SCREEN)
+    {
+        glViewport(0, 0, mScreenWidth, mScreenHeight);
+        return true;
+    }
+
+    Framebuffer& target = mFramebuffers[framebuffer];
+    GLuint color = pass.color != NO_RENDER_RESOURCE ? mResources[pass.color].texture : 0;
+    GLuint depth = pass.depth != NO_RENDER_RESOURCE ? mResources[pass.depth].texture : 0;
+
+    // The pool hands out the same textures every frame, until a resize
+    if (color != target.attachedColor || depth != target.attachedDepth)
+    {
+        GLenum depthAttachment = pass.depth != NO_RENDER_RESOURCE
+                                 && mResources[pass.depth].desc.format == GL_DEPTH24_STENCIL8
+                                 ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT;
+
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, color, 0);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, 0, 0);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, depthAttachment, GL_TEXTURE_2D, depth, 0);
+        // A depth only framebuffer needs both off to be complete everywhere
+        glDrawBuffer(color != 0 ? GL_COLOR_ATTACHMENT0 : GL_NONE);
+        glReadBuffer(color != 0 ? GL_COLOR_ATTACHMENT0 : GL_NONE);
+
+        target.attachedColor = color;
+        target.attachedDepth = depth;
+        target.complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+
+        if (!target.complete)
+        {
+            std::cout << "Render graph: the framebuffer of pass " << pass.name
+                      << " is not complete, the pass is skipped" << std::endl;
+        }
+    }
+
+    RenderResource size = pass.color != NO_RENDER_RESOURCE ? pass.color : pass.depth;
+    glViewport(0, 0, mResources[size].desc.width, mResources[size].desc.height);
+
+    return target.complete;
+}
+
+GLuint RenderGraph::GetTexture(RenderResource resource) const
+{
+    return mResources[resource].texture;
+}
+
+GLsizei RenderGraph::GetWidth(RenderResource resource) const
+{
+    return resource == SCREEN ? mScreenWidth : mResources[resource].desc.width;
+}
+
+GLsizei RenderGraph::GetHeight(RenderResource resource) const
+{
+    return resource == SCREEN ? mScreenHeight : mResources[resource].desc.height;
+}
+
+std::vector<std::string> RenderGraph::GetPassOrder() const
+{
+    return mRunOrder;
+}
+
+const RenderGraphStats& RenderGraph::GetStats() const
+{
+    return mStats;
+}
+
+void RenderGraph::Release()
+{
+    for (size_t i = 0; i < mFramebuffers.size(); i++)
+    {
+        glDeleteFramebuffers(1, &mFramebuffers[i].framebuffer);
+    }
+
+    mFramebuffers.clear();
+    mCompiled = false;
+    mValid = false;
+}
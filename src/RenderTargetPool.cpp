@@ -0,0 +1,145 @@
+#include "RenderTargetPool.hpp"
+
+#include <iostream>
+
+namespace {
+    // Textures left alone for this many frames are deleted
+    const unsigned long long UNUSED_FRAMES = 60;
+
+    void GetUploadFormat(GLenum format, GLenum& uploadFormat, GLenum& type)
+    {
+        switch (format)
+        {
+            case GL_DEPTH24_STENCIL8:
+                uploadFormat = GL_DEPTH_STENCIL;
+                type = GL_UNSIGNED_INT_24_8;
+                break;
+            case GL_RGBA16F:
+            case GL_R11F_G11F_B10F:
+                uploadFormat = format == GL_RGBA16F ? GL_RGBA : GL_RGB;
+                type = GL_HALF_FLOAT;
+                break;
+            default:
+                uploadFormat = GL_RGBA;
+                type = GL_UNSIGNED_BYTE;
+                break;
+        }
+    }
+}
+
+RenderTargetPool::RenderTargetPool()
+{
+    mFrame = 0;
+}
+
+GLuint RenderTargetPool::Acquire(const RenderTargetDesc& desc)
+{
+    mStats.acquiresThisFrame++;
+
+    for (size_t i = 0; i < mEntries.size(); i++)
+    {
+        Entry& entry = mEntries[i];
+
+        if (!entry.inUse && entry.desc.width == desc.width && entry.desc.height == desc.height
+            && entry.desc.format == desc.format)
+        {
+            entry.inUse = true;
+            entry.lastUsedFrame = mFrame;
+            mStats.reusesThisFrame++;
+            return entry.texture;
+        }
+    }
+
+    GLenum uploadFormat = GL_RGBA;
+    GLenum type = GL_UNSIGNED_BYTE;
+    GetUploadFormat(desc.format, uploadFormat, type);
+
+    Entry entry;
+    entry.desc = desc;
+    entry.inUse = true;
+    entry.lastUsedFrame = mFrame;
+
+    glGenTextures(1, &entry.texture);
+    glBindTexture(GL_TEXTURE_2D, entry.texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, desc.format, desc.width, desc.height, 0, uploadFormat, type, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    mEntries.push_back(entry);
+    mStats.textures++;
+    mStats.bytes += (GLsizeiptr) desc.width * desc.height * GetTexelBytes(desc.format);
+    mStats.createdThisFrame++;
+
+    return entry.texture;
+}
+
+void RenderTargetPool::Release(GLuint texture)
+{
+    for (size_t i = 0; i < mEntries.size(); i++)
+    {
+        if (mEntries[i].texture == texture)
+        {
+            mEntries[i].inUse = false;
+            return;
+        }
+    }
+
+    std::cout << "Render target " << texture << " is not from the pool" << std::endl;
+}
+
+void RenderTargetPool::EndFrame()
+{
+    for (size_t i = 0; i < mEntries.size();)
+    {
+        Entry& entry = mEntries[i];
+
+        if (!entry.inUse && mFrame - entry.lastUsedFrame >= UNUSED_FRAMES)
+        {
+            glDeleteTextures(1, &entry.texture);
+            mStats.textures--;
+            mStats.bytes -= (GLsizeiptr) entry.desc.width * entry.desc.height * GetTexelBytes(entry.desc.format);
+            mEntries.erase(mEntries.begin() + i);
+        }
+        else
+        {
+            i++;
+        }
+    }
+
+    mFrame++;
+    mStats.acquiresThisFrame = 0;
+    mStats.reusesThisFrame = 0;
+    mStats.createdThisFrame = 0;
+}
+
+const RenderTargetPoolStats& RenderTargetPool::GetStats() const
+{
+    return mStats;
+}
+
+void RenderTargetPool::Release()
+{
+    for (size_t i = 0; i < mEntries.size(); i++)
+    {
+        glDeleteTextures(1, &mEntries[i].texture);
+    }
+
+    mEntries.clear();
+    mStats = RenderTargetPoolStats();
+}
+
+GLsizeiptr RenderTargetPool::GetTexelBytes(GLenum format)
+{
+    switch (format)
+    {
+        case GL_RGBA16F:
+            return 8;
+        default:
+            // GL_RGBA8, GL_R11F_G11F_B10F, GL_DEPTH24_STENCIL8
+            return 4;
+    }
+}
@@ -0,0 +1,98 @@
+#include "Scene.hpp"
+
+#include <algorithm>
+
+void SortSceneInstances(std::vector<SceneInstance>& instances, const MaterialSystem& materials)
+{
+    std::stable_sort(instances.begin(), instances.end(), [&materials](const SceneInstance& a, const SceneInstance& b) {
+        if (a.program != b.program)
+        {
+            return a.program < b.program;
+        }
+
+        bool firstCulls = materials.Get(a.material).cullBackFaces;
+        bool secondCulls = materials.Get(b.material).cullBackFaces;
+
+        if (firstCulls != secondCulls)
+        {
+            return secondCulls;
+        }
+
+        if (a.mesh != b.mesh)
+        {
+            return a.mesh < b.mesh;
+        }
+
+        const TextureAsset* first = materials.GetBoundAlbedo(a.material);
+        const TextureAsset* second = materials.GetBoundAlbedo(b.material);
+
+        if (first != second)
+        {
+            return first < second;
+        }
+
+        return a.material < b.material;
+    });
+}
+
+SceneBatchCounts CountSceneBatches(const std::vector<SceneInstance>& instances, const MaterialSystem& materials,
+                                   unsigned int maxInstancesPerDraw)
+{
+    SceneBatchCounts counts;
+    const SceneInstance* previous = nullptr;
+    const TextureAsset* previousTexture = nullptr;
+    bool previousCulls = false;
+    // The atlas is a single texture on a unit of its own
+    bool atlasBound = false;
+    const TextureAsset* boundTexture = nullptr;
+    unsigned int batchSize = 0;
+
+    for (size_t i = 0; i < instances.size(); i++)
+    {
+        const SceneInstance& instance = instances[i];
+        const TextureAsset* texture = materials.GetBoundAlbedo(instance.material);
+        bool culls = materials.Get(instance.material).cullBackFaces;
+
+        if (previous == nullptr || instance.program != previous->program)
+        {
+            counts.programSwitches++;
+        }
+
+        // Culling starts out disabled
+        if (culls != previousCulls)
+        {
+            counts.cullStateChanges++;
+        }
+
+        if (materials.IsAtlased(instance.material) && !atlasBound)
+        {
+            counts.textureBinds++;
+            atlasBound = true;
+        }
+        else if (texture != nullptr && texture != boundTexture)
+        {
+            counts.textureBinds++;
+            boundTexture = texture;
+        }
+
+        bool sameBatch = previous != nullptr && batchSize < maxInstancesPerDraw
+                         && instance.program == previous->program && instance.mesh == previous->mesh
+                         && texture == previousTexture && culls == previousCulls;
+
+        if (sameBatch)
+        {
+            batchSize++;
+        }
+        else
+        {
+            counts.drawCalls++;
+            batchSize = 1;
+        }
+
+        previous = &instance;
+        previousTexture = texture;
+        previousCulls = culls;
+    }
+
+    return counts;
+}
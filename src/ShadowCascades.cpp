@@ -0,0 +1,266 @@
+#include "ShadowCascades.hpp"
+
+#include <glm/ext/matrix_clip_space.hpp>
+#include <glm/ext/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+namespace {
+    // Between logarithmic (1) and even (0) splits: logarithmic keeps the
+    // texels about as large as the pixels, the even part keeps the near
+    // cascade from being tiny
+    const float SPLIT_BLEND = 0.75f;
+
+    // Sphere radii are rounded up to this, so rounding errors never change
+    // a cascade's size from one frame to the next
+    const float RADIUS_STEP = 1.0f / 16.0f;
+}
+
+ShadowCascades::ShadowCascades(unsigned int size)
+{
+    mSize = std::max(size, 1u);
+    mFrame = 0;
+    mProjection = glm::mat4(0.0f);
+    mLightDirection = glm::vec3(0.0f);
+    mLightRotation = glm::mat4(1.0f);
+    mNear = 0.1f;
+    mTanHalfX = 1.0f;
+    mTanHalfY = 1.0f;
+    mTexture = 0;
+    mFramebuffer = 0;
+    mComplete = false;
+}
+
+void ShadowCascades::SetUpdateInterval(unsigned int cascade, unsigned int frames)
+{
+    mCascades[cascade].interval = std::max(frames, 1u);
+}
+
+unsigned int ShadowCascades::GetUpdateInterval(unsigned int cascade) const
+{
+    return mCascades[cascade].interval;
+}
+
+void ShadowCascades::Update(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& lightDirection)
+{
+    bool everything = mFrame == 0 || projection != mProjection || lightDirection != mLightDirection;
+
+    if (everything)
+    {
+        const glm::mat4& p = projection;
+        float farDistance = p[3][2] / (p[2][2] + 1.0f);
+
+        mProjection = projection;
+        mNear = p[3][2] / (p[2][2] - 1.0f);
+        mTanHalfX = 1.0f / p[0][0];
+        mTanHalfY = 1.0f / p[1][1];
+
+        for (unsigned int i = 0; i < SHADOW_CASCADE_COUNT; i++)
+        {
+            float t = (float) (i + 1) / SHADOW_CASCADE_COUNT;
+            float logarithmic = mNear * std::pow(farDistance / mNear, t);
+            float even = mNear + (farDistance - mNear) * t;
+            mCascades[i].splitDistance = SPLIT_BLEND * logarithmic + (1.0f - SPLIT_BLEND) * even;
+        }
+
+        // One rotation for every cascade, any up that is not the direction
+        mLightDirection = lightDirection;
+        glm::vec3 direction = glm::normalize(lightDirection);
+        glm::vec3 up = std::abs(direction.y) > 0.99f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+        mLightRotation = glm::lookAt(glm::vec3(0.0f), direction, up);
+    }
+
+    glm::mat4 inverseView = glm::inverse(view);
+
+    for (unsigned int i = 0; i < SHADOW_CASCADE_COUNT; i++)
+    {
+        Cascade& cascade = mCascades[i];
+
+        // Offset by the index, so cascades with one interval take turns
+        cascade.updated = everything || (mFrame + i) % cascade.interval == 0;
+
+        if (cascade.updated)
+        {
+            UpdateCascade(i, inverseView, i == 0 ? mNear : mCascades[i - 1].splitDistance, cascade.splitDistance);
+        }
+    }
+
+    mFrame++;
+}
+
+void ShadowCascades::UpdateCascade(unsigned int index, const glm::mat4& inverseView, float splitNear, float splitFar)
+{
+    Cascade& cascade = mCascades[index];
+
+    // The sphere around the split's corners, centered on the view axis:
+    // it only depends on the projection, never on where the camera looks
+    float center = 0.5f * (splitNear + splitFar);
+    float radius = 0.0f;
+    float depths[2] = { splitNear, splitFar };
+
+    for (int i = 0; i < 2; i++)
+    {
+        glm::vec3 corner(depths[i] * mTanHalfX, depths[i] * mTanHalfY, depths[i] - center);
+        radius = std::max(radius, glm::length(corner));
+    }
+
+    radius = std::ceil(radius / RADIUS_STEP) * RADIUS_STEP;
+
+    glm::vec3 worldCenter = glm::vec3(inverseView * glm::vec4(0.0f, 0.0f, -center, 1.0f));
+    glm::vec3 lightCenter = glm::vec3(mLightRotation * glm::vec4(worldCenter, 1.0f));
+
+    // Move in whole texels only
+    cascade.texelSize = 2.0f * radius / mSize;
+    glm::vec2 snapped = glm::floor(glm::vec2(lightCenter) / cascade.texelSize) * cascade.texelSize;
+
+    cascade.boxMin = snapped - glm::vec2(radius);
+    cascade.boxMax = snapped + glm::vec2(radius);
+    // Casters in front of the sphere are clamped onto the near plane (see
+    // BeginCascade), so it need not reach them
+    cascade.nearDistance = -lightCenter.z - radius;
+    cascade.farDistance = -lightCenter.z + radius;
+    cascade.view = mLightRotation;
+    cascade.projection = glm::ortho(cascade.boxMin.x, cascade.boxMax.x, cascade.boxMin.y, cascade.boxMax.y,
+                                    cascade.nearDistance, cascade.farDistance);
+}
+
+bool ShadowCascades::IsUpdated(unsigned int cascade) const
+{
+    return mCascades[cascade].updated;
+}
+
+bool ShadowCascades::IsCaster(unsigned int cascade, const glm::vec3& center, float radius) const
+{
+    const Cascade& box = mCascades[cascade];
+    glm::vec3 p = glm::vec3(box.view * glm::vec4(center, 1.0f));
+
+    if (p.x + radius < box.boxMin.x || p.x - radius > box.boxMax.x
+        || p.y + radius < box.boxMin.y || p.y - radius > box.boxMax.y)
+    {
+        return false;
+    }
+
+    // Light space looks down -z. Anything between the light and the far
+    // plane, however far in front, shadows the box.
+    return -p.z - radius <= box.farDistance;
+}
+
+const glm::mat4& ShadowCascades::GetLightView(unsigned int cascade) const
+{
+    return mCascades[cascade].view;
+}
+
+const glm::mat4& ShadowCascades::GetLightProjection(unsigned int cascade) const
+{
+    return mCascades[cascade].projection;
+}
+
+glm::mat4 ShadowCascades::GetShadowMatrix(unsigned int cascade) const
+{
+    // Clip space -1 - 1 to texture coordinates and depth 0 - 1
+    glm::mat4 bias = glm::translate(glm::mat4(1.0f), glm::vec3(0.5f));
+    bias = glm::scale(bias, glm::vec3(0.5f));
+
+    return bias * mCascades[cascade].projection * mCascades[cascade].view;
+}
+
+float ShadowCascades::GetSplitDistance(unsigned int cascade) const
+{
+    return mCascades[cascade].splitDistance;
+}
+
+float ShadowCascades::GetTexelSize(unsigned int cascade) const
+{
+    return mCascades[cascade].texelSize;
+}
+
+unsigned int ShadowCascades::GetSize() const
+{
+    return mSize;
+}
+
+bool ShadowCascades::BeginCascade(unsigned int cascade)
+{
+    if (mTexture == 0)
+    {
+        glGenTextures(1, &mTexture);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, mTexture);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24, mSize, mSize, SHADOW_CASCADE_COUNT, 0,
+                     GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+        // Linear filtering of a comparing texture: 2x2 samples, blended
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+        glGenFramebuffers(1, &mFramebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, mFramebuffer);
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, mTexture, 0, 0);
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+
+        mComplete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+
+        if (!mComplete)
+        {
+            std::cout << "Shadow map framebuffer is not complete, shadows are off" << std::endl;
+        }
+    }
+
+    if (!mComplete)
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        return false;
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, mFramebuffer);
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, mTexture, 0, (GLint) cascade);
+    glViewport(0, 0, (GLsizei) mSize, (GLsizei) mSize);
+    glDepthMask(GL_TRUE);
+    glClear(GL_DEPTH_BUFFER_BIT);
+    // Casters in front of the near plane are flattened onto it instead of
+    // being clipped away
+    glEnable(GL_DEPTH_CLAMP);
+
+    return true;
+}
+
+void ShadowCascades::EndCascades()
+{
+    glDisable(GL_DEPTH_CLAMP);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void ShadowCascades::Bind(GLuint unit) const
+{
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, mTexture);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+GLuint ShadowCascades::GetTexture() const
+{
+    return mTexture;
+}
+
+void ShadowCascades::Release()
+{
+    if (mFramebuffer != 0)
+    {
+        glDeleteFramebuffers(1, &mFramebuffer);
+        mFramebuffer = 0;
+    }
+
+    if (mTexture != 0)
+    {
+        glDeleteTextures(1, &mTexture);
+        mTexture = 0;
+    }
+
+    mComplete = false;
+}
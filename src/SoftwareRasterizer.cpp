@@ -0,0 +1,510 @@
+#include "SoftwareRasterizer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+
+// SSE2 is always there on x86-64, anything else takes the scalar path
+#if defined(__SSE2__) || defined(_M_X64)
+#define RASTER_SIMD 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+    const unsigned int TILE_SIZE = 64;
+    // Vertices per job when transforming on the thread pool
+    const unsigned int VERTEX_GRAIN = 4096;
+
+    // Set bits in a 4 bit mask
+    const int LANE_COUNT[16] = { 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4 };
+
+    double MillisecondsSince(std::chrono::high_resolution_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+
+    /* The plane a * x + b * y + c through three window space values */
+    void MakePlane(const glm::vec3 v[3], float f0, float f1, float f2, float area, float plane[3])
+    {
+        plane[0] = ((f1 - f0) * (v[2].y - v[0].y) - (f2 - f0) * (v[1].y - v[0].y)) / area;
+        plane[1] = ((f2 - f0) * (v[1].x - v[0].x) - (f1 - f0) * (v[2].x - v[0].x)) / area;
+        plane[2] = f0 - plane[0] * v[0].x - plane[1] * v[0].y;
+    }
+
+    unsigned int PackColor(float r, float g, float b)
+    {
+        unsigned int red = (unsigned int) (std::min(std::max(r, 0.0f), 1.0f) * 255.0f + 0.5f);
+        unsigned int green = (unsigned int) (std::min(std::max(g, 0.0f), 1.0f) * 255.0f + 0.5f);
+        unsigned int blue = (unsigned int) (std::min(std::max(b, 0.0f), 1.0f) * 255.0f + 0.5f);
+
+        return red | (green << 8) | (blue << 16) | 0xFF000000u;
+    }
+}
+
+SoftwareRasterizer::SoftwareRasterizer(unsigned int width, unsigned int height, ThreadPool* threadPool)
+{
+    mWidth = std::max(width, 1u);
+    mHeight = std::max(height, 1u);
+    mStride = (mWidth + 3) & ~3u;
+    mThreadPool = threadPool;
+
+    mDepthTest = false;
+    mBackfaceCulling = false;
+
+    mColor.assign(mStride * mHeight, 0xFF000000u);
+    mDepth.assign(mStride * mHeight, 1.0f);
+
+    mTilesX = (mWidth + TILE_SIZE - 1) / TILE_SIZE;
+    mTilesY = (mHeight + TILE_SIZE - 1) / TILE_SIZE;
+    mTileBins.resize(mTilesX * mTilesY);
+    mTilePixels.resize(mTilesX * mTilesY);
+}
+
+void SoftwareRasterizer::SetDepthTest(bool enabled)
+{
+    mDepthTest = enabled;
+}
+
+void SoftwareRasterizer::SetBackfaceCulling(bool enabled)
+{
+    mBackfaceCulling = enabled;
+}
+
+void SoftwareRasterizer::Clear(glm::vec4 color)
+{
+    std::fill(mColor.begin(), mColor.end(), PackColor(color.r, color.g, color.b));
+    std::fill(mDepth.begin(), mDepth.end(), 1.0f);
+
+    mTriangles.clear();
+
+    for (size_t i = 0; i < mTileBins.size(); i++)
+    {
+        mTileBins[i].clear();
+    }
+}
+
+void SoftwareRasterizer::DrawMesh(const Mesh3D* mesh, const glm::mat4& model, const glm::mat4& view,
+                                  const glm::mat4& projection)
+{
+    DrawMesh(mesh, model, view, projection, 0, mesh->indexBufferData.size());
+}
+
+void SoftwareRasterizer::DrawMesh(const Mesh3D* mesh, const glm::mat4& model, const glm::mat4& view,
+                                  const glm::mat4& projection, size_t firstIndex, size_t indexCount)
+{
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+    // The vertex shader
+    glm::mat4 transform = projection * view * model;
+    const GLfloat* vertices = mesh->vertexData.data();
+    size_t vertexCount = GetMeshVertexCount(mesh);
+
+    mVertices.resize(vertexCount);
+
+    std::function<void(unsigned int, unsigned int)> shadeVertices = [&](unsigned int begin, unsigned int end) {
+        for (unsigned int i = begin; i < end; i++)
+        {
+            const GLfloat* vertex = vertices + i * 6;
+            mVertices[i].position = transform * glm::vec4(vertex[0], vertex[1], vertex[2], 1.0f);
+            mVertices[i].color = glm::vec3(vertex[3], vertex[4], vertex[5]);
+        }
+    };
+
+    if (mThreadPool != nullptr && vertexCount > VERTEX_GRAIN)
+    {
+        mThreadPool->ParallelFor((unsigned int) vertexCount, VERTEX_GRAIN, shadeVertices);
+    }
+    else
+    {
+        shadeVertices(0, (unsigned int) vertexCount);
+    }
+
+    indexCount = std::min(indexCount, mesh->indexBufferData.size() - std::min(firstIndex, mesh->indexBufferData.size()));
+    const GLuint* indices = mesh->indexBufferData.data() + firstIndex;
+
+    for (size_t i = 0; i + 2 < indexCount; i += 3)
+    {
+        mStats.trianglesSubmitted++;
+
+        const ClipVertex* corners[3] = { &mVertices[indices[i]], &mVertices[indices[i + 1]], &mVertices[indices[i + 2]] };
+
+        // Clip against the near plane (z >= -w), which leaves 3 or 4 corners
+        ClipVertex polygon[4];
+        int polygonSize = 0;
+
+        for (int corner = 0; corner < 3; corner++)
+        {
+            const ClipVertex& current = *corners[corner];
+            const ClipVertex& next = *corners[(corner + 1) % 3];
+            float currentDistance = current.position.z + current.position.w;
+            float nextDistance = next.position.z + next.position.w;
+
+            if (currentDistance >= 0.0f)
+            {
+                polygon[polygonSize++] = current;
+            }
+
+            if ((currentDistance >= 0.0f) != (nextDistance >= 0.0f))
+            {
+                // Always from the inside corner, so neighbours that share the
+                // edge get the very same point
+                const ClipVertex& inside = currentDistance >= 0.0f ? current : next;
+                const ClipVertex& outside = currentDistance >= 0.0f ? next : current;
+                float insideDistance = inside.position.z + inside.position.w;
+                float outsideDistance = outside.position.z + outside.position.w;
+                float t = insideDistance / (insideDistance - outsideDistance);
+
+                polygon[polygonSize].position = inside.position + (outside.position - inside.position) * t;
+                polygon[polygonSize].color = inside.color + (outside.color - inside.color) * t;
+                polygonSize++;
+            }
+        }
+
+        for (int corner = 2; corner < polygonSize; corner++)
+        {
+            SetupTriangle(polygon[0], polygon[corner - 1], polygon[corner]);
+        }
+    }
+
+    mStats.setupMilliseconds += MillisecondsSince(start);
+}
+
+void SoftwareRasterizer::SetupTriangle(const ClipVertex& a, const ClipVertex& b, const ClipVertex& c)
+{
+    const ClipVertex* corners[3] = { &a, &b, &c };
+    glm::vec3 window[3];
+    float inverseW[3];
+
+    // Perspective divide and viewport transform, y up like OpenGL
+    for (int corner = 0; corner < 3; corner++)
+    {
+        const glm::vec4& clip = corners[corner]->position;
+
+        if (clip.w <= 0.0f)
+        {
+            return;
+        }
+
+        inverseW[corner] = 1.0f / clip.w;
+        window[corner] = glm::vec3((clip.x * inverseW[corner] * 0.5f + 0.5f) * mWidth,
+                                   (clip.y * inverseW[corner] * 0.5f + 0.5f) * mHeight,
+                                   clip.z * inverseW[corner] * 0.5f + 0.5f);
+    }
+
+    float area = (window[1].x - window[0].x) * (window[2].y - window[0].y)
+               - (window[2].x - window[0].x) * (window[1].y - window[0].y);
+
+    // Counter-clockwise is front facing, as in OpenGL
+    if (area == 0.0f || (mBackfaceCulling && area < 0.0f))
+    {
+        return;
+    }
+
+    // From here on the corners are always counter-clockwise
+    if (area < 0.0f)
+    {
+        std::swap(window[1], window[2]);
+        std::swap(inverseW[1], inverseW[2]);
+        std::swap(corners[1], corners[2]);
+        area = -area;
+    }
+
+    Triangle triangle;
+    triangle.minX = std::max(0, (int) std::floor(std::min(window[0].x, std::min(window[1].x, window[2].x))));
+    triangle.minY = std::max(0, (int) std::floor(std::min(window[0].y, std::min(window[1].y, window[2].y))));
+    triangle.maxX = std::min((int) mWidth - 1, (int) std::ceil(std::max(window[0].x, std::max(window[1].x, window[2].x))));
+    triangle.maxY = std::min((int) mHeight - 1, (int) std::ceil(std::max(window[0].y, std::max(window[1].y, window[2].y))));
+
+    if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY)
+    {
+        return;
+    }
+
+    for (int edge = 0; edge < 3; edge++)
+    {
+        const glm::vec3& from = window[edge];
+        const glm::vec3& to = window[(edge + 1) % 3];
+
+        // An edge shared by two triangles is computed from the same end in
+        // both and only negated, so the two edge functions are exact
+        // opposites and no pixel along it is drawn twice or dropped
+        bool flip = to.y < from.y || (to.y == from.y && to.x < from.x);
+        const glm::vec3& first = flip ? to : from;
+        const glm::vec3& second = flip ? from : to;
+        float sign = flip ? -1.0f : 1.0f;
+
+        float a = first.y - second.y;
+        float b = second.x - first.x;
+        triangle.edge[edge][0] = sign * a;
+        triangle.edge[edge][1] = sign * b;
+        triangle.edge[edge][2] = sign * -(a * first.x + b * first.y);
+
+        // Pixels exactly on a left or top edge belong to this triangle
+        triangle.topLeft[edge] = triangle.edge[edge][0] > 0.0f
+                                 || (triangle.edge[edge][0] == 0.0f && triangle.edge[edge][1] < 0.0f);
+    }
+
+    // 1 / w and color / w are linear in screen space, their ratio is the
+    // perspective correct color
+    MakePlane(window, inverseW[0], inverseW[1], inverseW[2], area, triangle.inverseW);
+
+    for (int channel = 0; channel < 3; channel++)
+    {
+        MakePlane(window,
+                  corners[0]->color[channel] * inverseW[0],
+                  corners[1]->color[channel] * inverseW[1],
+                  corners[2]->color[channel] * inverseW[2],
+                  area, triangle.colorOverW[channel]);
+    }
+
+    MakePlane(window, window[0].z, window[1].z, window[2].z, area, triangle.depth);
+
+    unsigned int index = (unsigned int) mTriangles.size();
+    mTriangles.push_back(triangle);
+    mStats.trianglesRasterized++;
+
+    for (int tileY = triangle.minY / (int) TILE_SIZE; tileY <= triangle.maxY / (int) TILE_SIZE; tileY++)
+    {
+        for (int tileX = triangle.minX / (int) TILE_SIZE; tileX <= triangle.maxX / (int) TILE_SIZE; tileX++)
+        {
+            mTileBins[tileY * mTilesX + tileX].push_back(index);
+        }
+    }
+}
+
+void SoftwareRasterizer::Flush()
+{
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+    unsigned int tileCount = mTilesX * mTilesY;
+
+    std::fill(mTilePixels.begin(), mTilePixels.end(), 0ull);
+
+    if (mThreadPool != nullptr && tileCount > 1)
+    {
+        mThreadPool->ParallelFor(tileCount, 1, [this](unsigned int begin, unsigned int end) {
+            for (unsigned int tile = begin; tile < end; tile++)
+            {
+                RasterizeTile(tile);
+            }
+        });
+    }
+    else
+    {
+        for (unsigned int tile = 0; tile < tileCount; tile++)
+        {
+            RasterizeTile(tile);
+        }
+    }
+
+    for (unsigned int tile = 0; tile < tileCount; tile++)
+    {
+        mStats.pixelsShaded += mTilePixels[tile];
+        mTileBins[tile].clear();
+    }
+
+    mTriangles.clear();
+    mStats.rasterMilliseconds += MillisecondsSince(start);
+}
+
+void SoftwareRasterizer::RasterizeTile(unsigned int tile)
+{
+    int tileX0 = (int) ((tile % mTilesX) * TILE_SIZE);
+    int tileY0 = (int) ((tile / mTilesX) * TILE_SIZE);
+    int tileX1 = std::min(tileX0 + (int) TILE_SIZE, (int) mWidth);
+    int tileY1 = std::min(tileY0 + (int) TILE_SIZE, (int) mHeight);
+
+    const std::vector<unsigned int>& bin = mTileBins[tile];
+    unsigned long long pixels = 0;
+
+    for (size_t t = 0; t < bin.size(); t++)
+    {
+        const Triangle& triangle = mTriangles[bin[t]];
+        int x0 = std::max(triangle.minX, tileX0);
+        int x1 = std::min(triangle.maxX + 1, tileX1);
+        int y0 = std::max(triangle.minY, tileY0);
+        int y1 = std::min(triangle.maxY + 1, tileY1);
+
+        for (int y = y0; y < y1; y++)
+        {
+            float centerY = y + 0.5f;
+            unsigned int* colorRow = &mColor[y * mStride];
+            float* depthRow = &mDepth[y * mStride];
+
+            float rowEdge[3];
+
+            for (int edge = 0; edge < 3; edge++)
+            {
+                rowEdge[edge] = triangle.edge[edge][1] * centerY + triangle.edge[edge][2];
+            }
+
+            float rowInverseW = triangle.inverseW[1] * centerY + triangle.inverseW[2];
+            float rowColor[3];
+
+            for (int channel = 0; channel < 3; channel++)
+            {
+                rowColor[channel] = triangle.colorOverW[channel][1] * centerY + triangle.colorOverW[channel][2];
+            }
+
+            float rowDepth = triangle.depth[1] * centerY + triangle.depth[2];
+
+#ifdef RASTER_SIMD
+            __m128 zero = _mm_setzero_ps();
+            __m128 one = _mm_set1_ps(1.0f);
+            __m128 scale = _mm_set1_ps(255.0f);
+            __m128 half = _mm_set1_ps(0.5f);
+            __m128 laneOffsets = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+            __m128i laneIndices = _mm_set_epi32(3, 2, 1, 0);
+            __m128i alpha = _mm_set1_epi32((int) 0xFF000000u);
+
+            __m128 edgeX[3], edgeRow[3], topLeft[3];
+
+            for (int edge = 0; edge < 3; edge++)
+            {
+                edgeX[edge] = _mm_set1_ps(triangle.edge[edge][0]);
+                edgeRow[edge] = _mm_set1_ps(rowEdge[edge]);
+                topLeft[edge] = _mm_castsi128_ps(_mm_set1_epi32(triangle.topLeft[edge] ? -1 : 0));
+            }
+
+            // Blocks start 4 aligned, the rows are padded so they never run off
+            for (int x = x0 & ~3; x < x1; x += 4)
+            {
+                __m128 centerX = _mm_add_ps(_mm_set1_ps((float) x), laneOffsets);
+
+                // Within [x0, x1)
+                __m128i lane = _mm_add_epi32(_mm_set1_epi32(x), laneIndices);
+                __m128 mask = _mm_castsi128_ps(_mm_and_si128(
+                    _mm_cmpgt_epi32(lane, _mm_set1_epi32(x0 - 1)),
+                    _mm_cmplt_epi32(lane, _mm_set1_epi32(x1))));
+
+                for (int edge = 0; edge < 3; edge++)
+                {
+                    __m128 value = _mm_add_ps(_mm_mul_ps(edgeX[edge], centerX), edgeRow[edge]);
+                    __m128 inside = _mm_or_ps(_mm_cmpgt_ps(value, zero),
+                                              _mm_and_ps(_mm_cmpeq_ps(value, zero), topLeft[edge]));
+                    mask = _mm_and_ps(mask, inside);
+                }
+
+                if (_mm_movemask_ps(mask) == 0)
+                {
+                    continue;
+                }
+
+                __m128 depth = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(triangle.depth[0]), centerX), _mm_set1_ps(rowDepth));
+                __m128 currentDepth = _mm_loadu_ps(depthRow + x);
+
+                if (mDepthTest)
+                {
+                    mask = _mm_and_ps(mask, _mm_cmplt_ps(depth, currentDepth));
+
+                    if (_mm_movemask_ps(mask) == 0)
+                    {
+                        continue;
+                    }
+
+                    _mm_storeu_ps(depthRow + x, _mm_or_ps(_mm_and_ps(mask, depth), _mm_andnot_ps(mask, currentDepth)));
+                }
+
+                __m128 w = _mm_div_ps(one, _mm_add_ps(_mm_mul_ps(_mm_set1_ps(triangle.inverseW[0]), centerX),
+                                                      _mm_set1_ps(rowInverseW)));
+                __m128i packed = alpha;
+
+                for (int channel = 0; channel < 3; channel++)
+                {
+                    __m128 overW = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(triangle.colorOverW[channel][0]), centerX),
+                                              _mm_set1_ps(rowColor[channel]));
+                    __m128 value = _mm_min_ps(_mm_max_ps(_mm_mul_ps(overW, w), zero), one);
+                    __m128i byte = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(value, scale), half));
+
+                    packed = _mm_or_si128(packed, _mm_slli_epi32(byte, channel * 8));
+                }
+
+                __m128i laneMask = _mm_castps_si128(mask);
+                __m128i current = _mm_loadu_si128((const __m128i*) (colorRow + x));
+
+                _mm_storeu_si128((__m128i*) (colorRow + x),
+                                 _mm_or_si128(_mm_and_si128(laneMask, packed), _mm_andnot_si128(laneMask, current)));
+
+                pixels += LANE_COUNT[_mm_movemask_ps(mask)];
+            }
+#else
+            for (int x = x0; x < x1; x++)
+            {
+                float centerX = x + 0.5f;
+                bool inside = true;
+
+                for (int edge = 0; edge < 3; edge++)
+                {
+                    float value = triangle.edge[edge][0] * centerX + rowEdge[edge];
+                    inside = inside && (value > 0.0f || (value == 0.0f && triangle.topLeft[edge]));
+                }
+
+                if (!inside)
+                {
+                    continue;
+                }
+
+                float depth = triangle.depth[0] * centerX + rowDepth;
+
+                if (mDepthTest)
+                {
+                    if (!(depth < depthRow[x]))
+                    {
+                        continue;
+                    }
+
+                    depthRow[x] = depth;
+                }
+
+                float w = 1.0f / (triangle.inverseW[0] * centerX + rowInverseW);
+
+                colorRow[x] = PackColor((triangle.colorOverW[0][0] * centerX + rowColor[0]) * w,
+                                        (triangle.colorOverW[1][0] * centerX + rowColor[1]) * w,
+                                        (triangle.colorOverW[2][0] * centerX + rowColor[2]) * w);
+                pixels++;
+            }
+#endif
+        }
+    }
+
+    mTilePixels[tile] = pixels;
+}
+
+void SoftwareRasterizer::ReadPixels(std::vector<unsigned char>& rgba) const
+{
+    rgba.resize((size_t) mWidth * mHeight * 4);
+
+    for (unsigned int y = 0; y < mHeight; y++)
+    {
+        for (unsigned int x = 0; x < mWidth; x++)
+        {
+            unsigned int pixel = mColor[y * mStride + x];
+            unsigned char* destination = &rgba[((size_t) y * mWidth + x) * 4];
+
+            destination[0] = (unsigned char) pixel;
+            destination[1] = (unsigned char) (pixel >> 8);
+            destination[2] = (unsigned char) (pixel >> 16);
+            destination[3] = (unsigned char) (pixel >> 24);
+        }
+    }
+}
+
+unsigned int SoftwareRasterizer::GetWidth() const
+{
+    return mWidth;
+}
+
+unsigned int SoftwareRasterizer::GetHeight() const
+{
+    return mHeight;
+}
+
+const RasterStats& SoftwareRasterizer::GetStats() const
+{
+    return mStats;
+}
+
+void SoftwareRasterizer::ResetStats()
+{
+    mStats = RasterStats();
+}
@@ -0,0 +1,291 @@
+#include "TextureAtlas.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+namespace {
+    // Texture corners sit on a grid of this many texels, so the textures'
+    // levels line up with the layer's down to the last atlas level
+    const unsigned int ATLAS_ALIGNMENT = 1u << (ATLAS_LEVEL_COUNT - 1);
+    // Edge texels repeated around every texture, one texel at the last level
+    const unsigned int ATLAS_GUTTER = ATLAS_ALIGNMENT;
+
+    unsigned int AlignUp(unsigned int value)
+    {
+        return (value + ATLAS_ALIGNMENT - 1) / ATLAS_ALIGNMENT * ATLAS_ALIGNMENT;
+    }
+
+    /*
+        Copy the matching level of texture into level 'level' of layer, at
+        (x, y) in level 0 texels, and fill the gutter around it with the
+        edge texels. The texture's coarsest level stands in for the ones it
+        does not have.
+    */
+    void CopyIntoLayer(const TextureData& texture, unsigned int x, unsigned int y, unsigned int level,
+                       TextureImage& layer)
+    {
+        const TextureImage& source = texture.levels[std::min<size_t>(level, texture.levels.size() - 1)];
+        const TextureImage& full = texture.levels[0];
+
+        int left = (int) (x >> level);
+        int bottom = (int) (y >> level);
+        int width = std::max((int) ((x + full.width) >> level) - left, 1);
+        int height = std::max((int) ((y + full.height) >> level) - bottom, 1);
+        int gutter = (int) (ATLAS_GUTTER >> level);
+
+        for (int row = -gutter; row < height + gutter; row++)
+        {
+            int sourceRow = std::min(std::max(row, 0), height - 1) * (int) source.height / height;
+
+            for (int column = -gutter; column < width + gutter; column++)
+            {
+                int sourceColumn = std::min(std::max(column, 0), width - 1) * (int) source.width / width;
+
+                std::memcpy(&layer.data[((size_t) (bottom + row) * layer.width + left + column) * 4],
+                            &source.data[((size_t) sourceRow * source.width + sourceColumn) * 4], 4);
+            }
+        }
+    }
+}
+
+SkylinePacker::SkylinePacker(unsigned int width, unsigned int height)
+{
+    mWidth = (int) width;
+    mHeight = (int) height;
+    mUsedArea = 0;
+
+    Segment floor = { 0, 0, mWidth };
+    mSkyline.push_back(floor);
+}
+
+/*
+    Whether a rectangle with its left edge at segment index fits, and the
+    height its bottom edge would rest at.
+*/
+bool SkylinePacker::Fits(size_t index, int width, int height, int& y) const
+{
+    if (mSkyline[index].x + width > mWidth)
+    {
+        return false;
+    }
+
+    int remaining = width;
+    y = 0;
+
+    for (size_t i = index; remaining > 0; i++)
+    {
+        y = std::max(y, mSkyline[i].y);
+
+        if (y + height > mHeight)
+        {
+            return false;
+        }
+
+        remaining -= mSkyline[i].width;
+    }
+
+    return true;
+}
+
+bool SkylinePacker::Insert(unsigned int width, unsigned int height, unsigned int& x, unsigned int& y)
+{
+    size_t best = mSkyline.size();
+    int bestX = 0;
+    int bestY = 0;
+
+    for (size_t i = 0; i < mSkyline.size(); i++)
+    {
+        int restingY = 0;
+
+        if (Fits(i, (int) width, (int) height, restingY)
+            && (best == mSkyline.size() || restingY < bestY || (restingY == bestY && mSkyline[i].x < bestX)))
+        {
+            best = i;
+            bestX = mSkyline[i].x;
+            bestY = restingY;
+        }
+    }
+
+    if (best == mSkyline.size())
+    {
+        return false;
+    }
+
+    // The new top edge, then cut away what it covers of the segments to
+    // its right
+    Segment top = { bestX, bestY + (int) height, (int) width };
+    mSkyline.insert(mSkyline.begin() + best, top);
+
+    for (size_t i = best + 1; i < mSkyline.size();)
+    {
+        int covered = top.x + top.width - mSkyline[i].x;
+
+        if (covered <= 0)
+        {
+            break;
+        }
+
+        mSkyline[i].x += covered;
+        mSkyline[i].width -= covered;
+
+        if (mSkyline[i].width > 0)
+        {
+            break;
+        }
+
+        mSkyline.erase(mSkyline.begin() + i);
+    }
+
+    // Neighbours at the same height become one segment
+    for (size_t i = 0; i + 1 < mSkyline.size();)
+    {
+        if (mSkyline[i].y == mSkyline[i + 1].y)
+        {
+            mSkyline[i].width += mSkyline[i + 1].width;
+            mSkyline.erase(mSkyline.begin() + i + 1);
+        }
+        else
+        {
+            i++;
+        }
+    }
+
+    x = (unsigned int) bestX;
+    y = (unsigned int) bestY;
+    mUsedArea += (unsigned long long) width * height;
+
+    return true;
+}
+
+float SkylinePacker::GetOccupancy() const
+{
+    return (float) ((double) mUsedArea / ((double) mWidth * mHeight));
+}
+
+unsigned int PackTextureAtlas(const std::vector<const TextureData*>& textures, TextureFormat format,
+                              unsigned int layerSize, unsigned int maxTextureSize,
+                              std::vector<AtlasEntry>& entries, std::vector<TextureData>& layers)
+{
+    entries.assign(textures.size(), AtlasEntry());
+    layers.clear();
+
+    std::vector<size_t> order;
+
+    for (size_t i = 0; i < textures.size(); i++)
+    {
+        const TextureData* texture = textures[i];
+
+        if (texture->format == format && !IsCompressedFormat(format) && !texture->levels.empty()
+            && texture->levels[0].width <= maxTextureSize && texture->levels[0].height <= maxTextureSize
+            && AlignUp(texture->levels[0].width) + 2 * ATLAS_GUTTER <= layerSize
+            && AlignUp(texture->levels[0].height) + 2 * ATLAS_GUTTER <= layerSize)
+        {
+            order.push_back(i);
+        }
+    }
+
+    // Tallest first packs the skyline the tightest
+    std::stable_sort(order.begin(), order.end(), [&textures](size_t a, size_t b) {
+        const TextureImage& first = textures[a]->levels[0];
+        const TextureImage& second = textures[b]->levels[0];
+
+        if (first.height != second.height)
+        {
+            return first.height > second.height;
+        }
+
+        return first.width > second.width;
+    });
+
+    std::vector<SkylinePacker> packers;
+
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        const TextureData& texture = *textures[order[i]];
+        unsigned int width = AlignUp(texture.levels[0].width) + 2 * ATLAS_GUTTER;
+        unsigned int height = AlignUp(texture.levels[0].height) + 2 * ATLAS_GUTTER;
+        unsigned int x = 0;
+        unsigned int y = 0;
+        size_t layer = 0;
+
+        // First layer it fits in, a new one otherwise
+        while (layer < packers.size() && !packers[layer].Insert(width, height, x, y))
+        {
+            layer++;
+        }
+
+        if (layer == packers.size())
+        {
+            packers.push_back(SkylinePacker(layerSize, layerSize));
+            packers.back().Insert(width, height, x, y);
+
+            TextureData page;
+            page.format = format;
+
+            for (unsigned int level = 0; level < ATLAS_LEVEL_COUNT; level++)
+            {
+                TextureImage image;
+                image.width = std::max(layerSize >> level, 1u);
+                image.height = std::max(layerSize >> level, 1u);
+                image.data.assign(GetTextureLevelBytes(format, image.width, image.height), 0);
+                page.levels.push_back(image);
+            }
+
+            layers.push_back(page);
+        }
+
+        x += ATLAS_GUTTER;
+        y += ATLAS_GUTTER;
+
+        for (unsigned int level = 0; level < ATLAS_LEVEL_COUNT; level++)
+        {
+            CopyIntoLayer(texture, x, y, level, layers[layer].levels[level]);
+        }
+
+        AtlasEntry& entry = entries[order[i]];
+        entry.layer = (int) layer;
+        entry.rect = glm::vec4((float) x, (float) y, (float) texture.levels[0].width,
+                               (float) texture.levels[0].height) / (float) layerSize;
+    }
+
+    return (unsigned int) order.size();
+}
+
+GLuint CreateTextureArray(const std::vector<TextureData>& layers)
+{
+    if (layers.empty())
+    {
+        return 0;
+    }
+
+    const TextureData& first = layers[0];
+    GLenum internalFormat = first.format == TEXTURE_FORMAT_SRGB8_ALPHA8 ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+    GLuint texture = 0;
+
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    for (size_t level = 0; level < first.levels.size(); level++)
+    {
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, (GLint) level, internalFormat, first.levels[level].width,
+                     first.levels[level].height, (GLsizei) layers.size(), 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+
+        for (size_t layer = 0; layer < layers.size(); layer++)
+        {
+            glTexSubImage3D(GL_TEXTURE_2D_ARRAY, (GLint) level, 0, 0, (GLint) layer, first.levels[level].width,
+                            first.levels[level].height, 1, GL_RGBA, GL_UNSIGNED_BYTE,
+                            layers[layer].levels[level].data.data());
+        }
+    }
+
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, (GLint) first.levels.size() - 1);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    return texture;
+}
@@ -0,0 +1,1273 @@
+#include "TextureCompressor.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <limits>
+
+namespace {
+    // Block rows are handed to the workers in chunks of about this many blocks
+    const unsigned int BLOCKS_PER_CHUNK = 512;
+
+    // Least squares passes over the endpoints in COMPRESSION_HIGH, they stop
+    // early once a pass does not lower the error
+    const int REFINE_PASSES = 4;
+
+    // Power iterations for the principal axis of a block
+    const int AXIS_ITERATIONS = 8;
+
+    // BC7 4 bit index weights, out of 64
+    const int BC7_WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    int Clamp(int value, int low, int high)
+    {
+        return std::min(std::max(value, low), high);
+    }
+
+    /*
+        Mean and principal axis (unit length, or zero for a flat block) of
+        count points with 'channels' components, by power iteration on the
+        covariance matrix.
+    */
+    void FitLine(const float (*points)[4], int count, int channels, float mean[4], float axis[4])
+    {
+        float covariance[4][4] = {};
+
+        for (int c = 0; c < 4; c++)
+        {
+            mean[c] = 0.0f;
+            axis[c] = 0.0f;
+        }
+
+        for (int i = 0; i < count; i++)
+        {
+            for (int c = 0; c < channels; c++)
+            {
+                mean[c] += points[i][c];
+            }
+        }
+
+        for (int c = 0; c < channels; c++)
+        {
+            mean[c] /= (float) count;
+        }
+
+        for (int i = 0; i < count; i++)
+        {
+            float d[4];
+
+            for (int c = 0; c < channels; c++)
+            {
+                d[c] = points[i][c] - mean[c];
+            }
+
+            for (int r = 0; r < channels; r++)
+            {
+                for (int c = 0; c < channels; c++)
+                {
+                    covariance[r][c] += d[r] * d[c];
+                }
+            }
+        }
+
+        // Start from the channel that varies the most, a fixed start vector
+        // could be orthogonal to the axis
+        int largest = 0;
+
+        for (int c = 1; c < channels; c++)
+        {
+            if (covariance[c][c] > covariance[largest][largest])
+            {
+                largest = c;
+            }
+        }
+
+        if (covariance[largest][largest] < 1e-3f)
+        {
+            return;
+        }
+
+        for (int c = 0; c < channels; c++)
+        {
+            axis[c] = covariance[largest][c];
+        }
+
+        for (int iteration = 0; iteration < AXIS_ITERATIONS; iteration++)
+        {
+            float next[4] = {};
+            float length = 0.0f;
+
+            for (int r = 0; r < channels; r++)
+            {
+                for (int c = 0; c < channels; c++)
+                {
+                    next[r] += covariance[r][c] * axis[c];
+                }
+
+                length += next[r] * next[r];
+            }
+
+            if (length < 1e-12f)
+            {
+                break;
+            }
+
+            float scale = 1.0f / std::sqrt(length);
+
+            for (int c = 0; c < channels; c++)
+            {
+                axis[c] = next[c] * scale;
+            }
+        }
+    }
+
+    /* The two points of the line through mean along axis that bound the projections. */
+    void LineEndpoints(const float (*points)[4], int count, int channels, const float mean[4],
+                       const float axis[4], float high[4], float low[4])
+    {
+        float minimum = 0.0f;
+        float maximum = 0.0f;
+
+        for (int i = 0; i < count; i++)
+        {
+            float t = 0.0f;
+
+            for (int c = 0; c < channels; c++)
+            {
+                t += (points[i][c] - mean[c]) * axis[c];
+            }
+
+            minimum = std::min(minimum, t);
+            maximum = std::max(maximum, t);
+        }
+
+        for (int c = 0; c < 4; c++)
+        {
+            high[c] = mean[c] + axis[c] * maximum;
+            low[c] = mean[c] + axis[c] * minimum;
+        }
+    }
+
+    /*
+        The endpoints e0, e1 that minimize the squared error of the points
+        reconstructed as e0 + w (e1 - e0). Points with a negative weight are
+        left out.
+
+        @return false when the weights cannot separate two endpoints.
+    */
+    bool LeastSquares(const float (*points)[4], const float* weights, int channels, float e0[4], float e1[4])
+    {
+        float aa = 0.0f;
+        float ab = 0.0f;
+        float bb = 0.0f;
+        float ax[4] = {};
+        float bx[4] = {};
+
+        for (int i = 0; i < 16; i++)
+        {
+            if (weights[i] < 0.0f)
+            {
+                continue;
+            }
+
+            float b = weights[i];
+            float a = 1.0f - b;
+
+            aa += a * a;
+            ab += a * b;
+            bb += b * b;
+
+            for (int c = 0; c < channels; c++)
+            {
+                ax[c] += a * points[i][c];
+                bx[c] += b * points[i][c];
+            }
+        }
+
+        float determinant = aa * bb - ab * ab;
+
+        if (std::fabs(determinant) < 1e-6f)
+        {
+            return false;
+        }
+
+        float inverse = 1.0f / determinant;
+
+        for (int c = 0; c < channels; c++)
+        {
+            e0[c] = (bb * ax[c] - ab * bx[c]) * inverse;
+            e1[c] = (aa * bx[c] - ab * ax[c]) * inverse;
+        }
+
+        return true;
+    }
+
+    // BC1 color block
+
+    int To565(const float color[4])
+    {
+        int r = Clamp((int) (color[0] * (31.0f / 255.0f) + 0.5f), 0, 31);
+        int g = Clamp((int) (color[1] * (63.0f / 255.0f) + 0.5f), 0, 63);
+        int b = Clamp((int) (color[2] * (31.0f / 255.0f) + 0.5f), 0, 31);
+
+        return (r << 11) | (g << 5) | b;
+    }
+
+    void From565(int color, int rgb[3])
+    {
+        int r = (color >> 11) & 31;
+        int g = (color >> 5) & 63;
+        int b = color & 31;
+
+        rgb[0] = (r << 3) | (r >> 2);
+        rgb[1] = (g << 2) | (g >> 4);
+        rgb[2] = (b << 3) | (b >> 2);
+    }
+
+    /* BC3 color blocks always use 4 colors, BC1 only when c0 > c1. */
+    void ColorPalette(int c0, int c1, bool alwaysFourColors, int palette[4][4])
+    {
+        int a[3];
+        int b[3];
+        From565(c0, a);
+        From565(c1, b);
+
+        bool fourColors = alwaysFourColors || c0 > c1;
+
+        for (int c = 0; c < 3; c++)
+        {
+            palette[0][c] = a[c];
+            palette[1][c] = b[c];
+            palette[2][c] = fourColors ? (2 * a[c] + b[c]) / 3 : (a[c] + b[c]) / 2;
+            palette[3][c] = fourColors ? (a[c] + 2 * b[c]) / 3 : 0;
+        }
+
+        palette[0][3] = 255;
+        palette[1][3] = 255;
+        palette[2][3] = 255;
+        palette[3][3] = fourColors ? 255 : 0;
+    }
+
+    struct ColorCandidate {
+        int c0 = 0;
+        int c1 = 0;
+        unsigned int indices = 0; // 2 bits per texel, texel 0 lowest
+        int error = std::numeric_limits<int>::max();
+    };
+
+    /*
+        Orders the endpoints for the mode (c0 > c1 for 4 colors, c0 <= c1 for
+        3 colors plus transparent) and picks the nearest color per texel.
+    */
+    ColorCandidate FitColors(const unsigned char* texels, int c0, int c1, bool threeColors, bool alwaysFourColors)
+    {
+        if ((!threeColors && c0 < c1) || (threeColors && c0 > c1))
+        {
+            std::swap(c0, c1);
+        }
+
+        int palette[4][4];
+        ColorPalette(c0, c1, alwaysFourColors, palette);
+
+        ColorCandidate candidate;
+        candidate.c0 = c0;
+        candidate.c1 = c1;
+        candidate.error = 0;
+
+        // Equal BC1 endpoints decode as 3 colors, the 4th is transparent
+        int colors = threeColors || (c0 == c1 && !alwaysFourColors) ? 3 : 4;
+
+        for (int i = 0; i < 16; i++)
+        {
+            const unsigned char* texel = texels + i * 4;
+            int best = 0;
+            int bestError = std::numeric_limits<int>::max();
+
+            if (threeColors && texel[3] < 128)
+            {
+                candidate.indices |= 3u << (i * 2);
+                continue;
+            }
+
+            for (int k = 0; k < colors; k++)
+            {
+                int dr = texel[0] - palette[k][0];
+                int dg = texel[1] - palette[k][1];
+                int db = texel[2] - palette[k][2];
+                int error = dr * dr + dg * dg + db * db;
+
+                if (error < bestError)
+                {
+                    best = k;
+                    bestError = error;
+                }
+            }
+
+            candidate.indices |= (unsigned int) best << (i * 2);
+            candidate.error += bestError;
+        }
+
+        return candidate;
+    }
+
+    /* Least squares on the indices of candidate until the error stops dropping. */
+    ColorCandidate RefineColors(const unsigned char* texels, const float (*points)[4], ColorCandidate best,
+                                bool threeColors, bool alwaysFourColors)
+    {
+        // Where each index sits between c0 (0) and c1 (1)
+        const float fourColorWeights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+        const float threeColorWeights[4] = { 0.0f, 1.0f, 0.5f, -1.0f };
+        const float* indexWeights = threeColors ? threeColorWeights : fourColorWeights;
+
+        for (int pass = 0; pass < REFINE_PASSES; pass++)
+        {
+            float weights[16];
+
+            for (int i = 0; i < 16; i++)
+            {
+                weights[i] = indexWeights[(best.indices >> (i * 2)) & 3];
+            }
+
+            float e0[4];
+            float e1[4];
+
+            if (!LeastSquares(points, weights, 3, e0, e1))
+            {
+                break;
+            }
+
+            ColorCandidate candidate = FitColors(texels, To565(e0), To565(e1), threeColors, alwaysFourColors);
+
+            if (candidate.error >= best.error)
+            {
+                break;
+            }
+
+            best = candidate;
+        }
+
+        return best;
+    }
+
+    /*
+        For every 8 bit value, the pair of 5 (or 6) bit endpoints whose 1/3
+        interpolant is closest to it. A flat block is then matched exactly
+        instead of being rounded to 565.
+    */
+    struct SingleColorTables {
+        unsigned char five[256][2];
+        unsigned char six[256][2];
+
+        SingleColorTables()
+        {
+            Build(5, five);
+            Build(6, six);
+        }
+
+        static void Build(int bits, unsigned char table[256][2])
+        {
+            int levels = 1 << bits;
+
+            for (int value = 0; value < 256; value++)
+            {
+                int bestError = 256;
+
+                for (int q0 = 0; q0 < levels; q0++)
+                {
+                    for (int q1 = 0; q1 < levels; q1++)
+                    {
+                        int a = bits == 5 ? (q0 << 3) | (q0 >> 2) : (q0 << 2) | (q0 >> 4);
+                        int b = bits == 5 ? (q1 << 3) | (q1 >> 2) : (q1 << 2) | (q1 >> 4);
+                        int error = std::abs((2 * a + b) / 3 - value);
+
+                        if (error < bestError)
+                        {
+                            bestError = error;
+                            table[value][0] = (unsigned char) q0;
+                            table[value][1] = (unsigned char) q1;
+                        }
+                    }
+                }
+            }
+        }
+    };
+
+    const SingleColorTables& GetSingleColorTables()
+    {
+        static const SingleColorTables tables;
+        return tables;
+    }
+
+    /* alpha1Bit: BC1, where texels with alpha below 128 become transparent. */
+    void EncodeColorBlock(const unsigned char* texels, bool alpha1Bit, CompressionQuality quality,
+                          unsigned char* block)
+    {
+        float points[16][4];
+        int count = 0;
+        bool transparent = false;
+
+        for (int i = 0; i < 16; i++)
+        {
+            const unsigned char* texel = texels + i * 4;
+
+            if (alpha1Bit && texel[3] < 128)
+            {
+                transparent = true;
+            }
+            else
+            {
+                points[count][0] = texel[0];
+                points[count][1] = texel[1];
+                points[count][2] = texel[2];
+                count++;
+            }
+        }
+
+        ColorCandidate best;
+
+        if (count == 0)
+        {
+            best.indices = 0xFFFFFFFFu;
+        }
+        else
+        {
+            float mean[4];
+            float axis[4];
+            float high[4];
+            float low[4];
+
+            FitLine(points, count, 3, mean, axis);
+            LineEndpoints(points, count, 3, mean, axis, high, low);
+
+            bool flat = axis[0] == 0.0f && axis[1] == 0.0f && axis[2] == 0.0f;
+            best = FitColors(texels, To565(high), To565(low), transparent, !alpha1Bit);
+
+            if (quality == COMPRESSION_HIGH)
+            {
+                if (flat && !transparent)
+                {
+                    const SingleColorTables& tables = GetSingleColorTables();
+                    int r = Clamp((int) (mean[0] + 0.5f), 0, 255);
+                    int g = Clamp((int) (mean[1] + 0.5f), 0, 255);
+                    int b = Clamp((int) (mean[2] + 0.5f), 0, 255);
+                    int c0 = (tables.five[r][0] << 11) | (tables.six[g][0] << 5) | tables.five[b][0];
+                    int c1 = (tables.five[r][1] << 11) | (tables.six[g][1] << 5) | tables.five[b][1];
+
+                    ColorCandidate candidate = FitColors(texels, c0, c1, false, !alpha1Bit);
+
+                    if (candidate.error < best.error)
+                    {
+                        best = candidate;
+                    }
+                }
+
+                // Least squares works on the points in texel order
+                float ordered[16][4];
+
+                for (int i = 0; i < 16; i++)
+                {
+                    for (int c = 0; c < 3; c++)
+                    {
+                        ordered[i][c] = texels[i * 4 + c];
+                    }
+                }
+
+                best = RefineColors(texels, ordered, best, transparent, !alpha1Bit);
+
+                // An opaque BC1 block may still do better with 3 colors
+                if (alpha1Bit && !transparent)
+                {
+                    ColorCandidate three = FitColors(texels, best.c0, best.c1, true, false);
+                    three = RefineColors(texels, ordered, three, true, false);
+
+                    if (three.error < best.error)
+                    {
+                        best = three;
+                    }
+                }
+            }
+        }
+
+        block[0] = (unsigned char) best.c0;
+        block[1] = (unsigned char) (best.c0 >> 8);
+        block[2] = (unsigned char) best.c1;
+        block[3] = (unsigned char) (best.c1 >> 8);
+        block[4] = (unsigned char) best.indices;
+        block[5] = (unsigned char) (best.indices >> 8);
+        block[6] = (unsigned char) (best.indices >> 16);
+        block[7] = (unsigned char) (best.indices >> 24);
+    }
+
+    void DecodeColorBlock(const unsigned char* block, bool alwaysFourColors, unsigned char* texels)
+    {
+        int c0 = block[0] | (block[1] << 8);
+        int c1 = block[2] | (block[3] << 8);
+        unsigned int indices = block[4] | (block[5] << 8) | (block[6] << 16) | ((unsigned int) block[7] << 24);
+
+        int palette[4][4];
+        ColorPalette(c0, c1, alwaysFourColors, palette);
+
+        for (int i = 0; i < 16; i++)
+        {
+            const int* color = palette[(indices >> (i * 2)) & 3];
+
+            for (int c = 0; c < 4; c++)
+            {
+                texels[i * 4 + c] = (unsigned char) color[c];
+            }
+        }
+    }
+
+    // BC4 single channel block, BC3 alpha and the two halves of BC5
+
+    /* 8 values when a0 > a1, otherwise 6 values plus 0 and 255. */
+    void ValuePalette(int a0, int a1, int palette[8])
+    {
+        palette[0] = a0;
+        palette[1] = a1;
+
+        if (a0 > a1)
+        {
+            for (int i = 2; i < 8; i++)
+            {
+                palette[i] = ((8 - i) * a0 + (i - 1) * a1) / 7;
+            }
+        }
+        else
+        {
+            for (int i = 2; i < 6; i++)
+            {
+                palette[i] = ((6 - i) * a0 + (i - 1) * a1) / 5;
+            }
+
+            palette[6] = 0;
+            palette[7] = 255;
+        }
+    }
+
+    struct ValueCandidate {
+        int a0 = 0;
+        int a1 = 0;
+        unsigned long long indices = 0; // 3 bits per texel, texel 0 lowest
+        int error = std::numeric_limits<int>::max();
+    };
+
+    ValueCandidate FitValues(const int* values, int a0, int a1)
+    {
+        int palette[8];
+        ValuePalette(a0, a1, palette);
+
+        ValueCandidate candidate;
+        candidate.a0 = a0;
+        candidate.a1 = a1;
+        candidate.error = 0;
+
+        for (int i = 0; i < 16; i++)
+        {
+            int best = 0;
+            int bestError = std::numeric_limits<int>::max();
+
+            for (int k = 0; k < 8; k++)
+            {
+                int error = (values[i] - palette[k]) * (values[i] - palette[k]);
+
+                if (error < bestError)
+                {
+                    best = k;
+                    bestError = error;
+                }
+            }
+
+            candidate.indices |= (unsigned long long) best << (i * 3);
+            candidate.error += bestError;
+        }
+
+        return candidate;
+    }
+
+    void EncodeValueBlock(const int* values, CompressionQuality quality, unsigned char* block)
+    {
+        int minimum = 255;
+        int maximum = 0;
+
+        for (int i = 0; i < 16; i++)
+        {
+            minimum = std::min(minimum, values[i]);
+            maximum = std::max(maximum, values[i]);
+        }
+
+        ValueCandidate best = FitValues(values, maximum, minimum);
+
+        if (quality == COMPRESSION_HIGH && maximum > minimum)
+        {
+            // Least squares in the 8 value mode, index i > 1 sits at (i - 1) / 7
+            float points[16][4];
+
+            for (int i = 0; i < 16; i++)
+            {
+                points[i][0] = (float) values[i];
+            }
+
+            for (int pass = 0; pass < REFINE_PASSES; pass++)
+            {
+                float weights[16];
+
+                for (int i = 0; i < 16; i++)
+                {
+                    int index = (int) ((best.indices >> (i * 3)) & 7);
+                    weights[i] = index == 0 ? 0.0f : (index == 1 ? 1.0f : (index - 1) / 7.0f);
+                }
+
+                float e0[4];
+                float e1[4];
+
+                if (best.a0 <= best.a1 || !LeastSquares(points, weights, 1, e0, e1))
+                {
+                    break;
+                }
+
+                int a0 = Clamp((int) (e0[0] + 0.5f), 0, 255);
+                int a1 = Clamp((int) (e1[0] + 0.5f), 0, 255);
+
+                if (a0 < a1)
+                {
+                    std::swap(a0, a1);
+                }
+
+                if (a0 == a1)
+                {
+                    break;
+                }
+
+                ValueCandidate candidate = FitValues(values, a0, a1);
+
+                if (candidate.error >= best.error)
+                {
+                    break;
+                }
+
+                best = candidate;
+            }
+
+            // The 6 value mode spends its endpoints on the values between 0
+            // and 255, which it has for free
+            int low = 255;
+            int high = 0;
+
+            for (int i = 0; i < 16; i++)
+            {
+                if (values[i] != 0 && values[i] != 255)
+                {
+                    low = std::min(low, values[i]);
+                    high = std::max(high, values[i]);
+                }
+            }
+
+            if (low > high)
+            {
+                low = high = 0;
+            }
+
+            ValueCandidate candidate = FitValues(values, low, high);
+
+            if (candidate.error < best.error)
+            {
+                best = candidate;
+            }
+        }
+
+        block[0] = (unsigned char) best.a0;
+        block[1] = (unsigned char) best.a1;
+
+        for (int i = 0; i < 6; i++)
+        {
+            block[2 + i] = (unsigned char) (best.indices >> (i * 8));
+        }
+    }
+
+    void DecodeValueBlock(const unsigned char* block, int* values)
+    {
+        int palette[8];
+        ValuePalette(block[0], block[1], palette);
+
+        unsigned long long indices = 0;
+
+        for (int i = 0; i < 6; i++)
+        {
+            indices |= (unsigned long long) block[2 + i] << (i * 8);
+        }
+
+        for (int i = 0; i < 16; i++)
+        {
+            values[i] = palette[(indices >> (i * 3)) & 7];
+        }
+    }
+
+    void EncodeChannel(const unsigned char* texels, int channel, CompressionQuality quality, unsigned char* block)
+    {
+        int values[16];
+
+        for (int i = 0; i < 16; i++)
+        {
+            values[i] = texels[i * 4 + channel];
+        }
+
+        EncodeValueBlock(values, quality, block);
+    }
+
+    void DecodeChannel(const unsigned char* block, int channel, unsigned char* texels)
+    {
+        int values[16];
+        DecodeValueBlock(block, values);
+
+        for (int i = 0; i < 16; i++)
+        {
+            texels[i * 4 + channel] = (unsigned char) values[i];
+        }
+    }
+
+    // BC7 mode 6: 7777 RGBA endpoints, one p-bit (the shared lowest bit)
+    // per endpoint, 4 bit indices
+
+    struct BitWriter {
+        unsigned char* out;
+        int position;
+
+        void Write(unsigned int value, int bits)
+        {
+            for (int i = 0; i < bits; i++, position++)
+            {
+                if ((value >> i) & 1)
+                {
+                    out[position >> 3] |= (unsigned char) (1 << (position & 7));
+                }
+            }
+        }
+    };
+
+    struct BitReader {
+        const unsigned char* in;
+        int position;
+
+        unsigned int Read(int bits)
+        {
+            unsigned int value = 0;
+
+            for (int i = 0; i < bits; i++, position++)
+            {
+                value |= (unsigned int) ((in[position >> 3] >> (position & 7)) & 1) << i;
+            }
+
+            return value;
+        }
+    };
+
+    struct BC7Candidate {
+        int endpoints[2][4]; // 7 bit
+        int pBits[2];
+        unsigned char indices[16];
+        int error = std::numeric_limits<int>::max();
+    };
+
+    int Expand7(int value, int pBit)
+    {
+        return (value << 1) | pBit;
+    }
+
+    /* The 7 bit endpoint for pBit closest to color, @return its squared error. */
+    float QuantizeEndpoint(const float color[4], int pBit, int endpoint[4])
+    {
+        float error = 0.0f;
+
+        for (int c = 0; c < 4; c++)
+        {
+            endpoint[c] = Clamp((int) std::floor((color[c] - pBit) * 0.5f + 0.5f), 0, 127);
+
+            float d = (float) Expand7(endpoint[c], pBit) - color[c];
+            error += d * d;
+        }
+
+        return error;
+    }
+
+    void BC7Palette(const int endpoints[2][4], const int pBits[2], int palette[16][4])
+    {
+        for (int c = 0; c < 4; c++)
+        {
+            int e0 = Expand7(endpoints[0][c], pBits[0]);
+            int e1 = Expand7(endpoints[1][c], pBits[1]);
+
+            for (int k = 0; k < 16; k++)
+            {
+                palette[k][c] = ((64 - BC7_WEIGHTS[k]) * e0 + BC7_WEIGHTS[k] * e1 + 32) >> 6;
+            }
+        }
+    }
+
+    /*
+        Quantizes the endpoints, with the given p-bits or (pBit0 < 0) the
+        best one for each, and picks the index per texel. The projection on
+        the endpoint line gives the index, its neighbors are checked too.
+    */
+    BC7Candidate FitBC7(const unsigned char* texels, const float e0[4], const float e1[4], int pBit0, int pBit1)
+    {
+        BC7Candidate candidate;
+        const float* colors[2] = { e0, e1 };
+        int forced[2] = { pBit0, pBit1 };
+
+        for (int e = 0; e < 2; e++)
+        {
+            if (forced[e] >= 0)
+            {
+                candidate.pBits[e] = forced[e];
+                QuantizeEndpoint(colors[e], forced[e], candidate.endpoints[e]);
+            }
+            else
+            {
+                int zero[4];
+                float zeroError = QuantizeEndpoint(colors[e], 0, zero);
+                float oneError = QuantizeEndpoint(colors[e], 1, candidate.endpoints[e]);
+                candidate.pBits[e] = 1;
+
+                if (zeroError < oneError)
+                {
+                    std::memcpy(candidate.endpoints[e], zero, sizeof(zero));
+                    candidate.pBits[e] = 0;
+                }
+            }
+        }
+
+        int palette[16][4];
+        BC7Palette(candidate.endpoints, candidate.pBits, palette);
+
+        int direction[4];
+        int lengthSquared = 0;
+
+        for (int c = 0; c < 4; c++)
+        {
+            direction[c] = palette[15][c] - palette[0][c];
+            lengthSquared += direction[c] * direction[c];
+        }
+
+        candidate.error = 0;
+
+        for (int i = 0; i < 16; i++)
+        {
+            const unsigned char* texel = texels + i * 4;
+            int guess = 0;
+
+            if (lengthSquared > 0)
+            {
+                int dot = 0;
+
+                for (int c = 0; c < 4; c++)
+                {
+                    dot += (texel[c] - palette[0][c]) * direction[c];
+                }
+
+                guess = Clamp((int) ((float) dot / lengthSquared * 15.0f + 0.5f), 0, 15);
+            }
+
+            int best = guess;
+            int bestError = std::numeric_limits<int>::max();
+
+            for (int k = std::max(guess - 1, 0); k <= std::min(guess + 1, 15); k++)
+            {
+                int error = 0;
+
+                for (int c = 0; c < 4; c++)
+                {
+                    int d = texel[c] - palette[k][c];
+                    error += d * d;
+                }
+
+                if (error < bestError)
+                {
+                    best = k;
+                    bestError = error;
+                }
+            }
+
+            candidate.indices[i] = (unsigned char) best;
+            candidate.error += bestError;
+        }
+
+        return candidate;
+    }
+
+    void EncodeBC7Block(const unsigned char* texels, CompressionQuality quality, unsigned char* block)
+    {
+        float points[16][4];
+
+        for (int i = 0; i < 16; i++)
+        {
+            for (int c = 0; c < 4; c++)
+            {
+                points[i][c] = texels[i * 4 + c];
+            }
+        }
+
+        float mean[4];
+        float axis[4];
+        float high[4];
+        float low[4];
+
+        FitLine(points, 16, 4, mean, axis);
+        LineEndpoints(points, 16, 4, mean, axis, high, low);
+
+        BC7Candidate best = FitBC7(texels, low, high, -1, -1);
+
+        if (quality == COMPRESSION_HIGH)
+        {
+            for (int pass = 0; pass < REFINE_PASSES; pass++)
+            {
+                float weights[16];
+
+                for (int i = 0; i < 16; i++)
+                {
+                    weights[i] = BC7_WEIGHTS[best.indices[i]] / 64.0f;
+                }
+
+                float e0[4];
+                float e1[4];
+
+                if (!LeastSquares(points, weights, 4, e0, e1))
+                {
+                    break;
+                }
+
+                bool improved = false;
+
+                for (int pBits = 0; pBits < 4; pBits++)
+                {
+                    BC7Candidate candidate = FitBC7(texels, e0, e1, pBits & 1, pBits >> 1);
+
+                    if (candidate.error < best.error)
+                    {
+                        best = candidate;
+                        improved = true;
+                    }
+                }
+
+                if (!improved)
+                {
+                    break;
+                }
+            }
+        }
+
+        // Texel 0 only has 3 index bits, its index must be below 8
+        if (best.indices[0] >= 8)
+        {
+            for (int c = 0; c < 4; c++)
+            {
+                std::swap(best.endpoints[0][c], best.endpoints[1][c]);
+            }
+
+            std::swap(best.pBits[0], best.pBits[1]);
+
+            for (int i = 0; i < 16; i++)
+            {
+                best.indices[i] = (unsigned char) (15 - best.indices[i]);
+            }
+        }
+
+        std::memset(block, 0, 16);
+        BitWriter writer = { block, 0 };
+        writer.Write(1 << 6, 7);
+
+        for (int c = 0; c < 4; c++)
+        {
+            writer.Write((unsigned int) best.endpoints[0][c], 7);
+            writer.Write((unsigned int) best.endpoints[1][c], 7);
+        }
+
+        writer.Write((unsigned int) best.pBits[0], 1);
+        writer.Write((unsigned int) best.pBits[1], 1);
+        writer.Write(best.indices[0], 3);
+
+        for (int i = 1; i < 16; i++)
+        {
+            writer.Write(best.indices[i], 4);
+        }
+    }
+
+    void DecodeBC7Block(const unsigned char* block, unsigned char* texels)
+    {
+        BitReader reader = { block, 0 };
+
+        if (reader.Read(7) != (1 << 6))
+        {
+            for (int i = 0; i < 16; i++)
+            {
+                texels[i * 4 + 0] = 255;
+                texels[i * 4 + 1] = 0;
+                texels[i * 4 + 2] = 255;
+                texels[i * 4 + 3] = 255;
+            }
+
+            return;
+        }
+
+        int endpoints[2][4];
+        int pBits[2];
+
+        for (int c = 0; c < 4; c++)
+        {
+            endpoints[0][c] = (int) reader.Read(7);
+            endpoints[1][c] = (int) reader.Read(7);
+        }
+
+        pBits[0] = (int) reader.Read(1);
+        pBits[1] = (int) reader.Read(1);
+
+        int palette[16][4];
+        BC7Palette(endpoints, pBits, palette);
+
+        for (int i = 0; i < 16; i++)
+        {
+            const int* color = palette[reader.Read(i == 0 ? 3 : 4)];
+
+            for (int c = 0; c < 4; c++)
+            {
+                texels[i * 4 + c] = (unsigned char) color[c];
+            }
+        }
+    }
+
+    typedef std::function<void(unsigned int begin, unsigned int end)> RowBody;
+
+    void ForBlockRows(ThreadPool* threadPool, unsigned int rows, unsigned int blocksPerRow, const RowBody& body)
+    {
+        unsigned int grain = std::max(1u, BLOCKS_PER_CHUNK / std::max(blocksPerRow, 1u));
+
+        if (threadPool == nullptr || rows <= grain)
+        {
+            body(0, rows);
+        }
+        else
+        {
+            threadPool->ParallelFor(rows, grain, body);
+        }
+    }
+
+    size_t GetBlockBytes(TextureFormat format)
+    {
+        return format == TEXTURE_FORMAT_BC1 || format == TEXTURE_FORMAT_BC1_SRGB ? 8 : 16;
+    }
+}
+
+void EncodeBlock(TextureFormat format, const unsigned char* texels, CompressionQuality quality,
+                 unsigned char* block)
+{
+    switch (format)
+    {
+        case TEXTURE_FORMAT_BC1:
+        case TEXTURE_FORMAT_BC1_SRGB:
+            EncodeColorBlock(texels, true, quality, block);
+            break;
+        case TEXTURE_FORMAT_BC3:
+        case TEXTURE_FORMAT_BC3_SRGB:
+            EncodeChannel(texels, 3, quality, block);
+            EncodeColorBlock(texels, false, quality, block + 8);
+            break;
+        case TEXTURE_FORMAT_BC5:
+            EncodeChannel(texels, 0, quality, block);
+            EncodeChannel(texels, 1, quality, block + 8);
+            break;
+        case TEXTURE_FORMAT_BC7:
+        case TEXTURE_FORMAT_BC7_SRGB:
+            EncodeBC7Block(texels, quality, block);
+            break;
+        default:
+            break;
+    }
+}
+
+void DecodeBlock(TextureFormat format, const unsigned char* block, unsigned char* texels)
+{
+    switch (format)
+    {
+        case TEXTURE_FORMAT_BC1:
+        case TEXTURE_FORMAT_BC1_SRGB:
+            DecodeColorBlock(block, false, texels);
+            break;
+        case TEXTURE_FORMAT_BC3:
+        case TEXTURE_FORMAT_BC3_SRGB:
+            DecodeColorBlock(block + 8, true, texels);
+            DecodeChannel(block, 3, texels);
+            break;
+        case TEXTURE_FORMAT_BC5:
+            for (int i = 0; i < 16; i++)
+            {
+                texels[i * 4 + 2] = 0;
+                texels[i * 4 + 3] = 255;
+            }
+
+            DecodeChannel(block, 0, texels);
+            DecodeChannel(block + 8, 1, texels);
+            break;
+        case TEXTURE_FORMAT_BC7:
+        case TEXTURE_FORMAT_BC7_SRGB:
+            DecodeBC7Block(block, texels);
+            break;
+        default:
+            break;
+    }
+}
+
+bool CompressTexture(const TextureData& source, TextureFormat format, CompressionQuality quality,
+                     ThreadPool* threadPool, TextureData& compressed)
+{
+    if (source.format != TEXTURE_FORMAT_RGBA8 && source.format != TEXTURE_FORMAT_SRGB8_ALPHA8)
+    {
+        std::cout << "Only RGBA8 textures can be compressed" << std::endl;
+        return false;
+    }
+
+    if (format != TEXTURE_FORMAT_BC1 && format != TEXTURE_FORMAT_BC3 && format != TEXTURE_FORMAT_BC5
+        && format != TEXTURE_FORMAT_BC7)
+    {
+        std::cout << "Unknown block format " << format << std::endl;
+        return false;
+    }
+
+    bool srgb = source.format == TEXTURE_FORMAT_SRGB8_ALPHA8;
+
+    if (srgb && format == TEXTURE_FORMAT_BC5)
+    {
+        std::cout << "BC5 has no sRGB variant" << std::endl;
+        return false;
+    }
+
+    // Every sRGB variant directly follows its linear format
+    compressed.format = srgb ? (TextureFormat) (format + 1) : format;
+    compressed.levels.resize(source.levels.size());
+
+    size_t blockBytes = GetBlockBytes(format);
+
+    for (size_t l = 0; l < source.levels.size(); l++)
+    {
+        const TextureImage& level = source.levels[l];
+        TextureImage& result = compressed.levels[l];
+        unsigned int blocksX = (level.width + 3) / 4;
+        unsigned int blocksY = (level.height + 3) / 4;
+
+        result.width = level.width;
+        result.height = level.height;
+        result.data.assign(GetTextureLevelBytes(compressed.format, level.width, level.height), 0);
+
+        ForBlockRows(threadPool, blocksY, blocksX, [&](unsigned int begin, unsigned int end) {
+            unsigned char texels[64];
+
+            for (unsigned int by = begin; by < end; by++)
+            {
+                for (unsigned int bx = 0; bx < blocksX; bx++)
+                {
+                    for (unsigned int y = 0; y < 4; y++)
+                    {
+                        unsigned int sy = std::min(by * 4 + y, level.height - 1);
+
+                        for (unsigned int x = 0; x < 4; x++)
+                        {
+                            unsigned int sx = std::min(bx * 4 + x, level.width - 1);
+                            std::memcpy(&texels[(y * 4 + x) * 4], &level.data[((size_t) sy * level.width + sx) * 4], 4);
+                        }
+                    }
+
+                    EncodeBlock(format, texels, quality, &result.data[((size_t) by * blocksX + bx) * blockBytes]);
+                }
+            }
+        });
+    }
+
+    return true;
+}
+
+bool DecompressTexture(const TextureData& compressed, ThreadPool* threadPool, TextureData& rgba)
+{
+    if (!IsCompressedFormat(compressed.format))
+    {
+        std::cout << "Texture is not block compressed" << std::endl;
+        return false;
+    }
+
+    rgba.format = IsSRGBFormat(compressed.format) ? TEXTURE_FORMAT_SRGB8_ALPHA8 : TEXTURE_FORMAT_RGBA8;
+    rgba.levels.resize(compressed.levels.size());
+
+    size_t blockBytes = GetBlockBytes(compressed.format);
+
+    for (size_t l = 0; l < compressed.levels.size(); l++)
+    {
+        const TextureImage& level = compressed.levels[l];
+        TextureImage& result = rgba.levels[l];
+        unsigned int blocksX = (level.width + 3) / 4;
+        unsigned int blocksY = (level.height + 3) / 4;
+
+        if (level.data.size() < GetTextureLevelBytes(compressed.format, level.width, level.height))
+        {
+            std::cout << "Texture level " << l << " is truncated" << std::endl;
+            return false;
+        }
+
+        result.width = level.width;
+        result.height = level.height;
+        result.data.resize(GetTextureLevelBytes(rgba.format, level.width, level.height));
+
+        ForBlockRows(threadPool, blocksY, blocksX, [&](unsigned int begin, unsigned int end) {
+            unsigned char texels[64];
+
+            for (unsigned int by = begin; by < end; by++)
+            {
+                for (unsigned int bx = 0; bx < blocksX; bx++)
+                {
+                    DecodeBlock(compressed.format, &level.data[((size_t) by * blocksX + bx) * blockBytes], texels);
+
+                    // Edge blocks hang over the level
+                    for (unsigned int y = 0; y < 4 && by * 4 + y < level.height; y++)
+                    {
+                        for (unsigned int x = 0; x < 4 && bx * 4 + x < level.width; x++)
+                        {
+                            size_t offset = ((size_t) (by * 4 + y) * level.width + bx * 4 + x) * 4;
+                            std::memcpy(&result.data[offset], &texels[(y * 4 + x) * 4], 4);
+                        }
+                    }
+                }
+            }
+        });
+    }
+
+    return true;
+}
+
+double ComputePSNR(const unsigned char* a, const unsigned char* b, size_t texelCount,
+                   unsigned int channelMask)
+{
+    double sum = 0.0;
+    size_t samples = 0;
+
+    for (int c = 0; c < 4; c++)
+    {
+        if ((channelMask & (1u << c)) == 0)
+        {
+            continue;
+        }
+
+        for (size_t i = 0; i < texelCount; i++)
+        {
+            double d = (double) a[i * 4 + c] - b[i * 4 + c];
+            sum += d * d;
+        }
+
+        samples += texelCount;
+    }
+
+    if (samples == 0 || sum == 0.0)
+    {
+        return std::numeric_limits<double>::infinity();
+    }
+
+    return 10.0 * std::log10(255.0 * 255.0 / (sum / samples));
+}
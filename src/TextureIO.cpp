@@ -0,0 +1,205 @@
+#include "TextureIO.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace {
+    const size_t LEVEL_ALIGNMENT = 16;
+
+    size_t Align(size_t value)
+    {
+        return (value + LEVEL_ALIGNMENT - 1) / LEVEL_ALIGNMENT * LEVEL_ALIGNMENT;
+    }
+
+    bool IsKnownFormat(unsigned int format)
+    {
+        return format <= TEXTURE_FORMAT_BC7_SRGB;
+    }
+}
+
+size_t GetTextureLevelBytes(TextureFormat format, unsigned int width, unsigned int height)
+{
+    size_t blocks = (size_t) ((width + 3) / 4) * ((height + 3) / 4);
+
+    switch (format)
+    {
+        case TEXTURE_FORMAT_RGBA8:
+        case TEXTURE_FORMAT_SRGB8_ALPHA8:
+            return (size_t) width * height * 4;
+        case TEXTURE_FORMAT_BC1:
+        case TEXTURE_FORMAT_BC1_SRGB:
+            return blocks * 8;
+        case TEXTURE_FORMAT_BC3:
+        case TEXTURE_FORMAT_BC3_SRGB:
+        case TEXTURE_FORMAT_BC5:
+        case TEXTURE_FORMAT_BC7:
+        case TEXTURE_FORMAT_BC7_SRGB:
+            return blocks * 16;
+    }
+
+    return 0;
+}
+
+bool IsCompressedFormat(TextureFormat format)
+{
+    return format >= TEXTURE_FORMAT_BC1;
+}
+
+bool IsSRGBFormat(TextureFormat format)
+{
+    return format == TEXTURE_FORMAT_SRGB8_ALPHA8 || format == TEXTURE_FORMAT_BC1_SRGB
+        || format == TEXTURE_FORMAT_BC3_SRGB || format == TEXTURE_FORMAT_BC7_SRGB;
+}
+
+unsigned int GetFullMipCount(unsigned int width, unsigned int height)
+{
+    unsigned int count = 1;
+
+    while (width > 1 || height > 1)
+    {
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+        count++;
+    }
+
+    return count;
+}
+
+void SerializeTexture(const TextureData& texture, std::vector<unsigned char>& bytes)
+{
+    TextureFileHeader header;
+    std::memcpy(header.magic, "TEX1", 4);
+    header.version = TEXTURE_FILE_VERSION;
+    header.format = texture.format;
+    header.width = texture.levels.empty() ? 0 : texture.levels[0].width;
+    header.height = texture.levels.empty() ? 0 : texture.levels[0].height;
+    header.levelCount = (unsigned int) texture.levels.size();
+
+    std::vector<TextureLevel> levels(texture.levels.size());
+    size_t offset = Align(sizeof(header) + levels.size() * sizeof(TextureLevel));
+
+    // Coarsest first
+    for (size_t i = levels.size(); i-- > 0;)
+    {
+        levels[i].width = texture.levels[i].width;
+        levels[i].height = texture.levels[i].height;
+        levels[i].offset = offset;
+        levels[i].size = texture.levels[i].data.size();
+        offset = Align(offset + texture.levels[i].data.size());
+    }
+
+    bytes.assign(offset, 0);
+    std::memcpy(bytes.data(), &header, sizeof(header));
+
+    if (!levels.empty())
+    {
+        std::memcpy(bytes.data() + sizeof(header), levels.data(), levels.size() * sizeof(TextureLevel));
+    }
+
+    for (size_t i = 0; i < levels.size(); i++)
+    {
+        if (!texture.levels[i].data.empty())
+        {
+            std::memcpy(bytes.data() + levels[i].offset, texture.levels[i].data.data(), levels[i].size);
+        }
+    }
+}
+
+bool SaveTextureBinary(const std::string& fileName, const TextureData& texture)
+{
+    std::ofstream myFile(fileName.c_str(), std::ios::binary);
+
+    if (!myFile.is_open())
+    {
+        std::cout << "Could not open " << fileName << " for writing" << std::endl;
+        return false;
+    }
+
+    std::vector<unsigned char> bytes;
+    SerializeTexture(texture, bytes);
+
+    myFile.write((const char*) bytes.data(), bytes.size());
+
+    return myFile.good();
+}
+
+bool ReadTextureLevels(const unsigned char* data, size_t size, TextureFileHeader& header,
+                       std::vector<TextureLevel>& levels)
+{
+    if (size < sizeof(header))
+    {
+        std::cout << "Texture data is truncated" << std::endl;
+        return false;
+    }
+
+    std::memcpy(&header, data, sizeof(header));
+
+    if (std::memcmp(header.magic, "TEX1", 4) != 0 || header.version != TEXTURE_FILE_VERSION)
+    {
+        std::cout << "Not texture data (or wrong version)" << std::endl;
+        return false;
+    }
+
+    if (!IsKnownFormat(header.format) || header.width == 0 || header.height == 0 || header.levelCount == 0
+        || header.levelCount > GetFullMipCount(header.width, header.height))
+    {
+        std::cout << "Texture format " << header.format << " with " << header.levelCount
+                  << " levels is not supported" << std::endl;
+        return false;
+    }
+
+    if (size < sizeof(header) + (size_t) header.levelCount * sizeof(TextureLevel))
+    {
+        std::cout << "Texture data is truncated" << std::endl;
+        return false;
+    }
+
+    levels.resize(header.levelCount);
+    std::memcpy(levels.data(), data + sizeof(header), header.levelCount * sizeof(TextureLevel));
+
+    unsigned int width = header.width;
+    unsigned int height = header.height;
+
+    for (size_t i = 0; i < levels.size(); i++)
+    {
+        const TextureLevel& level = levels[i];
+
+        // Every level must be half the one before, the GPU relies on it
+        if (level.width != width || level.height != height
+            || level.size != GetTextureLevelBytes((TextureFormat) header.format, width, height)
+            || level.offset > size || level.size > size - level.offset)
+        {
+            std::cout << "Texture level " << i << " is out of range" << std::endl;
+            return false;
+        }
+
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+    }
+
+    return true;
+}
+
+bool LoadTextureFromMemory(const unsigned char* data, size_t size, TextureData& texture)
+{
+    TextureFileHeader header;
+    std::vector<TextureLevel> levels;
+
+    if (!ReadTextureLevels(data, size, header, levels))
+    {
+        return false;
+    }
+
+    texture.format = (TextureFormat) header.format;
+    texture.levels.resize(levels.size());
+
+    for (size_t i = 0; i < levels.size(); i++)
+    {
+        texture.levels[i].width = levels[i].width;
+        texture.levels[i].height = levels[i].height;
+        texture.levels[i].data.assign(data + levels[i].offset, data + levels[i].offset + levels[i].size);
+    }
+
+    return true;
+}
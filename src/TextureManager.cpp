@@ -0,0 +1,534 @@
+#include "TextureManager.hpp"
+#include "MipGenerator.hpp"
+#include "TextureCompressor.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <thread>
+
+namespace {
+    // Levels up to this size are uploaded with the texture and never dropped
+    const unsigned int TAIL_SIZE = 64;
+    // Frames without a request before a texture only wants its tail
+    const unsigned long long IDLE_FRAMES = 120;
+
+    GLenum GetInternalFormat(TextureFormat format)
+    {
+        switch (format)
+        {
+            case TEXTURE_FORMAT_RGBA8:
+                return GL_RGBA8;
+            case TEXTURE_FORMAT_SRGB8_ALPHA8:
+                return GL_SRGB8_ALPHA8;
+            case TEXTURE_FORMAT_BC1:
+                return GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+            case TEXTURE_FORMAT_BC1_SRGB:
+                return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT;
+            case TEXTURE_FORMAT_BC3:
+                return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+            case TEXTURE_FORMAT_BC3_SRGB:
+                return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT;
+            case TEXTURE_FORMAT_BC5:
+                return GL_COMPRESSED_RG_RGTC2;
+            case TEXTURE_FORMAT_BC7:
+                return GL_COMPRESSED_RGBA_BPTC_UNORM_ARB;
+            case TEXTURE_FORMAT_BC7_SRGB:
+                return GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM_ARB;
+        }
+
+        return GL_RGBA8;
+    }
+
+    // Whether the driver takes the blocks as they are, by the extensions
+    // glad found when the context was created
+    bool IsFormatSupported(TextureFormat format)
+    {
+        switch (format)
+        {
+            case TEXTURE_FORMAT_BC1:
+            case TEXTURE_FORMAT_BC3:
+                return GLAD_GL_EXT_texture_compression_s3tc != 0;
+            case TEXTURE_FORMAT_BC1_SRGB:
+            case TEXTURE_FORMAT_BC3_SRGB:
+                return GLAD_GL_EXT_texture_compression_s3tc != 0 && GLAD_GL_EXT_texture_sRGB != 0;
+            case TEXTURE_FORMAT_BC5:
+                return true; // RGTC is core since 3.0
+            case TEXTURE_FORMAT_BC7:
+            case TEXTURE_FORMAT_BC7_SRGB:
+                return GLAD_GL_ARB_texture_compression_bptc != 0;
+            default:
+                return true;
+        }
+    }
+
+    // The first level that is small enough to always be resident
+    int GetTailLevel(const TextureAsset* texture)
+    {
+        int level = 0;
+
+        while (level + 1 < (int) texture->mLevels.size()
+               && std::max(texture->mLevels[level].width, texture->mLevels[level].height) > TAIL_SIZE)
+        {
+            level++;
+        }
+
+        return level;
+    }
+}
+
+TextureManager::TextureManager(ThreadPool* threadPool, const VirtualFileSystem* fileSystem,
+                               GLsizeiptr budgetBytes, GLsizeiptr uploadBytesPerFrame)
+    : mWorkerJobs(0)
+{
+    mThreadPool = threadPool;
+    mFileSystem = fileSystem;
+    mUploadBytesPerFrame = uploadBytesPerFrame;
+    mFrame = 1;
+    mStats.budgetBytes = budgetBytes;
+}
+
+TextureManager::~TextureManager()
+{
+    // Workers still hold pointers to our textures
+    while (mWorkerJobs.load() != 0)
+    {
+        std::this_thread::yield();
+    }
+
+    for (size_t i = 0; i < mTextures.size(); i++)
+    {
+        if (mTextures[i]->mTexture != 0)
+        {
+            glDeleteTextures(1, &mTextures[i]->mTexture);
+        }
+
+        delete mTextures[i];
+    }
+}
+
+TextureAsset* TextureManager::Load(const std::string& fileName)
+{
+    TextureAsset* texture = new TextureAsset();
+    texture->mPath = fileName;
+    mTextures.push_back(texture);
+    mStats.textures++;
+    mWorkerJobs++;
+
+    mThreadPool->Submit([this, texture]() {
+        texture->mState = ASSET_LOADING;
+
+        // Levels are uploaded straight out of the archive mapping when we can
+        const unsigned char* data = nullptr;
+        size_t size = 0;
+
+        if (!mFileSystem->GetView(texture->mPath, data, size)
+            && mFileSystem->ReadFile(texture->mPath, texture->mFile))
+        {
+            data = texture->mFile.data();
+            size = texture->mFile.size();
+        }
+
+        TextureFileHeader header;
+        bool valid = data != nullptr && ReadTextureLevels(data, size, header, texture->mLevels);
+
+        // Block formats the driver lacks are decoded here, at 4-8x the memory
+        if (valid && !IsFormatSupported((TextureFormat) header.format))
+        {
+            TextureData compressed;
+            TextureData rgba;
+
+            valid = LoadTextureFromMemory(data, size, compressed) && DecompressTexture(compressed, mThreadPool, rgba);
+
+            if (valid)
+            {
+                std::cout << "No driver support for the blocks of " << texture->mPath << ", decoded on the CPU" << std::endl;
+                SerializeTexture(rgba, texture->mFile);
+
+                data = texture->mFile.data();
+                size = texture->mFile.size();
+                valid = ReadTextureLevels(data, size, header, texture->mLevels);
+            }
+        }
+
+        // A lone full size level gets its chain here instead of from
+        // glGenerateMipmap. Normal maps and block formats need mipgen
+        // beforehand.
+        if (valid && header.levelCount == 1 && GetFullMipCount(header.width, header.height) > 1
+            && !IsCompressedFormat((TextureFormat) header.format))
+        {
+            TextureData source;
+            TextureData chain;
+            MipOptions options;
+            options.srgb = header.format == TEXTURE_FORMAT_SRGB8_ALPHA8;
+
+            valid = LoadTextureFromMemory(data, size, source);
+
+            if (valid)
+            {
+                GenerateMips(source.levels[0].data.data(), header.width, header.height, options, mThreadPool, chain);
+                SerializeTexture(chain, texture->mFile);
+
+                data = texture->mFile.data();
+                size = texture->mFile.size();
+                valid = ReadTextureLevels(data, size, header, texture->mLevels);
+            }
+        }
+
+        if (valid)
+        {
+            texture->mFormat = (TextureFormat) header.format;
+            texture->mFileData = data;
+            texture->mState = ASSET_UPLOADING;
+
+            std::lock_guard<std::mutex> lock(mLoadedMutex);
+            mLoaded.push_back(texture);
+        }
+        else
+        {
+            std::cout << "Could not load texture " << texture->mPath << std::endl;
+            texture->mState = ASSET_FAILED;
+        }
+
+        mWorkerJobs--;
+    });
+
+    return texture;
+}
+
+TextureAsset* TextureManager::Create(const std::string& name, const TextureData& data)
+{
+    TextureAsset* texture = new TextureAsset();
+    texture->mPath = name;
+    mTextures.push_back(texture);
+    mStats.textures++;
+
+    TextureFileHeader header;
+    SerializeTexture(data, texture->mFile);
+
+    if (!ReadTextureLevels(texture->mFile.data(), texture->mFile.size(), header, texture->mLevels))
+    {
+        std::cout << "Could not create texture " << name << std::endl;
+        texture->mState = ASSET_FAILED;
+        return texture;
+    }
+
+    texture->mFormat = data.format;
+    texture->mFileData = texture->mFile.data();
+    texture->mState = ASSET_UPLOADING;
+
+    std::lock_guard<std::mutex> lock(mLoadedMutex);
+    mLoaded.push_back(texture);
+
+    return texture;
+}
+
+bool TextureManager::ReadTexture(const TextureAsset* texture, TextureData& data) const
+{
+    if (!texture->IsReady())
+    {
+        return false;
+    }
+
+    data.format = texture->mFormat;
+    data.levels.resize(texture->mLevels.size());
+
+    for (size_t i = 0; i < texture->mLevels.size(); i++)
+    {
+        const TextureLevel& level = texture->mLevels[i];
+        data.levels[i].width = level.width;
+        data.levels[i].height = level.height;
+        data.levels[i].data.assign(texture->mFileData + level.offset, texture->mFileData + level.offset + level.size);
+    }
+
+    return true;
+}
+
+void TextureManager::Unload(TextureAsset* texture)
+{
+    if (!texture->IsReady())
+    {
+        return;
+    }
+
+    glDeleteTextures(1, &texture->mTexture);
+    texture->mTexture = 0;
+
+    mStats.residentBytes -= texture->mResidentBytes;
+    mStats.textures--;
+    texture->mResidentBytes = 0;
+
+    std::vector<TextureLevel>().swap(texture->mLevels);
+    std::vector<unsigned char>().swap(texture->mFile);
+    texture->mFileData = nullptr;
+    texture->mState = ASSET_RELEASED;
+}
+
+void TextureManager::Request(TextureAsset* texture, float screenPixels)
+{
+    if (!texture->IsReady() || screenPixels <= 0.0f)
+    {
+        return;
+    }
+
+    // Every level down halves the texels, one texel per pixel is enough
+    const TextureLevel& full = texture->mLevels[0];
+    float texels = (float) std::max(full.width, full.height);
+    int level = (int) std::floor(std::log2(std::max(texels / screenPixels, 1.0f)));
+    level = std::min(level, (int) texture->mLevels.size() - 1);
+
+    if (texture->mLastRequestFrame != mFrame)
+    {
+        texture->mLastRequestFrame = mFrame;
+        texture->mRequestedLevel = level;
+    }
+    else
+    {
+        texture->mRequestedLevel = std::min(texture->mRequestedLevel, level);
+    }
+}
+
+void TextureManager::Update()
+{
+    mStats.uploadedBytesThisFrame = 0;
+    mStats.levelsStreamedThisFrame = 0;
+    mStats.levelsDroppedThisFrame = 0;
+    mStats.overBudget = false;
+
+    for (;;)
+    {
+        TextureAsset* texture = nullptr;
+
+        {
+            std::lock_guard<std::mutex> lock(mLoadedMutex);
+
+            if (mLoaded.empty())
+            {
+                break;
+            }
+
+            texture = mLoaded.front();
+            mLoaded.pop_front();
+        }
+
+        CreateTexture(texture);
+    }
+
+    for (size_t i = 0; i < mTextures.size(); i++)
+    {
+        TextureAsset* texture = mTextures[i];
+
+        if (!texture->IsReady())
+        {
+            continue;
+        }
+
+        if (texture->mLastRequestFrame == mFrame)
+        {
+            texture->mWantedLevel = std::min(texture->mRequestedLevel, GetTailLevel(texture));
+        }
+        else if (mFrame - texture->mLastRequestFrame > IDLE_FRAMES)
+        {
+            texture->mWantedLevel = GetTailLevel(texture);
+        }
+    }
+
+    // Finer levels for the textures that are the furthest from what the
+    // screen asks for, within the upload budget. A level larger than the
+    // whole budget still goes, on its own.
+    GLsizeiptr budget = mUploadBytesPerFrame;
+
+    while (budget > 0)
+    {
+        TextureAsset* best = nullptr;
+
+        for (size_t i = 0; i < mTextures.size(); i++)
+        {
+            TextureAsset* texture = mTextures[i];
+
+            if (!texture->IsReady() || texture->mResidentLevel <= texture->mWantedLevel)
+            {
+                continue;
+            }
+
+            if (best == nullptr
+                || texture->mResidentLevel - texture->mWantedLevel > best->mResidentLevel - best->mWantedLevel)
+            {
+                best = texture;
+            }
+        }
+
+        if (best == nullptr)
+        {
+            break;
+        }
+
+        int level = best->mResidentLevel - 1;
+        GLsizeiptr bytes = (GLsizeiptr) best->mLevels[level].size;
+
+        if (bytes > budget && mStats.uploadedBytesThisFrame > 0)
+        {
+            break;
+        }
+
+        if (!MakeRoom(bytes, best))
+        {
+            mStats.overBudget = true;
+            break;
+        }
+
+        UploadLevel(best, level);
+        budget -= bytes;
+    }
+
+    mStats.streamingTextures = 0;
+
+    for (size_t i = 0; i < mTextures.size(); i++)
+    {
+        if (mTextures[i]->IsReady() && mTextures[i]->mResidentLevel > mTextures[i]->mWantedLevel)
+        {
+            mStats.streamingTextures++;
+        }
+    }
+
+    mFrame++;
+}
+
+void TextureManager::SetBudget(GLsizeiptr budgetBytes)
+{
+    mStats.budgetBytes = budgetBytes;
+}
+
+const TextureStats& TextureManager::GetStats() const
+{
+    return mStats;
+}
+
+/*
+    Create the GL texture with just the tail levels. Nothing else may be
+    sampled until finer levels arrive.
+*/
+void TextureManager::CreateTexture(TextureAsset* texture)
+{
+    int levelCount = (int) texture->mLevels.size();
+
+    glGenTextures(1, &texture->mTexture);
+    glBindTexture(GL_TEXTURE_2D, texture->mTexture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    texture->mResidentLevel = levelCount;
+    int tail = GetTailLevel(texture);
+
+    for (int level = levelCount - 1; level >= tail; level--)
+    {
+        UploadLevel(texture, level);
+    }
+
+    texture->mWantedLevel = tail;
+    texture->mState = ASSET_READY;
+}
+
+void TextureManager::UploadLevel(TextureAsset* texture, int level)
+{
+    const TextureLevel& source = texture->mLevels[level];
+
+    glBindTexture(GL_TEXTURE_2D, texture->mTexture);
+
+    if (IsCompressedFormat(texture->mFormat))
+    {
+        glCompressedTexImage2D(GL_TEXTURE_2D, level, GetInternalFormat(texture->mFormat), source.width, source.height,
+                               0, (GLsizei) source.size, texture->mFileData + source.offset);
+    }
+    else
+    {
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glTexImage2D(GL_TEXTURE_2D, level, GetInternalFormat(texture->mFormat), source.width, source.height, 0,
+                     GL_RGBA, GL_UNSIGNED_BYTE, texture->mFileData + source.offset);
+    }
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    texture->mResidentLevel = level;
+    texture->mResidentBytes += (GLsizeiptr) source.size;
+
+    mStats.residentBytes += (GLsizeiptr) source.size;
+    mStats.uploadedBytesThisFrame += (GLsizeiptr) source.size;
+    mStats.uploadedBytesTotal += source.size;
+    mStats.levelsStreamedThisFrame++;
+}
+
+/*
+    Drop the finest resident level. Moving the base level up first keeps the
+    texture complete, the 0x0 image then frees the storage.
+*/
+void TextureManager::DropLevel(TextureAsset* texture)
+{
+    int level = texture->mResidentLevel;
+    const TextureLevel& source = texture->mLevels[level];
+
+    glBindTexture(GL_TEXTURE_2D, texture->mTexture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level + 1);
+
+    if (IsCompressedFormat(texture->mFormat))
+    {
+        glCompressedTexImage2D(GL_TEXTURE_2D, level, GetInternalFormat(texture->mFormat), 0, 0, 0, 0, nullptr);
+    }
+    else
+    {
+        glTexImage2D(GL_TEXTURE_2D, level, GetInternalFormat(texture->mFormat), 0, 0, 0,
+                     GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    }
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    texture->mResidentLevel = level + 1;
+    texture->mResidentBytes -= (GLsizeiptr) source.size;
+
+    mStats.residentBytes -= (GLsizeiptr) source.size;
+    mStats.levelsDroppedThisFrame++;
+}
+
+/*
+    Drop levels nobody needs, least recently drawn texture first, until
+    bytes more fit the budget. Tails and the levels the screen currently
+    wants are never dropped.
+
+    @return true when there is room.
+*/
+bool TextureManager::MakeRoom(GLsizeiptr bytes, const TextureAsset* keep)
+{
+    while (mStats.residentBytes + bytes > mStats.budgetBytes)
+    {
+        TextureAsset* victim = nullptr;
+
+        for (size_t i = 0; i < mTextures.size(); i++)
+        {
+            TextureAsset* texture = mTextures[i];
+
+            if (texture == keep || !texture->IsReady() || texture->mResidentLevel >= texture->mWantedLevel)
+            {
+                continue;
+            }
+
+            if (victim == nullptr || texture->mLastRequestFrame < victim->mLastRequestFrame)
+            {
+                victim = texture;
+            }
+        }
+
+        if (victim == nullptr)
+        {
+            return false;
+        }
+
+        DropLevel(victim);
+    }
+
+    return true;
+}
@@ -0,0 +1,161 @@
+#include "ThreadPool.hpp"
+
+#include <atomic>
+#include <memory>
+
+ThreadPool::ThreadPool(unsigned int workerCount)
+{
+    mShutdown = false;
+
+    for (unsigned int i = 0; i < workerCount; i++)
+    {
+        mWorkers.push_back(std::thread(&ThreadPool::WorkerMain, this));
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mShutdown = true;
+    }
+
+    mWakeUp.notify_all();
+
+    for (size_t i = 0; i < mWorkers.size(); i++)
+    {
+        mWorkers[i].join();
+    }
+}
+
+void ThreadPool::Submit(const std::function<void()>& job)
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mJobs.push_back(job);
+    }
+
+    mWakeUp.notify_one();
+}
+
+namespace {
+    // Shared between the caller of ParallelFor and the helper jobs, which
+    // may still be sitting in the queue after the loop is finished.
+    struct ParallelForState {
+        std::atomic<unsigned int> nextChunk;
+        std::atomic<unsigned int> chunksDone;
+        unsigned int chunkCount;
+        unsigned int count;
+        unsigned int grain;
+        std::function<void(unsigned int, unsigned int)> body;
+        std::mutex mutex;
+        std::condition_variable finished;
+    };
+
+    void RunChunks(ParallelForState* state)
+    {
+        unsigned int chunk;
+
+        while ((chunk = state->nextChunk.fetch_add(1)) < state->chunkCount)
+        {
+            unsigned int begin = chunk * state->grain;
+            unsigned int end = begin + state->grain;
+
+            if (end > state->count)
+            {
+                end = state->count;
+            }
+
+            state->body(begin, end);
+
+            if (state->chunksDone.fetch_add(1) + 1 == state->chunkCount)
+            {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                state->finished.notify_all();
+            }
+        }
+    }
+}
+
+void ThreadPool::ParallelFor(unsigned int count, unsigned int grain,
+                             const std::function<void(unsigned int begin, unsigned int end)>& body)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    if (grain == 0)
+    {
+        grain = 1;
+    }
+
+    std::shared_ptr<ParallelForState> state(new ParallelForState());
+    state->nextChunk = 0;
+    state->chunksDone = 0;
+    state->chunkCount = (count + grain - 1) / grain;
+    state->count = count;
+    state->grain = grain;
+    state->body = body;
+
+    // No point waking up more workers than there are chunks
+    unsigned int helpers = state->chunkCount - 1;
+
+    if (helpers > mWorkers.size())
+    {
+        helpers = (unsigned int) mWorkers.size();
+    }
+
+    for (unsigned int i = 0; i < helpers; i++)
+    {
+        Submit([state]() { RunChunks(state.get()); });
+    }
+
+    RunChunks(state.get());
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+
+    while (state->chunksDone.load() < state->chunkCount)
+    {
+        state->finished.wait(lock);
+    }
+}
+
+unsigned int ThreadPool::GetWorkerCount() const
+{
+    return (unsigned int) mWorkers.size();
+}
+
+unsigned int ThreadPool::DefaultWorkerCount()
+{
+    unsigned int hardwareThreads = std::thread::hardware_concurrency();
+
+    return hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+}
+
+void ThreadPool::WorkerMain()
+{
+    while (true)
+    {
+        std::function<void()> job;
+
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+
+            while (!mShutdown && mJobs.empty())
+            {
+                mWakeUp.wait(lock);
+            }
+
+            if (mShutdown && mJobs.empty())
+            {
+                return;
+            }
+
+            job = mJobs.front();
+            mJobs.pop_front();
+        }
+
+        job();
+    }
+}
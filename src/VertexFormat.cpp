@@ -0,0 +1,233 @@
+#include "VertexFormat.hpp"
+
+#include <glm/packing.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include <cstring>
+
+namespace {
+    // The position goes to a stream of its own, the others are interleaved
+    void AddAttribute(VertexLayout& layout, GLuint location, GLint components,
+                      GLenum type, GLboolean normalized, GLsizei size)
+    {
+        GLsizei& stride = location == ATTRIBUTE_POSITION ? layout.positionStride : layout.stride;
+
+        VertexAttribute attribute;
+        attribute.location = location;
+        attribute.components = components;
+        attribute.type = type;
+        attribute.normalized = normalized;
+        attribute.offset = stride;
+
+        layout.attributes.push_back(attribute);
+        stride += size;
+    }
+
+    void SetAttributePointer(const VertexAttribute& attribute, GLsizei stride, size_t streamOffset)
+    {
+        glEnableVertexAttribArray(attribute.location);
+        glVertexAttribPointer(
+            attribute.location,
+            attribute.components,
+            attribute.type,
+            attribute.normalized,
+            stride,
+            (GLvoid*) (streamOffset + attribute.offset)
+        );
+    }
+
+    const VertexAttribute* FindAttribute(const VertexLayout& layout, GLuint location)
+    {
+        for (size_t i = 0; i < layout.attributes.size(); i++)
+        {
+            if (layout.attributes[i].location == location)
+            {
+                return &layout.attributes[i];
+            }
+        }
+
+        return nullptr;
+    }
+
+    template <typename T>
+    void Store(unsigned char* destination, const T& value)
+    {
+        std::memcpy(destination, &value, sizeof(T));
+    }
+}
+
+VertexLayout MakeVertexLayout(VertexFormat format, NormalEncoding normalEncoding,
+                              bool hasNormals, bool hasUVs)
+{
+    VertexLayout layout;
+
+    if (format == VERTEX_FORMAT_FLOAT)
+    {
+        AddAttribute(layout, ATTRIBUTE_POSITION, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat));
+        AddAttribute(layout, ATTRIBUTE_COLOR, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat));
+
+        if (hasNormals)
+        {
+            AddAttribute(layout, ATTRIBUTE_NORMAL, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat));
+        }
+
+        if (hasUVs)
+        {
+            AddAttribute(layout, ATTRIBUTE_UV, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(GLfloat));
+        }
+
+        return layout;
+    }
+
+    // The fourth position component is padding, it keeps things 4 byte aligned
+    AddAttribute(layout, ATTRIBUTE_POSITION, 4, GL_UNSIGNED_SHORT, GL_TRUE, 4 * sizeof(GLushort));
+    AddAttribute(layout, ATTRIBUTE_COLOR, 4, GL_UNSIGNED_BYTE, GL_TRUE, 4 * sizeof(GLubyte));
+
+    if (hasNormals)
+    {
+        if (normalEncoding == NORMAL_ENCODING_OCTAHEDRAL)
+        {
+            AddAttribute(layout, ATTRIBUTE_NORMAL, 2, GL_SHORT, GL_TRUE, 2 * sizeof(GLshort));
+        }
+        else
+        {
+            AddAttribute(layout, ATTRIBUTE_NORMAL, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(GLuint));
+        }
+    }
+
+    if (hasUVs)
+    {
+        AddAttribute(layout, ATTRIBUTE_UV, 2, GL_HALF_FLOAT, GL_FALSE, 2 * sizeof(GLhalf));
+    }
+
+    return layout;
+}
+
+void EncodeVertices(const VertexLayout& layout, VertexFormat format, NormalEncoding normalEncoding,
+                    size_t vertexCount, const GLfloat* positionsAndColors,
+                    const GLfloat* normals, const GLfloat* uvs,
+                    glm::vec3 boundsMin, glm::vec3 boundsExtent,
+                    std::vector<unsigned char>& stream)
+{
+    stream.resize(GetVertexBytes(layout, vertexCount));
+
+    const VertexAttribute* position = FindAttribute(layout, ATTRIBUTE_POSITION);
+    const VertexAttribute* color = FindAttribute(layout, ATTRIBUTE_COLOR);
+    const VertexAttribute* normal = normals != nullptr ? FindAttribute(layout, ATTRIBUTE_NORMAL) : nullptr;
+    const VertexAttribute* uv = uvs != nullptr ? FindAttribute(layout, ATTRIBUTE_UV) : nullptr;
+
+    // Guard against a flat bounding box
+    glm::vec3 inverseExtent = 1.0f / glm::max(boundsExtent, glm::vec3(1e-20f));
+
+    for (size_t i = 0; i < vertexCount; i++)
+    {
+        unsigned char* positionVertex = stream.data() + i * layout.positionStride;
+        unsigned char* vertex = stream.data() + vertexCount * layout.positionStride + i * layout.stride;
+        glm::vec3 p(positionsAndColors[i * 6 + 0], positionsAndColors[i * 6 + 1], positionsAndColors[i * 6 + 2]);
+        glm::vec3 c(positionsAndColors[i * 6 + 3], positionsAndColors[i * 6 + 4], positionsAndColors[i * 6 + 5]);
+
+        if (format == VERTEX_FORMAT_FLOAT)
+        {
+            Store(positionVertex + position->offset, p);
+            Store(vertex + color->offset, c);
+
+            if (normal != nullptr)
+            {
+                Store(vertex + normal->offset, glm::vec3(normals[i * 3], normals[i * 3 + 1], normals[i * 3 + 2]));
+            }
+
+            if (uv != nullptr)
+            {
+                Store(vertex + uv->offset, glm::vec2(uvs[i * 2], uvs[i * 2 + 1]));
+            }
+
+            continue;
+        }
+
+        glm::vec3 relative = glm::clamp((p - boundsMin) * inverseExtent, 0.0f, 1.0f);
+        Store(positionVertex + position->offset, glm::packUnorm4x16(glm::vec4(relative, 0.0f)));
+        Store(vertex + color->offset, glm::packUnorm4x8(glm::vec4(c, 1.0f)));
+
+        if (normal != nullptr)
+        {
+            glm::vec3 n(normals[i * 3], normals[i * 3 + 1], normals[i * 3 + 2]);
+
+            if (normalEncoding == NORMAL_ENCODING_OCTAHEDRAL)
+            {
+                Store(vertex + normal->offset, glm::packSnorm2x16(EncodeOctahedral(n)));
+            }
+            else
+            {
+                Store(vertex + normal->offset, glm::packSnorm3x10_1x2(glm::vec4(glm::normalize(n), 0.0f)));
+            }
+        }
+
+        if (uv != nullptr)
+        {
+            Store(vertex + uv->offset, glm::packHalf2x16(glm::vec2(uvs[i * 2], uvs[i * 2 + 1])));
+        }
+    }
+}
+
+void ApplyVertexLayout(const VertexLayout& layout, size_t vertexCount)
+{
+    for (size_t i = 0; i < layout.attributes.size(); i++)
+    {
+        const VertexAttribute& attribute = layout.attributes[i];
+
+        if (attribute.location == ATTRIBUTE_POSITION)
+        {
+            SetAttributePointer(attribute, layout.positionStride, 0);
+        }
+        else
+        {
+            SetAttributePointer(attribute, layout.stride, vertexCount * layout.positionStride);
+        }
+    }
+}
+
+void ApplyPositionLayout(const VertexLayout& layout)
+{
+    const VertexAttribute* position = FindAttribute(layout, ATTRIBUTE_POSITION);
+
+    if (position != nullptr)
+    {
+        SetAttributePointer(*position, layout.positionStride, 0);
+    }
+}
+
+size_t GetVertexBytes(const VertexLayout& layout, size_t vertexCount)
+{
+    return vertexCount * (layout.positionStride + layout.stride);
+}
+
+glm::vec2 EncodeOctahedral(glm::vec3 normal)
+{
+    normal /= glm::abs(normal.x) + glm::abs(normal.y) + glm::abs(normal.z);
+
+    glm::vec2 encoded(normal.x, normal.y);
+
+    // Fold the lower hemisphere over the diagonals
+    if (normal.z < 0.0f)
+    {
+        encoded = (1.0f - glm::abs(glm::vec2(normal.y, normal.x)))
+                  * glm::vec2(normal.x >= 0.0f ? 1.0f : -1.0f, normal.y >= 0.0f ? 1.0f : -1.0f);
+    }
+
+    return encoded;
+}
+
+glm::vec3 DecodeOctahedral(glm::vec2 encoded)
+{
+    glm::vec3 normal(encoded.x, encoded.y, 1.0f - glm::abs(encoded.x) - glm::abs(encoded.y));
+
+    if (normal.z < 0.0f)
+    {
+        glm::vec2 folded = (1.0f - glm::abs(glm::vec2(normal.y, normal.x)))
+                           * glm::vec2(normal.x >= 0.0f ? 1.0f : -1.0f, normal.y >= 0.0f ? 1.0f : -1.0f);
+        normal.x = folded.x;
+        normal.y = folded.y;
+    }
+
+    return glm::normalize(normal);
+}
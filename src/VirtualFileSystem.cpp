@@ -0,0 +1,432 @@
+#include "VirtualFileSystem.hpp"
+#include "BlockCodec.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    // No asset comes close, a larger entry is corrupt and must not get
+    // that much memory
+    const uint64_t MAX_RAW_SIZE = 1ull << 30;
+}
+
+MappedFile::MappedFile()
+{
+    mData = nullptr;
+    mSize = 0;
+#ifdef _WIN32
+    mFileHandle = nullptr;
+    mMappingHandle = nullptr;
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+bool MappedFile::Open(const std::string& fileName)
+{
+    Close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    GetFileSizeEx(file, &size);
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+    if (mapping == nullptr)
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    mData = (const unsigned char*) MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+
+    if (mData == nullptr)
+    {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    mSize = (size_t) size.QuadPart;
+    mFileHandle = file;
+    mMappingHandle = mapping;
+#else
+    int file = open(fileName.c_str(), O_RDONLY);
+
+    if (file < 0)
+    {
+        return false;
+    }
+
+    struct stat info;
+
+    if (fstat(file, &info) != 0 || info.st_size == 0)
+    {
+        close(file);
+        return false;
+    }
+
+    void* data = mmap(nullptr, (size_t) info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+
+    // The mapping keeps the file alive
+    close(file);
+
+    if (data == MAP_FAILED)
+    {
+        return false;
+    }
+
+    mData = (const unsigned char*) data;
+    mSize = (size_t) info.st_size;
+#endif
+
+    return true;
+}
+
+void MappedFile::Close()
+{
+    if (mData == nullptr)
+    {
+        return;
+    }
+
+#ifdef _WIN32
+    UnmapViewOfFile(mData);
+    CloseHandle((HANDLE) mMappingHandle);
+    CloseHandle((HANDLE) mFileHandle);
+    mFileHandle = nullptr;
+    mMappingHandle = nullptr;
+#else
+    munmap((void*) mData, mSize);
+#endif
+
+    mData = nullptr;
+    mSize = 0;
+}
+
+const unsigned char* MappedFile::GetData() const
+{
+    return mData;
+}
+
+size_t MappedFile::GetSize() const
+{
+    return mSize;
+}
+
+VirtualFileSystem::VirtualFileSystem()
+{
+    mEntries = nullptr;
+    mEntryCount = 0;
+    mNames = nullptr;
+    mThreadPool = nullptr;
+}
+
+void VirtualFileSystem::SetThreadPool(ThreadPool* threadPool)
+{
+    mThreadPool = threadPool;
+}
+
+bool VirtualFileSystem::MountArchive(const std::string& fileName)
+{
+    if (!mArchive.Open(fileName))
+    {
+        return false;
+    }
+
+    const unsigned char* data = mArchive.GetData();
+    size_t size = mArchive.GetSize();
+    const PackHeader* header = (const PackHeader*) data;
+
+    // Written so that no sum can wrap around
+    if (size < sizeof(PackHeader) || std::memcmp(header->magic, "PAK1", 4) != 0
+        || header->version != PACK_VERSION
+        || header->entriesOffset > size
+        || header->entryCount > (size - header->entriesOffset) / sizeof(PackEntry)
+        || header->namesOffset > size)
+    {
+        std::cout << "Not a valid archive: " << fileName << std::endl;
+        mArchive.Close();
+        return false;
+    }
+
+    const PackEntry* entries = (const PackEntry*) (data + header->entriesOffset);
+    uint64_t namesSize = size - header->namesOffset;
+
+    // Every read later trusts the entries, so a truncated or corrupt archive
+    // is turned away here rather than read out of bounds
+    for (uint32_t i = 0; i < header->entryCount; i++)
+    {
+        const PackEntry& entry = entries[i];
+
+        if (entry.nameOffset > namesSize || entry.nameLength > namesSize - entry.nameOffset
+            || entry.offset > size || entry.storedSize > size - entry.offset
+            || (entry.compression == PACK_COMPRESSION_NONE && entry.rawSize != entry.storedSize))
+        {
+            std::cout << "Not a valid archive: " << fileName << " (entry " << i
+                      << " lies outside the file)" << std::endl;
+            mArchive.Close();
+            return false;
+        }
+
+        // The frame has to agree with the entry on what it decompresses to
+        size_t frameRawSize = 0;
+
+        if (entry.compression == PACK_COMPRESSION_LZ
+            && (entry.rawSize > MAX_RAW_SIZE
+                || !BlockDecompressedSize(data + entry.offset, (size_t) entry.storedSize, frameRawSize)
+                || frameRawSize != entry.rawSize))
+        {
+            std::cout << "Not a valid archive: " << fileName << " (entry " << i
+                      << " has a bad compressed size)" << std::endl;
+            mArchive.Close();
+            return false;
+        }
+    }
+
+    mEntries = entries;
+    mEntryCount = header->entryCount;
+    mNames = (const char*) (data + header->namesOffset);
+
+    return true;
+}
+
+void VirtualFileSystem::AddOverlayDirectory(const std::string& directory)
+{
+    std::string normalized = directory;
+
+    if (!normalized.empty() && normalized[normalized.size() - 1] != '/'
+        && normalized[normalized.size() - 1] != '\\')
+    {
+        normalized += '/';
+    }
+
+    mOverlayDirectories.push_back(normalized);
+}
+
+/*
+    Turn "./shaders\\vertexShader.glsl" into "shaders/vertexShader.glsl" so
+    every spelling of a path hashes the same.
+*/
+std::string VirtualFileSystem::NormalizePath(const std::string& path)
+{
+    std::string result = path;
+
+    for (size_t i = 0; i < result.size(); i++)
+    {
+        if (result[i] == '\\')
+        {
+            result[i] = '/';
+        }
+    }
+
+    while (result.compare(0, 2, "./") == 0)
+    {
+        result.erase(0, 2);
+    }
+
+    while (!result.empty() && result[0] == '/')
+    {
+        result.erase(0, 1);
+    }
+
+    return result;
+}
+
+// 64 bit FNV-1a
+uint64_t VirtualFileSystem::HashPath(const std::string& normalizedPath)
+{
+    uint64_t hash = 14695981039346656037ULL;
+
+    for (size_t i = 0; i < normalizedPath.size(); i++)
+    {
+        hash ^= (unsigned char) normalizedPath[i];
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+const PackEntry* VirtualFileSystem::FindEntry(const std::string& normalizedPath) const
+{
+    uint64_t hash = HashPath(normalizedPath);
+
+    uint32_t low = 0;
+    uint32_t high = mEntryCount;
+
+    while (low < high)
+    {
+        uint32_t middle = low + (high - low) / 2;
+
+        if (mEntries[middle].pathHash < hash)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+
+    if (low == mEntryCount || mEntries[low].pathHash != hash)
+    {
+        return nullptr;
+    }
+
+    // The packer refuses collisions, but make sure we got the right file
+    const PackEntry* entry = &mEntries[low];
+
+    if (entry->nameLength != normalizedPath.size()
+        || std::memcmp(mNames + entry->nameOffset, normalizedPath.data(), entry->nameLength) != 0)
+    {
+        return nullptr;
+    }
+
+    return entry;
+}
+
+bool VirtualFileSystem::ReadLooseFile(const std::string& normalizedPath,
+                                      std::vector<unsigned char>& contents) const
+{
+    for (size_t i = 0; i < mOverlayDirectories.size(); i++)
+    {
+        std::string fileName = mOverlayDirectories[i] + normalizedPath;
+        FILE* myFile = std::fopen(fileName.c_str(), "rb");
+
+        if (myFile == nullptr)
+        {
+            continue;
+        }
+
+        std::fseek(myFile, 0, SEEK_END);
+        long size = std::ftell(myFile);
+        std::fseek(myFile, 0, SEEK_SET);
+
+        contents.resize(size > 0 ? (size_t) size : 0);
+        size_t read = contents.empty() ? 0 : std::fread(contents.data(), 1, contents.size(), myFile);
+        std::fclose(myFile);
+
+        return read == contents.size();
+    }
+
+    return false;
+}
+
+bool VirtualFileSystem::Exists(const std::string& path) const
+{
+    std::string normalized = NormalizePath(path);
+
+    for (size_t i = 0; i < mOverlayDirectories.size(); i++)
+    {
+        FILE* myFile = std::fopen((mOverlayDirectories[i] + normalized).c_str(), "rb");
+
+        if (myFile != nullptr)
+        {
+            std::fclose(myFile);
+            return true;
+        }
+    }
+
+    return FindEntry(normalized) != nullptr;
+}
+
+bool VirtualFileSystem::ReadFile(const std::string& path, std::vector<unsigned char>& contents) const
+{
+    std::string normalized = NormalizePath(path);
+
+    if (ReadLooseFile(normalized, contents))
+    {
+        return true;
+    }
+
+    const PackEntry* entry = FindEntry(normalized);
+
+    if (entry == nullptr)
+    {
+        std::cout << "File not found: " << path << std::endl;
+        return false;
+    }
+
+    const unsigned char* stored = mArchive.GetData() + entry->offset;
+
+    switch (entry->compression)
+    {
+        case PACK_COMPRESSION_NONE:
+            contents.assign(stored, stored + entry->storedSize);
+            return true;
+
+        case PACK_COMPRESSION_LZ:
+            // Checked when mounting
+            contents.resize((size_t) entry->rawSize);
+
+            if (!BlockDecompress(stored, (size_t) entry->storedSize,
+                                 contents.data(), contents.size(), mThreadPool))
+            {
+                std::cout << "Corrupt compressed data in " << path << std::endl;
+                return false;
+            }
+
+            return true;
+
+        default:
+            std::cout << "Unsupported compression " << entry->compression
+                      << " for " << path << std::endl;
+            return false;
+    }
+}
+
+bool VirtualFileSystem::ReadText(const std::string& path, std::string& text) const
+{
+    std::vector<unsigned char> contents;
+
+    if (!ReadFile(path, contents))
+    {
+        return false;
+    }
+
+    text.assign(contents.begin(), contents.end());
+
+    return true;
+}
+
+bool VirtualFileSystem::GetView(const std::string& path, const unsigned char*& data, size_t& size) const
+{
+    // A loose file might shadow the archive, let ReadFile sort that out
+    if (!mOverlayDirectories.empty())
+    {
+        return false;
+    }
+
+    const PackEntry* entry = FindEntry(NormalizePath(path));
+
+    if (entry == nullptr || entry->compression != PACK_COMPRESSION_NONE)
+    {
+        return false;
+    }
+
+    data = mArchive.GetData() + entry->offset;
+    size = (size_t) entry->storedSize;
+
+    return true;
+}
@@ -0,0 +1,64 @@
+/*
+    benchcompare: compare a benchmark report against a stored baseline.
+
+    usage: benchcompare baseline.json current.json [tolerance [minimum_ms]]
+
+    Every metric of the baseline that the current report also has is
+    listed with its change. A metric regressed when it grew by more than
+    the tolerance (default 0.1, i.e. 10 %); times additionally need to grow
+    by minimum_ms (default 0.05) to count. Exits with 1 on a regression, so
+    it can gate a build.
+*/
+#include "BenchmarkReport.hpp"
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+
+int main(int argc, char* argv[])
+{
+    if (argc < 3)
+    {
+        std::cout << "usage: benchcompare baseline.json current.json [tolerance [minimum_ms]]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    double tolerance = argc > 3 ? std::atof(argv[3]) : 0.1;
+    double minimumMilliseconds = argc > 4 ? std::atof(argv[4]) : 0.05;
+
+    BenchmarkReport baseline;
+    BenchmarkReport current;
+
+    if (!LoadBenchmarkReport(argv[1], baseline) || !LoadBenchmarkReport(argv[2], current))
+    {
+        return EXIT_FAILURE;
+    }
+
+    std::vector<BenchmarkComparison> comparisons;
+    bool passed = CompareBenchmarkReports(baseline, current, tolerance, minimumMilliseconds, comparisons);
+    size_t regressions = 0;
+
+    for (size_t i = 0; i < comparisons.size(); i++)
+    {
+        const BenchmarkComparison& comparison = comparisons[i];
+        double change = comparison.baseline != 0.0
+                      ? (comparison.current - comparison.baseline) / comparison.baseline * 100.0 : 0.0;
+
+        std::cout << std::left << std::setw(30) << comparison.name << std::right << std::fixed
+                  << std::setprecision(3) << std::setw(12) << comparison.baseline
+                  << std::setw(12) << comparison.current
+                  << std::setprecision(1) << std::setw(9) << std::showpos << change << "%" << std::noshowpos
+                  << (comparison.regression ? "  REGRESSION" : "") << std::endl;
+
+        regressions += comparison.regression;
+    }
+
+    if (passed)
+    {
+        std::cout << "no regressions (" << comparisons.size() << " metrics)" << std::endl;
+        return EXIT_SUCCESS;
+    }
+
+    std::cout << regressions << " regression(s)" << std::endl;
+    return 1;
+}
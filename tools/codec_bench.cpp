@@ -0,0 +1,217 @@
+/*
+    codec_bench: compression ratio and throughput of the block codec.
+
+    usage: codec_bench [file...]
+
+    Without arguments a generated grid mesh (in the binary mesh format) is
+    used, so there is always something representative to measure. Hand
+    built malformed frames are checked to be rejected first.
+*/
+#include "BlockCodec.hpp"
+#include "MeshIO.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+static double Seconds(std::chrono::high_resolution_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+static std::vector<unsigned char> GridMeshFile(unsigned int size)
+{
+    Mesh3D mesh;
+    mesh.vertexData.clear();
+    mesh.indexBufferData.clear();
+
+    for (unsigned int y = 0; y <= size; y++)
+    {
+        for (unsigned int x = 0; x <= size; x++)
+        {
+            float u = (float) x / size;
+            float v = (float) y / size;
+
+            // position
+            mesh.vertexData.push_back(u - 0.5f);
+            mesh.vertexData.push_back(v - 0.5f);
+            mesh.vertexData.push_back(0.1f * u * v);
+            // color
+            mesh.vertexData.push_back(u);
+            mesh.vertexData.push_back(v);
+            mesh.vertexData.push_back(1.0f - u);
+        }
+    }
+
+    for (unsigned int y = 0; y < size; y++)
+    {
+        for (unsigned int x = 0; x < size; x++)
+        {
+            GLuint i = y * (size + 1) + x;
+            GLuint quad[6] = { i, i + 1, i + size + 1, i + 1, i + size + 2, i + size + 1 };
+            mesh.indexBufferData.insert(mesh.indexBufferData.end(), quad, quad + 6);
+        }
+    }
+
+    const char* fileName = "codec_bench_grid.mesh";
+    SaveMeshBinary(fileName, &mesh);
+
+    std::ifstream myFile(fileName, std::ios::binary);
+    std::stringstream contents;
+    contents << myFile.rdbuf();
+    std::string bytes = contents.str();
+    std::remove(fileName);
+
+    return std::vector<unsigned char>(bytes.begin(), bytes.end());
+}
+
+// A header, a block table and stored blocks of blockSize zero bytes
+static std::vector<unsigned char> MakeFrame(uint32_t blockSize, uint64_t rawSize, uint32_t blockCount)
+{
+    BlockFrameHeader header;
+    std::memcpy(header.magic, "LZB1", 4);
+    header.blockSize = blockSize;
+    header.rawSize = rawSize;
+    header.blockCount = blockCount;
+    header.reserved = 0;
+
+    std::vector<unsigned char> frame(sizeof(header) + blockCount * (sizeof(uint32_t) + blockSize), 0);
+    std::memcpy(frame.data(), &header, sizeof(header));
+
+    for (uint32_t i = 0; i < blockCount; i++)
+    {
+        uint32_t storedSize = blockSize | BLOCK_CODEC_STORED_FLAG;
+        std::memcpy(&frame[sizeof(header) + i * sizeof(uint32_t)], &storedSize, sizeof(storedSize));
+    }
+
+    return frame;
+}
+
+/*
+    Blocks are decoded in parallel, so a block past the output runs even
+    when an earlier one fails.
+
+    @return whether every malformed frame is refused without writing past
+    the output.
+*/
+static bool RejectsMalformedFrames(ThreadPool* threadPool)
+{
+    struct Case {
+        const char* name;
+        uint64_t rawSize;
+        uint32_t blockCount;
+    };
+
+    // 16 byte blocks
+    const Case cases[] = {
+        { "empty with blocks", 0, 2 },
+        { "too many blocks", 20, 3 },
+        { "too few blocks", 40, 2 },
+    };
+
+    bool ok = true;
+
+    for (const Case& test : cases)
+    {
+        std::vector<unsigned char> frame = MakeFrame(16, test.rawSize, test.blockCount);
+        // Room for every block, what lies past the output must stay untouched
+        std::vector<unsigned char> out((size_t) test.rawSize + 16 * test.blockCount, 0xab);
+        bool accepted = BlockDecompress(frame.data(), frame.size(), out.data(), (size_t) test.rawSize, threadPool);
+
+        if (accepted || std::count(out.begin() + (size_t) test.rawSize, out.end(), 0xab) != 16 * test.blockCount)
+        {
+            std::cout << "malformed frame accepted: " << test.name << std::endl;
+            ok = false;
+        }
+    }
+
+    return ok;
+}
+
+static void Benchmark(const std::string& name, const std::vector<unsigned char>& data,
+                      ThreadPool* threadPool)
+{
+    const int repeats = 20;
+    std::vector<unsigned char> frame;
+
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+    for (int i = 0; i < repeats; i++)
+    {
+        BlockCompress(data.data(), data.size(), frame);
+    }
+
+    double compressSeconds = Seconds(start) / repeats;
+
+    std::vector<unsigned char> decoded(data.size());
+
+    start = std::chrono::high_resolution_clock::now();
+
+    for (int i = 0; i < repeats; i++)
+    {
+        BlockDecompress(frame.data(), frame.size(), decoded.data(), decoded.size());
+    }
+
+    double decodeSeconds = Seconds(start) / repeats;
+
+    start = std::chrono::high_resolution_clock::now();
+
+    for (int i = 0; i < repeats; i++)
+    {
+        BlockDecompress(frame.data(), frame.size(), decoded.data(), decoded.size(), threadPool);
+    }
+
+    double parallelSeconds = Seconds(start) / repeats;
+
+    bool roundTrip = decoded == data;
+    double megabytes = data.size() / (1024.0 * 1024.0);
+
+    std::cout << name << "\n"
+              << "  size:             " << data.size() << " -> " << frame.size() << " bytes\n"
+              << "  ratio:            " << (double) data.size() / frame.size() << "\n"
+              << "  compress:         " << megabytes / compressSeconds << " MB/s\n"
+              << "  decode (1 thread):" << megabytes / decodeSeconds << " MB/s\n"
+              << "  decode (" << threadPool->GetWorkerCount() + 1 << " threads):"
+              << megabytes / parallelSeconds << " MB/s\n"
+              << "  round trip:       " << (roundTrip ? "ok" : "FAILED") << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    ThreadPool threadPool(ThreadPool::DefaultWorkerCount());
+
+    if (!RejectsMalformedFrames(&threadPool))
+    {
+        return EXIT_FAILURE;
+    }
+
+    std::cout << "malformed frames: rejected" << std::endl;
+
+    if (argc < 2)
+    {
+        Benchmark("generated 512x512 grid mesh", GridMeshFile(512), &threadPool);
+        return EXIT_SUCCESS;
+    }
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::ifstream myFile(argv[i], std::ios::binary);
+
+        if (!myFile.is_open())
+        {
+            std::cout << "Could not open " << argv[i] << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        std::stringstream contents;
+        contents << myFile.rdbuf();
+        std::string bytes = contents.str();
+
+        Benchmark(argv[i], std::vector<unsigned char>(bytes.begin(), bytes.end()), &threadPool);
+    }
+
+    return EXIT_SUCCESS;
+}
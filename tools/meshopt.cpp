@@ -0,0 +1,119 @@
+/*
+    meshopt: reorder a mesh for the vertex cache, overdraw and vertex fetch,
+    and build its level of detail chain and meshlets.
+
+    usage: meshopt [input.mesh [output.mesh]]
+
+    Prints the ACMR / ATVR after each stage and the triangles and error of
+    every level of detail. Without arguments a shuffled
+    grid mesh is optimized, so there is always something to compare. The
+    output defaults to overwriting the input.
+*/
+#include "MeshGenerator.hpp"
+#include "MeshIO.hpp"
+#include "MeshLOD.hpp"
+#include "MeshOptimizer.hpp"
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+
+static void Report(const char* stage, const Mesh3D& mesh, double milliseconds)
+{
+    size_t vertexCount = GetMeshVertexCount(&mesh);
+    VertexCacheStats stats = AnalyzeVertexCache(mesh.indexBufferData, vertexCount);
+
+    std::cout << std::left << std::setw(16) << stage << std::right << std::fixed
+              << "ACMR " << std::setprecision(3) << stats.acmr
+              << "  ATVR " << stats.atvr
+              << "  (" << std::setprecision(2) << milliseconds << " ms)" << std::endl;
+}
+
+static double Milliseconds(std::chrono::high_resolution_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+int main(int argc, char* argv[])
+{
+    Mesh3D mesh;
+
+    if (argc < 2)
+    {
+        GenerateGridMesh(&mesh, 200, true);
+        std::cout << "generated 200x200 grid mesh, shuffled triangles" << std::endl;
+    }
+    else if (!LoadMeshBinary(argv[1], &mesh))
+    {
+        return EXIT_FAILURE;
+    }
+
+    size_t vertexCount = GetMeshVertexCount(&mesh);
+
+    std::cout << vertexCount << " vertices, " << mesh.indexBufferData.size() / 3 << " triangles, cache size "
+              << DEFAULT_VERTEX_CACHE_SIZE << std::endl;
+
+    Report("input", mesh, 0.0);
+
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+    OptimizeVertexCache(mesh.indexBufferData, vertexCount);
+    Report("vertex cache", mesh, Milliseconds(start));
+
+    start = std::chrono::high_resolution_clock::now();
+    OptimizeOverdraw(mesh.indexBufferData, mesh.vertexData);
+    Report("overdraw", mesh, Milliseconds(start));
+
+    start = std::chrono::high_resolution_clock::now();
+    OptimizeVertexFetch(&mesh);
+    Report("vertex fetch", mesh, Milliseconds(start));
+
+    start = std::chrono::high_resolution_clock::now();
+    size_t lodCount = GenerateMeshLODs(&mesh);
+    double lodMilliseconds = Milliseconds(start);
+
+    std::cout << lodCount << " levels of detail (" << std::setprecision(2) << lodMilliseconds << " ms)" << std::endl;
+
+    for (size_t i = 0; i < mesh.mLODs.size(); i++)
+    {
+        const MeshLOD& lod = mesh.mLODs[i];
+        VertexCacheStats stats = AnalyzeVertexCache(
+            std::vector<GLuint>(mesh.indexBufferData.begin() + lod.firstIndex,
+                                mesh.indexBufferData.begin() + lod.firstIndex + lod.indexCount),
+            GetMeshVertexCount(&mesh));
+
+        std::cout << "  LOD " << i << ": " << std::setw(8) << lod.indexCount / 3 << " triangles"
+                  << "  error " << std::setprecision(5) << lod.error
+                  << "  ACMR " << std::setprecision(3) << stats.acmr << std::endl;
+    }
+
+    BuildMeshlets(&mesh);
+
+    if (!mesh.mMeshlets.empty())
+    {
+        size_t fullDetailIndices = mesh.mLODs.empty() ? mesh.indexBufferData.size() : mesh.mLODs[0].indexCount;
+
+        std::cout << mesh.mMeshlets.size() << " meshlets, " << std::setprecision(1)
+                  << (double) fullDetailIndices / 3 / mesh.mMeshlets.size()
+                  << " triangles each on average" << std::endl;
+    }
+
+    // BuildMeshStreams picks the index type, no GL needed
+    BuildMeshStreams(&mesh);
+    std::cout << "index buffer:   " << mesh.indexBufferData.size() * sizeof(GLuint) << " -> "
+              << mesh.mIndexStream.size() << " bytes ("
+              << (mesh.mIndexType == GL_UNSIGNED_SHORT ? "16" : "32") << " bit)" << std::endl;
+
+    if (argc >= 2)
+    {
+        const char* outputName = argc >= 3 ? argv[2] : argv[1];
+
+        if (!SaveMeshBinary(outputName, &mesh))
+        {
+            return EXIT_FAILURE;
+        }
+
+        std::cout << "wrote " << outputName << std::endl;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,295 @@
+/*
+    mipgen: build the mip chain of an image on the CPU and write it as a
+    texture file.
+
+    usage: mipgen [input.ppm|input.pam [output.tex]] [--kaiser] [--srgb] [--normal]
+                  [--bc1|--bc3|--bc5|--bc7 [--hq]]
+
+    Without an input a 2048x2048 test pattern is generated (a bumpy normal
+    map with --normal). Every filter is timed on one thread and on the
+    thread pool and reported in megapixels of input per second, then the
+    chain is built with the chosen filter and written (to mipgen.tex unless
+    an output is given).
+
+    With a block format the chain is also compressed, fast and high quality
+    each timed on one thread and on the pool (megapixels of the whole chain
+    per second) with the PSNR of the decoded chain, and written compressed
+    (high quality with --hq). --bc1 makes alpha below 128 transparent (the
+    color PSNR leaves those texels out), --bc5 keeps red and green, for
+    --normal.
+*/
+#include "ImageIO.hpp"
+#include "MipGenerator.hpp"
+#include "TextureCompressor.hpp"
+#include "TextureIO.hpp"
+#include "ThreadPool.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+static double Seconds(std::chrono::high_resolution_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+static unsigned char Byte(float value)
+{
+    return (unsigned char) (std::fmin(std::fmax(value, 0.0f), 1.0f) * 255.0f + 0.5f);
+}
+
+/* Checkers, gradients and fine stripes that alias badly with a poor filter. */
+static void TestPattern(unsigned int size, bool normalMap, std::vector<unsigned char>& rgba)
+{
+    rgba.resize((size_t) size * size * 4);
+
+    for (unsigned int y = 0; y < size; y++)
+    {
+        for (unsigned int x = 0; x < size; x++)
+        {
+            unsigned char* texel = &rgba[((size_t) y * size + x) * 4];
+            float u = (float) x / size;
+            float v = (float) y / size;
+
+            if (normalMap)
+            {
+                // Slopes of sin(a x) sin(a y)
+                float a = 40.0f;
+                float dx = a * std::cos(a * u) * std::sin(a * v) * 0.02f;
+                float dy = a * std::sin(a * u) * std::cos(a * v) * 0.02f;
+                float length = std::sqrt(dx * dx + dy * dy + 1.0f);
+
+                texel[0] = Byte(-dx / length * 0.5f + 0.5f);
+                texel[1] = Byte(-dy / length * 0.5f + 0.5f);
+                texel[2] = Byte(1.0f / length * 0.5f + 0.5f);
+                texel[3] = 255;
+            }
+            else
+            {
+                bool checker = ((x / 128) + (y / 128)) % 2 == 0;
+                bool stripe = (x / 2) % 2 == 0;
+
+                texel[0] = checker ? Byte(u) : 32;
+                texel[1] = v < 0.5f ? (stripe ? 255 : 0) : Byte(v);
+                texel[2] = checker ? 200 : Byte(1.0f - u);
+                texel[3] = Byte(0.5f + 0.5f * std::sin(u * 20.0f));
+            }
+        }
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    std::vector<std::string> files;
+    MipOptions options;
+    TextureFormat blockFormat = TEXTURE_FORMAT_RGBA8;
+    CompressionQuality quality = COMPRESSION_FAST;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string argument = argv[i];
+
+        if (argument == "--kaiser")
+        {
+            options.filter = MIP_FILTER_KAISER;
+        }
+        else if (argument == "--srgb")
+        {
+            options.srgb = true;
+        }
+        else if (argument == "--normal")
+        {
+            options.normalMap = true;
+        }
+        else if (argument == "--bc1")
+        {
+            blockFormat = TEXTURE_FORMAT_BC1;
+        }
+        else if (argument == "--bc3")
+        {
+            blockFormat = TEXTURE_FORMAT_BC3;
+        }
+        else if (argument == "--bc5")
+        {
+            blockFormat = TEXTURE_FORMAT_BC5;
+        }
+        else if (argument == "--bc7")
+        {
+            blockFormat = TEXTURE_FORMAT_BC7;
+        }
+        else if (argument == "--hq")
+        {
+            quality = COMPRESSION_HIGH;
+        }
+        else
+        {
+            files.push_back(argument);
+        }
+    }
+
+    if (options.srgb && options.normalMap)
+    {
+        std::cout << "A normal map is never sRGB" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    unsigned int width = 2048;
+    unsigned int height = 2048;
+    std::vector<unsigned char> rgba;
+
+    if (files.empty())
+    {
+        TestPattern(width, options.normalMap, rgba);
+        std::cout << "generated " << width << "x" << height << " test pattern" << std::endl;
+    }
+    else if (!LoadPPM(files[0], width, height, rgba))
+    {
+        return EXIT_FAILURE;
+    }
+
+    ThreadPool threadPool(ThreadPool::DefaultWorkerCount());
+    double megapixels = width * (double) height / 1e6;
+
+    const char* filterNames[] = { "box", "kaiser" };
+
+    for (int filter = MIP_FILTER_BOX; filter <= MIP_FILTER_KAISER; filter++)
+    {
+        for (int threaded = 0; threaded < 2; threaded++)
+        {
+            MipOptions timed = options;
+            timed.filter = (MipFilter) filter;
+            TextureData texture;
+
+            // Once to warm up, then for at least half a second
+            GenerateMips(rgba.data(), width, height, timed, threaded ? &threadPool : nullptr, texture);
+
+            unsigned int runs = 0;
+            std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+            while (runs < 3 || Seconds(start) < 0.5)
+            {
+                GenerateMips(rgba.data(), width, height, timed, threaded ? &threadPool : nullptr, texture);
+                runs++;
+            }
+
+            double seconds = Seconds(start);
+
+            std::cout << std::left << std::setw(8) << filterNames[filter]
+                      << std::setw(12) << (threaded ? "pool" : "1 thread") << std::right << std::fixed
+                      << std::setprecision(1) << std::setw(8) << megapixels * runs / seconds << " MP/s  ("
+                      << std::setprecision(2) << seconds / runs * 1000.0 << " ms)" << std::endl;
+        }
+    }
+
+    TextureData texture;
+    GenerateMips(rgba.data(), width, height, options, &threadPool, texture);
+
+    if (blockFormat != TEXTURE_FORMAT_RGBA8)
+    {
+        const char* qualityNames[] = { "fast", "hq" };
+        double chainMegapixels = 0.0;
+
+        for (size_t i = 0; i < texture.levels.size(); i++)
+        {
+            chainMegapixels += texture.levels[i].width * (double) texture.levels[i].height / 1e6;
+        }
+
+        TextureData compressed;
+
+        for (int timedQuality = COMPRESSION_FAST; timedQuality <= COMPRESSION_HIGH; timedQuality++)
+        {
+            for (int threaded = 0; threaded < 2; threaded++)
+            {
+                unsigned int runs = 0;
+                std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+                while (runs < 1 || Seconds(start) < 0.5)
+                {
+                    if (!CompressTexture(texture, blockFormat, (CompressionQuality) timedQuality,
+                                         threaded ? &threadPool : nullptr, compressed))
+                    {
+                        return EXIT_FAILURE;
+                    }
+
+                    runs++;
+                }
+
+                double seconds = Seconds(start);
+
+                std::cout << std::left << std::setw(8) << qualityNames[timedQuality]
+                          << std::setw(12) << (threaded ? "pool" : "1 thread") << std::right << std::fixed
+                          << std::setprecision(1) << std::setw(8) << chainMegapixels * runs / seconds << " MP/s  ("
+                          << std::setprecision(2) << seconds / runs * 1000.0 << " ms)" << std::endl;
+            }
+
+            // Every level counts by its texels
+            TextureData decoded;
+            DecompressTexture(compressed, &threadPool, decoded);
+
+            std::vector<unsigned char> original;
+            std::vector<unsigned char> result;
+
+            for (size_t i = 0; i < texture.levels.size(); i++)
+            {
+                original.insert(original.end(), texture.levels[i].data.begin(), texture.levels[i].data.end());
+                result.insert(result.end(), decoded.levels[i].data.begin(), decoded.levels[i].data.end());
+            }
+
+            size_t texels = original.size() / 4;
+
+            if (blockFormat == TEXTURE_FORMAT_BC5)
+            {
+                std::cout << std::left << std::setw(20) << qualityNames[timedQuality] << "rg " << ComputePSNR(original.data(), result.data(), texels, 3) << " dB" << std::endl;
+            }
+            else if (blockFormat == TEXTURE_FORMAT_BC1)
+            {
+                // Texels under alpha 128 decode to transparent black on
+                // purpose, their color is left out and only counted
+                std::vector<unsigned char> opaqueOriginal;
+                std::vector<unsigned char> opaqueResult;
+
+                for (size_t i = 0; i < texels; i++)
+                {
+                    if (original[i * 4 + 3] >= 128)
+                    {
+                        opaqueOriginal.insert(opaqueOriginal.end(), &original[i * 4], &original[i * 4] + 4);
+                        opaqueResult.insert(opaqueResult.end(), &result[i * 4], &result[i * 4] + 4);
+                    }
+                }
+
+                size_t opaqueTexels = opaqueOriginal.size() / 4;
+
+                std::cout << std::left << std::setw(20) << qualityNames[timedQuality] << "rgb " << ComputePSNR(opaqueOriginal.data(), opaqueResult.data(), opaqueTexels, 7) << " dB  alpha "
+                          << ComputePSNR(original.data(), result.data(), texels, 8) << " dB  ("
+                          << texels - opaqueTexels << " punch-through texels)" << std::endl;
+            }
+            else
+            {
+                std::cout << std::left << std::setw(20) << qualityNames[timedQuality] << "rgb " << ComputePSNR(original.data(), result.data(), texels, 7) << " dB  alpha "
+                          << ComputePSNR(original.data(), result.data(), texels, 8) << " dB" << std::endl;
+            }
+        }
+
+        if (!CompressTexture(texture, blockFormat, quality, &threadPool, compressed))
+        {
+            return EXIT_FAILURE;
+        }
+
+        texture = compressed;
+    }
+
+    std::string output = files.size() > 1 ? files[1] : "mipgen.tex";
+
+    if (!SaveTextureBinary(output, texture))
+    {
+        return EXIT_FAILURE;
+    }
+
+    std::cout << "wrote " << texture.levels.size() << " levels to " << output
+              << " (" << threadPool.GetWorkerCount() << " workers)" << std::endl;
+
+    return EXIT_SUCCESS;
+}
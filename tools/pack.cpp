@@ -0,0 +1,163 @@
+/*
+    pack: build a packed asset archive for the VirtualFileSystem.
+
+    usage: pack [-z] <output.pak> <file> [file...]
+
+    Files are stored under the path given on the command line, relative to
+    the directory the game is started from (e.g. shaders/vertexShader.glsl).
+    With -z, entries are compressed with the block codec whenever that
+    makes them smaller.
+*/
+#include "BlockCodec.hpp"
+#include "VirtualFileSystem.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+struct PackInput {
+    std::string path;
+    std::vector<unsigned char> data;
+    PackEntry entry;
+};
+
+static bool ByHash(const PackInput& a, const PackInput& b)
+{
+    return a.entry.pathHash < b.entry.pathHash;
+}
+
+static uint64_t AlignUp(uint64_t value, uint64_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+int main(int argc, char* argv[])
+{
+    bool compress = argc > 1 && std::strcmp(argv[1], "-z") == 0;
+    int firstArgument = compress ? 2 : 1;
+
+    if (argc - firstArgument < 2)
+    {
+        std::cout << "usage: pack [-z] <output.pak> <file> [file...]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const char* outputName = argv[firstArgument];
+    ThreadPool threadPool(ThreadPool::DefaultWorkerCount());
+
+    std::vector<PackInput> inputs(argc - firstArgument - 1);
+    std::string names = "";
+
+    for (int i = firstArgument + 1; i < argc; i++)
+    {
+        PackInput& input = inputs[i - firstArgument - 1];
+        input.path = VirtualFileSystem::NormalizePath(argv[i]);
+
+        std::ifstream myFile(argv[i], std::ios::binary);
+
+        if (!myFile.is_open())
+        {
+            std::cout << "Could not open " << argv[i] << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        std::stringstream contents;
+        contents << myFile.rdbuf();
+        std::string bytes = contents.str();
+        input.data.assign(bytes.begin(), bytes.end());
+
+        std::memset(&input.entry, 0, sizeof(PackEntry));
+        input.entry.pathHash = VirtualFileSystem::HashPath(input.path);
+        input.entry.storedSize = input.data.size();
+        input.entry.rawSize = input.data.size();
+        input.entry.nameOffset = (uint32_t) names.size();
+        input.entry.nameLength = (uint16_t) input.path.size();
+        input.entry.compression = PACK_COMPRESSION_NONE;
+
+        if (compress && !input.data.empty())
+        {
+            std::vector<unsigned char> frame;
+            BlockCompress(input.data.data(), input.data.size(), frame,
+                          BLOCK_CODEC_DEFAULT_BLOCK_SIZE, &threadPool);
+
+            if (frame.size() < input.data.size())
+            {
+                input.data.swap(frame);
+                input.entry.storedSize = input.data.size();
+                input.entry.compression = PACK_COMPRESSION_LZ;
+            }
+        }
+
+        names += input.path;
+    }
+
+    std::sort(inputs.begin(), inputs.end(), ByHash);
+
+    for (size_t i = 1; i < inputs.size(); i++)
+    {
+        if (inputs[i].entry.pathHash == inputs[i - 1].entry.pathHash)
+        {
+            std::cout << "Path hash collision (or duplicate): " << inputs[i - 1].path
+                      << " and " << inputs[i].path << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    PackHeader header;
+    std::memcpy(header.magic, "PAK1", 4);
+    header.version = PACK_VERSION;
+    header.entryCount = (uint32_t) inputs.size();
+    header.flags = 0;
+    header.entriesOffset = sizeof(PackHeader);
+    header.namesOffset = header.entriesOffset + inputs.size() * sizeof(PackEntry);
+
+    uint64_t offset = AlignUp(header.namesOffset + names.size(), 16);
+
+    for (size_t i = 0; i < inputs.size(); i++)
+    {
+        inputs[i].entry.offset = offset;
+        offset = AlignUp(offset + inputs[i].entry.storedSize, 16);
+    }
+
+    std::ofstream output(outputName, std::ios::binary);
+
+    if (!output.is_open())
+    {
+        std::cout << "Could not open " << outputName << " for writing" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    output.write((const char*) &header, sizeof(header));
+
+    for (size_t i = 0; i < inputs.size(); i++)
+    {
+        output.write((const char*) &inputs[i].entry, sizeof(PackEntry));
+    }
+
+    output.write(names.data(), names.size());
+
+    for (size_t i = 0; i < inputs.size(); i++)
+    {
+        const PackEntry& entry = inputs[i].entry;
+
+        // Padding up to the entry
+        std::vector<char> padding(entry.offset - (uint64_t) output.tellp(), 0);
+        output.write(padding.data(), padding.size());
+
+        output.write((const char*) inputs[i].data.data(), inputs[i].data.size());
+    }
+
+    if (!output.good())
+    {
+        std::cout << "Failed writing " << outputName << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::cout << "Packed " << inputs.size() << " files into " << outputName
+              << " (" << offset << " bytes)" << std::endl;
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,107 @@
+/*
+    softrender: draw a frame with the software reference rasterizer and
+    benchmark it.
+
+    usage: softrender [output.png|output.ppm [input.mesh]]
+
+    Without a mesh the demo scene of main.cpp is drawn: the default quad
+    with its model matrix, the default camera and the 1000x900 window, so
+    the output can be compared with a screenshot of the GPU path. Then a
+    dense sphere is drawn repeatedly and triangles and pixels per second are
+    reported, single threaded and on the thread pool.
+*/
+#include "Camera.hpp"
+#include "ImageIO.hpp"
+#include "MeshGenerator.hpp"
+#include "MeshIO.hpp"
+#include "SoftwareRasterizer.hpp"
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+
+namespace {
+    const unsigned int WIDTH = 1000;
+    const unsigned int HEIGHT = 900;
+    const int BENCHMARK_FRAMES = 20;
+
+    // Same as the clear color in PreDraw
+    const glm::vec4 CLEAR_COLOR(1.0f, 0.984f, 0.0f, 1.0f);
+}
+
+static void Benchmark(const char* label, const Mesh3D& mesh, const glm::mat4& model, const Camera& camera,
+                      ThreadPool* threadPool)
+{
+    SoftwareRasterizer rasterizer(WIDTH, HEIGHT, threadPool);
+    rasterizer.SetDepthTest(true);
+    rasterizer.SetBackfaceCulling(true);
+
+    glm::mat4 view = camera.GetViewMatrix();
+    glm::mat4 projection = camera.GetProjectionMatrix((float) WIDTH / (float) HEIGHT);
+
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+    for (int frame = 0; frame < BENCHMARK_FRAMES; frame++)
+    {
+        rasterizer.Clear(CLEAR_COLOR);
+        rasterizer.DrawMesh(&mesh, model, view, projection);
+        rasterizer.Flush();
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+    const RasterStats& stats = rasterizer.GetStats();
+
+    std::cout << std::left << std::setw(22) << label << std::right << std::fixed << std::setprecision(2)
+              << seconds * 1000.0 / BENCHMARK_FRAMES << " ms/frame  "
+              << stats.trianglesSubmitted / seconds / 1e6 << " Mtris/s  "
+              << stats.pixelsShaded / seconds / 1e6 << " Mpx/s  "
+              << "(setup " << stats.setupMilliseconds / BENCHMARK_FRAMES
+              << " ms, raster " << stats.rasterMilliseconds / BENCHMARK_FRAMES << " ms)" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    std::string outputFile = argc > 1 ? argv[1] : "softrender.png";
+
+    Mesh3D mesh;
+    Camera camera;
+
+    if (argc > 2 && !LoadMeshBinary(argv[2], &mesh))
+    {
+        return EXIT_FAILURE;
+    }
+
+    ThreadPool threadPool(ThreadPool::DefaultWorkerCount());
+
+    // The reference frame, with the render state of PreDraw
+    SoftwareRasterizer rasterizer(WIDTH, HEIGHT, &threadPool);
+    rasterizer.Clear(CLEAR_COLOR);
+    rasterizer.DrawMesh(&mesh, GetMeshModelMatrix(&mesh), camera.GetViewMatrix(),
+                        camera.GetProjectionMatrix((float) WIDTH / (float) HEIGHT));
+    rasterizer.Flush();
+
+    std::vector<unsigned char> pixels;
+    rasterizer.ReadPixels(pixels);
+
+    if (!SaveImage(outputFile, WIDTH, HEIGHT, pixels.data()))
+    {
+        return EXIT_FAILURE;
+    }
+
+    const RasterStats& stats = rasterizer.GetStats();
+    std::cout << "wrote " << outputFile << ": " << stats.trianglesRasterized << " triangles, "
+              << stats.pixelsShaded << " pixels" << std::endl;
+
+    // Throughput on a mesh that fills a good part of the screen
+    Mesh3D sphere;
+    GenerateSphereMesh(&sphere, 256, 512);
+    glm::mat4 model = GetMeshModelMatrix(&sphere);
+
+    std::cout << "sphere: " << sphere.indexBufferData.size() / 3 << " triangles, "
+              << threadPool.GetWorkerCount() << " worker threads" << std::endl;
+
+    Benchmark("single threaded", sphere, model, camera, nullptr);
+    Benchmark("thread pool", sphere, model, camera, &threadPool);
+
+    return EXIT_SUCCESS;
+}